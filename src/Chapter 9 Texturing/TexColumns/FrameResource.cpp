@@ -1,15 +1,16 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount)
+FrameResource::FrameResource(ID3D12Device* device, UINT objectCount, UINT instanceCount)
 {
     ThrowIfFailed(device->CreateCommandAllocator(
         D3D12_COMMAND_LIST_TYPE_DIRECT,
 		IID_PPV_ARGS(CmdListAlloc.GetAddressOf())));
 
   //  FrameCB = std::make_unique<UploadBuffer<FrameConstants>>(device, 1, true);
-    PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
-    MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, true);
-    ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
+    ObjectCB = std::make_unique<UploadBufferPool<ObjectConstants>>(device, ObjectChunkSize, true);
+    ObjectCB->Reserve(objectCount);
+    InstanceBuffer = std::make_unique<UploadBufferPool<InstanceData>>(device, InstanceChunkSize, false);
+    InstanceBuffer->Reserve(instanceCount);
 }
 
 FrameResource::~FrameResource()
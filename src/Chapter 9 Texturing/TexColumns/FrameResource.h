@@ -3,6 +3,7 @@
 #include "../../Common/d3dUtil.h"
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
+#include "../../Common/UploadBufferPool.h"
 
 struct ObjectConstants
 {
@@ -11,6 +12,32 @@ struct ObjectConstants
 	DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 };
 
+// Per-instance data read by the instanced vertex shader from a structured buffer.
+struct InstanceData
+{
+    DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
+    DirectX::XMFLOAT4X4 InvWorld = MathHelper::Identity4x4();
+    DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+    UINT MaterialIndex = 0;
+    UINT InstancePad0 = 0;
+    UINT InstancePad1 = 0;
+    UINT InstancePad2 = 0;
+};
+
+// Per-material entry of the bindless material table (gMaterialData).  The texture
+// indices point into the unbounded texture table, i.e. the persistent SRV heap region.
+struct MaterialData
+{
+    DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
+    DirectX::XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
+    float Roughness = 0.25f;
+    DirectX::XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
+    UINT DiffuseMapIndex = 0;
+    UINT NormalMapIndex = 0;
+    UINT DispMapIndex = 0;
+    UINT MaterialPad0 = 0;
+};
+
 struct PassConstants
 {
     DirectX::XMFLOAT4X4 View = MathHelper::Identity4x4();
@@ -66,7 +93,7 @@ struct FrameResource
 {
 public:
     
-    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount);
+    FrameResource(ID3D12Device* device, UINT objectCount, UINT instanceCount);
     FrameResource(const FrameResource& rhs) = delete;
     FrameResource& operator=(const FrameResource& rhs) = delete;
     ~FrameResource();
@@ -76,11 +103,21 @@ public:
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc;
 
     // We cannot update a cbuffer until the GPU is done processing the commands
-    // that reference it.  So each frame needs their own cbuffers.
+    // that reference it.  Pass and material constants are rewritten every frame, so
+    // they are suballocated from the app's UploadRing; these are this frame's copies.
    // std::unique_ptr<UploadBuffer<FrameConstants>> FrameCB = nullptr;
-    std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
-    std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
-    std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
+    D3D12_GPU_VIRTUAL_ADDRESS PassCBAddress = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS MaterialCBAddress = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS MaterialDataAddress = 0;
+
+    // Per-item data lives in chunked pools so new render items only append chunks.
+    // Call Reserve() on these when items are added; it never flushes or reallocates.
+    static const UINT ObjectChunkSize = 256;
+    static const UINT InstanceChunkSize = 1024;
+    std::unique_ptr<UploadBufferPool<ObjectConstants>> ObjectCB = nullptr;
+
+    // Instance data of every render item, grouped by instance batch.
+    std::unique_ptr<UploadBufferPool<InstanceData>> InstanceBuffer = nullptr;
 
     // Fence value to mark commands up to this fence point.  This lets us
     // check if these frame resources are still in use by the GPU.
@@ -15,12 +15,27 @@
     #define NUM_SPOT_LIGHTS 0
 #endif
 
+// Permutation switches (see ShaderPermutation.h).  Everything is on by default.
+#ifndef TESSELLATION
+    #define TESSELLATION 1
+#endif
+
+#ifndef DECAL
+    #define DECAL 1
+#endif
+
+#ifndef NORMAL_MAP
+    #define NORMAL_MAP 1
+#endif
+
 // Include structures and functions for lighting.
 #include "LightingUtil.hlsl"
 
+#ifndef BINDLESS
 Texture2D    gDiffuseMap : register(t0);
 Texture2D    gNormalMap : register(t1);
 Texture2D    gDispMap : register(t2);
+#endif
 Texture2D gDecalDispMap : register(t3);
 
 SamplerState gsamPointWrap        : register(s0);
@@ -77,6 +92,50 @@ cbuffer cbPass : register(b1)
     // are spot lights for a maximum of MaxLights per object.
 };
 
+#ifdef BINDLESS
+// Bindless mode: every texture lives in one unbounded table over the persistent part
+// of the SRV heap, and materials are looked up by index instead of bound per draw.
+struct MaterialData
+{
+    float4   DiffuseAlbedo;
+    float3   FresnelR0;
+    float    Roughness;
+    float4x4 MatTransform;
+    uint     DiffuseMapIndex;
+    uint     NormalMapIndex;
+    uint     DispMapIndex;
+    uint     MatPad0;
+};
+
+Texture2D gTextureTable[] : register(t0, space2);
+StructuredBuffer<MaterialData> gMaterialData : register(t1, space1);
+
+// Filled by LoadMaterial() so the code below reads the material the same way in
+// both modes.  The index is the same for a whole draw, so no NonUniformResourceIndex.
+static float4   gDiffuseAlbedo;
+static float3   gFresnelR0;
+static float    gRoughness;
+static float4x4 gMatTransform;
+static uint     gDiffuseMapIndex;
+static uint     gNormalMapIndex;
+static uint     gDispMapIndex;
+
+#define gDiffuseMap gTextureTable[gDiffuseMapIndex]
+#define gNormalMap  gTextureTable[gNormalMapIndex]
+#define gDispMap    gTextureTable[gDispMapIndex]
+
+void LoadMaterial(uint matIndex)
+{
+    MaterialData matData = gMaterialData[matIndex];
+    gDiffuseAlbedo = matData.DiffuseAlbedo;
+    gFresnelR0 = matData.FresnelR0;
+    gRoughness = matData.Roughness;
+    gMatTransform = matData.MatTransform;
+    gDiffuseMapIndex = matData.DiffuseMapIndex;
+    gNormalMapIndex = matData.NormalMapIndex;
+    gDispMapIndex = matData.DispMapIndex;
+}
+#else
 cbuffer cbMaterial : register(b2)
 {
 	float4   gDiffuseAlbedo;
@@ -84,6 +143,27 @@ cbuffer cbMaterial : register(b2)
     float    gRoughness;
 	float4x4 gMatTransform;
 };
+#endif
+
+// Per-instance data for the instanced path (InstancedVS).  SV_InstanceID always
+// starts at 0, so the batch offset into the buffer is passed as a root constant.
+struct InstanceData
+{
+    float4x4 World;
+    float4x4 InvWorld;
+    float4x4 TexTransform;
+    uint     MaterialIndex;
+    uint     InstPad0;
+    uint     InstPad1;
+    uint     InstPad2;
+};
+
+StructuredBuffer<InstanceData> gInstanceData : register(t0, space1);
+
+cbuffer cbInstancing : register(b3)
+{
+    uint gBaseInstance;
+};
 
 struct VertexIn
 {
@@ -109,6 +189,7 @@ struct VertexOutHSIn
     float3 NormalW : NORMAL;
     float2 TexC : TEXCOORD0;
     float3 TanW : TANGENT;
+    nointerpolation uint MatIndex : MATINDEX;
 };
 
 // HS -> DS (Control Point Data) -    VertexOutHSIn
@@ -118,6 +199,7 @@ struct HSOutDSIn
     float3 NormalW : NORMAL;
     float2 TexC : TEXCOORD0;
     float3 TanW : TANGENT;
+    nointerpolation uint MatIndex : MATINDEX;
 };
 
 // HS Constant Function Output
@@ -138,6 +220,7 @@ struct DSOutPSIn
     float2 decalUV : TEXCOORD1; //  
     float3 TanW : TANGENT; //    ( normal mapping)
     bool isInDecal : ISINDECAL;
+    nointerpolation uint MatIndex : MATINDEX;
 };
 
 
@@ -158,23 +241,131 @@ float3 NormalSampleToWorldSpace(float3 normalMapSample, float3 unitNormalW, floa
 
     return bumpedNormalW;
 }
-VertexOutHSIn VS(VertexIn vin)
+VertexOutHSIn TransformVertex(VertexIn vin, float4x4 world, float4x4 texTransform)
 {
     VertexOutHSIn vout;
 
     //  , ,    
-    vout.PosW = mul(float4(vin.PosL, 1.0f), gWorld).xyz;
+    vout.PosW = mul(float4(vin.PosL, 1.0f), world).xyz;
     //  /  gWorld ( uniform scale).
     //   non-uniform scale,  -   ( (float3x3)gInvWorld).
     //      gWorld.
-    vout.NormalW = normalize(mul(vin.NormalL, (float3x3) gWorld));
-    vout.TanW = normalize(mul(vin.Tan, (float3x3) gWorld));
+    vout.NormalW = normalize(mul(vin.NormalL, (float3x3) world));
+    vout.TanW = normalize(mul(vin.Tan, (float3x3) world));
 
     //    (     )
-    float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
+    float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), texTransform);
     vout.TexC = mul(texC, gMatTransform).xy;
+    vout.MatIndex = 0;
+
+    return vout;
+}
+
+// Decal displacement and the clip space position of a surface point.  Runs per domain
+// point with tessellation and per vertex without it.
+DSOutPSIn FinishSurfacePoint(DSOutPSIn dout)
+{
+    dout.decalUV = float2(0.0f, 0.0f);
+    dout.isInDecal = false;
+
+#if DECAL
+    // --- 2.       ---
+    float distToDecalCenter = distance(dout.PosW, decalPosition);
+    float decalInfluence = smoothstep(DecalFalloffRadius, DecalRadius, distToDecalCenter);
+     // --- 3.  ,     ---
+    float finalDisplacementOffset = 0.0f; //    
+    
+    
+    if (decalInfluence > 0.0f) //      
+    {
+        // --- 3a.  UV    ---
+        //       
+        float4 decalClipPos = mul(float4(dout.PosW, 1.0f), decalViewProj);
+
+        //   (  )
+        //  small epsilon     
+        decalClipPos.xyz /= (decalClipPos.w + 1e-6f);
+
+        //  Clip Space [-1, 1]  UV [0, 1]
+        // (Y , ..  UV  0 )
+        float2 decalUV = float2(decalClipPos.x * 0.5f + 0.5f, decalClipPos.y * -0.5f + 0.5f);
+
+        // --- 3b.     (  UV   [0,1]) ---
+        // Clamp UVs   saturate,      
+        decalUV = saturate(decalUV); //  UV  [0, 1]
+
+        //  :          XY
+        //    (decalClipPos.z)     (, [0, 1]  )
+        //     , .. decalInfluence    ,
+        //        .
+        // if(all(decalUV >= 0) && all(decalUV <= 1) && decalClipPos.z >= 0 && decalClipPos.z <= 1) { ... }
+        float2 texC = mul(float4(dout.TexC, 0.0f, 1.0f), decalTranslation).xy;
+        dout.decalUV = texC;
+        float decalDispValue = gDecalDispMap.SampleLevel(gsamLinearWrap, texC, 0.0f).r;
+        // --- 3c.    ---
+        // (decalDispValue - 0.5f)  0.5 -  
+        //          ( )
+        finalDisplacementOffset = (decalDispValue - 0.5f) * gDisplacementScale * decalInfluence;
+
+        //      
+        dout.PosW += finalDisplacementOffset * dout.NormalW;
+        dout.isInDecal = true;
+    }
+    else
+    {
+        dout.isInDecal = false;
+    }
+    
+#endif
+
+    // 4.  / ( ,    )
+    //    (    )
+    dout.NormalW = normalize(dout.NormalW);
+    dout.TanW = normalize(dout.TanW);
+  
+    // 5.      Clip Space
+    dout.PosH = mul(float4(dout.PosW, 1.0f), gViewProj);
+
+    //     
+    return dout;
+}
+
+#if TESSELLATION
+#define VS_OUTPUT VertexOutHSIn
+#else
+#define VS_OUTPUT DSOutPSIn
+#endif
 
+// Without tessellation the vertex shader also does the domain shader's work.
+VS_OUTPUT FinishVertex(VertexOutHSIn vout)
+{
+#if TESSELLATION
     return vout;
+#else
+    DSOutPSIn dout = (DSOutPSIn)0;
+    dout.PosW = vout.PosW;
+    dout.NormalW = vout.NormalW;
+    dout.TexC = vout.TexC;
+    dout.TanW = vout.TanW;
+    dout.MatIndex = vout.MatIndex;
+    return FinishSurfacePoint(dout);
+#endif
+}
+
+VS_OUTPUT VS(VertexIn vin)
+{
+    return FinishVertex(TransformVertex(vin, gWorld, gTexTransform));
+}
+
+VS_OUTPUT InstancedVS(VertexIn vin, uint instanceID : SV_InstanceID)
+{
+    InstanceData instData = gInstanceData[gBaseInstance + instanceID];
+#ifdef BINDLESS
+    LoadMaterial(instData.MaterialIndex);
+#endif
+    VertexOutHSIn vout = TransformVertex(vin, instData.World, instData.TexTransform);
+    vout.MatIndex = instData.MaterialIndex;
+    return FinishVertex(vout);
 }
 
 float exponential_interpolation_exp(float a, float b, float alpha)
@@ -247,6 +438,7 @@ HSOutDSIn HSMain(InputPatch<VertexOutHSIn, 3> patch, uint i : SV_OutputControlPo
     hout.NormalW = patch[i].NormalW;
     hout.TexC = patch[i].TexC;
     hout.TanW = patch[i].TanW;
+    hout.MatIndex = patch[i].MatIndex;
 
     return hout;
 }
@@ -259,70 +451,16 @@ DSOutPSIn DSMain(PatchTess patchTessConstants,
                  float3 domainLoc : SV_DomainLocation, //   (u, v, w)
                  const OutputPatch<HSOutDSIn, 3> patch)
 {
-    DSOutPSIn dout;
+    DSOutPSIn dout = (DSOutPSIn)0;
 
     // 1.    
     dout.PosW = domainLoc.x * patch[0].PosW + domainLoc.y * patch[1].PosW + domainLoc.z * patch[2].PosW;
     dout.NormalW = domainLoc.x * patch[0].NormalW + domainLoc.y * patch[1].NormalW + domainLoc.z * patch[2].NormalW;
     dout.TexC = domainLoc.x * patch[0].TexC + domainLoc.y * patch[1].TexC + domainLoc.z * patch[2].TexC;
     dout.TanW = domainLoc.x * patch[0].TanW + domainLoc.y * patch[1].TanW + domainLoc.z * patch[2].TanW;
-    // --- 2.       ---
-    float distToDecalCenter = distance(dout.PosW, decalPosition);
-    float decalInfluence = smoothstep(DecalFalloffRadius, DecalRadius, distToDecalCenter);
-     // --- 3.  ,     ---
-    float finalDisplacementOffset = 0.0f; //    
-    
-    
-    if (decalInfluence > 0.0f) //      
-    {
-        // --- 3a.  UV    ---
-        //       
-        float4 decalClipPos = mul(float4(dout.PosW, 1.0f), decalViewProj);
-
-        //   (  )
-        //  small epsilon     
-        decalClipPos.xyz /= (decalClipPos.w + 1e-6f);
-
-        //  Clip Space [-1, 1]  UV [0, 1]
-        // (Y , ..  UV  0 )
-        float2 decalUV = float2(decalClipPos.x * 0.5f + 0.5f, decalClipPos.y * -0.5f + 0.5f);
+    dout.MatIndex = patch[0].MatIndex;
 
-        // --- 3b.     (  UV   [0,1]) ---
-        // Clamp UVs   saturate,      
-        decalUV = saturate(decalUV); //  UV  [0, 1]
-
-        //  :          XY
-        //    (decalClipPos.z)     (, [0, 1]  )
-        //     , .. decalInfluence    ,
-        //        .
-        // if(all(decalUV >= 0) && all(decalUV <= 1) && decalClipPos.z >= 0 && decalClipPos.z <= 1) { ... }
-        float2 texC = mul(float4(dout.TexC, 0.0f, 1.0f), decalTranslation).xy;
-        dout.decalUV = texC;
-        float decalDispValue = gDecalDispMap.SampleLevel(gsamLinearWrap, texC, 0.0f).r;
-        // --- 3c.    ---
-        // (decalDispValue - 0.5f)  0.5 -  
-        //          ( )
-        finalDisplacementOffset = (decalDispValue - 0.5f) * gDisplacementScale * decalInfluence;
-
-        //      
-        dout.PosW += finalDisplacementOffset * dout.NormalW;
-        dout.isInDecal = true;
-    }
-    else
-    {
-        dout.isInDecal = false;
-    }
-    
-    // 4.  / ( ,    )
-    //    (    )
-    dout.NormalW = normalize(dout.NormalW);
-    dout.TanW = normalize(dout.TanW);
-  
-    // 5.      Clip Space
-    dout.PosH = mul(float4(dout.PosW, 1.0f), gViewProj);
-
-    //     
-    return dout;
+    return FinishSurfacePoint(dout);
 }
 
 
@@ -331,17 +469,24 @@ DSOutPSIn DSMain(PatchTess patchTessConstants,
 //   
 float4 PS(DSOutPSIn pin) : SV_Target
 {
+#ifdef BINDLESS
+    LoadMaterial(pin.MatIndex);
+#endif
     float4 diffuseAlbedo;
-    float3 normalSample;
+    float3 normalSample = float3(0.5f, 0.5f, 1.0f);
+#if DECAL
     if (pin.isInDecal)
     {
         diffuseAlbedo = gDecalDispMap.Sample(gsamAnisotropicWrap, pin.decalUV) * gDiffuseAlbedo;
         normalSample = gDecalDispMap.Sample(gsamAnisotropicWrap, pin.decalUV).rgb; //   
     }
     else
+#endif
     {
         diffuseAlbedo = gDiffuseMap.Sample(gsamAnisotropicWrap, pin.TexC) * gDiffuseAlbedo;
+#if NORMAL_MAP
     normalSample = gNormalMap.Sample(gsamAnisotropicWrap, pin.TexC).rgb; //   
+#endif
         
     }
     if (diffuseAlbedo.r == 1 && diffuseAlbedo.g == 1 && diffuseAlbedo.b == 1)
@@ -353,7 +498,12 @@ float4 PS(DSOutPSIn pin) : SV_Target
     //  normal map,  
     //  NormalSampleToWorldSpace   pin.NormalW  pin.TanW  DS
  
+#if NORMAL_MAP || DECAL
     float3 bumpedNormalW = NormalSampleToWorldSpace(normalSample, pin.NormalW, pin.TanW); //   
+#else
+    // A flat normal map sample maps to the interpolated normal.
+    float3 bumpedNormalW = pin.NormalW;
+#endif
 
     //       DS,    :
     bumpedNormalW = normalize(bumpedNormalW); //  bumpedNormalW  
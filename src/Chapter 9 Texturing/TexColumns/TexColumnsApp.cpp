@@ -1,12 +1,32 @@
 //***************************************************************************************
 // TexColumnsApp.cpp by Frank Luna (C) 2015 All Rights Reserved.
 //***************************************************************************************
+#include "../../Common/AllocationTracker.h"
 #include "../../Common/Camera.h"
+#include "../../Common/CameraPath.h"
+#include "../../Common/Counters.h"
 #include "../../Common/d3dApp.h"
+#include "../../Common/DescriptorHeap.h"
+#include "../../Common/FrameArena.h"
+#include "../../Common/FrameStats.h"
+#include "../../Common/InputLog.h"
 #include "../../Common/MathHelper.h"
+#include "../../Common/MemoryReport.h"
+#include "../../Common/Profiler.h"
+#include "../../Common/PsoCache.h"
 #include "../../Common/UploadBuffer.h"
+#include "../../Common/UploadManager.h"
+#include "../../Common/UploadRing.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/ShaderPermutation.h"
+#include "../../Common/TraceExporter.h"
+#include "../../Common/TransformBatch.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
+#include <map>
+#include <tuple>
 #include "FrameResource.h"
 #include <iostream>
 #include "imgui_impl_dx12.h"
@@ -22,6 +42,50 @@ using namespace DirectX::PackedVector;
 
 const int gNumFrameResources = 3;
 
+// Number of render items processed by one job when updating object constant buffers.
+const UINT gObjectCBChunkSize = 256;
+
+// Initial block size of each per-thread frame arena for transient CPU data.  An arena
+// that outgrows it is resized on its next reset.
+const size_t gFrameArenaBlockSize = 256 * 1024;
+
+// Size of the upload ring shared by the frames in flight for per-frame constants.
+const UINT64 gUploadRingSize = 4 * 1024 * 1024;
+
+// Nothing reads the system memory copies of the geometry after upload, so by default
+// they are freed.  Keep them for CPU side work such as picking.
+const bool gKeepGeometryCpuCopies = false;
+
+// Regions of the shader visible CBV/SRV/UAV heap.
+const UINT gPersistentDescriptorCount = 1024;
+const UINT gTransientDescriptorCount = 1024;
+
+// Lights set up in mMainPassCB; must match the defaults in Default.hlsl.
+const UINT gNumDirLights = 0;
+const UINT gNumPointLights = 1;
+const UINT gNumSpotLights = 0;
+
+// Zero-allocation test (-zeroalloc on the command line): after the warm-up frames,
+// every checked frame must get by without a heap allocation.  Needs a build with
+// ALLOCATION_TRACKING_ENABLED, i.e. the Profile configuration.
+const UINT gZeroAllocationWarmupFrames = 300;
+const UINT gZeroAllocationCheckFrames = 600;
+
+// Benchmark mode (-benchmark <path file> [-frames n] on the command line): the camera
+// follows the path one fixed step per frame, whatever the real frame time, and the
+// measured frames are written to Stats\benchmark_<path name>.csv.  The warm-up frames
+// hold the start of the path while shaders and uploads settle.
+const double gBenchmarkStepSeconds = 1.0 / 60.0;
+const UINT gBenchmarkWarmupFrames = 120;
+
+// Stress objects (-objects <n> on the command line) are laid out on a square grid with
+// this spacing.
+const float gStressObjectSpacing = 4.0f;
+
+// Static frames in a row before the app idles.  Gives ImGui time to finish its hover
+// and fade animations and every frame resource time to receive the last change.
+const UINT gIdleAfterStaticFrames = 30;
+
 // Lightweight structure stores parameters to draw a shape.  This will
 // vary from app-to-app.
 struct RenderItem
@@ -29,10 +93,10 @@ struct RenderItem
 	RenderItem() = default;
     RenderItem(const RenderItem& rhs) = delete;
 
-    // World matrix of the shape that describes the object's local space
-    // relative to the world space, which defines the position, orientation,
-    // and scale of the object in the world.
-    XMFLOAT4X4 World = MathHelper::Identity4x4();
+    // Position, orientation, and scale of the object in the world.  Expanded to the
+    // world matrix in UpdateObjectCBs, so moving an object is just a write to
+    // Transform.Translation followed by NumFramesDirty = gNumFrameResources.
+    TransformTRS Transform;
 
 	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 
@@ -45,6 +109,10 @@ struct RenderItem
 	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
 	UINT ObjCBIndex = -1;
 
+	// Index into the per-frame instance buffer.  Assigned by BuildInstanceBatches so
+	// that the instances of one batch are contiguous.
+	UINT InstanceIndex = 0;
+
 	Material* Mat = nullptr;
 	MeshGeometry* Geo = nullptr;
 
@@ -56,8 +124,85 @@ struct RenderItem
     UINT StartIndexLocation = 0;
     int BaseVertexLocation = 0;
 	std::string Name;
+
+	// Object space bounds of the submesh, used to pick the shader permutation.
+	BoundingBox Bounds;
+
+	// Cheapest shader permutation that draws the item correctly this frame.
+	ShaderPermutationKey Permutation;
+
+	// Index of the InstanceBatch the item belongs to.
+	UINT InstanceBatchIndex = 0;
+
+	// Stress object (-objects): counts as moved every frame, so its constants are
+	// rewritten like a dynamic object's, but it is never drawn.
+	bool StressOnly = false;
+};
+
+// Render items that share geometry, submesh and material, drawn with one
+// DrawIndexedInstanced call.
+struct InstanceBatch
+{
+	MeshGeometry* Geo = nullptr;
+	Material* Mat = nullptr;
+
+	UINT IndexCount = 0;
+	UINT StartIndexLocation = 0;
+	int BaseVertexLocation = 0;
+
+	// Range of the batch in the per-frame instance buffer.
+	UINT StartInstance = 0;
+	UINT InstanceCount = 0;
+
+	// Merge of the permutations of all instances.
+	ShaderPermutationKey Permutation;
 };
 
+// Writes data[i] to slot slotOf(items[i]) of pool.  Consecutive slots are merged
+// into one bulk streaming write.
+template<typename T, typename ItemAlloc, typename SlotFunc>
+static void WriteSlotRuns(UploadBufferPool<T>& pool, const std::vector<RenderItem*, ItemAlloc>& items, const T* data, SlotFunc slotOf)
+{
+	size_t runStart = 0;
+	while(runStart < items.size())
+	{
+		size_t runEnd = runStart + 1;
+		while(runEnd < items.size() && slotOf(items[runEnd]) == slotOf(items[runEnd - 1]) + 1)
+			++runEnd;
+
+		pool.CopyData(slotOf(items[runStart]), &data[runStart], (UINT)(runEnd - runStart));
+		runStart = runEnd;
+	}
+}
+
+static UINT DrawOrderOf(const RenderItem* ri)
+{
+	return ri->ObjCBIndex;
+}
+
+static UINT DrawOrderOf(const InstanceBatch* batch)
+{
+	return batch->StartInstance;
+}
+
+// Orders draws by permutation so the PSO changes as rarely as possible, and by their
+// original order within a permutation.  std::stable_sort would allocate a buffer.
+template<typename T, typename Alloc>
+static void SortByPermutation(std::vector<T*, Alloc>& draws)
+{
+	std::sort(draws.begin(), draws.end(), [](const T* a, const T* b)
+	{
+		if(a->Permutation == b->Permutation)
+			return DrawOrderOf(a) < DrawOrderOf(b);
+		return a->Permutation < b->Permutation;
+	});
+}
+
+static D3D_PRIMITIVE_TOPOLOGY PermutationTopology(const ShaderPermutationKey& key)
+{
+	return key.Has(ShaderFeatureTessellation) ? D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST : D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+}
+
 class TexColumnsApp : public D3DApp
 {
 public:
@@ -68,6 +213,26 @@ public:
 
     virtual bool Initialize()override;
 
+	// Runs the zero-allocation check and quits with exit code 1 if a checked frame
+	// allocated, 0 otherwise.  Returns false, after reporting why, if allocation
+	// tracking is compiled out.
+	bool EnableZeroAllocationTest();
+
+	// Plays the camera path in pathFile for frameCount measured frames, or once through
+	// if frameCount is 0, then writes the results and quits.
+	void EnableBenchmark(const std::string& pathFile, UINT frameCount);
+
+	// Records the input from the first frame on and writes it to file on exit.
+	void EnableInputRecording(const std::string& file);
+
+	// Replays the input recorded in file from the first frame on, then writes the
+	// frame times and quits.
+	void EnableInputReplay(const std::string& file);
+
+	// Adds count objects that are updated every frame but not drawn, to measure how
+	// UpdateObjectCBs scales with the number of dirty objects.
+	void EnableStressObjects(UINT count);
+
 private:
     virtual void OnResize()override;
     virtual void Update(const GameTimer& gt)override;
@@ -81,27 +246,66 @@ private:
 	virtual void MoveUpDown(float step)override;
 	void OnKeyPressed(const GameTimer& gt, WPARAM key) override;
 	void OnKeyReleased(const GameTimer& gt, WPARAM key) override;
-	std::wstring GetCamSpeed() override;
+	float GetCamSpeed() override;
+	bool CanIdle() override;
+	void UpdateIdleState(bool valuesChanged);
 	void UpdateCamera(const GameTimer& gt);
 	void AnimateMaterials(const GameTimer& gt);
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMaterialCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
+	void UpdateFrameStats(const GameTimer& gt);
 	
 	void LoadAllTextures();
-	void LoadTexture(const std::string& name);
+	void LoadTexture(const std::string& name, ID3DBlob* fileData);
+	static std::wstring TextureFilename(const std::string& name);
     void BuildRootSignature();
 	void BuildDescriptorHeaps();
+	void CreateTextureSrv(const std::string& name);
+	void ShowTexturePreview();
     void BuildShadersAndInputLayout();
     void BuildShapeGeometry();
     void BuildPSOs();
     void BuildFrameResources();
-	void CreateMaterial(std::string _name, int _CBIndex, int _SRVDiffIndex, int _SRVNMapIndex, int _SRVDispIndex, XMFLOAT4 _DiffuseAlbedo, XMFLOAT3 _FresnelR0, float _Roughness);
+	void GrowFrameResources();
+	void CreateMaterial(std::string _name, int _SRVDiffIndex, int _SRVNMapIndex, int _SRVDispIndex, XMFLOAT4 _DiffuseAlbedo, XMFLOAT3 _FresnelR0, float _Roughness);
     void BuildMaterials();
-	void RenderCustomMesh(std::string unique_name, std::string meshname, std::string materialName, XMMATRIX Scale, XMMATRIX Rotation, XMMATRIX Translation);
+	void RenderCustomMesh(std::string unique_name, std::string meshname, std::string materialName, const TransformTRS& transform);
 	void BuildCustomMeshGeometry(std::string name, UINT& meshVertexOffset, UINT& meshIndexOffset, UINT& prevVertSize, UINT& prevIndSize, std::vector<Vertex>& vertices, std::vector<std::uint16_t>& indices, MeshGeometry* Geo);
     void BuildRenderItems();
+	void BuildStressRenderItems();
     void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+	MemoryReport BuildMemoryReport()const;
+	std::string BuildAllocationReport()const;
+	void UpdateZeroAllocationTest();
+	bool StartBenchmark();
+	void UpdateBenchmark();
+	void FinishMeasuredRun(const std::string& kind, const std::string& sourceFile, const FrameStats& stats);
+	void ApplyKeyPressed(WPARAM key);
+	void ApplyKeyReleased(WPARAM key);
+	void ApplyMouseMove(WPARAM btnState, int x, int y);
+	void ApplyInputEvent(const InputEvent& event);
+	void RecordInput(InputEventType type, std::uint64_t code, int x = 0, int y = 0);
+	void BuildRecordedValues();
+	bool SyncRecordedValues();
+	bool StartInputReplay();
+	void UpdateInputReplay();
+	bool SaveInputRecording();
+	void BuildInstanceBatches();
+	void DrawInstanceBatches(ID3D12GraphicsCommandList* cmdList);
+	void DrawBindless(ID3D12GraphicsCommandList* cmdList);
+
+	enum class DrawPath
+	{
+		Standard,
+		Instanced,
+		Bindless,
+		Count
+	};
+	void SelectPermutations();
+	void BuildPermutationPSOs();
+	ID3D12PipelineState* GetPermutationPSO(const ShaderPermutationKey& key, DrawPath path, bool solid);
+	void BindPermutation(ID3D12GraphicsCommandList* cmdList, const ShaderPermutationKey& key, DrawPath path);
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
 
@@ -109,21 +313,39 @@ private:
 	std::unordered_map<std::string, unsigned int>ObjectsMeshCount;
     std::vector<std::unique_ptr<FrameResource>> mFrameResources;
     FrameResource* mCurrFrameResource = nullptr;
+	std::unique_ptr<UploadRing> mUploadRing;
     int mCurrFrameResourceIndex = 0;
+
+	// Textures and geometry are uploaded on a copy queue; frames wait for it on the GPU.
+	std::unique_ptr<UploadManager> mUploadManager;
 	//
 	std::unordered_map<std::string, int>TexOffsets;
+	// SRV heap index of the decal texture, bound by every draw path.
+	int mDecalSrvIndex = 0;
+	// Texture and mip shown in the UI preview, through a transient SRV.
+	std::string mPreviewTexture;
+	int mPreviewMip = 0;
 	//
     UINT mCbvSrvDescriptorSize = 0;
 
     ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
+	std::uint64_t mRootSignatureHash = 0;
 
-	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
+	// Every PSO comes from mPsoCache, which dedups equal descriptions and persists
+	// them in a pipeline library.  mBasePso holds the state they all share.
+	std::unique_ptr<PsoCache> mPsoCache;
+	GraphicsPsoBuilder mBasePso;
+
+	std::unique_ptr<DescriptorHeap> mSrvHeap;
 
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
 	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
 	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
-	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
+
+	// The PSO each draw path starts a frame with, per fill mode (solid, wireframe).
+	// Owned by mPsoCache.
+	ID3D12PipelineState* mDrawPathPSOs[(int)DrawPath::Count][2] = {};
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
  
@@ -133,6 +355,86 @@ private:
 	// Render items divided by PSO.
 	std::vector<RenderItem*> mOpaqueRitems;
 
+	// Number of StressOnly items in mAllRitems.
+	UINT mStressObjectCount = 0;
+
+	// mOpaqueRitems grouped for the instanced path.  Rebuilt when items are added.
+	std::vector<InstanceBatch> mInstanceBatches;
+	bool mInstanceBatchesDirty = true;
+	bool mInstancingEnabled = true;
+
+	// Bindless mode: textures come from one unbounded table and materials from a
+	// structured buffer, so a draw only sets its base instance root constant.  The
+	// unbounded table needs resource binding tier 2; on tier 1 the root signature
+	// leaves it out and bindless stays off.
+	bool mBindlessSupported = false;
+	bool mBindlessEnabled = false;
+
+	// Shader permutations: every draw uses the cheapest variant that is correct for
+	// it.  Variant PSOs are built from mBasePso at load (BuildPermutationPSOs).
+	bool mPermutationsEnabled = true;
+	std::unordered_map<std::uint64_t, ID3D12PipelineState*> mPermutationPSOs;
+	ShaderPermutationKey mBoundPermutation;
+	bool mPermutationBound = false;
+
+	// Cost of one profiler zone, measured at startup, and the zones shown in the
+	// profiler panel.
+	double mProfilerOverheadNs = 0.0;
+	std::vector<ProfileZone> mProfileZones;
+
+	// Chrome trace captures of the profiler zones, written to Traces\.
+	TraceExporter mTraceExporter;
+	UINT mTraceCaptureCount = 0;
+
+	// Frame time distribution and stutters, attributed to the main thread's zones.
+	FrameStats mFrameStats;
+	std::vector<std::uint64_t> mFrameStatsCursors;
+	std::vector<ProfileZone> mFrameZones;
+	std::vector<FrameStageTime> mStageTimes;
+	std::vector<OpenStageZone> mStageStack;
+	bool mCaptureTraceOnStutter = false;
+	UINT mFrameStatsCsvCount = 0;
+
+	// Signaled when the frame resource being reused is free again.
+	HANDLE mFrameResourceEvent = nullptr;
+
+	bool mZeroAllocationTest = false;
+
+	// Benchmark playback, null unless running one.
+	std::string mBenchmarkPathFile;
+	UINT mBenchmarkFrameCount = 0;
+	std::unique_ptr<CameraPathPlayback> mBenchmark;
+	std::unique_ptr<FrameStats> mBenchmarkStats;
+
+	// Input recording and replay, both from the first frame.  mInputFrame counts
+	// Updates; input applied before Update n, or by the UI during it, is stamped n.
+	std::uint32_t mInputFrame = 0;
+	std::string mInputRecordFile;
+	bool mRecordingInput = false;
+	InputLog mInputLog;
+	std::string mInputReplayFile;
+	std::unique_ptr<InputReplay> mInputReplay;
+	std::unique_ptr<FrameStats> mReplayStats;
+
+	// UI values that change what is drawn, recorded as Value events by their index.
+	struct RecordedValue
+	{
+		void* Value;
+		std::uint8_t Size;
+		unsigned char Last[InputEvent::MaxValueSize];
+	};
+	std::vector<RecordedValue> mRecordedValues;
+
+	// Keyframes recorded from the UI for benchmark paths, saved to Paths\.
+	CameraPath mRecordedPath;
+	float mRecordedKeySeconds = 2.0f;
+	UINT mRecordedPathCount = 0;
+	std::string mLastSavedPath;
+	std::vector<AllocationCallSite> mAllocationCallSites;
+
+	// Transient CPU data of the frame being built: draw order, per-job scratch.
+	FrameArena mFrameArena{ (std::uint32_t)gNumFrameResources, gFrameArenaBlockSize };
+
     PassConstants mMainPassCB;
 
 	XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
@@ -146,8 +448,50 @@ private:
     POINT mLastMousePos;
 
 	bool isFillModeSolid = true;
+
+	// Present waits for vblank when set.  mFrameCap (0 = off) drives mFrameLimiter.
+	bool mVSync = true;
+	int mFrameCap = 0;
+
+	// Idle mode: once nothing has changed for gIdleAfterStaticFrames frames, Run()
+	// stops updating and drawing until input arrives.
+	bool mIdleWhenStatic = true;
+	UINT mStaticFrames = 0;
+	XMFLOAT4X4 mIdleView = MathHelper::Identity4x4();
+	XMFLOAT4X4 mIdleProj = MathHelper::Identity4x4();
+	std::atomic<UINT> mDirtyObjectCount{ 0 };
+	bool mMaterialsDirty = false;
 };
 
+// Value after name on the command line, e.g. "600" for "-frames 600", or empty if name
+// is absent.  Values with spaces can be quoted.
+static std::string CommandLineValue(const char* cmdLine, const char* name)
+{
+	const char* found = std::strstr(cmdLine, name);
+	if(found == nullptr)
+		return std::string();
+
+	const char* begin = found + std::strlen(name);
+	while(*begin == ' ' || *begin == '\t')
+		++begin;
+
+	const char* end = nullptr;
+	if(*begin == '"')
+	{
+		++begin;
+		end = std::strchr(begin, '"');
+		if(end == nullptr)
+			end = begin + std::strlen(begin);
+	}
+	else
+	{
+		end = begin;
+		while(*end != '\0' && *end != ' ' && *end != '\t')
+			++end;
+	}
+	return std::string(begin, end);
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
     PSTR cmdLine, int showCmd)
 {
@@ -159,6 +503,20 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
     try
     {
         TexColumnsApp theApp(hInstance);
+        if(std::strstr(cmdLine, "-zeroalloc") != nullptr && !theApp.EnableZeroAllocationTest())
+            return 1;
+        std::string benchmarkPath = CommandLineValue(cmdLine, "-benchmark");
+        if(!benchmarkPath.empty())
+            theApp.EnableBenchmark(benchmarkPath, (UINT)std::strtoul(CommandLineValue(cmdLine, "-frames").c_str(), nullptr, 10));
+        std::string recordFile = CommandLineValue(cmdLine, "-record");
+        if(!recordFile.empty())
+            theApp.EnableInputRecording(recordFile);
+        std::string replayFile = CommandLineValue(cmdLine, "-replay");
+        if(!replayFile.empty())
+            theApp.EnableInputReplay(replayFile);
+        std::string stressObjects = CommandLineValue(cmdLine, "-objects");
+        if(!stressObjects.empty())
+            theApp.EnableStressObjects((UINT)std::strtoul(stressObjects.c_str(), nullptr, 10));
         if(!theApp.Initialize())
             return 0;
 
@@ -182,6 +540,16 @@ TexColumnsApp::~TexColumnsApp()
 
     if(md3dDevice != nullptr)
         FlushCommandQueue();
+
+	if(mFrameResourceEvent != nullptr)
+		CloseHandle(mFrameResourceEvent);
+
+	if(mRecordingInput)
+		SaveInputRecording();
+
+	// Keeps the PSOs created this run (including permutations) for the next one.
+	if(mPsoCache != nullptr)
+		mPsoCache->Save();
 }
 void TexColumnsApp::MoveBackFwd(float step) {
 	XMFLOAT3 newPos;
@@ -220,9 +588,11 @@ bool TexColumnsApp::Initialize()
     if(!D3DApp::Initialize())
         return false;
 
+	mUploadManager = std::make_unique<UploadManager>(md3dDevice.Get());
 
-    // Reset the command list to prep for initialization commands.
-    ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
+	mFrameResourceEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+	if(mFrameResourceEvent == nullptr)
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
 
     // Get the increment size of a descriptor in this heap type.  This is hardware specific, 
 	// so we have to query this information.
@@ -238,9 +608,28 @@ bool TexColumnsApp::Initialize()
     BuildPSOs();
     BuildRenderItems();
     BuildFrameResources();
+	BuildPermutationPSOs();
+
+	if(!gKeepGeometryCpuCopies)
+	{
+		for(auto& kv : mGeometries)
+			kv.second->DisposeCpuCopies();
+	}
 
 	// INITIALIZE IMGUI ////////////////////
 	IMGUI_CHECKVERSION();
+
+	// ImGui allocates with malloc, past the operator new the tracker replaces.
+	ImGui::SetAllocatorFunctions([](size_t size, void*)
+	{
+		AllocationTracker::RecordAllocation(size);
+		return std::malloc(size);
+	}, [](void* p, void*)
+	{
+		if(p != nullptr)
+			AllocationTracker::RecordFree();
+		std::free(p);
+	});
 	ImGui::CreateContext();
 	ImGui::StyleColorsDark();
 	ImGuiIO& io = ImGui::GetIO();
@@ -253,20 +642,43 @@ bool TexColumnsApp::Initialize()
 	init_info.NumFramesInFlight = gNumFrameResources;
 	init_info.RTVFormat = DXGI_FORMAT_R8G8B8A8_UNORM; // Or your render target format.
 	init_info.DSVFormat = DXGI_FORMAT_UNKNOWN;
-	init_info.SrvDescriptorHeap = mSrvDescriptorHeap.Get();
-	init_info.LegacySingleSrvCpuDescriptor = mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-	init_info.LegacySingleSrvGpuDescriptor = mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+	// ImGui allocates its font atlas SRV from the persistent region like any texture.
+	init_info.UserData = mSrvHeap.get();
+	init_info.SrvDescriptorHeap = mSrvHeap->Heap();
+	init_info.SrvDescriptorAllocFn = [](ImGui_ImplDX12_InitInfo* info, D3D12_CPU_DESCRIPTOR_HANDLE* outCpuHandle, D3D12_GPU_DESCRIPTOR_HANDLE* outGpuHandle)
+	{
+		auto heap = static_cast<DescriptorHeap*>(info->UserData);
+		UINT index = heap->AllocatePersistent();
+		*outCpuHandle = heap->CpuHandle(index);
+		*outGpuHandle = heap->GpuHandle(index);
+	};
+	init_info.SrvDescriptorFreeFn = [](ImGui_ImplDX12_InitInfo* info, D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle, D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle)
+	{
+		auto heap = static_cast<DescriptorHeap*>(info->UserData);
+		heap->FreePersistent(heap->IndexOf(cpuHandle));
+	};
 	ImGui_ImplWin32_Init(mhMainWnd);
 	ImGui_ImplDX12_Init(&init_info);
 	////////////////////////////////////////
 	
-    // Execute the initialization commands.
-    ThrowIfFailed(mCommandList->Close());
-    ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-    mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+	// Start the remaining uploads without waiting for them.  The first frame that
+	// reads them waits for the copy queue on the GPU (see Draw).
+	mUploadManager->Submit();
+
+	std::cout << "Memory after load:\n" << BuildMemoryReport().ToString();
 
-    // Wait until initialization is complete.
-    FlushCommandQueue();
+	mProfilerOverheadNs = Profiler::MeasureZoneOverheadNs();
+	std::cout << "Profiler zone overhead: " << mProfilerOverheadNs << " ns\n";
+
+	if(mZeroAllocationTest)
+		AllocationTracker::BeginZeroAllocationCheck(gZeroAllocationWarmupFrames);
+	if(!mBenchmarkPathFile.empty() && !StartBenchmark())
+		return false;
+
+	BuildRecordedValues();
+	mRecordingInput = !mInputRecordFile.empty();
+	if(!mInputReplayFile.empty() && !StartInputReplay())
+		return false;
     return true;
 }
  
@@ -281,6 +693,21 @@ void TexColumnsApp::OnResize()
 
 void TexColumnsApp::Update(const GameTimer& gt)
 {
+	PROFILE_ZONE("Update");
+
+	mTraceExporter.Tick();
+	UpdateFrameStats(gt);
+	if(mZeroAllocationTest)
+		UpdateZeroAllocationTest();
+	if(mBenchmark != nullptr)
+		UpdateBenchmark();
+	if(mInputReplay != nullptr)
+		UpdateInputReplay();
+
+	// A replay recorded on tier 2 hardware can turn bindless on.
+	if(!mBindlessSupported)
+		mBindlessEnabled = false;
+
 	__m128 headpos;
 	headpos.m128_f32[0] = 0;
 	headpos.m128_f32[1] = 0;
@@ -347,30 +774,49 @@ void TexColumnsApp::Update(const GameTimer& gt)
     // If not, wait until the GPU has completed commands up to this fence point.
     if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
     {
-        HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
+		PROFILE_ZONE("WaitForFrameResource");
+        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, mFrameResourceEvent));
+        WaitForSingleObject(mFrameResourceEvent, INFINITE);
     }
 
+	// Nothing from the last use of this frame index is referenced any more.
+	mFrameArena.BeginFrame(mCurrFrameResourceIndex);
+
+	// Every frame the GPU has finished gives its upload ring space and transient
+	// descriptors back.
+	mUploadRing->ReleaseCompleted(mFence->GetCompletedValue());
+	mSrvHeap->ReleaseCompleted(mFence->GetCompletedValue());
+	mUploadManager->ReleaseCompleted();
+
 
 	// === ImGui Setup ===
-	ImGui_ImplDX12_NewFrame();
-	ImGui_ImplWin32_NewFrame();
-	ImGui::NewFrame();
+	{
+		PROFILE_ZONE("ImGuiNewFrame");
+		ImGui_ImplDX12_NewFrame();
+		ImGui_ImplWin32_NewFrame();
+		ImGui::NewFrame();
+	}
 	ImGui::Begin("Settings");
 	
 	UpdateMainPassCB(gt);
 	AnimateMaterials(gt);
+	if(mInstanceBatchesDirty)
+		BuildInstanceBatches();
+	SelectPermutations();
 	UpdateObjectCBs(gt);
 	UpdateMaterialCBs(gt);
 
 	ImGui::End();
+
+	bool valuesChanged = SyncRecordedValues();
+	UpdateIdleState(valuesChanged);
+	mInputFrame++;
 }
 
 void TexColumnsApp::Draw(const GameTimer& gt)
 {
-	
+	PROFILE_ZONE("Draw");
+
     auto cmdListAlloc = mCurrFrameResource->CmdListAlloc;
 
     // Reuse the memory associated with command recording.
@@ -379,12 +825,8 @@ void TexColumnsApp::Draw(const GameTimer& gt)
 
     // A command list can be reset after it has been added to the command queue via ExecuteCommandList.
     // Reusing the command list reuses memory.
-	if (isFillModeSolid)
-	{
-		ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["solid"].Get()));
-	}
-	else 
-		ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["wireframe"].Get()));
+	DrawPath drawPath = mBindlessEnabled ? DrawPath::Bindless : mInstancingEnabled ? DrawPath::Instanced : DrawPath::Standard;
+	ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mDrawPathPSOs[(int)drawPath][isFillModeSolid ? 0 : 1]));
     mCommandList->RSSetViewports(1, &mScreenViewport);
     mCommandList->RSSetScissorRects(1, &mScissorRect);
 
@@ -399,20 +841,29 @@ void TexColumnsApp::Draw(const GameTimer& gt)
     // Specify the buffers we are going to render to.
     mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
 
-	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
+	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvHeap->Heap() };
 	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
 	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
-	auto passCB = mCurrFrameResource->PassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(5, passCB->GetGPUVirtualAddress());
+	mPermutationBound = false;
 
-	
-	
-    DrawRenderItems(mCommandList.Get(), mOpaqueRitems);
+	mCommandList->SetGraphicsRootConstantBufferView(5, mCurrFrameResource->PassCBAddress);
+	Counters::Add(CounterRootParameterSets);
+	Counters::Add(CounterRootCbvBinds);
 
-	ImGui::Render();
-	ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), mCommandList.Get());
+	if(mBindlessEnabled)
+		DrawBindless(mCommandList.Get());
+	else if(mInstancingEnabled)
+		DrawInstanceBatches(mCommandList.Get());
+	else
+		DrawRenderItems(mCommandList.Get(), mOpaqueRitems);
+
+	{
+		PROFILE_ZONE("ImGuiRender");
+		ImGui::Render();
+		ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), mCommandList.Get());
+	}
 
 
 
@@ -429,16 +880,24 @@ void TexColumnsApp::Draw(const GameTimer& gt)
     // Done recording commands.
     ThrowIfFailed(mCommandList->Close());
 
+	// Resources still being copied are only read once the copy queue is done with them.
+	mUploadManager->InsertWait(mCommandQueue.Get());
+
     // Add the command list to the queue for execution.
     ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
     mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
     // Swap the back and front buffers
-    ThrowIfFailed(mSwapChain->Present(1, 0));
+	{
+		PROFILE_ZONE("Present");
+		ThrowIfFailed(mSwapChain->Present(mVSync ? 1 : 0, 0));
+	}
 	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
 
     // Advance the fence value to mark commands up to this fence point.
     mCurrFrameResource->Fence = ++mCurrentFence;
+	mUploadRing->FinishFrame(mCurrentFence);
+	mSrvHeap->FinishFrame(mCurrentFence);
 
     // Add an instruction to the command queue to set a new fence point. 
     // Because we are on the GPU timeline, the new fence point won't be 
@@ -448,6 +907,10 @@ void TexColumnsApp::Draw(const GameTimer& gt)
 
 void TexColumnsApp::OnMouseDown(WPARAM btnState, int x, int y)
 {
+	if(mBenchmark != nullptr || mInputReplay != nullptr)
+		return;
+
+	RecordInput(InputEventType::MouseDown, btnState, x, y);
     mLastMousePos.x = x;
     mLastMousePos.y = y;
 
@@ -461,33 +924,56 @@ void TexColumnsApp::OnMouseUp(WPARAM btnState, int x, int y)
 
 void TexColumnsApp::OnMouseMove(WPARAM btnState, int x, int y)
 {
+	// The benchmark path or the replayed input drives the camera.
+	if(mBenchmark != nullptr || mInputReplay != nullptr)
+		return;
+
 	if (!ImGui::GetIO().WantCaptureMouse)
 	{
-		if ((btnState & MK_LBUTTON) != 0)
-		{
-			// Make each pixel correspond to a quarter of a degree.
-			float dx = XMConvertToRadians(0.25f * static_cast<float>(x - mLastMousePos.x));
-			float dy = XMConvertToRadians(0.25f * static_cast<float>(y - mLastMousePos.y));
+		RecordInput(InputEventType::MouseMove, btnState, x, y);
+		ApplyMouseMove(btnState, x, y);
+	}
+	
+}
+
+void TexColumnsApp::ApplyMouseMove(WPARAM btnState, int x, int y)
+{
+	if ((btnState & MK_LBUTTON) != 0)
+	{
+		// Make each pixel correspond to a quarter of a degree.
+		float dx = XMConvertToRadians(0.25f * static_cast<float>(x - mLastMousePos.x));
+		float dy = XMConvertToRadians(0.25f * static_cast<float>(y - mLastMousePos.y));
 
-			// Update angles based on input to orbit camera around box.
+		// Update angles based on input to orbit camera around box.
 
-			cam.YawPitch(dx, -dy);
+		cam.YawPitch(dx, -dy);
 
-		}
-		mLastMousePos.x = x;
-		mLastMousePos.y = y;
 	}
-	
+	mLastMousePos.x = x;
+	mLastMousePos.y = y;
 }
 
  
 void TexColumnsApp::OnKeyPressed(const GameTimer& gt, WPARAM key)
 {
-	if (GET_WHEEL_DELTA_WPARAM(key) > 0 && !ImGui::GetIO().WantCaptureMouse)
+	if(mBenchmark != nullptr || mInputReplay != nullptr)
+		return;
+
+	// Over the UI the wheel scrolls it instead of changing the camera speed.
+	if (GET_WHEEL_DELTA_WPARAM(key) != 0 && ImGui::GetIO().WantCaptureMouse)
+		return;
+
+	RecordInput(InputEventType::KeyDown, key);
+	ApplyKeyPressed(key);
+}
+
+void TexColumnsApp::ApplyKeyPressed(WPARAM key)
+{
+	if (GET_WHEEL_DELTA_WPARAM(key) > 0)
 	{
 		cam.IncreaseSpeed(0.05);
 	}
-	else if (GET_WHEEL_DELTA_WPARAM(key) < 0 && !ImGui::GetIO().WantCaptureMouse)
+	else if (GET_WHEEL_DELTA_WPARAM(key) < 0)
 	{
 		cam.IncreaseSpeed(-0.05);
 	}
@@ -519,7 +1005,15 @@ void TexColumnsApp::OnKeyPressed(const GameTimer& gt, WPARAM key)
 
 void TexColumnsApp::OnKeyReleased(const GameTimer& gt, WPARAM key)
 {
-	
+	if(mBenchmark != nullptr || mInputReplay != nullptr)
+		return;
+
+	RecordInput(InputEventType::KeyUp, key);
+	ApplyKeyReleased(key);
+}
+
+void TexColumnsApp::ApplyKeyReleased(WPARAM key)
+{
 	switch (key)
 	{
 	case VK_SHIFT:
@@ -528,9 +1022,9 @@ void TexColumnsApp::OnKeyReleased(const GameTimer& gt, WPARAM key)
 	}
 }
 
-std::wstring TexColumnsApp::GetCamSpeed()
+float TexColumnsApp::GetCamSpeed()
 {
-	return std::to_wstring(cam.GetSpeed());
+	return cam.GetSpeed();
 }
  
 void TexColumnsApp::UpdateCamera(const GameTimer& gt)
@@ -561,60 +1055,194 @@ void TexColumnsApp::AnimateMaterials(const GameTimer& gt)
 
 void TexColumnsApp::UpdateObjectCBs(const GameTimer& gt)
 {
-	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
+	PROFILE_ZONE("UpdateObjectCBs");
 
-	for(auto& e : mAllRitems)
+	// Every render item owns its own ObjCBIndex and InstanceIndex slot, so each chunk writes straight
+	// into its part of the mapped upload buffer without any synchronization.
+	mDirtyObjectCount.store(0, std::memory_order_relaxed);
+
+	// Named so the chunks can refer to it; capturing only this keeps it inside
+	// std::function's small buffer, so the dispatch does not allocate.
+	JobSystem::RangeFunc updateChunk = [this](std::uint32_t begin, std::uint32_t end)
 	{
-		// Only update the cbuffer data if the constants have changed.  
-		// This needs to be tracked per frame resource.
-		if(e->NumFramesDirty > 0)
+		PROFILE_ZONE("ObjectCBChunk");
+
+		auto currObjectCB = mCurrFrameResource->ObjectCB.get();
+		auto currInstanceBuffer = mCurrFrameResource->InstanceBuffer.get();
+
+		// Gather the dirty items of this chunk so the matrix math runs as one batch.
+		// The scratch arrays live in this worker's frame arena.
+		LinearArena& arena = mFrameArena.Local();
+		ArenaVector<RenderItem*> dirty{ ArenaAllocator<RenderItem*>(arena) };
+		ArenaVector<TransformTRS> transforms{ ArenaAllocator<TransformTRS>(arena) };
+		ArenaVector<XMFLOAT4X4> world{ ArenaAllocator<XMFLOAT4X4>(arena) };
+		ArenaVector<XMFLOAT4X4> invWorld{ ArenaAllocator<XMFLOAT4X4>(arena) };
+		ArenaVector<XMFLOAT4X4> texTransform{ ArenaAllocator<XMFLOAT4X4>(arena) };
+		ArenaVector<ObjectConstants> objConstants{ ArenaAllocator<ObjectConstants>(arena) };
+		ArenaVector<InstanceData> instData{ ArenaAllocator<InstanceData>(arena) };
+
+		dirty.reserve(end - begin);
+		transforms.reserve(end - begin);
+		texTransform.reserve(end - begin);
+
+		for(std::uint32_t i = begin; i < end; ++i)
 		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
+			auto& e = mAllRitems[i];
+			if(e->StressOnly)
+				e->NumFramesDirty = gNumFrameResources;
 
+			// Only update the cbuffer data if the constants have changed.  
+			// This needs to be tracked per frame resource.
+			if(e->NumFramesDirty > 0)
+			{
+				dirty.push_back(e.get());
+				transforms.push_back(e->Transform);
+				texTransform.push_back(e->TexTransform);
+			}
+		}
 
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-			XMStoreFloat4x4(&objConstants.InvWorld,MathHelper::InverseTranspose(world));
-			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+		if(dirty.empty())
+			return;
+		Counters::Add(CounterDirtyObjects, dirty.size());
+		mDirtyObjectCount.fetch_add((UINT)dirty.size(), std::memory_order_relaxed);
+
+		world.resize(transforms.size());
+		invWorld.resize(transforms.size());
+		TransformBatch::ExpandTRS(transforms.data(), world.data(), invWorld.data(), transforms.size());
+		TransformBatch::Transpose(world.data(), world.data(), world.size());
+		TransformBatch::Transpose(texTransform.data(), texTransform.data(), texTransform.size());
+
+		// Everything is staged in ordinary memory first; the upload heap is write-combined
+		// and only receives whole elements through streaming stores.
+		objConstants.resize(dirty.size());
+		instData.resize(dirty.size());
+		for(size_t i = 0; i < dirty.size(); ++i)
+		{
+			objConstants[i].World = world[i];
+			objConstants[i].InvWorld = invWorld[i];
+			objConstants[i].TexTransform = texTransform[i];
 
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
+			// Both paths are kept up to date so instancing can be toggled at any time.
+			instData[i].World = world[i];
+			instData[i].InvWorld = invWorld[i];
+			instData[i].TexTransform = texTransform[i];
+			instData[i].MaterialIndex = dirty[i]->Mat->MatCBIndex;
 
 			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
+			dirty[i]->NumFramesDirty--;
 		}
-	}
+
+		WriteSlotRuns(*currObjectCB, dirty, objConstants.data(), [](const RenderItem* ri) { return ri->ObjCBIndex; });
+		WriteSlotRuns(*currInstanceBuffer, dirty, instData.data(), [](const RenderItem* ri) { return ri->InstanceIndex; });
+	};
+
+	JobCounter counter;
+	mJobSystem.Dispatch((UINT)mAllRitems.size(), gObjectCBChunkSize, updateChunk, counter);
+	mJobSystem.Wait(counter);
 }
 
 void TexColumnsApp::UpdateMaterialCBs(const GameTimer& gt)
 {
-	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
+	PROFILE_ZONE("UpdateMaterialCBs");
+
+	// The ring hands out fresh memory every frame, so all materials are written
+	// each frame instead of tracking NumFramesDirty per frame resource.
+	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+	auto currMaterialCB = mUploadRing->AllocateConstants<MaterialConstants>((UINT)mMaterials.size());
+	mCurrFrameResource->MaterialCBAddress = currMaterialCB.GpuAddress;
+
+	mMaterialsDirty = false;
 	for(auto& e : mMaterials)
 	{
-		
-		// Only update the cbuffer data if the constants have changed.  If the cbuffer
-		// data changes, it needs to be updated for each FrameResource.
 		Material* mat = e.second.get();
+		XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
+
+		// Nothing needs NumFramesDirty for the upload, but it still tells idle
+		// detection that the material changed recently.
 		if(mat->NumFramesDirty > 0)
 		{
-			XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
+			mat->NumFramesDirty--;
+			mMaterialsDirty = true;
+		}
+
+		MaterialConstants matConstants;
+		matConstants.DiffuseAlbedo = mat->DiffuseAlbedo;
+		matConstants.FresnelR0 = mat->FresnelR0;
+		matConstants.Roughness = mat->Roughness;
+		XMStoreFloat4x4(&matConstants.MatTransform, XMMatrixTranspose(matTransform));
 
-			MaterialConstants matConstants;
-			matConstants.DiffuseAlbedo = mat->DiffuseAlbedo;
-			matConstants.FresnelR0 = mat->FresnelR0;
-			matConstants.Roughness = mat->Roughness;
-			XMStoreFloat4x4(&matConstants.MatTransform, XMMatrixTranspose(matTransform));
+		StreamCopy(currMaterialCB.CpuAddress + mat->MatCBIndex*matCBByteSize, &matConstants, sizeof(MaterialConstants));
+	}
 
-			currMaterialCB->CopyData(mat->MatCBIndex, matConstants);
+	if(mBindlessEnabled)
+	{
+		// Bindless material table: same constants plus the texture indices, tightly
+		// packed for the structured buffer.
+		auto currMaterialData = mUploadRing->Allocate(mMaterials.size() * sizeof(MaterialData));
+		mCurrFrameResource->MaterialDataAddress = currMaterialData.GpuAddress;
 
-			// Next FrameResource need to be updated too.
-			mat->NumFramesDirty--;
+		for(auto& e : mMaterials)
+		{
+			Material* mat = e.second.get();
+			XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
+
+			MaterialData matData;
+			matData.DiffuseAlbedo = mat->DiffuseAlbedo;
+			matData.FresnelR0 = mat->FresnelR0;
+			matData.Roughness = mat->Roughness;
+			XMStoreFloat4x4(&matData.MatTransform, XMMatrixTranspose(matTransform));
+			matData.DiffuseMapIndex = mat->DiffuseSrvHeapIndex;
+			matData.NormalMapIndex = mat->NormalSrvHeapIndex;
+			matData.DispMapIndex = mat->DispSrvHeapIndex;
+
+			StreamCopy(currMaterialData.CpuAddress + mat->MatCBIndex*sizeof(MaterialData), &matData, sizeof(MaterialData));
 		}
 	}
+	StreamFence();
+}
+
+void TexColumnsApp::UpdateFrameStats(const GameTimer& gt)
+{
+	// Called first thing in Update, so the zones finished since the last call are
+	// those of the previous frame, the one gt.DeltaTime() measured.
+	mFrameZones.clear();
+	Profiler::CollectNewZones(mFrameStatsCursors, mFrameZones);
+	std::sort(mFrameZones.begin(), mFrameZones.end(), [](const ProfileZone& a, const ProfileZone& b)
+	{
+		return a.StartNs != b.StartNs ? a.StartNs < b.StartNs : a.Depth < b.Depth;
+	});
+	FrameStats::ComputeStageTimes(mFrameZones, Profiler::GetCurrentThreadIndex(), mStageTimes, mStageStack);
+
+	// Time outside every zone (message pump, window title) competes as well.
+	double frameMs = gt.DeltaTime() * 1000.0;
+	double zonedMs = 0.0;
+	for(const auto& stage : mStageTimes)
+		zonedMs += stage.Ms;
+	if(frameMs > zonedMs)
+		mStageTimes.push_back({ "Untracked", frameMs - zonedMs });
+
+	// Counters::EndFrame() ran just before this frame started, so the last counter
+	// frame is the same frame.
+	CounterFrame counters;
+	bool haveCounters = Counters::GetLastFrame(counters);
+
+	bool stutter = mFrameStats.AddFrame(frameMs, mStageTimes, haveCounters ? &counters : nullptr);
+
+	// The benchmark step of the frame just measured ran in the previous Update.
+	if(mBenchmark != nullptr && mBenchmark->IsMeasuring())
+		mBenchmarkStats->AddFrame(frameMs, mStageTimes, haveCounters ? &counters : nullptr);
+	if(mReplayStats != nullptr && mInputFrame != 0)
+		mReplayStats->AddFrame(frameMs, mStageTimes, haveCounters ? &counters : nullptr);
+	if(stutter && mCaptureTraceOnStutter && mTraceExporter.GetPendingWrites() == 0)
+	{
+		mTraceExporter.CaptureLastFrames("Traces/stutter_" + std::to_string(mFrameStats.GetStutterCount()) + ".json", 30);
+	}
 }
 
 void TexColumnsApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_ZONE("UpdateMainPassCB");
+
 	XMMATRIX view = XMLoadFloat4x4(&mView);
 	XMMATRIX proj = XMLoadFloat4x4(&mProj);
 
@@ -636,6 +1264,12 @@ void TexColumnsApp::UpdateMainPassCB(const GameTimer& gt)
 	mMainPassCB.FarZ = 1000.0f;
 	mMainPassCB.TotalTime = gt.TotalTime();
 	mMainPassCB.DeltaTime = gt.DeltaTime();
+	if(mBenchmark != nullptr)
+	{
+		// Anything animated by time must look the same on every run.
+		mMainPassCB.TotalTime = (float)mBenchmark->GetTime();
+		mMainPassCB.DeltaTime = (float)mBenchmark->GetStepSeconds();
+	}
 	mMainPassCB.AmbientLight = { 0.25f, 0.25f, 0.35f, 1.0f };
 
 
@@ -653,8 +1287,10 @@ void TexColumnsApp::UpdateMainPassCB(const GameTimer& gt)
 	XMStoreFloat4x4(&mMainPassCB.DecalViewProj, XMMatrixTranspose(decalView * decalProj));
 	// ---    ---
 
-	auto currPassCB = mCurrFrameResource->PassCB.get();
-	currPassCB->CopyData(0, mMainPassCB);
+	auto currPassCB = mUploadRing->AllocateConstants<PassConstants>(1);
+	StreamCopy(currPassCB.CpuAddress, &mMainPassCB, sizeof(PassConstants));
+	StreamFence();
+	mCurrFrameResource->PassCBAddress = currPassCB.GpuAddress;
 
 	// Controls for light settings
 	ImGui::PushID(0);
@@ -665,9 +1301,9 @@ void TexColumnsApp::UpdateMainPassCB(const GameTimer& gt)
 	ImGui::PushID(1);
 	ImGui::Text("Light settings");
 	ImGui::SliderFloat3("Position", (float*)&mMainPassCB.Lights[0].Position, -20.f, 20.f);
-	static float strength = mMainPassCB.Lights[0].Strength.x;
-	ImGui::SliderFloat("Strength", (float*)&strength, 0.f, 3.f);
-	mMainPassCB.Lights[0].Strength = XMFLOAT3(strength, strength, strength);
+	float strength = mMainPassCB.Lights[0].Strength.x;
+	if(ImGui::SliderFloat("Strength", (float*)&strength, 0.f, 3.f))
+		mMainPassCB.Lights[0].Strength = XMFLOAT3(strength, strength, strength);
 	ImGui::SliderFloat("FallofEnd", (float*)&mMainPassCB.Lights[0].FalloffEnd, 0.f, 100.f);
 	ImGui::PopID();
 
@@ -681,6 +1317,205 @@ void TexColumnsApp::UpdateMainPassCB(const GameTimer& gt)
 	ImGui::PushID(3);
 	ImGui::Text("Other settings");
 	ImGui::Checkbox("FillMode Solid", &isFillModeSolid);
+	ImGui::Checkbox("Instancing", &mInstancingEnabled);
+	if(mBindlessSupported)
+		ImGui::Checkbox("Bindless", &mBindlessEnabled);
+	else
+		ImGui::Text("Bindless: needs resource binding tier 2");
+	ImGui::Checkbox("VSync", &mVSync);
+	ImGui::Checkbox("Idle when static", &mIdleWhenStatic);
+	ImGui::SameLine();
+	ImGui::Text("(%u static frames)", mStaticFrames);
+	if(ImGui::SliderInt("Frame cap (fps, 0 = off)", &mFrameCap, 0, 240))
+		mFrameLimiter.SetTargetFrameTime(mFrameCap > 0 ? 1.0 / mFrameCap : 0.0);
+	if(mFrameCap > 0)
+	{
+		ImGui::Text("Limiter: waited %.2f ms (%.2f ms spinning), %.1f us late", mFrameLimiter.GetLastWaitNs() / 1e6,
+			mFrameLimiter.GetLastSpinNs() / 1e6, mFrameLimiter.GetLastLatenessNs() / 1e3);
+	}
+	CounterFrame counters;
+	Counters::GetLastFrame(counters);
+	ImGui::Text("Draw calls: %llu", (unsigned long long)counters.Values[CounterDrawCalls]);
+	ImGui::Text("Root parameter sets: %llu (%llu descriptor tables)", (unsigned long long)counters.Values[CounterRootParameterSets],
+		(unsigned long long)counters.Values[CounterDescriptorTableBinds]);
+	ImGui::Checkbox("Shader permutations", &mPermutationsEnabled);
+	ImGui::Text("PSO switches: %llu, permutation PSOs: %u", (unsigned long long)counters.Values[CounterPipelineStateSets],
+		(UINT)mPermutationPSOs.size());
+	ImGui::Text("PSOs: %u (%u from library, %u created)", mPsoCache->GetPsoCount(), mPsoCache->GetLibraryLoadCount(), mPsoCache->GetCreateCount());
+	ImGui::Text("Upload batches in flight: %u (%.1f MB staging)", mUploadManager->GetBatchesInFlight(), mUploadManager->GetPendingStagingBytes() / (1024.0 * 1024.0));
+	if(ImGui::CollapsingHeader("Counters"))
+	{
+		for(int i = 0; i < CounterCount; ++i)
+			ImGui::Text("%s: %llu", Counters::GetInfo((CounterId)i).Name, (unsigned long long)counters.Values[i]);
+	}
+	if(ImGui::CollapsingHeader("Allocations"))
+	{
+		// The panel itself allocates while it is open.
+		AllocationCounts allocations = AllocationTracker::GetLastFrame();
+		ImGui::Text("Last frame: %llu allocations, %.1f KB, %llu frees", (unsigned long long)allocations.Allocations,
+			allocations.Bytes / 1024.0, (unsigned long long)allocations.Frees);
+		ImGui::Text("Frame arena: %.1f KB used of %.1f KB", mFrameArena.GetUsedBytes() / 1024.0,
+			mFrameArena.GetCapacity() / 1024.0);
+
+		bool capture = AllocationTracker::IsCallSiteCaptureEnabled();
+		if(ImGui::Checkbox("Capture call sites", &capture))
+			AllocationTracker::SetCallSiteCapture(capture);
+		ImGui::SameLine();
+		if(ImGui::Button("Clear"))
+			AllocationTracker::ClearCallSites();
+
+		AllocationTracker::GetCallSites(mAllocationCallSites);
+		for(size_t i = 0; i < mAllocationCallSites.size() && i < 10; ++i)
+		{
+			const AllocationCallSite& site = mAllocationCallSites[i];
+			ImGui::Text("%llu allocations, %.1f KB", (unsigned long long)site.Allocations, site.Bytes / 1024.0);
+			for(void* frame : site.Frames)
+			{
+				if(frame != nullptr)
+					ImGui::Text("    %s", AllocationTracker::DescribeAddress(frame).c_str());
+			}
+		}
+	}
+	if(ImGui::CollapsingHeader("Camera path"))
+	{
+		if(mBenchmark != nullptr)
+			ImGui::Text("Benchmark frame %u of %u", mBenchmark->GetFrame(), mBenchmark->GetTotalFrames());
+
+		ImGui::Text("Recorded: %u keyframes, %.1f s", (UINT)mRecordedPath.GetKeyframes().size(), mRecordedPath.GetDuration());
+		ImGui::SliderFloat("Seconds to next key", &mRecordedKeySeconds, 0.25f, 10.0f);
+		if(ImGui::Button("Add keyframe"))
+		{
+			XMFLOAT3 position = cam.GetPosition3f();
+			XMFLOAT3 look = cam.GetLook3f();
+			CameraPose pose;
+			std::memcpy(pose.Position, &position, sizeof(pose.Position));
+			std::memcpy(pose.Look, &look, sizeof(pose.Look));
+
+			const auto& keys = mRecordedPath.GetKeyframes();
+			mRecordedPath.AddKeyframe(keys.empty() ? 0.0 : keys.back().Time + mRecordedKeySeconds, pose);
+		}
+		ImGui::SameLine();
+		if(ImGui::Button("Clear path"))
+			mRecordedPath.Clear();
+		ImGui::SameLine();
+		if(ImGui::Button("Save path") && !mRecordedPath.IsEmpty())
+		{
+			std::string file = "Paths/camera_" + std::to_string(mRecordedPathCount++) + ".txt";
+			mLastSavedPath = mRecordedPath.Save(file) ? file : std::string();
+		}
+		if(!mLastSavedPath.empty())
+			ImGui::Text("Saved %s; run with -benchmark %s", mLastSavedPath.c_str(), mLastSavedPath.c_str());
+	}
+	if(ImGui::CollapsingHeader("Input recording"))
+	{
+		if(mInputReplay != nullptr)
+		{
+			ImGui::Text("Replaying frame %u of %u", mInputFrame, mInputReplay->GetLog().GetFrameCount());
+		}
+		else if(mRecordingInput)
+		{
+			ImGui::Text("Recording to %s: frame %u, %u events", mInputRecordFile.c_str(), mInputFrame,
+				(UINT)mInputLog.GetEvents().size());
+			if(ImGui::Button("Save now"))
+				SaveInputRecording();
+		}
+		else
+		{
+			ImGui::Text("Start with -record <file> to record, -replay <file> to replay");
+		}
+	}
+	if(ImGui::CollapsingHeader("Textures"))
+		ShowTexturePreview();
+	if(ImGui::CollapsingHeader("Memory"))
+	{
+		MemoryReport report = BuildMemoryReport();
+		for(int i = 0; i < MemoryCategoryCount; ++i)
+		{
+			ImGui::Text("%s: %.2f MB (%u)", MemoryReport::CategoryName((MemoryCategory)i),
+				report.Bytes[i] / (1024.0 * 1024.0), report.Objects[i]);
+		}
+		ImGui::Text("Total: %.2f MB", report.Total() / (1024.0 * 1024.0));
+	}
+	if(ImGui::CollapsingHeader("Frame stats"))
+	{
+		FrameStatsSummary summary = mFrameStats.ComputeSummary();
+		ImGui::Text("%u frames: avg %.2f, p50 %.2f, p95 %.2f, p99 %.2f, max %.2f ms", summary.FrameCount,
+			summary.AverageMs, summary.P50Ms, summary.P95Ms, summary.P99Ms, summary.MaxMs);
+
+		const auto& histogram = mFrameStats.GetHistogram();
+		std::vector<float> counts(histogram.begin(), histogram.end());
+		std::string label = std::to_string((int)mFrameStats.GetBucketMs()) + " ms buckets";
+		ImGui::PlotHistogram("##FrameTimes", counts.data(), (int)counts.size(), 0, label.c_str(), 0.0f, FLT_MAX, ImVec2(0, 80));
+
+		float threshold = (float)mFrameStats.GetStutterThresholdMs();
+		if(ImGui::SliderFloat("Stutter threshold (ms)", &threshold, 5.0f, 100.0f))
+			mFrameStats.SetStutterThresholdMs(threshold);
+		ImGui::Checkbox("Capture trace on stutter", &mCaptureTraceOnStutter);
+
+		ImGui::Text("Stutters: %llu", (unsigned long long)mFrameStats.GetStutterCount());
+		const auto& stutters = mFrameStats.GetStutters();
+		for(std::size_t i = 0; i < stutters.size() && i < 8; ++i)
+		{
+			const FrameSample& stutter = stutters[stutters.size() - 1 - i];
+			ImGui::Text("  frame %llu: %.2f ms, %s %.2f ms", (unsigned long long)stutter.FrameIndex, stutter.FrameMs,
+				stutter.DominantStage, stutter.DominantStageMs);
+		}
+
+		if(ImGui::Button("Save CSV"))
+			mFrameStats.WriteCsv("Stats/frames_" + std::to_string(mFrameStatsCsvCount++) + ".csv");
+	}
+	if(ImGui::CollapsingHeader("Profiler"))
+	{
+		ImGui::Text("Zone overhead: %.1f ns", mProfilerOverheadNs);
+
+		if(ImGui::Button("Save last 120 frames"))
+			mTraceExporter.CaptureLastFrames("Traces/frames_" + std::to_string(mTraceCaptureCount++) + ".json", 120);
+		ImGui::SameLine();
+		if(!mTraceExporter.IsCapturing())
+		{
+			if(ImGui::Button("Start capture"))
+				mTraceExporter.BeginCapture("Traces/capture_" + std::to_string(mTraceCaptureCount++) + ".json");
+		}
+		else if(ImGui::Button("Stop capture"))
+		{
+			mTraceExporter.EndCapture();
+		}
+		if(mTraceExporter.GetPendingWrites() != 0)
+			ImGui::Text("Writing trace...");
+		else if(!mTraceExporter.GetLastWrittenFile().empty())
+			ImGui::Text("Saved %s", mTraceExporter.GetLastWrittenFile().string().c_str());
+
+		// Main thread zones of the last finished frame, outermost first.
+		std::uint64_t frameStart = 0;
+		std::uint64_t frameEnd = 0;
+		if(Profiler::GetFrameBounds(0, frameStart, frameEnd))
+		{
+			ImGui::Text("Last frame: %.3f ms", (frameEnd - frameStart) / 1e6);
+
+			mProfileZones.clear();
+			Profiler::CollectZones(frameStart, mProfileZones);
+			std::stable_sort(mProfileZones.begin(), mProfileZones.end(), [](const ProfileZone& a, const ProfileZone& b)
+			{
+				return a.StartNs < b.StartNs;
+			});
+
+			std::uint32_t mainThread = Profiler::GetCurrentThreadIndex();
+			for(const auto& zone : mProfileZones)
+			{
+				if(zone.ThreadIndex != mainThread || zone.StartNs < frameStart || zone.StartNs >= frameEnd)
+					continue;
+				if(zone.Allocations != 0)
+				{
+					ImGui::Text("%*s%s: %.3f ms, %u allocations (%.1f KB)", (int)zone.Depth * 2, "", zone.Name,
+						(zone.EndNs - zone.StartNs) / 1e6, zone.Allocations, zone.AllocatedBytes / 1024.0);
+				}
+				else
+				{
+					ImGui::Text("%*s%s: %.3f ms", (int)zone.Depth * 2, "", zone.Name, (zone.EndNs - zone.StartNs) / 1e6);
+				}
+			}
+		}
+	}
 	ImGui::Checkbox("Fix Tess Level", (bool*) & mMainPassCB.fixTessLevel);
 	ImGui::SliderFloat3("decal position", (float*) & mMainPassCB.decalPosition, -40, 40);
 	ImGui::SliderFloat("decal radius", (float*) & mMainPassCB.DecalRadius, 0, 10);
@@ -698,6 +1533,7 @@ void TexColumnsApp::UpdateMainPassCB(const GameTimer& gt)
 
 void TexColumnsApp::LoadAllTextures()
 {
+	std::vector<std::string> names;
 	// MEGA COSTYL
 	for (const auto& entry : std::filesystem::directory_iterator("../../Textures/textures"))
 	{
@@ -707,23 +1543,389 @@ void TexColumnsApp::LoadAllTextures()
 			filepath = filepath.substr(24, filepath.size());
 			filepath = filepath.substr(0, filepath.size()-4);
 			filepath = "textures/" + filepath;
-			LoadTexture(filepath);
+			names.push_back(filepath);
 		}
 	}
+
+	// Reading the files is the slow part and needs no device access, so it runs on
+	// the workers.  Recording the uploads uses the upload manager's command list and
+	// stays serial.
+	std::vector<ComPtr<ID3DBlob>> fileData(names.size());
+	mJobSystem.ParallelFor((UINT)names.size(), 1, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t i = begin; i < end; ++i)
+		{
+			PROFILE_ZONE("ReadTextureFile");
+			fileData[i] = d3dUtil::LoadBinary(TextureFilename(names[i]));
+		}
+	});
+
+	for (size_t i = 0; i < names.size(); ++i)
+		LoadTexture(names[i], fileData[i].Get());
+
+	Counters::Set(CounterTexturesResident, mTextures.size());
+}
+
+std::wstring TexColumnsApp::TextureFilename(const std::string& name)
+{
+	return L"../../Textures/" + std::wstring(name.begin(), name.end()) + L".dds";
 }
 
-void TexColumnsApp::LoadTexture(const std::string& name)
+void TexColumnsApp::LoadTexture(const std::string& name, ID3DBlob* fileData)
 {
 	auto tex = std::make_unique<Texture>();
 	tex->Name = name;
-	tex->Filename = L"../../Textures/" + std::wstring(name.begin(), name.end()) + L".dds";
+	tex->Filename = TextureFilename(name);
 	
-	if (FAILED(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), tex->Filename.c_str(),
-		tex->Resource, tex->UploadHeap))) std::cout << name << "\n";
+	if (FAILED(mUploadManager->CreateDDSTexture((const uint8_t*)fileData->GetBufferPointer(),
+		fileData->GetBufferSize(), tex->Resource))) std::cout << name << "\n";
 	mTextures[name] = std::move(tex);
 }
 
+bool TexColumnsApp::EnableZeroAllocationTest()
+{
+#if ALLOCATION_TRACKING_ENABLED
+	mZeroAllocationTest = true;
+	return true;
+#else
+	// Every count would be zero, so the test would pass whatever the frames allocate.
+	std::string message = "Zero-allocation test: allocation tracking is compiled out of this build; "
+		"use the Profile configuration\n";
+	std::cerr << message;
+	::OutputDebugStringA(message.c_str());
+
+	std::filesystem::create_directories("Stats");
+	std::ofstream("Stats/zero_allocation.txt") << message;
+	return false;
+#endif
+}
+
+void TexColumnsApp::UpdateZeroAllocationTest()
+{
+	if(AllocationTracker::GetCheckedFrameCount() < gZeroAllocationCheckFrames)
+		return;
+
+	mZeroAllocationTest = false;
+	AllocationTracker::EndZeroAllocationCheck();
+
+	std::string report = BuildAllocationReport();
+	std::cout << report;
+	::OutputDebugStringA(report.c_str());
+
+	std::filesystem::create_directories("Stats");
+	std::ofstream("Stats/zero_allocation.txt") << report;
+
+	PostQuitMessage(AllocationTracker::GetViolationCount() == 0 ? 0 : 1);
+}
+
+void TexColumnsApp::EnableBenchmark(const std::string& pathFile, UINT frameCount)
+{
+	mBenchmarkPathFile = pathFile;
+	mBenchmarkFrameCount = frameCount;
+}
+
+bool TexColumnsApp::StartBenchmark()
+{
+	CameraPath path;
+	std::string error;
+	if(!path.Load(mBenchmarkPathFile, error))
+	{
+		std::string message = "Benchmark: " + error + "\n";
+		std::cerr << message;
+		::OutputDebugStringA(message.c_str());
+		return false;
+	}
+
+	UINT frameCount = mBenchmarkFrameCount;
+	if(frameCount == 0)
+		frameCount = (UINT)(path.GetDuration() / gBenchmarkStepSeconds) + 1;
+
+	std::cout << "Benchmark: " << mBenchmarkPathFile << ", " << frameCount << " frames after "
+		<< gBenchmarkWarmupFrames << " warm-up frames\n";
+
+	mBenchmark = std::make_unique<CameraPathPlayback>(std::move(path), gBenchmarkStepSeconds, gBenchmarkWarmupFrames, frameCount);
+	mBenchmarkStats = std::make_unique<FrameStats>(frameCount);
+	return true;
+}
+
+void TexColumnsApp::UpdateBenchmark()
+{
+	CameraPose pose;
+	if(mBenchmark->Next(pose))
+	{
+		XMFLOAT3 position(pose.Position);
+		XMFLOAT3 look(pose.Look);
+		XMVECTOR P = XMLoadFloat3(&position);
+		cam.LookAt(P, P + XMLoadFloat3(&look), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		cam.UpdateViewMatrix();
+		return;
+	}
+
+	// Every measured frame has been added by UpdateFrameStats by now.
+	FinishMeasuredRun("benchmark", mBenchmarkPathFile, *mBenchmarkStats);
+	mBenchmark.reset();
+	mBenchmarkStats.reset();
+}
+
+void TexColumnsApp::FinishMeasuredRun(const std::string& kind, const std::string& sourceFile, const FrameStats& stats)
+{
+	FrameStatsSummary summary = stats.ComputeSummary();
+	std::filesystem::path results = "Stats/" + kind + "_" + std::filesystem::path(sourceFile).stem().string() + ".csv";
+	bool written = stats.WriteCsv(results);
+
+	std::ostringstream out;
+	out << kind << ": " << summary.FrameCount << " frames, average " << summary.AverageMs << " ms, p50 "
+		<< summary.P50Ms << " ms, p95 " << summary.P95Ms << " ms, p99 " << summary.P99Ms << " ms, max "
+		<< summary.MaxMs << " ms\n";
+	out << (written ? "Results written to " : "Could not write ") << results.string() << "\n";
+	std::cout << out.str();
+	::OutputDebugStringA(out.str().c_str());
+
+	PostQuitMessage(written ? 0 : 1);
+}
+
+void TexColumnsApp::EnableInputRecording(const std::string& file)
+{
+	mInputRecordFile = file;
+}
+
+void TexColumnsApp::EnableInputReplay(const std::string& file)
+{
+	mInputReplayFile = file;
+}
+
+void TexColumnsApp::EnableStressObjects(UINT count)
+{
+	mStressObjectCount = count;
+}
+
+void TexColumnsApp::RecordInput(InputEventType type, std::uint64_t code, int x, int y)
+{
+	if(!mRecordingInput)
+		return;
+
+	InputEvent event;
+	event.Frame = mInputFrame;
+	event.Type = type;
+	event.Code = code;
+	event.X = x;
+	event.Y = y;
+	mInputLog.Add(event);
+}
+
+void TexColumnsApp::ApplyInputEvent(const InputEvent& event)
+{
+	switch(event.Type)
+	{
+	case InputEventType::KeyDown:
+		ApplyKeyPressed((WPARAM)event.Code);
+		return;
+	case InputEventType::KeyUp:
+		ApplyKeyReleased((WPARAM)event.Code);
+		return;
+	case InputEventType::MouseDown:
+		mLastMousePos.x = event.X;
+		mLastMousePos.y = event.Y;
+		return;
+	case InputEventType::MouseMove:
+		ApplyMouseMove((WPARAM)event.Code, event.X, event.Y);
+		return;
+	case InputEventType::Value:
+		if(event.Code < mRecordedValues.size() && event.Size == mRecordedValues[event.Code].Size)
+		{
+			RecordedValue& value = mRecordedValues[event.Code];
+			std::memcpy(value.Value, event.Data, value.Size);
+			std::memcpy(value.Last, event.Data, value.Size);
+		}
+		return;
+	}
+}
+
+void TexColumnsApp::BuildRecordedValues()
+{
+	// The indices are stored in recordings, so only ever append to this list.
+	auto add = [this](void* value, size_t size)
+	{
+		assert(size <= InputEvent::MaxValueSize);
+		RecordedValue recorded;
+		recorded.Value = value;
+		recorded.Size = (std::uint8_t)size;
+		std::memcpy(recorded.Last, value, size);
+		mRecordedValues.push_back(recorded);
+	};
+	add(&mMainPassCB.gDisplacementScale, sizeof(mMainPassCB.gDisplacementScale));
+	add(&mMainPassCB.Lights[0].Position, sizeof(mMainPassCB.Lights[0].Position));
+	add(&mMainPassCB.Lights[0].Strength, sizeof(mMainPassCB.Lights[0].Strength));
+	add(&mMainPassCB.Lights[0].FalloffEnd, sizeof(mMainPassCB.Lights[0].FalloffEnd));
+	add(&mMainPassCB.gTessFactorMax, sizeof(mMainPassCB.gTessFactorMax));
+	add(&mMainPassCB.gTessLevel, sizeof(mMainPassCB.gTessLevel));
+	add(&mMainPassCB.gMaxTessDistance, sizeof(mMainPassCB.gMaxTessDistance));
+	add(&mMainPassCB.fixTessLevel, sizeof(mMainPassCB.fixTessLevel));
+	add(&mMainPassCB.decalPosition, sizeof(mMainPassCB.decalPosition));
+	add(&mMainPassCB.DecalRadius, sizeof(mMainPassCB.DecalRadius));
+	add(&mMainPassCB.DecalFalloffRadius, sizeof(mMainPassCB.DecalFalloffRadius));
+	add(&isFillModeSolid, sizeof(isFillModeSolid));
+	add(&mInstancingEnabled, sizeof(mInstancingEnabled));
+	add(&mBindlessEnabled, sizeof(mBindlessEnabled));
+	add(&mPermutationsEnabled, sizeof(mPermutationsEnabled));
+}
+
+bool TexColumnsApp::SyncRecordedValues()
+{
+	// Runs after the UI of the frame, at the point where its changes were recorded.
+	bool changed = false;
+	InputEvent event;
+	while(mInputReplay != nullptr && mInputReplay->Next(mInputFrame, event))
+		ApplyInputEvent(event);
+
+	for(size_t i = 0; i < mRecordedValues.size(); ++i)
+	{
+		RecordedValue& value = mRecordedValues[i];
+		if(std::memcmp(value.Value, value.Last, value.Size) == 0)
+			continue;
+
+		// A replay undoes what the UI changed on its own.
+		if(mInputReplay != nullptr)
+		{
+			std::memcpy(value.Value, value.Last, value.Size);
+			continue;
+		}
+
+		std::memcpy(value.Last, value.Value, value.Size);
+		changed = true;
+		if(mRecordingInput)
+		{
+			event = InputEvent();
+			event.Frame = mInputFrame;
+			event.Type = InputEventType::Value;
+			event.Code = i;
+			event.Size = value.Size;
+			std::memcpy(event.Data, value.Value, value.Size);
+			mInputLog.Add(event);
+		}
+	}
+	return changed;
+}
+
+bool TexColumnsApp::CanIdle()
+{
+	return mIdleWhenStatic && !mInputSinceLastFrame && !mRedrawRequested && mStaticFrames >= gIdleAfterStaticFrames;
+}
+
+void TexColumnsApp::UpdateIdleState(bool valuesChanged)
+{
+	// A frame is static if it looks like the one before: same view and projection, no
+	// UI value or item changed, no input or redraw request, and no upload that could
+	// still change what is drawn.  Materials are not animated; a change to one sets its
+	// NumFramesDirty.  A redraw request restarts the count, so after a resize the app
+	// draws gIdleAfterStaticFrames frames before idling again.
+	bool viewChanged = std::memcmp(&mView, &mIdleView, sizeof(mView)) != 0 ||
+		std::memcmp(&mProj, &mIdleProj, sizeof(mProj)) != 0;
+	mIdleView = mView;
+	mIdleProj = mProj;
+
+	// Runs that must see every frame never idle.
+	bool unattended = mBenchmark != nullptr || mInputReplay != nullptr || mZeroAllocationTest;
+
+	bool staticFrame = !viewChanged && !valuesChanged && !mInputSinceLastFrame && !mRedrawRequested && !unattended &&
+		mDirtyObjectCount.load(std::memory_order_relaxed) == 0 && !mMaterialsDirty && !mInstanceBatchesDirty &&
+		mUploadManager->GetBatchesInFlight() == 0 && !ImGui::IsAnyItemActive();
+	mStaticFrames = staticFrame ? mStaticFrames + 1 : 0;
+}
+
+bool TexColumnsApp::StartInputReplay()
+{
+	InputLog log;
+	std::string error;
+	if(!log.Load(mInputReplayFile, error))
+	{
+		std::string message = "Replay: " + error + "\n";
+		std::cerr << message;
+		::OutputDebugStringA(message.c_str());
+		return false;
+	}
+
+	std::cout << "Replay: " << mInputReplayFile << ", " << log.GetFrameCount() << " frames, "
+		<< log.GetEvents().size() << " events\n";
+
+	mReplayStats = std::make_unique<FrameStats>(std::max(log.GetFrameCount(), 1u));
+	mInputReplay = std::make_unique<InputReplay>(std::move(log));
+	return true;
+}
+
+void TexColumnsApp::UpdateInputReplay()
+{
+	if(mInputReplay->IsFinished(mInputFrame))
+	{
+		// Frames 0 to mInputFrame - 1 have been added by UpdateFrameStats by now.
+		FinishMeasuredRun("replay", mInputReplayFile, *mReplayStats);
+		mInputReplay.reset();
+		mReplayStats.reset();
+		return;
+	}
+
+	// The values changed by the UI come after the UI, in SyncRecordedValues.
+	InputEvent event;
+	while(const InputEvent* next = mInputReplay->Peek(mInputFrame))
+	{
+		if(next->Type == InputEventType::Value)
+			break;
+		mInputReplay->Next(mInputFrame, event);
+		ApplyInputEvent(event);
+	}
+}
+
+bool TexColumnsApp::SaveInputRecording()
+{
+	mInputLog.SetFrameCount(mInputFrame);
+	bool saved = mInputLog.Save(mInputRecordFile);
+	std::cout << (saved ? "Input recorded to " : "Could not write ") << mInputRecordFile << "\n";
+	return saved;
+}
+
+std::string TexColumnsApp::BuildAllocationReport()const
+{
+	std::vector<AllocationCallSite> sites;
+	AllocationTracker::GetCallSites(sites);
+
+	std::ostringstream out;
+	out << "Zero-allocation check: " << AllocationTracker::GetViolationCount() << " of "
+		<< AllocationTracker::GetCheckedFrameCount() << " frames allocated\n";
+	for(size_t i = 0; i < sites.size() && i < 20; ++i)
+	{
+		out << sites[i].Allocations << " allocations, " << sites[i].Bytes << " bytes\n";
+		for(void* frame : sites[i].Frames)
+		{
+			if(frame != nullptr)
+				out << "    " << AllocationTracker::DescribeAddress(frame) << "\n";
+		}
+	}
+	if(AllocationTracker::GetDroppedCallSiteCount() != 0)
+		out << AllocationTracker::GetDroppedCallSiteCount() << " allocations from call sites that did not fit\n";
+	return out.str();
+}
+
+MemoryReport TexColumnsApp::BuildMemoryReport()const
+{
+	MemoryReport report;
+
+	for(const auto& kv : mTextures)
+		report.Add(MemoryCategoryTextures, ResourceAllocationSize(md3dDevice.Get(), kv.second->Resource.Get()));
+
+	report.Add(MemoryCategoryStaging, mUploadManager->GetPendingStagingBytes(), mUploadManager->GetPendingStagingCount());
+
+	for(const auto& kv : mGeometries)
+	{
+		const MeshGeometry* geo = kv.second.get();
+		report.Add(MemoryCategoryGeometryCpu, geo->CpuByteSize());
+		report.Add(MemoryCategoryGeometryGpu,
+			ResourceAllocationSize(md3dDevice.Get(), geo->VertexBufferGPU.Get()) +
+			ResourceAllocationSize(md3dDevice.Get(), geo->IndexBufferGPU.Get()), 2);
+	}
+
+	return report;
+}
+
 void TexColumnsApp::BuildRootSignature()
 {
 	CD3DX12_DESCRIPTOR_RANGE diffuseRange;
@@ -738,8 +1940,17 @@ void TexColumnsApp::BuildRootSignature()
 	CD3DX12_DESCRIPTOR_RANGE decaldispMap;
 	decaldispMap.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 3);  // Dispmap   t3
 
+	// Unbounded descriptor ranges need resource binding tier 2.
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+	ThrowIfFailed(md3dDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+	mBindlessSupported = options.ResourceBindingTier >= D3D12_RESOURCE_BINDING_TIER_2;
+
+	// Bindless texture table: unbounded, starting at the first persistent descriptor.
+	CD3DX12_DESCRIPTOR_RANGE textureTable;
+	textureTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 2); // register t0 space2
+
     // Root parameter can be a table, root descriptor or root constants.
-    CD3DX12_ROOT_PARAMETER slotRootParameter[7];
+    CD3DX12_ROOT_PARAMETER slotRootParameter[11];
 
 	// Perfomance TIP: Order from most frequent to least frequent.
 	slotRootParameter[0].InitAsDescriptorTable(1, &diffuseRange, D3D12_SHADER_VISIBILITY_ALL);
@@ -750,11 +1961,19 @@ void TexColumnsApp::BuildRootSignature()
     slotRootParameter[4].InitAsConstantBufferView(0); // register b0
     slotRootParameter[5].InitAsConstantBufferView(1); // register b1
     slotRootParameter[6].InitAsConstantBufferView(2); // register b2
+    slotRootParameter[7].InitAsShaderResourceView(0, 1); // instance data, register t0 space1
+    slotRootParameter[8].InitAsConstants(1, 3); // base instance, register b3
+	slotRootParameter[9].InitAsDescriptorTable(1, &textureTable, D3D12_SHADER_VISIBILITY_ALL);
+    slotRootParameter[10].InitAsShaderResourceView(1, 1); // material table, register t1 space1
+
+	// Without bindless only the per-texture tables (0-3) and the parameters shared with
+	// the instanced path are used.
+	UINT numParameters = mBindlessSupported ? 11 : 9;
 
 	auto staticSamplers = GetStaticSamplers();
 
     // A root signature is an array of root parameters.
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(7, slotRootParameter,
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(numParameters, slotRootParameter,
 		(UINT)staticSamplers.size(), staticSamplers.data(),
 		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
@@ -775,15 +1994,24 @@ void TexColumnsApp::BuildRootSignature()
         serializedRootSig->GetBufferPointer(),
         serializedRootSig->GetBufferSize(),
         IID_PPV_ARGS(mRootSignature.GetAddressOf())));
+
+	// PSO cache keys refer to the root signature by content.
+	mRootSignatureHash = ShaderCache::Fnv1a(serializedRootSig->GetBufferPointer(), serializedRootSig->GetBufferSize());
 }
-void TexColumnsApp::CreateMaterial(std::string _name, int _CBIndex, int _SRVDiffIndex, int _SRVNMapIndex, int _SRVDispIndex, XMFLOAT4 _DiffuseAlbedo, XMFLOAT3 _FresnelR0, float _Roughness)
+void TexColumnsApp::CreateMaterial(std::string _name, int _SRVDiffIndex, int _SRVNMapIndex, int _SRVDispIndex, XMFLOAT4 _DiffuseAlbedo, XMFLOAT3 _FresnelR0, float _Roughness)
 {
 	
 	auto material = std::make_unique<Material>();
 	material->Name = _name;
-	material->MatCBIndex = _CBIndex;
+	// Every material gets its own constant buffer slot and material table entry;
+	// redefining a material keeps its slot.
+	auto it = mMaterials.find(_name);
+	material->MatCBIndex = it != mMaterials.end() ? it->second->MatCBIndex : (int)mMaterials.size();
 	material->DiffuseSrvHeapIndex = _SRVDiffIndex;
-	material->NormalSrvHeapIndex = _SRVNMapIndex;
+	// A negative normal map index means the material has none; the diffuse texture
+	// fills the slot so the table stays valid.
+	material->HasNormalMap = _SRVNMapIndex >= 0;
+	material->NormalSrvHeapIndex = _SRVNMapIndex >= 0 ? _SRVNMapIndex : _SRVDiffIndex;
 	material->DispSrvHeapIndex = _SRVDispIndex;
 	material->DiffuseAlbedo = _DiffuseAlbedo;
 	material->FresnelR0 = _FresnelR0;
@@ -793,31 +2021,72 @@ void TexColumnsApp::CreateMaterial(std::string _name, int _CBIndex, int _SRVDiff
 void TexColumnsApp::BuildDescriptorHeaps()
 {
 	//
-	// Create the SRV heap.
+	// Create the SRV heap.  Sized for more textures than are loaded now, so textures
+	// can also be added later with CreateTextureSrv.
 	//
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = mTextures.size();
-	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
+	mSrvHeap = std::make_unique<DescriptorHeap>(md3dDevice.Get(), gPersistentDescriptorCount, gTransientDescriptorCount);
 
 	//
 	// Fill out the heap with actual descriptors.
 	//
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	for (const auto& tex : mTextures) {
+		CreateTextureSrv(tex.first);
+	}
+	mDecalSrvIndex = TexOffsets["textures/ochko"];
+}
+
+void TexColumnsApp::CreateTextureSrv(const std::string& name)
+{
+	auto text = mTextures[name]->Resource;
+
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	int offset = 0;
-	for (const auto& tex : mTextures) {
-		auto text = tex.second->Resource;
-		srvDesc.Format = text->GetDesc().Format;
-		srvDesc.Texture2D.MipLevels = text->GetDesc().MipLevels;
-		md3dDevice->CreateShaderResourceView(text.Get(), &srvDesc, hDescriptor);
-		hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-		TexOffsets[tex.first] = offset;
-		offset++;
+	srvDesc.Format = text->GetDesc().Format;
+	srvDesc.Texture2D.MipLevels = text->GetDesc().MipLevels;
+
+	UINT index = mSrvHeap->AllocatePersistent();
+	md3dDevice->CreateShaderResourceView(text.Get(), &srvDesc, mSrvHeap->CpuHandle(index));
+	TexOffsets[name] = index;
+}
+
+void TexColumnsApp::ShowTexturePreview()
+{
+	if(ImGui::BeginCombo("Texture", mPreviewTexture.empty() ? "(none)" : mPreviewTexture.c_str()))
+	{
+		for(const auto& tex : mTextures)
+		{
+			if(ImGui::Selectable(tex.first.c_str(), tex.first == mPreviewTexture))
+			{
+				mPreviewTexture = tex.first;
+				mPreviewMip = 0;
+			}
+		}
+		ImGui::EndCombo();
 	}
+
+	auto it = mTextures.find(mPreviewTexture);
+	if(it == mTextures.end())
+		return;
+
+	D3D12_RESOURCE_DESC texDesc = it->second->Resource->GetDesc();
+	ImGui::SliderInt("Mip", &mPreviewMip, 0, texDesc.MipLevels - 1);
+	UINT64 width = std::max<UINT64>(texDesc.Width >> mPreviewMip, 1);
+	UINT height = std::max<UINT>(texDesc.Height >> mPreviewMip, 1);
+	ImGui::Text("%llu x %u", (unsigned long long)width, height);
+
+	// A view of just the selected mip, written every frame into the transient region;
+	// it is reclaimed once this frame's fence passes.
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Format = texDesc.Format;
+	srvDesc.Texture2D.MostDetailedMip = mPreviewMip;
+	srvDesc.Texture2D.MipLevels = 1;
+
+	UINT index = mSrvHeap->AllocateTransient(1);
+	md3dDevice->CreateShaderResourceView(it->second->Resource.Get(), &srvDesc, mSrvHeap->CpuHandle(index));
+	ImGui::Image((ImTextureID)mSrvHeap->GpuHandle(index).ptr, ImVec2(256.0f, 256.0f * height / (float)width));
 }
 
 void TexColumnsApp::BuildShadersAndInputLayout()
@@ -829,11 +2098,20 @@ void TexColumnsApp::BuildShadersAndInputLayout()
 	};
 
 	//  :
-	mShaders["standardHS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "HSMain", "hs_5_1");
-	mShaders["standardDS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "DSMain", "ds_5_1");
+	mShaders["standardHS"] = d3dUtil::CompileShaderCached(L"Shaders\\Default.hlsl", nullptr, "HSMain", "hs_5_1");
+	mShaders["standardDS"] = d3dUtil::CompileShaderCached(L"Shaders\\Default.hlsl", nullptr, "DSMain", "ds_5_1");
 	// VS  PS         /
-	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_1");
+	mShaders["standardVS"] = d3dUtil::CompileShaderCached(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
+	mShaders["instancedVS"] = d3dUtil::CompileShaderCached(L"Shaders\\Default.hlsl", nullptr, "InstancedVS", "vs_5_1");
+	mShaders["opaquePS"] = d3dUtil::CompileShaderCached(L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_1");
+
+	const D3D_SHADER_MACRO bindlessDefines[] =
+	{
+		"BINDLESS", "1",
+		NULL, NULL
+	};
+	mShaders["bindlessVS"] = d3dUtil::CompileShaderCached(L"Shaders\\Default.hlsl", bindlessDefines, "InstancedVS", "vs_5_1");
+	mShaders["bindlessPS"] = d3dUtil::CompileShaderCached(L"Shaders\\Default.hlsl", bindlessDefines, "PS", "ps_5_1");
     mInputLayout =
     {
         { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
@@ -941,12 +2219,17 @@ void TexColumnsApp::BuildCustomMeshGeometry(std::string name, UINT& meshVertexOf
 		std::string a = std::string(texPath.C_Str());
 		a = a.substr(0, a.length() - 4);
 		std::cout << "DIFFUSE: " << a << "\n";
-		scene->mMaterials[k]->GetTexture(aiTextureType_DISPLACEMENT, 0, &texPath);
-		std::string b = std::string(texPath.C_Str());
+		aiString normalPath;
+		bool hasNormalMap = scene->mMaterials[k]->GetTexture(aiTextureType_DISPLACEMENT, 0, &normalPath) == aiReturn_SUCCESS;
+		std::string b = std::string(normalPath.C_Str());
 		b = b.substr(0, b.length() - 4);
 		std::cout << "NORMAL: " << b << "\n";
 
-		CreateMaterial(scene->mMaterials[k]->GetName().C_Str(), k, TexOffsets[a], TexOffsets[b], TexOffsets[b], XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);
+		// Only a texture that was actually loaded counts as a normal map.
+		auto normal = TexOffsets.find(b);
+		int normalIndex = hasNormalMap && normal != TexOffsets.end() ? normal->second : -1;
+
+		CreateMaterial(scene->mMaterials[k]->GetName().C_Str(), TexOffsets[a], normalIndex, TexOffsets[b], XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);
 	}
 
 	UINT totalMeshSize = 0;
@@ -964,6 +2247,8 @@ void TexColumnsApp::BuildCustomMeshGeometry(std::string name, UINT& meshVertexOf
 		meshSubmesh.IndexCount = (UINT)mesh.Indices32.size();
 		meshSubmesh.StartIndexLocation = meshIndexOffset;
 		meshSubmesh.BaseVertexLocation = meshVertexOffset;
+		if(!mesh.Vertices.empty())
+			BoundingBox::CreateFromPoints(meshSubmesh.Bounds, mesh.Vertices.size(), &mesh.Vertices[0].Position, sizeof(GeometryGenerator::Vertex));
 		GeometryGenerator::MeshData m = mesh;
 		meshSubmeshes.push_back(std::make_pair(m,meshSubmesh));
 	}
@@ -1030,6 +2315,11 @@ void TexColumnsApp::BuildShapeGeometry()
 	cylinderSubmesh.StartIndexLocation = cylinderIndexOffset;
 	cylinderSubmesh.BaseVertexLocation = cylinderVertexOffset;
 
+	BoundingBox::CreateFromPoints(boxSubmesh.Bounds, box.Vertices.size(), &box.Vertices[0].Position, sizeof(GeometryGenerator::Vertex));
+	BoundingBox::CreateFromPoints(gridSubmesh.Bounds, grid.Vertices.size(), &grid.Vertices[0].Position, sizeof(GeometryGenerator::Vertex));
+	BoundingBox::CreateFromPoints(sphereSubmesh.Bounds, sphere.Vertices.size(), &sphere.Vertices[0].Position, sizeof(GeometryGenerator::Vertex));
+	BoundingBox::CreateFromPoints(cylinderSubmesh.Bounds, cylinder.Vertices.size(), &cylinder.Vertices[0].Position, sizeof(GeometryGenerator::Vertex));
+
 	//
 	// Extract the vertex elements we are interested in and pack the
 	// vertices of all the meshes into one vertex buffer.
@@ -1109,11 +2399,8 @@ void TexColumnsApp::BuildShapeGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	geo->VertexBufferGPU = mUploadManager->CreateBuffer(vertices.data(), vbByteSize);
+	geo->IndexBufferGPU = mUploadManager->CreateBuffer(indices.data(), ibByteSize);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -1130,100 +2417,64 @@ void TexColumnsApp::BuildShapeGeometry()
 
 void TexColumnsApp::BuildPSOs()
 {
-    D3D12_GRAPHICS_PIPELINE_STATE_DESC opaquePsoDesc;
+	mPsoCache = std::make_unique<PsoCache>(md3dDevice.Get(), L"ShaderCache\\Pipelines.bin");
 
 	//
-	// PSO for opaque objects.
+	// PSOs for opaque objects.  The fixed variants differ only in fill mode and in
+	// the VS/PS pair of the draw path.
 	//
-    ZeroMemory(&opaquePsoDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
-	opaquePsoDesc.InputLayout = { mInputLayout.data(), (UINT)mInputLayout.size() };
-	opaquePsoDesc.pRootSignature = mRootSignature.Get();
-	opaquePsoDesc.VS = 
-	{ 
-		reinterpret_cast<BYTE*>(mShaders["standardVS"]->GetBufferPointer()), 
-		mShaders["standardVS"]->GetBufferSize()
-	};
-	opaquePsoDesc.HS =
+	mBasePso = GraphicsPsoBuilder()
+		.RootSignature(mRootSignature.Get())
+		.InputLayout(mInputLayout)
+		.VS(mShaders["standardVS"].Get())
+		.HS(mShaders["standardHS"].Get())
+		.DS(mShaders["standardDS"].Get())
+		.PS(mShaders["opaquePS"].Get())
+		.TopologyType(D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH)
+		.RenderTarget(mBackBufferFormat)
+		.DepthStencil(mDepthStencilFormat)
+		.Msaa(m4xMsaaState ? 4 : 1, m4xMsaaState ? (m4xMsaaQuality - 1) : 0);
+
+	struct DrawPathShaders
 	{
-		reinterpret_cast<BYTE*>(mShaders["standardHS"]->GetBufferPointer()),
-		mShaders["standardHS"]->GetBufferSize()
+		DrawPath Path;
+		const char* VS;
+		const char* PS;
 	};
-	opaquePsoDesc.DS =
+	const DrawPathShaders drawPaths[] =
 	{
-		reinterpret_cast<BYTE*>(mShaders["standardDS"]->GetBufferPointer()),
-		mShaders["standardDS"]->GetBufferSize()
-	};
-	opaquePsoDesc.PS = 
-	{ 
-		reinterpret_cast<BYTE*>(mShaders["opaquePS"]->GetBufferPointer()),
-		mShaders["opaquePS"]->GetBufferSize()
+		{ DrawPath::Standard, "standardVS", "opaquePS" },
+		{ DrawPath::Instanced, "instancedVS", "opaquePS" },
+		{ DrawPath::Bindless, "bindlessVS", "bindlessPS" },
 	};
-	opaquePsoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-	opaquePsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
-	opaquePsoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-	opaquePsoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
-	opaquePsoDesc.SampleMask = UINT_MAX;
-	opaquePsoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH;
-	opaquePsoDesc.NumRenderTargets = 1;
-	opaquePsoDesc.RTVFormats[0] = mBackBufferFormat;
-	opaquePsoDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
-	opaquePsoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
-	opaquePsoDesc.DSVFormat = mDepthStencilFormat;
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&mPSOs["wireframe"])));
-
 
+	for(const auto& drawPath : drawPaths)
+	{
+		// The bindless shaders read the unbounded table, which is not in the root
+		// signature on tier 1.
+		if(drawPath.Path == DrawPath::Bindless && !mBindlessSupported)
+			continue;
 
+		GraphicsPsoBuilder builder = mBasePso;
+		builder.VS(mShaders[drawPath.VS].Get()).PS(mShaders[drawPath.PS].Get());
 
-	D3D12_GRAPHICS_PIPELINE_STATE_DESC solidPsoDesc;
+		builder.FillMode(D3D12_FILL_MODE_SOLID);
+		mDrawPathPSOs[(int)drawPath.Path][0] = mPsoCache->GetOrCreate(builder.Desc(), mRootSignatureHash);
 
-	//
-	// PSO for opaque objects.
-	//
-	ZeroMemory(&solidPsoDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
-	solidPsoDesc.InputLayout = { mInputLayout.data(), (UINT)mInputLayout.size() };
-	solidPsoDesc.pRootSignature = mRootSignature.Get();
-	solidPsoDesc.VS =
-	{
-		reinterpret_cast<BYTE*>(mShaders["standardVS"]->GetBufferPointer()),
-		mShaders["standardVS"]->GetBufferSize()
-	};
-	solidPsoDesc.HS =
-	{
-		reinterpret_cast<BYTE*>(mShaders["standardHS"]->GetBufferPointer()),
-		mShaders["standardHS"]->GetBufferSize()
-	};
-	solidPsoDesc.DS =
-	{
-		reinterpret_cast<BYTE*>(mShaders["standardDS"]->GetBufferPointer()),
-		mShaders["standardDS"]->GetBufferSize()
-	};
-	solidPsoDesc.PS =
-	{
-		reinterpret_cast<BYTE*>(mShaders["opaquePS"]->GetBufferPointer()),
-		mShaders["opaquePS"]->GetBufferSize()
-	};
-	solidPsoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-	solidPsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
-	solidPsoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-	solidPsoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
-	solidPsoDesc.SampleMask = UINT_MAX;
-	solidPsoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH;
-	solidPsoDesc.NumRenderTargets = 1;
-	solidPsoDesc.RTVFormats[0] = mBackBufferFormat;
-	solidPsoDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
-	solidPsoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
-	solidPsoDesc.DSVFormat = mDepthStencilFormat;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&solidPsoDesc, IID_PPV_ARGS(&mPSOs["solid"])));
+		builder.FillMode(D3D12_FILL_MODE_WIREFRAME);
+		mDrawPathPSOs[(int)drawPath.Path][1] = mPsoCache->GetOrCreate(builder.Desc(), mRootSignatureHash);
+	}
 }
 
 void TexColumnsApp::BuildFrameResources()
 {
 	FlushCommandQueue();
 	mFrameResources.clear();
+	mUploadRing = std::make_unique<UploadRing>(md3dDevice.Get(), gUploadRingSize);
     for(int i = 0; i < gNumFrameResources; ++i)
     {
         mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-            1, (UINT)mAllRitems.size(), (UINT)mMaterials.size()));
+            (UINT)mAllRitems.size(), (UINT)mAllRitems.size()));
     }
 	mCurrFrameResourceIndex = 0;
 	mCurrFrameResource = mFrameResources[mCurrFrameResourceIndex].get();
@@ -1237,18 +2488,30 @@ void TexColumnsApp::BuildFrameResources()
 	}
 }
 
+void TexColumnsApp::GrowFrameResources()
+{
+	// Only appends pool chunks; the chunks the GPU may still be reading stay where they
+	// are, so there is no need to flush the queue.  New items start with
+	// NumFramesDirty = gNumFrameResources and get written into every frame resource.
+	for(auto& frameResource : mFrameResources)
+	{
+		frameResource->ObjectCB->Reserve((UINT)mAllRitems.size());
+		frameResource->InstanceBuffer->Reserve((UINT)mAllRitems.size());
+	}
+}
+
 void TexColumnsApp::BuildMaterials()
 {
-	/*CreateMaterial("NiggaMat", 0, TexOffsets["textures/texture"], TexOffsets["textures/texture_nm"], __, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);
-	CreateMaterial("eye", 0, TexOffsets["textures/eye"], TexOffsets["textures/eye_nm"], __, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);
-	CreateMaterial("map", 0, TexOffsets["textures/HeightMap2"], TexOffsets["textures/HeightMap2"], __, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);*/
-	CreateMaterial("map2", 0, TexOffsets["textures/stone"], TexOffsets["textures/stone_nmap"], TexOffsets["textures/stone_disp"], XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);
-	CreateMaterial("bricks2", 0, TexOffsets["textures/redbrick_diff"], TexOffsets["textures/redbrick_nmap"], TexOffsets["textures/redbrick_disp"], XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);
-	CreateMaterial("bricks3", 0, TexOffsets["textures/rock"], TexOffsets["textures/rock_nmap"], TexOffsets["textures/rock_disp"], XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);
-	CreateMaterial("rocks", 0, TexOffsets["textures/rocks"], TexOffsets["textures/rocks_nmap"], TexOffsets["textures/rocks_disp"], XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);
+	/*CreateMaterial("NiggaMat", TexOffsets["textures/texture"], TexOffsets["textures/texture_nm"], __, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);
+	CreateMaterial("eye", TexOffsets["textures/eye"], TexOffsets["textures/eye_nm"], __, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);
+	CreateMaterial("map", TexOffsets["textures/HeightMap2"], TexOffsets["textures/HeightMap2"], __, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);*/
+	CreateMaterial("map2", TexOffsets["textures/stone"], TexOffsets["textures/stone_nmap"], TexOffsets["textures/stone_disp"], XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);
+	CreateMaterial("bricks2", TexOffsets["textures/redbrick_diff"], TexOffsets["textures/redbrick_nmap"], TexOffsets["textures/redbrick_disp"], XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);
+	CreateMaterial("bricks3", TexOffsets["textures/rock"], TexOffsets["textures/rock_nmap"], TexOffsets["textures/rock_disp"], XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);
+	CreateMaterial("rocks", TexOffsets["textures/rocks"], TexOffsets["textures/rocks_nmap"], TexOffsets["textures/rocks_disp"], XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.3f);
 	
 }
-void TexColumnsApp::RenderCustomMesh(std::string unique_name, std::string meshname, std::string materialName, XMMATRIX Scale, XMMATRIX Rotation, XMMATRIX Translation)
+void TexColumnsApp::RenderCustomMesh(std::string unique_name, std::string meshname, std::string materialName, const TransformTRS& transform)
 {
 	for (int i = 0;i < ObjectsMeshCount[meshname];i++)
 	{
@@ -1256,7 +2519,7 @@ void TexColumnsApp::RenderCustomMesh(std::string unique_name, std::string meshna
 		std::string textureFile;
 		rItem->Name = unique_name;
 		XMStoreFloat4x4(&rItem->TexTransform, XMMatrixScaling(1, 1., 1.));
-		XMStoreFloat4x4(&rItem->World, Scale * Rotation * Translation);
+		rItem->Transform = transform;
 		rItem->ObjCBIndex = mAllRitems.size();
 		rItem->Geo = mGeometries["shapeGeo"].get();
 		rItem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -1268,10 +2531,12 @@ void TexColumnsApp::RenderCustomMesh(std::string unique_name, std::string meshna
 		rItem->IndexCount = rItem->Geo->MultiDrawArgs[meshname][i].second.IndexCount;
 		rItem->StartIndexLocation = rItem->Geo->MultiDrawArgs[meshname][i].second.StartIndexLocation;
 		rItem->BaseVertexLocation = rItem->Geo->MultiDrawArgs[meshname][i].second.BaseVertexLocation;
+		rItem->Bounds = rItem->Geo->MultiDrawArgs[meshname][i].second.Bounds;
 		mAllRitems.push_back(std::move(rItem));
 		mOpaqueRitems.push_back(mAllRitems[mAllRitems.size() - 1].get());
 	}
-	BuildFrameResources();
+	mInstanceBatchesDirty = true;
+	GrowFrameResources();
 }
 
 
@@ -1280,7 +2545,7 @@ void TexColumnsApp::BuildRenderItems()
 {
 	auto boxRitem = std::make_unique<RenderItem>();
 	boxRitem->Name = "plane";
-	XMStoreFloat4x4(&boxRitem->World, XMMatrixScaling(1.0f, 1.0f,1.0f) * XMMatrixTranslation(0.0f, -1.0f, 3.0f));
+	boxRitem->Transform.Translation = XMFLOAT3(0.0f, -1.0f, 3.0f);
 	XMStoreFloat4x4(&boxRitem->TexTransform, XMMatrixScaling(1,1,1)*XMMatrixTranslation(0,0,0));
 	boxRitem->ObjCBIndex = 0;
 	boxRitem->Mat = mMaterials["map2"].get();
@@ -1289,11 +2554,12 @@ void TexColumnsApp::BuildRenderItems()
 	boxRitem->IndexCount = boxRitem->Geo->DrawArgs["grid"].IndexCount;
 	boxRitem->StartIndexLocation = boxRitem->Geo->DrawArgs["grid"].StartIndexLocation;
 	boxRitem->BaseVertexLocation = boxRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
+	boxRitem->Bounds = boxRitem->Geo->DrawArgs["grid"].Bounds;
 	mAllRitems.push_back(std::move(boxRitem));
 
 	auto box1Ritem = std::make_unique<RenderItem>();
 	box1Ritem->Name = "plane2";
-	XMStoreFloat4x4(&box1Ritem->World, XMMatrixScaling(1.0f, 1.0f, 1.0f) * XMMatrixTranslation(30.0f, -1.0f, 3.0f));
+	box1Ritem->Transform.Translation = XMFLOAT3(30.0f, -1.0f, 3.0f);
 	XMStoreFloat4x4(&box1Ritem->TexTransform, XMMatrixScaling(1, 1, 1));
 	box1Ritem->ObjCBIndex = 1;
 	box1Ritem->Mat = mMaterials["bricks2"].get();
@@ -1302,11 +2568,12 @@ void TexColumnsApp::BuildRenderItems()
 	box1Ritem->IndexCount = box1Ritem->Geo->DrawArgs["grid"].IndexCount;
 	box1Ritem->StartIndexLocation = box1Ritem->Geo->DrawArgs["grid"].StartIndexLocation;
 	box1Ritem->BaseVertexLocation = box1Ritem->Geo->DrawArgs["grid"].BaseVertexLocation;
+	box1Ritem->Bounds = box1Ritem->Geo->DrawArgs["grid"].Bounds;
 	mAllRitems.push_back(std::move(box1Ritem));
 
 	auto box2Ritem = std::make_unique<RenderItem>();
 	box2Ritem->Name = "plane3";
-	XMStoreFloat4x4(&box2Ritem->World, XMMatrixScaling(1.0f, 1.0f, 1.0f) * XMMatrixTranslation(30.0f, -1.0f, 33.0f));
+	box2Ritem->Transform.Translation = XMFLOAT3(30.0f, -1.0f, 33.0f);
 	XMStoreFloat4x4(&box2Ritem->TexTransform, XMMatrixScaling(1, 1, 1));
 	box2Ritem->ObjCBIndex = 2;
 	box2Ritem->Mat = mMaterials["bricks3"].get();
@@ -1315,11 +2582,12 @@ void TexColumnsApp::BuildRenderItems()
 	box2Ritem->IndexCount = box2Ritem->Geo->DrawArgs["grid"].IndexCount;
 	box2Ritem->StartIndexLocation = box2Ritem->Geo->DrawArgs["grid"].StartIndexLocation;
 	box2Ritem->BaseVertexLocation = box2Ritem->Geo->DrawArgs["grid"].BaseVertexLocation;
+	box2Ritem->Bounds = box2Ritem->Geo->DrawArgs["grid"].Bounds;
 	mAllRitems.push_back(std::move(box2Ritem));
 
 	auto box3Ritem = std::make_unique<RenderItem>();
 	box3Ritem->Name = "plane4";
-	XMStoreFloat4x4(&box3Ritem->World, XMMatrixScaling(1.0f, 1.0f, 1.0f) * XMMatrixTranslation(0.0f, -1.0f, 33.0f));
+	box3Ritem->Transform.Translation = XMFLOAT3(0.0f, -1.0f, 33.0f);
 	XMStoreFloat4x4(&box3Ritem->TexTransform, XMMatrixScaling(1, 1, 1));
 	box3Ritem->ObjCBIndex = 3;
 	box3Ritem->Mat = mMaterials["rocks"].get();
@@ -1328,14 +2596,15 @@ void TexColumnsApp::BuildRenderItems()
 	box3Ritem->IndexCount = box3Ritem->Geo->DrawArgs["grid"].IndexCount;
 	box3Ritem->StartIndexLocation = box3Ritem->Geo->DrawArgs["grid"].StartIndexLocation;
 	box3Ritem->BaseVertexLocation = box3Ritem->Geo->DrawArgs["grid"].BaseVertexLocation;
+	box3Ritem->Bounds = box3Ritem->Geo->DrawArgs["grid"].Bounds;
 	mAllRitems.push_back(std::move(box3Ritem));
 
-	//RenderCustomMesh("building", "sponza", "", XMMatrixScaling(0.07, 0.07, 0.07), XMMatrixRotationRollPitchYaw(0, 3.14 / 2, 0), XMMatrixTranslation(0, 0, 0));
-/*	RenderCustomMesh("nigga", "negr", "NiggaMat", XMMatrixScaling(3, 3, 3), XMMatrixRotationRollPitchYaw(0, 3.14, 0), XMMatrixTranslation(0, 3, 0));
-	RenderCustomMesh("eyeL", "left", "eye", XMMatrixScaling(3, 3, 3), XMMatrixRotationRollPitchYaw(0, 3.14, 0), XMMatrixIdentity());
-	RenderCustomMesh("eyeR", "right", "eye", XMMatrixScaling(3, 3, 3), XMMatrixRotationRollPitchYaw(0, 3.14, 0), XMMatrixIdentity());
-	*///RenderCustomMesh("plan", "plane2", "map", XMMatrixScaling(3, 3, 3), XMMatrixRotationRollPitchYaw(3.14, 0, 3.14), XMMatrixTranslation(0,-10,0));
-	//RenderCustomMesh("plan", "plane2", "map2", XMMatrixScaling(3, 3, 3), XMMatrixRotationRollPitchYaw(3.14, 0, 3.14), XMMatrixTranslation(0,10,0));
+	//RenderCustomMesh("building", "sponza", "", TransformTRS::Make(XMFLOAT3(0.07, 0.07, 0.07), 0, 3.14 / 2, 0, XMFLOAT3(0, 0, 0)));
+/*	RenderCustomMesh("nigga", "negr", "NiggaMat", TransformTRS::Make(XMFLOAT3(3, 3, 3), 0, 3.14, 0, XMFLOAT3(0, 3, 0)));
+	RenderCustomMesh("eyeL", "left", "eye", TransformTRS::Make(XMFLOAT3(3, 3, 3), 0, 3.14, 0, XMFLOAT3(0, 0, 0)));
+	RenderCustomMesh("eyeR", "right", "eye", TransformTRS::Make(XMFLOAT3(3, 3, 3), 0, 3.14, 0, XMFLOAT3(0, 0, 0)));
+	*///RenderCustomMesh("plan", "plane2", "map", TransformTRS::Make(XMFLOAT3(3, 3, 3), 3.14, 0, 3.14, XMFLOAT3(0,-10,0)));
+	//RenderCustomMesh("plan", "plane2", "map2", TransformTRS::Make(XMFLOAT3(3, 3, 3), 3.14, 0, 3.14, XMFLOAT3(0,10,0)));
 	// All the render items are opaque.
 	for (auto& e : mAllRitems)
 	{
@@ -1345,35 +2614,57 @@ void TexColumnsApp::BuildRenderItems()
 		}
 		mOpaqueRitems.push_back(e.get());
 	}
+
+	BuildStressRenderItems();
+}
+
+void TexColumnsApp::BuildStressRenderItems()
+{
+	UINT side = (UINT)std::ceil(std::sqrt((double)mStressObjectCount));
+	for(UINT i = 0; i < mStressObjectCount; ++i)
+	{
+		auto ri = std::make_unique<RenderItem>();
+		ri->Name = "stress";
+		ri->StressOnly = true;
+		ri->Transform = TransformTRS::Make(XMFLOAT3(0.1f, 0.1f, 0.1f), 0.0f, 0.001f * i, 0.0f,
+			XMFLOAT3((i % side) * gStressObjectSpacing, -10.0f, (i / side) * gStressObjectSpacing));
+		ri->ObjCBIndex = (UINT)mAllRitems.size();
+		ri->Mat = mMaterials["map2"].get();
+		ri->Geo = mGeometries["shapeGeo"].get();
+		mAllRitems.push_back(std::move(ri));
+	}
 }
 
 void TexColumnsApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
-    UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+	PROFILE_ZONE("DrawRenderItems");
+
     UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
  
-	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
-	auto matCB = mCurrFrameResource->MaterialCB->Resource();
+	auto objectCB = mCurrFrameResource->ObjectCB.get();
+	auto matCBAddressBase = mCurrFrameResource->MaterialCBAddress;
+
+	ArenaVector<RenderItem*> sortedRitems(ritems.begin(), ritems.end(), mFrameArena.Allocator<RenderItem*>());
+	if(mPermutationsEnabled)
+		SortByPermutation(sortedRitems);
 
     // For each render item...
-    for(size_t i = 0; i < ritems.size(); ++i)
+    for(size_t i = 0; i < sortedRitems.size(); ++i)
     {
-        auto ri = ritems[i];
+        auto ri = sortedRitems[i];
+		BindPermutation(cmdList, ri->Permutation, DrawPath::Standard);
+
         cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
         cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-        cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
+        cmdList->IASetPrimitiveTopology(PermutationTopology(ri->Permutation));
 
-		CD3DX12_GPU_DESCRIPTOR_HANDLE diffuseHandle(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		diffuseHandle.Offset(ri->Mat->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
+		CD3DX12_GPU_DESCRIPTOR_HANDLE diffuseHandle = mSrvHeap->GpuHandle(ri->Mat->DiffuseSrvHeapIndex);
 		cmdList->SetGraphicsRootDescriptorTable(0, diffuseHandle);
-		CD3DX12_GPU_DESCRIPTOR_HANDLE normalHandle(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		normalHandle.Offset(ri->Mat->NormalSrvHeapIndex, mCbvSrvDescriptorSize);
+		CD3DX12_GPU_DESCRIPTOR_HANDLE normalHandle = mSrvHeap->GpuHandle(ri->Mat->NormalSrvHeapIndex);
 		cmdList->SetGraphicsRootDescriptorTable(1, normalHandle);
-		CD3DX12_GPU_DESCRIPTOR_HANDLE dispHandle(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		dispHandle.Offset(ri->Mat->DispSrvHeapIndex, mCbvSrvDescriptorSize);
+		CD3DX12_GPU_DESCRIPTOR_HANDLE dispHandle = mSrvHeap->GpuHandle(ri->Mat->DispSrvHeapIndex);
 		cmdList->SetGraphicsRootDescriptorTable(2, dispHandle);
-		CD3DX12_GPU_DESCRIPTOR_HANDLE decaldispHandle(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		decaldispHandle.Offset(TexOffsets["textures/ochko"], mCbvSrvDescriptorSize);
+		CD3DX12_GPU_DESCRIPTOR_HANDLE decaldispHandle = mSrvHeap->GpuHandle(mDecalSrvIndex);
 		cmdList->SetGraphicsRootDescriptorTable(3, decaldispHandle);
 
 
@@ -1382,16 +2673,362 @@ void TexColumnsApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const st
 		//normalHandle.Offset(ri->Mat->NormalSrvHeapIndex, mCbvSrvDescriptorSize);
 		//cmdList->SetGraphicsRootDescriptorTable(1, normalHandle);
 
-        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex*matCBByteSize;
+        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress(ri->ObjCBIndex);
+		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCBAddressBase + ri->Mat->MatCBIndex*matCBByteSize;
 
         cmdList->SetGraphicsRootConstantBufferView(4, objCBAddress);
         cmdList->SetGraphicsRootConstantBufferView(6, matCBAddress);
 
         cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+
+		Counters::Add(CounterDrawCalls);
+		Counters::Add(CounterTriangles, ri->IndexCount / 3);
+		Counters::Add(CounterRootParameterSets, 6);
+		Counters::Add(CounterDescriptorTableBinds, 4);
+		Counters::Add(CounterRootCbvBinds, 2);
     }
 }
 
+void TexColumnsApp::BuildInstanceBatches()
+{
+	// Group by everything that has to match for one DrawIndexedInstanced call.
+	using BatchKey = std::tuple<MeshGeometry*, Material*, UINT, UINT, int>;
+	std::map<BatchKey, std::vector<RenderItem*>> groups;
+	for(auto ri : mOpaqueRitems)
+	{
+		BatchKey key(ri->Geo, ri->Mat, ri->IndexCount, ri->StartIndexLocation, ri->BaseVertexLocation);
+		groups[key].push_back(ri);
+	}
+
+	mInstanceBatches.clear();
+	UINT instanceIndex = 0;
+	for(auto& group : groups)
+	{
+		size_t next = 0;
+		while(next < group.second.size())
+		{
+			InstanceBatch batch;
+			batch.Geo = std::get<0>(group.first);
+			batch.Mat = std::get<1>(group.first);
+			batch.IndexCount = std::get<2>(group.first);
+			batch.StartIndexLocation = std::get<3>(group.first);
+			batch.BaseVertexLocation = std::get<4>(group.first);
+			batch.StartInstance = instanceIndex;
+
+			// A batch is bound through one root SRV, so it is split where the
+			// instance buffer moves on to its next chunk.
+			UINT roomInChunk = FrameResource::InstanceChunkSize - instanceIndex % FrameResource::InstanceChunkSize;
+			batch.InstanceCount = (UINT)std::min<size_t>(roomInChunk, group.second.size() - next);
+
+			// Instance slots moved, so every frame resource has to be rewritten.
+			for(UINT i = 0; i < batch.InstanceCount; ++i)
+			{
+				RenderItem* ri = group.second[next++];
+				ri->InstanceIndex = instanceIndex++;
+				ri->InstanceBatchIndex = (UINT)mInstanceBatches.size();
+				ri->NumFramesDirty = gNumFrameResources;
+			}
+
+			mInstanceBatches.push_back(batch);
+		}
+	}
+
+	// Stress objects are never drawn but still own an instance slot each.
+	for(auto& ri : mAllRitems)
+	{
+		if(ri->StressOnly)
+			ri->InstanceIndex = instanceIndex++;
+	}
+
+	mInstanceBatchesDirty = false;
+}
+
+void TexColumnsApp::DrawInstanceBatches(ID3D12GraphicsCommandList* cmdList)
+{
+	PROFILE_ZONE("DrawInstanceBatches");
+
+	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+
+	auto matCBAddressBase = mCurrFrameResource->MaterialCBAddress;
+	auto instanceBuffer = mCurrFrameResource->InstanceBuffer.get();
+
+	CD3DX12_GPU_DESCRIPTOR_HANDLE decaldispHandle = mSrvHeap->GpuHandle(mDecalSrvIndex);
+	cmdList->SetGraphicsRootDescriptorTable(3, decaldispHandle);
+	Counters::Add(CounterRootParameterSets);
+	Counters::Add(CounterDescriptorTableBinds);
+
+	ArenaVector<const InstanceBatch*> sortedBatches(mFrameArena.Allocator<const InstanceBatch*>());
+	sortedBatches.reserve(mInstanceBatches.size());
+	for(const auto& batch : mInstanceBatches)
+		sortedBatches.push_back(&batch);
+	if(mPermutationsEnabled)
+		SortByPermutation(sortedBatches);
+
+	for(const InstanceBatch* batchPtr : sortedBatches)
+	{
+		const InstanceBatch& batch = *batchPtr;
+		BindPermutation(cmdList, batch.Permutation, DrawPath::Instanced);
+
+		cmdList->IASetVertexBuffers(0, 1, &batch.Geo->VertexBufferView());
+		cmdList->IASetIndexBuffer(&batch.Geo->IndexBufferView());
+		cmdList->IASetPrimitiveTopology(PermutationTopology(batch.Permutation));
+
+		CD3DX12_GPU_DESCRIPTOR_HANDLE diffuseHandle = mSrvHeap->GpuHandle(batch.Mat->DiffuseSrvHeapIndex);
+		cmdList->SetGraphicsRootDescriptorTable(0, diffuseHandle);
+		CD3DX12_GPU_DESCRIPTOR_HANDLE normalHandle = mSrvHeap->GpuHandle(batch.Mat->NormalSrvHeapIndex);
+		cmdList->SetGraphicsRootDescriptorTable(1, normalHandle);
+		CD3DX12_GPU_DESCRIPTOR_HANDLE dispHandle = mSrvHeap->GpuHandle(batch.Mat->DispSrvHeapIndex);
+		cmdList->SetGraphicsRootDescriptorTable(2, dispHandle);
+
+		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCBAddressBase + batch.Mat->MatCBIndex*matCBByteSize;
+		cmdList->SetGraphicsRootConstantBufferView(6, matCBAddress);
+
+		// Batches never straddle two instance chunks (see BuildInstanceBatches).
+		cmdList->SetGraphicsRootShaderResourceView(7, instanceBuffer->GetChunkGPUVirtualAddress(batch.StartInstance));
+		cmdList->SetGraphicsRoot32BitConstant(8, batch.StartInstance % instanceBuffer->GetChunkSize(), 0);
+
+		cmdList->DrawIndexedInstanced(batch.IndexCount, batch.InstanceCount, batch.StartIndexLocation, batch.BaseVertexLocation, 0);
+
+		Counters::Add(CounterDrawCalls);
+		Counters::Add(CounterTriangles, (std::uint64_t)batch.IndexCount / 3 * batch.InstanceCount);
+		Counters::Add(CounterRootParameterSets, 6);
+		Counters::Add(CounterDescriptorTableBinds, 3);
+		Counters::Add(CounterRootCbvBinds);
+	}
+}
+
+void TexColumnsApp::DrawBindless(ID3D12GraphicsCommandList* cmdList)
+{
+	PROFILE_ZONE("DrawBindless");
+
+	auto instanceBuffer = mCurrFrameResource->InstanceBuffer.get();
+
+	// Everything except the base instance is bound once per frame.  The texture table
+	// starts at the first persistent descriptor, so SRV heap indices are table indices.
+	cmdList->SetGraphicsRootDescriptorTable(9, mSrvHeap->GpuHandle(0));
+	cmdList->SetGraphicsRootShaderResourceView(10, mCurrFrameResource->MaterialDataAddress);
+	cmdList->SetGraphicsRootDescriptorTable(3, mSrvHeap->GpuHandle(mDecalSrvIndex));
+	Counters::Add(CounterRootParameterSets, 3);
+	Counters::Add(CounterDescriptorTableBinds, 2);
+
+	MeshGeometry* boundGeo = nullptr;
+	D3D_PRIMITIVE_TOPOLOGY boundTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	D3D12_GPU_VIRTUAL_ADDRESS boundInstanceChunk = 0;
+
+	auto draw = [&](MeshGeometry* geo, const ShaderPermutationKey& permutation, UINT indexCount, UINT startIndexLocation,
+		int baseVertexLocation, UINT startInstance, UINT instanceCount)
+	{
+		BindPermutation(cmdList, permutation, DrawPath::Bindless);
+
+		if(geo != boundGeo)
+		{
+			cmdList->IASetVertexBuffers(0, 1, &geo->VertexBufferView());
+			cmdList->IASetIndexBuffer(&geo->IndexBufferView());
+			boundGeo = geo;
+		}
+
+		D3D_PRIMITIVE_TOPOLOGY topology = PermutationTopology(permutation);
+		if(topology != boundTopology)
+		{
+			cmdList->IASetPrimitiveTopology(topology);
+			boundTopology = topology;
+		}
+
+		// The instance buffer root SRV only changes when a draw moves on to another chunk.
+		D3D12_GPU_VIRTUAL_ADDRESS instanceChunk = instanceBuffer->GetChunkGPUVirtualAddress(startInstance);
+		if(instanceChunk != boundInstanceChunk)
+		{
+			cmdList->SetGraphicsRootShaderResourceView(7, instanceChunk);
+			Counters::Add(CounterRootParameterSets);
+			boundInstanceChunk = instanceChunk;
+		}
+
+		cmdList->SetGraphicsRoot32BitConstant(8, startInstance % instanceBuffer->GetChunkSize(), 0);
+		cmdList->DrawIndexedInstanced(indexCount, instanceCount, startIndexLocation, baseVertexLocation, 0);
+
+		Counters::Add(CounterDrawCalls);
+		Counters::Add(CounterTriangles, (std::uint64_t)indexCount / 3 * instanceCount);
+		Counters::Add(CounterRootParameterSets);
+	};
+
+	// The instance data holds the world matrices and material index of every item, so
+	// without instancing each item is drawn as a batch of one.
+	if(mInstancingEnabled)
+	{
+		ArenaVector<const InstanceBatch*> sortedBatches(mFrameArena.Allocator<const InstanceBatch*>());
+		sortedBatches.reserve(mInstanceBatches.size());
+		for(const auto& batch : mInstanceBatches)
+			sortedBatches.push_back(&batch);
+		if(mPermutationsEnabled)
+			SortByPermutation(sortedBatches);
+
+		for(const InstanceBatch* batch : sortedBatches)
+			draw(batch->Geo, batch->Permutation, batch->IndexCount, batch->StartIndexLocation, batch->BaseVertexLocation, batch->StartInstance, batch->InstanceCount);
+	}
+	else
+	{
+		ArenaVector<RenderItem*> sortedRitems(mOpaqueRitems.begin(), mOpaqueRitems.end(), mFrameArena.Allocator<RenderItem*>());
+		if(mPermutationsEnabled)
+			SortByPermutation(sortedRitems);
+
+		for(auto ri : sortedRitems)
+			draw(ri->Geo, ri->Permutation, ri->IndexCount, ri->StartIndexLocation, ri->BaseVertexLocation, ri->InstanceIndex, 1);
+	}
+}
+
+void TexColumnsApp::SelectPermutations()
+{
+	// With permutations off every draw uses the full shader, as the fixed PSOs do.
+	const ShaderPermutationKey fullKey = ShaderPermutationKeyBuilder()
+		.Tessellation()
+		.Decal()
+		.NormalMap()
+		.Lights(gNumDirLights, gNumPointLights, gNumSpotLights)
+		.Build();
+
+	PermutationSceneInfo scene;
+	scene.NumDirLights = gNumDirLights;
+	scene.NumPointLights = gNumPointLights;
+	scene.NumSpotLights = gNumSpotLights;
+	scene.DecalReach = std::max(mMainPassCB.DecalRadius, mMainPassCB.DecalFalloffRadius);
+	scene.TessellationDistance = mMainPassCB.gMaxTessDistance;
+
+	XMVECTOR eyePos = cam.GetPosition();
+	XMVECTOR decalPos = XMLoadFloat3(&mMainPassCB.decalPosition);
+
+	for(auto& batch : mInstanceBatches)
+		batch.Permutation = ShaderPermutationKey();
+
+	for(auto ri : mOpaqueRitems)
+	{
+		if(mPermutationsEnabled)
+		{
+			// World space bounding sphere of the object space box.
+			const TransformTRS& t = ri->Transform;
+			XMVECTOR center = XMLoadFloat3(&ri->Bounds.Center) * XMLoadFloat3(&t.Scale);
+			center = XMVector3Rotate(center, XMLoadFloat4(&t.Rotation)) + XMLoadFloat3(&t.Translation);
+			float maxScale = std::max(std::max(fabsf(t.Scale.x), fabsf(t.Scale.y)), fabsf(t.Scale.z));
+
+			PermutationItemInfo item;
+			item.Radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&ri->Bounds.Extents))) * maxScale;
+			item.DistanceToEye = XMVectorGetX(XMVector3Length(center - eyePos));
+			item.DistanceToDecal = XMVectorGetX(XMVector3Length(center - decalPos));
+			item.HasNormalMap = ri->Mat->HasNormalMap;
+
+			// A point light contributes nothing beyond FalloffEnd.
+			item.PointLightMask = 0;
+			for(UINT i = 0; i < gNumPointLights; ++i)
+			{
+				const Light& light = mMainPassCB.Lights[gNumDirLights + i];
+				float distance = XMVectorGetX(XMVector3Length(center - XMLoadFloat3(&light.Position)));
+				if(distance - item.Radius < light.FalloffEnd)
+					item.PointLightMask |= 1u << i;
+			}
+
+			ri->Permutation = SelectShaderPermutation(item, scene);
+		}
+		else
+		{
+			ri->Permutation = fullKey;
+		}
+
+		InstanceBatch& batch = mInstanceBatches[ri->InstanceBatchIndex];
+		batch.Permutation = ShaderPermutationKey::Merge(batch.Permutation, ri->Permutation);
+	}
+}
+
+void TexColumnsApp::BuildPermutationPSOs()
+{
+	// Every variant SelectPermutations can pick for the loaded items, wherever the
+	// camera, lights and decal move, on every draw path and fill mode.  Compiling
+	// during Draw would stall the frame that first needs a variant.
+	bool withNormalMap = false;
+	bool withoutNormalMap = false;
+	for(auto ri : mOpaqueRitems)
+	{
+		if(ri->Mat->HasNormalMap)
+			withNormalMap = true;
+		else
+			withoutNormalMap = true;
+	}
+
+	PermutationSceneInfo scene;
+	scene.NumDirLights = gNumDirLights;
+	scene.NumPointLights = gNumPointLights;
+	scene.NumSpotLights = gNumSpotLights;
+	std::vector<ShaderPermutationKey> keys = ReachableShaderPermutations(scene, withNormalMap, withoutNormalMap);
+
+	for(int path = 0; path < (int)DrawPath::Count; ++path)
+	{
+		if((DrawPath)path == DrawPath::Bindless && !mBindlessSupported)
+			continue;
+
+		for(const auto& key : keys)
+		{
+			GetPermutationPSO(key, (DrawPath)path, true);
+			GetPermutationPSO(key, (DrawPath)path, false);
+		}
+	}
+
+	std::cout << "Permutation PSOs: " << keys.size() << " variants, " << mPermutationPSOs.size() << " PSOs\n";
+}
+
+ID3D12PipelineState* TexColumnsApp::GetPermutationPSO(const ShaderPermutationKey& key, DrawPath path, bool solid)
+{
+	std::uint64_t psoKey = (std::uint64_t)key.Pack() << 8 | (std::uint64_t)path << 1 | (solid ? 1 : 0);
+	auto it = mPermutationPSOs.find(psoKey);
+	if(it != mPermutationPSOs.end())
+		return it->second;
+
+	// Normally only reached from BuildPermutationPSOs; items added later with a new
+	// kind of material build their variant here.  The shader cache keeps later runs
+	// from recompiling.
+	std::vector<ShaderDefine> defines = key.Defines();
+	if(path == DrawPath::Bindless)
+		defines.push_back({ "BINDLESS", "1" });
+
+	std::vector<D3D_SHADER_MACRO> macros;
+	for(const auto& d : defines)
+		macros.push_back({ d.Name.c_str(), d.Value.c_str() });
+	macros.push_back({ NULL, NULL });
+
+	auto compile = [&](const std::string& entryPoint, const std::string& target)
+	{
+		std::string name = entryPoint + "_" + key.Name() + (path == DrawPath::Bindless ? "_bindless" : "");
+		ComPtr<ID3DBlob>& blob = mShaders[name];
+		if(blob == nullptr)
+			blob = d3dUtil::CompileShaderCached(L"Shaders\\Default.hlsl", macros.data(), entryPoint, target);
+		return blob.Get();
+	};
+
+	bool tessellation = key.Has(ShaderFeatureTessellation);
+
+	GraphicsPsoBuilder builder = mBasePso;
+	builder.FillMode(solid ? D3D12_FILL_MODE_SOLID : D3D12_FILL_MODE_WIREFRAME)
+		.VS(compile(path == DrawPath::Standard ? "VS" : "InstancedVS", "vs_5_1"))
+		.PS(compile("PS", "ps_5_1"))
+		.HS(tessellation ? compile("HSMain", "hs_5_1") : nullptr)
+		.DS(tessellation ? compile("DSMain", "ds_5_1") : nullptr)
+		.TopologyType(tessellation ? D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH : D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE);
+
+	// Equal descriptions (e.g. the full key and the fixed PSO) share one PSO.
+	ID3D12PipelineState* pso = mPsoCache->GetOrCreate(builder.Desc(), mRootSignatureHash);
+	mPermutationPSOs[psoKey] = pso;
+	return pso;
+}
+
+void TexColumnsApp::BindPermutation(ID3D12GraphicsCommandList* cmdList, const ShaderPermutationKey& key, DrawPath path)
+{
+	// Without permutations the PSO set by Reset() in Draw() is used for everything.
+	if(!mPermutationsEnabled || (mPermutationBound && key == mBoundPermutation))
+		return;
+
+	cmdList->SetPipelineState(GetPermutationPSO(key, path, isFillModeSolid));
+	mBoundPermutation = key;
+	mPermutationBound = true;
+	Counters::Add(CounterPipelineStateSets);
+}
+
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> TexColumnsApp::GetStaticSamplers()
 {
 	// Applications usually only need a handful of samplers.  So just define them all up front
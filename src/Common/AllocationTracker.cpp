@@ -0,0 +1,429 @@
+//***************************************************************************************
+// AllocationTracker.cpp
+//***************************************************************************************
+
+#include "AllocationTracker.h"
+#include "Counters.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace
+{
+	// Static storage only: the tracker runs inside operator new, so it must not
+	// allocate, and it may run before any dynamic initializer.
+	AllocationTracker::ThreadAllocations gThreads[AllocationTracker::MaxThreads];
+	std::atomic<std::uint32_t> gThreadCount{ 0 };
+
+	struct CallSiteSlot
+	{
+		std::atomic<std::uint64_t> Hash;
+		std::atomic<bool> Ready;
+		void* Frames[AllocationCallSite::MaxDepth];
+		std::atomic<std::uint64_t> Allocations;
+		std::atomic<std::uint64_t> Bytes;
+	};
+	CallSiteSlot gCallSites[AllocationTracker::CallSiteCapacity];
+	std::atomic<std::uint64_t> gDroppedCallSites{ 0 };
+	std::atomic<bool> gCaptureCallSites{ false };
+
+	// Frame state, only touched by the thread calling EndFrame().
+	AllocationCounts gLastTotals;
+	AllocationCounts gLastFrame;
+	bool gChecking = false;
+	std::uint32_t gWarmupFramesLeft = 0;
+	std::uint64_t gCheckedFrames = 0;
+	std::uint64_t gViolations = 0;
+
+	std::uint32_t ClaimedThreadCount()
+	{
+		std::uint32_t count = gThreadCount.load(std::memory_order_acquire);
+		return count < AllocationTracker::MaxThreads ? count : AllocationTracker::MaxThreads;
+	}
+
+	void RecordCallSite(std::size_t size)
+	{
+		void* frames[AllocationCallSite::MaxDepth] = {};
+#if defined(_WIN32)
+		// Skips this function, RecordAllocation and operator new.  Where the compiler
+		// inlined them the first frames kept are allocator internals instead.
+		CaptureStackBackTrace(3, AllocationCallSite::MaxDepth, frames, nullptr);
+#else
+		frames[0] = __builtin_return_address(0);
+#endif
+
+		// FNV-1a over the frame addresses; 0 marks an empty slot.
+		std::uint64_t hash = 14695981039346656037ull;
+		for(void* frame : frames)
+		{
+			hash ^= (std::uint64_t)(std::uintptr_t)frame;
+			hash *= 1099511628211ull;
+		}
+		hash |= 1;
+
+		const std::uint32_t mask = AllocationTracker::CallSiteCapacity - 1;
+		for(std::uint32_t probe = 0; probe < AllocationTracker::CallSiteCapacity; ++probe)
+		{
+			CallSiteSlot& slot = gCallSites[(hash + probe) & mask];
+
+			std::uint64_t slotHash = slot.Hash.load(std::memory_order_acquire);
+			if(slotHash == 0)
+			{
+				if(slot.Hash.compare_exchange_strong(slotHash, hash, std::memory_order_acq_rel))
+				{
+					std::copy(std::begin(frames), std::end(frames), slot.Frames);
+					slot.Ready.store(true, std::memory_order_release);
+					slotHash = hash;
+				}
+			}
+
+			if(slotHash == hash)
+			{
+				slot.Allocations.fetch_add(1, std::memory_order_relaxed);
+				slot.Bytes.fetch_add(size, std::memory_order_relaxed);
+				return;
+			}
+		}
+
+		gDroppedCallSites.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void AllocationTracker::RecordAllocation(std::size_t size)
+{
+#if ALLOCATION_TRACKING_ENABLED
+	// Only this thread writes its slot, so it needs no read-modify-write.
+	ThreadAllocations& thread = LocalThread();
+	thread.Allocations.store(thread.Allocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	thread.Bytes.store(thread.Bytes.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+
+	if(gCaptureCallSites.load(std::memory_order_relaxed))
+		RecordCallSite(size);
+#endif
+}
+
+void AllocationTracker::RecordFree()
+{
+#if ALLOCATION_TRACKING_ENABLED
+	ThreadAllocations& thread = LocalThread();
+	thread.Frees.store(thread.Frees.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+#endif
+}
+
+void AllocationTracker::EndFrame()
+{
+	AllocationCounts totals;
+	std::uint32_t threadCount = ClaimedThreadCount();
+	for(std::uint32_t i = 0; i < threadCount; ++i)
+	{
+		totals.Allocations += gThreads[i].Allocations.load(std::memory_order_relaxed);
+		totals.Bytes += gThreads[i].Bytes.load(std::memory_order_relaxed);
+		totals.Frees += gThreads[i].Frees.load(std::memory_order_relaxed);
+	}
+
+	gLastFrame.Allocations = totals.Allocations - gLastTotals.Allocations;
+	gLastFrame.Bytes = totals.Bytes - gLastTotals.Bytes;
+	gLastFrame.Frees = totals.Frees - gLastTotals.Frees;
+	gLastTotals = totals;
+
+	Counters::Set(CounterAllocations, gLastFrame.Allocations);
+	Counters::Set(CounterAllocatedBytes, gLastFrame.Bytes);
+
+	if(!gChecking)
+		return;
+
+	if(gWarmupFramesLeft > 0)
+	{
+		if(--gWarmupFramesLeft == 0)
+		{
+			ClearCallSites();
+			SetCallSiteCapture(true);
+		}
+		return;
+	}
+
+	gCheckedFrames++;
+	if(gLastFrame.Allocations != 0)
+		gViolations++;
+}
+
+AllocationCounts AllocationTracker::GetLastFrame()
+{
+	return gLastFrame;
+}
+
+void AllocationTracker::BeginZeroAllocationCheck(std::uint32_t warmupFrames)
+{
+	gChecking = true;
+	gWarmupFramesLeft = warmupFrames + 1;
+	gCheckedFrames = 0;
+	gViolations = 0;
+}
+
+void AllocationTracker::EndZeroAllocationCheck()
+{
+	gChecking = false;
+	SetCallSiteCapture(false);
+}
+
+bool AllocationTracker::IsCheckingZeroAllocations()
+{
+	return gChecking;
+}
+
+std::uint64_t AllocationTracker::GetCheckedFrameCount()
+{
+	return gCheckedFrames;
+}
+
+std::uint64_t AllocationTracker::GetViolationCount()
+{
+	return gViolations;
+}
+
+void AllocationTracker::SetCallSiteCapture(bool enable)
+{
+	gCaptureCallSites.store(enable, std::memory_order_relaxed);
+}
+
+bool AllocationTracker::IsCallSiteCaptureEnabled()
+{
+	return gCaptureCallSites.load(std::memory_order_relaxed);
+}
+
+void AllocationTracker::GetCallSites(std::vector<AllocationCallSite>& sites)
+{
+	sites.clear();
+	for(const auto& slot : gCallSites)
+	{
+		if(!slot.Ready.load(std::memory_order_acquire))
+			continue;
+
+		AllocationCallSite site;
+		std::copy(std::begin(slot.Frames), std::end(slot.Frames), site.Frames);
+		site.Allocations = slot.Allocations.load(std::memory_order_relaxed);
+		site.Bytes = slot.Bytes.load(std::memory_order_relaxed);
+		if(site.Allocations != 0)
+			sites.push_back(site);
+	}
+
+	std::sort(sites.begin(), sites.end(), [](const AllocationCallSite& a, const AllocationCallSite& b)
+	{
+		return a.Allocations > b.Allocations;
+	});
+}
+
+std::uint64_t AllocationTracker::GetDroppedCallSiteCount()
+{
+	return gDroppedCallSites.load(std::memory_order_relaxed);
+}
+
+void AllocationTracker::ClearCallSites()
+{
+	// Sites stay claimed so concurrent captures never see a half-reset slot; only
+	// their counts restart.
+	for(auto& slot : gCallSites)
+	{
+		slot.Allocations.store(0, std::memory_order_relaxed);
+		slot.Bytes.store(0, std::memory_order_relaxed);
+	}
+	gDroppedCallSites.store(0, std::memory_order_relaxed);
+}
+
+std::string AllocationTracker::DescribeAddress(void* address)
+{
+	char text[320];
+#if defined(_WIN32)
+	HMODULE module = nullptr;
+	char path[MAX_PATH] = {};
+	if(GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+		(LPCSTR)address, &module) && GetModuleFileNameA(module, path, MAX_PATH) != 0)
+	{
+		const char* name = std::strrchr(path, '\\');
+		std::snprintf(text, sizeof(text), "%s+0x%llx", name != nullptr ? name + 1 : path,
+			(unsigned long long)((std::uintptr_t)address - (std::uintptr_t)module));
+		return text;
+	}
+#endif
+	std::snprintf(text, sizeof(text), "0x%llx", (unsigned long long)(std::uintptr_t)address);
+	return text;
+}
+
+AllocationTracker::ThreadAllocations* AllocationTracker::RegisterThread()
+{
+	std::uint32_t index = gThreadCount.fetch_add(1, std::memory_order_acq_rel);
+	tlsThread = &gThreads[index < MaxThreads ? index : MaxThreads - 1];
+	return tlsThread;
+}
+
+#if ALLOCATION_TRACKING_ENABLED
+
+// Replacements of every global allocation function that a program may replace, so
+// that no form of new bypasses the count.
+
+void* operator new(std::size_t size)
+{
+	AllocationTracker::RecordAllocation(size);
+
+	if(size == 0)
+		size = 1;
+	for(;;)
+	{
+		if(void* p = std::malloc(size))
+			return p;
+
+		std::new_handler handler = std::get_new_handler();
+		if(handler == nullptr)
+			throw std::bad_alloc();
+		handler();
+	}
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return operator new(size);
+	}
+	catch(...)
+	{
+		return nullptr;
+	}
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept
+{
+	if(p == nullptr)
+		return;
+
+	AllocationTracker::RecordFree();
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	operator delete(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	operator delete(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	operator delete(p);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	AllocationTracker::RecordAllocation(size);
+
+	if(size == 0)
+		size = 1;
+	for(;;)
+	{
+#if defined(_MSC_VER)
+		void* p = _aligned_malloc(size, (std::size_t)alignment);
+#else
+		std::size_t rounded = (size + (std::size_t)alignment - 1) & ~((std::size_t)alignment - 1);
+		void* p = std::aligned_alloc((std::size_t)alignment, rounded);
+#endif
+		if(p != nullptr)
+			return p;
+
+		std::new_handler handler = std::get_new_handler();
+		if(handler == nullptr)
+			throw std::bad_alloc();
+		handler();
+	}
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return operator new(size, alignment);
+	}
+	catch(...)
+	{
+		return nullptr;
+	}
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return operator new(size, alignment, std::nothrow);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+	if(p == nullptr)
+		return;
+
+	AllocationTracker::RecordFree();
+#if defined(_MSC_VER)
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+
+void operator delete[](void* p, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+
+void operator delete(void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	operator delete(p, alignment);
+}
+
+void operator delete[](void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	operator delete(p, alignment);
+}
+
+#endif
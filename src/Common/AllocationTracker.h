@@ -0,0 +1,122 @@
+//***************************************************************************************
+// AllocationTracker.h
+//
+// Counts heap allocations per thread, per frame and per profiler zone.  The global
+// operator new/delete are replaced (in AllocationTracker.cpp) to feed it; allocators
+// that bypass them, such as ImGui's, can report through RecordAllocation/RecordFree.
+//   -Every thread counts into a slot of its own, claimed on its first allocation from
+//    a static array, so counting takes no lock and never allocates itself.
+//   -Call-site capture (off by default) records a short stack per allocation in a
+//    fixed table, for finding what allocates in a frame that should not.
+//   -The zero-allocation check counts the frames after a warm-up that allocated at
+//    all, so a steady state without heap traffic can be enforced.
+// Tracking is off unless ALLOCATION_TRACKING_ENABLED is defined to 1, as the Profile
+// configuration of TexColumns does: otherwise the default operator new is kept and
+// every count is zero.  No D3D types are used.
+//***************************************************************************************
+
+#pragma once
+
+#ifndef ALLOCATION_TRACKING_ENABLED
+#define ALLOCATION_TRACKING_ENABLED 0
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct AllocationCounts
+{
+	std::uint64_t Allocations = 0;
+	std::uint64_t Bytes = 0;
+	std::uint64_t Frees = 0;
+};
+
+struct AllocationCallSite
+{
+	static const std::uint32_t MaxDepth = 6;
+
+	// Innermost first; unused entries are null.
+	void* Frames[MaxDepth] = {};
+	std::uint64_t Allocations = 0;
+	std::uint64_t Bytes = 0;
+};
+
+class AllocationTracker
+{
+public:
+	// Threads past this many share the last slot, and may lose counts to races.
+	static const std::uint32_t MaxThreads = 256;
+	static const std::uint32_t CallSiteCapacity = 4096;
+
+	// Counts of one thread since it first allocated.  Only the owning thread writes.
+	struct alignas(64) ThreadAllocations
+	{
+		std::atomic<std::uint64_t> Allocations;
+		std::atomic<std::uint64_t> Bytes;
+		std::atomic<std::uint64_t> Frees;
+	};
+
+	static void RecordAllocation(std::size_t size);
+	static void RecordFree();
+
+	// Totals of the calling thread; the difference of two calls is what the thread
+	// allocated in between.
+	static AllocationCounts GetThreadCounts()
+	{
+#if ALLOCATION_TRACKING_ENABLED
+		const ThreadAllocations& thread = LocalThread();
+		AllocationCounts counts;
+		counts.Allocations = thread.Allocations.load(std::memory_order_relaxed);
+		counts.Bytes = thread.Bytes.load(std::memory_order_relaxed);
+		counts.Frees = thread.Frees.load(std::memory_order_relaxed);
+		return counts;
+#else
+		return AllocationCounts();
+#endif
+	}
+
+	// Closes the current frame and publishes its totals to the Counters gauges.  Call
+	// once per frame from the main loop; the frame queries below belong to the same
+	// thread.
+	static void EndFrame();
+
+	// Allocations of all threads in the last closed frame.
+	static AllocationCounts GetLastFrame();
+
+	// Every frame closed more than warmupFrames after this call that allocated is a
+	// violation.  Call-site capture is switched on (and cleared) when the warm-up
+	// ends, so the call sites then describe the violations.
+	static void BeginZeroAllocationCheck(std::uint32_t warmupFrames);
+	static void EndZeroAllocationCheck();
+	static bool IsCheckingZeroAllocations();
+	static std::uint64_t GetCheckedFrameCount();
+	static std::uint64_t GetViolationCount();
+
+	static void SetCallSiteCapture(bool enable);
+	static bool IsCallSiteCaptureEnabled();
+
+	// Captured call sites, most allocations first.  Sites that did not fit in the
+	// table are counted by GetDroppedCallSiteCount().
+	static void GetCallSites(std::vector<AllocationCallSite>& sites);
+	static std::uint64_t GetDroppedCallSiteCount();
+	static void ClearCallSites();
+
+	// "module+0xoffset" for a code address, to be resolved against the module's PDB.
+	static std::string DescribeAddress(void* address);
+
+private:
+	static ThreadAllocations& LocalThread()
+	{
+		ThreadAllocations* thread = tlsThread;
+		if(thread == nullptr)
+			thread = RegisterThread();
+		return *thread;
+	}
+
+	static ThreadAllocations* RegisterThread();
+
+	inline static thread_local ThreadAllocations* tlsThread = nullptr;
+};
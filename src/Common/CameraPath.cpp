@@ -0,0 +1,229 @@
+//***************************************************************************************
+// CameraPath.cpp
+//***************************************************************************************
+
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	// Hermite interpolation of one component.  m0 and m1 are rates per second, h is the
+	// length of the segment in seconds and u the position in it, 0 to 1.
+	float Hermite(float p0, float m0, float p1, float m1, double h, double u)
+	{
+		double u2 = u * u;
+		double u3 = u2 * u;
+		double h00 = 2.0 * u3 - 3.0 * u2 + 1.0;
+		double h10 = u3 - 2.0 * u2 + u;
+		double h01 = -2.0 * u3 + 3.0 * u2;
+		double h11 = u3 - u2;
+		return (float)(h00 * p0 + h10 * h * m0 + h01 * p1 + h11 * h * m1);
+	}
+}
+
+bool CameraPath::AddKeyframe(double time, const CameraPose& pose)
+{
+	if(!mKeyframes.empty() && !(time > mKeyframes.back().Time))
+		return false;
+
+	CameraKeyframe key;
+	key.Time = time;
+	key.Pose = pose;
+	mKeyframes.push_back(key);
+	return true;
+}
+
+const std::vector<CameraKeyframe>& CameraPath::GetKeyframes()const
+{
+	return mKeyframes;
+}
+
+bool CameraPath::IsEmpty()const
+{
+	return mKeyframes.empty();
+}
+
+double CameraPath::GetDuration()const
+{
+	return mKeyframes.empty() ? 0.0 : mKeyframes.back().Time - mKeyframes.front().Time;
+}
+
+CameraPose CameraPath::Evaluate(double time)const
+{
+	if(time <= mKeyframes.front().Time)
+		return mKeyframes.front().Pose;
+	if(time >= mKeyframes.back().Time)
+		return mKeyframes.back().Pose;
+
+	// Segment [i, i + 1] holding time.
+	auto next = std::upper_bound(mKeyframes.begin(), mKeyframes.end(), time, [](double t, const CameraKeyframe& key)
+	{
+		return t < key.Time;
+	});
+	std::size_t i = (std::size_t)(next - mKeyframes.begin()) - 1;
+
+	// Rates at keyframe k: the slope between its neighbours, one-sided at the ends.
+	auto tangent = [this](std::size_t k)
+	{
+		std::size_t a = k == 0 ? k : k - 1;
+		std::size_t b = k + 1 == mKeyframes.size() ? k : k + 1;
+		const CameraPose& pa = mKeyframes[a].Pose;
+		const CameraPose& pb = mKeyframes[b].Pose;
+		double dt = mKeyframes[b].Time - mKeyframes[a].Time;
+
+		CameraPose rate;
+		for(int c = 0; c < 3; ++c)
+		{
+			rate.Position[c] = (float)((pb.Position[c] - pa.Position[c]) / dt);
+			rate.Look[c] = (float)((pb.Look[c] - pa.Look[c]) / dt);
+		}
+		return rate;
+	};
+
+	const CameraKeyframe& k0 = mKeyframes[i];
+	const CameraKeyframe& k1 = mKeyframes[i + 1];
+	CameraPose m0 = tangent(i);
+	CameraPose m1 = tangent(i + 1);
+	double h = k1.Time - k0.Time;
+	double u = (time - k0.Time) / h;
+
+	CameraPose pose;
+	for(int c = 0; c < 3; ++c)
+	{
+		pose.Position[c] = Hermite(k0.Pose.Position[c], m0.Position[c], k1.Pose.Position[c], m1.Position[c], h, u);
+		pose.Look[c] = Hermite(k0.Pose.Look[c], m0.Look[c], k1.Pose.Look[c], m1.Look[c], h, u);
+	}
+	return pose;
+}
+
+void CameraPath::Clear()
+{
+	mKeyframes.clear();
+}
+
+bool CameraPath::Load(const std::filesystem::path& file, std::string& error)
+{
+	std::ifstream fin(file);
+	if(!fin)
+	{
+		error = "cannot open " + file.string();
+		return false;
+	}
+
+	CameraPath path;
+	std::string line;
+	for(int lineNumber = 1; std::getline(fin, line); ++lineNumber)
+	{
+		std::size_t first = line.find_first_not_of(" \t\r");
+		if(first == std::string::npos || line[first] == '#')
+			continue;
+
+		std::istringstream in(line);
+		double time = 0.0;
+		CameraPose pose;
+		in >> time >> pose.Position[0] >> pose.Position[1] >> pose.Position[2]
+			>> pose.Look[0] >> pose.Look[1] >> pose.Look[2];
+		if(!in)
+		{
+			error = "line " + std::to_string(lineNumber) + ": expected time px py pz lx ly lz";
+			return false;
+		}
+		if(!path.AddKeyframe(time, pose))
+		{
+			error = "line " + std::to_string(lineNumber) + ": keyframe times must increase";
+			return false;
+		}
+	}
+
+	if(path.IsEmpty())
+	{
+		error = file.string() + " has no keyframes";
+		return false;
+	}
+
+	mKeyframes = std::move(path.mKeyframes);
+	return true;
+}
+
+bool CameraPath::Save(const std::filesystem::path& file)const
+{
+	std::error_code ec;
+	if(file.has_parent_path())
+		std::filesystem::create_directories(file.parent_path(), ec);
+
+	std::ofstream fout(file, std::ios::trunc);
+	if(!fout)
+		return false;
+
+	fout.precision(9);
+	fout << "# time px py pz lx ly lz\n";
+	for(const auto& key : mKeyframes)
+	{
+		const CameraPose& p = key.Pose;
+		fout << key.Time << ' ' << p.Position[0] << ' ' << p.Position[1] << ' ' << p.Position[2] << ' '
+			<< p.Look[0] << ' ' << p.Look[1] << ' ' << p.Look[2] << '\n';
+	}
+	return (bool)fout;
+}
+
+CameraPathPlayback::CameraPathPlayback(CameraPath path, double stepSeconds, std::uint32_t warmupFrames, std::uint32_t frameCount) :
+	mPath(std::move(path)),
+	mStepSeconds(stepSeconds),
+	mWarmupFrames(warmupFrames),
+	mFrameCount(frameCount)
+{
+}
+
+bool CameraPathPlayback::Next(CameraPose& pose)
+{
+	if(mFrame >= mWarmupFrames + mFrameCount)
+		return false;
+
+	// Computed from the frame number rather than accumulated, so no error builds up.
+	mTime = 0.0;
+	if(mFrame >= mWarmupFrames)
+	{
+		double duration = mPath.GetDuration();
+		mTime = (mFrame - mWarmupFrames) * mStepSeconds;
+		if(mTime > duration)
+			mTime = duration > 0.0 ? std::fmod(mTime, duration) : 0.0;
+	}
+
+	pose = mPath.Evaluate(mPath.GetKeyframes().front().Time + mTime);
+	mFrame++;
+	return true;
+}
+
+bool CameraPathPlayback::IsMeasuring()const
+{
+	return mFrame > mWarmupFrames;
+}
+
+double CameraPathPlayback::GetTime()const
+{
+	return mTime;
+}
+
+double CameraPathPlayback::GetStepSeconds()const
+{
+	return mStepSeconds;
+}
+
+std::uint32_t CameraPathPlayback::GetFrame()const
+{
+	return mFrame;
+}
+
+std::uint32_t CameraPathPlayback::GetTotalFrames()const
+{
+	return mWarmupFrames + mFrameCount;
+}
+
+const CameraPath& CameraPathPlayback::GetPath()const
+{
+	return mPath;
+}
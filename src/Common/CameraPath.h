@@ -0,0 +1,97 @@
+//***************************************************************************************
+// CameraPath.h
+//
+// Camera keyframes for reproducible fly-throughs.
+//   -CameraPath holds keyframes of position and look direction at given times and
+//    evaluates a Hermite spline through them, with Catmull-Rom tangents scaled by the
+//    actual keyframe spacing so the motion stays smooth when keys are uneven.  Paths
+//    are stored as text, one keyframe per line: "time px py pz lx ly lz".
+//   -CameraPathPlayback steps through a path at a fixed timestep for a fixed number of
+//    frames, independent of wall-clock time, so every run sees the same views.
+// No D3D types are used.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct CameraPose
+{
+	float Position[3] = { 0.0f, 0.0f, 0.0f };
+
+	// Not normalized; interpolated directions get shorter between keys.
+	float Look[3] = { 0.0f, 0.0f, 1.0f };
+};
+
+struct CameraKeyframe
+{
+	double Time = 0.0;   // seconds
+	CameraPose Pose;
+};
+
+class CameraPath
+{
+public:
+	// Keyframe times must increase.  Returns false and leaves the path unchanged if
+	// time is not after the last keyframe's.
+	bool AddKeyframe(double time, const CameraPose& pose);
+
+	const std::vector<CameraKeyframe>& GetKeyframes()const;
+	bool IsEmpty()const;
+
+	// Time from the first keyframe to the last.
+	double GetDuration()const;
+
+	// Pose at time on the keyframes' clock, clamped to the first and last keyframes.
+	// Requires a keyframe.
+	CameraPose Evaluate(double time)const;
+
+	void Clear();
+
+	// On failure the path is unchanged and error says what is wrong with the file.
+	bool Load(const std::filesystem::path& file, std::string& error);
+	bool Save(const std::filesystem::path& file)const;
+
+private:
+	std::vector<CameraKeyframe> mKeyframes;
+};
+
+class CameraPathPlayback
+{
+public:
+	// Plays warmupFrames frames holding the start pose, then frameCount frames moving
+	// stepSeconds along the path per frame.  The path wraps around if the frames run
+	// past its end.  The path must have a keyframe.
+	CameraPathPlayback(CameraPath path, double stepSeconds, std::uint32_t warmupFrames, std::uint32_t frameCount);
+	CameraPathPlayback(const CameraPathPlayback& rhs) = delete;
+	CameraPathPlayback& operator=(const CameraPathPlayback& rhs) = delete;
+
+	// Pose of the next frame.  Returns false, without a pose, once every frame was
+	// played.
+	bool Next(CameraPose& pose);
+
+	// Whether the frame of the last Next() is past the warm-up.
+	bool IsMeasuring()const;
+
+	// Time since the first keyframe of the frame of the last Next().
+	double GetTime()const;
+	double GetStepSeconds()const;
+
+	// Frames returned by Next() so far, warm-up included.
+	std::uint32_t GetFrame()const;
+	std::uint32_t GetTotalFrames()const;
+
+	const CameraPath& GetPath()const;
+
+private:
+	CameraPath mPath;
+	double mStepSeconds;
+	std::uint32_t mWarmupFrames;
+	std::uint32_t mFrameCount;
+
+	std::uint32_t mFrame = 0;
+	double mTime = 0.0;
+};
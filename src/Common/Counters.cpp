@@ -0,0 +1,142 @@
+//***************************************************************************************
+// Counters.cpp
+//***************************************************************************************
+
+#include "Counters.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+	const CounterInfo gCounterInfos[CounterCount] =
+	{
+		{ "Draw calls", "draw_calls", false },
+		{ "Triangles", "triangles", false },
+		{ "Root parameter sets", "root_parameter_sets", false },
+		{ "Descriptor table binds", "descriptor_table_binds", false },
+		{ "Root CBV binds", "root_cbv_binds", false },
+		{ "PSO switches", "pso_switches", false },
+		{ "Upload bytes", "upload_bytes", false },
+		{ "Dirty objects", "dirty_objects", false },
+		{ "Textures resident", "textures_resident", true },
+		{ "Allocations", "allocations", true },
+		{ "Allocated bytes", "allocated_bytes", true },
+	};
+
+	struct CountersState
+	{
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<Counters::ThreadCounters>> Threads;
+		std::atomic<std::uint64_t> Gauges[CounterCount] = {};
+
+		// Sums over all threads at the last EndFrame().
+		std::uint64_t Totals[CounterCount] = {};
+		std::uint64_t LastEndNs = 0;
+
+		std::unique_ptr<CounterFrame[]> Frames{ new CounterFrame[Counters::FrameHistoryCapacity] };
+		std::uint64_t FrameCount = 0;
+	};
+
+	CountersState& State()
+	{
+		static CountersState state;
+		return state;
+	}
+}
+
+void Counters::Set(CounterId id, std::uint64_t value)
+{
+	State().Gauges[id].store(value, std::memory_order_relaxed);
+}
+
+void Counters::EndFrame()
+{
+	CountersState& state = State();
+	std::uint64_t nowNs = Profiler::NowNs();
+
+	std::lock_guard<std::mutex> lock(state.Mutex);
+
+	std::uint64_t totals[CounterCount] = {};
+	for(const auto& thread : state.Threads)
+	{
+		for(int i = 0; i < CounterCount; ++i)
+			totals[i] += thread->Values[i].load(std::memory_order_relaxed);
+	}
+
+	CounterFrame& frame = state.Frames[state.FrameCount & (FrameHistoryCapacity - 1)];
+	frame.Frame = state.FrameCount;
+	frame.StartNs = state.LastEndNs;
+	frame.EndNs = nowNs;
+	for(int i = 0; i < CounterCount; ++i)
+	{
+		frame.Values[i] = gCounterInfos[i].Gauge ?
+			state.Gauges[i].load(std::memory_order_relaxed) : totals[i] - state.Totals[i];
+		state.Totals[i] = totals[i];
+	}
+
+	state.LastEndNs = nowNs;
+	state.FrameCount++;
+}
+
+std::uint64_t Counters::GetFrameCount()
+{
+	CountersState& state = State();
+
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	return state.FrameCount;
+}
+
+bool Counters::GetLastFrame(CounterFrame& frame)
+{
+	CountersState& state = State();
+
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	if(state.FrameCount == 0)
+		return false;
+
+	frame = state.Frames[(state.FrameCount - 1) & (FrameHistoryCapacity - 1)];
+	return true;
+}
+
+void Counters::CollectFrames(std::uint64_t sinceNs, std::vector<CounterFrame>& frames)
+{
+	CountersState& state = State();
+
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	std::uint64_t first = state.FrameCount > FrameHistoryCapacity ? state.FrameCount - FrameHistoryCapacity : 0;
+	for(std::uint64_t i = first; i < state.FrameCount; ++i)
+	{
+		const CounterFrame& frame = state.Frames[i & (FrameHistoryCapacity - 1)];
+		if(frame.StartNs >= sinceNs)
+			frames.push_back(frame);
+	}
+}
+
+void Counters::CollectNewFrames(std::uint64_t& cursor, std::vector<CounterFrame>& frames)
+{
+	CountersState& state = State();
+
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	std::uint64_t first = state.FrameCount > FrameHistoryCapacity ? state.FrameCount - FrameHistoryCapacity : 0;
+	for(std::uint64_t i = std::max(cursor, first); i < state.FrameCount; ++i)
+		frames.push_back(state.Frames[i & (FrameHistoryCapacity - 1)]);
+	cursor = state.FrameCount;
+}
+
+const CounterInfo& Counters::GetInfo(CounterId id)
+{
+	return gCounterInfos[id];
+}
+
+Counters::ThreadCounters* Counters::RegisterThread()
+{
+	CountersState& state = State();
+
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	state.Threads.push_back(std::make_unique<ThreadCounters>());
+	tlsCounters = state.Threads.back().get();
+	return tlsCounters;
+}
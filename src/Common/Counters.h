@@ -0,0 +1,103 @@
+//***************************************************************************************
+// Counters.h
+//
+// Per-frame work counters (draw calls, bytes uploaded, ...) that any thread can bump
+// from its hot loops.  Every thread adds into a block of its own, written only by that
+// thread, so Add() is a relaxed load and store with no lock and no shared cache line.
+// EndFrame() sums the blocks once per frame and keeps a short history of the per-frame
+// values for the UI and the exporters.  Gauges (Set) hold a level instead of a count
+// and report their current value.  No D3D types are used.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+enum CounterId
+{
+	CounterDrawCalls,
+	CounterTriangles,
+	CounterRootParameterSets,      // every SetGraphicsRoot* call
+	CounterDescriptorTableBinds,
+	CounterRootCbvBinds,
+	CounterPipelineStateSets,
+	CounterUploadBytes,            // CPU writes to upload heaps
+	CounterDirtyObjects,
+	CounterTexturesResident,       // gauge
+	CounterAllocations,            // gauge, set per frame by AllocationTracker
+	CounterAllocatedBytes,         // gauge, set per frame by AllocationTracker
+	CounterCount
+};
+
+struct CounterInfo
+{
+	const char* Name;   // for display
+	const char* Key;    // snake_case, for CSV columns and trace series
+	bool Gauge;
+};
+
+// Counter values of one frame.
+struct CounterFrame
+{
+	std::uint64_t Frame = 0;
+	std::uint64_t StartNs = 0;  // Profiler::NowNs() time base
+	std::uint64_t EndNs = 0;
+	std::uint64_t Values[CounterCount] = {};
+};
+
+class Counters
+{
+public:
+	static const std::uint32_t FrameHistoryCapacity = 1 << 10;
+
+	// Counts of one thread since it first added.  Padded to a cache line so that
+	// threads adding at the same time do not share one.
+	struct alignas(64) ThreadCounters
+	{
+		std::atomic<std::uint64_t> Values[CounterCount] = {};
+	};
+
+	static void Add(CounterId id, std::uint64_t amount = 1)
+	{
+		// Only this thread writes the value, so it needs no read-modify-write.
+		std::atomic<std::uint64_t>& value = LocalCounters().Values[id];
+		value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+	// For gauges: replaces the value reported from now on.
+	static void Set(CounterId id, std::uint64_t value);
+
+	// Closes the current frame.  Call once per frame from the main loop, after the
+	// frame's jobs have been waited for.
+	static void EndFrame();
+
+	// Number of EndFrame() calls so far.
+	static std::uint64_t GetFrameCount();
+
+	// The last closed frame; false before the first EndFrame().
+	static bool GetLastFrame(CounterFrame& frame);
+
+	// Appends the frames still in the history that started at or after sinceNs.
+	static void CollectFrames(std::uint64_t sinceNs, std::vector<CounterFrame>& frames);
+
+	// Appends the frames closed since the previous call with the same cursor and
+	// advances it.  Frames that left the history in between are skipped.
+	static void CollectNewFrames(std::uint64_t& cursor, std::vector<CounterFrame>& frames);
+
+	static const CounterInfo& GetInfo(CounterId id);
+
+private:
+	static ThreadCounters& LocalCounters()
+	{
+		ThreadCounters* counters = tlsCounters;
+		if(counters == nullptr)
+			counters = RegisterThread();
+		return *counters;
+	}
+
+	static ThreadCounters* RegisterThread();
+
+	inline static thread_local ThreadCounters* tlsCounters = nullptr;
+};
@@ -0,0 +1,43 @@
+//***************************************************************************************
+// DeferredReleaseQueue.cpp
+//***************************************************************************************
+
+#include "DeferredReleaseQueue.h"
+
+void DeferredReleaseQueue::Release(Microsoft::WRL::ComPtr<ID3D12Pageable> object, UINT64 fenceValue, UINT64 byteSize)
+{
+	assert(mEntries.empty() || mEntries.back().Fence <= fenceValue);
+
+	Entry entry;
+	entry.Object = std::move(object);
+	entry.Fence = fenceValue;
+	entry.ByteSize = byteSize;
+	mEntries.push_back(std::move(entry));
+
+	mPendingBytes += byteSize;
+}
+
+void DeferredReleaseQueue::ReleaseCompleted(UINT64 completedFenceValue)
+{
+	while(!mEntries.empty() && mEntries.front().Fence <= completedFenceValue)
+	{
+		mPendingBytes -= mEntries.front().ByteSize;
+		mEntries.pop_front();
+	}
+}
+
+void DeferredReleaseQueue::ReleaseAll()
+{
+	mEntries.clear();
+	mPendingBytes = 0;
+}
+
+UINT64 DeferredReleaseQueue::GetPendingBytes()const
+{
+	return mPendingBytes;
+}
+
+UINT DeferredReleaseQueue::GetPendingCount()const
+{
+	return (UINT)mEntries.size();
+}
@@ -0,0 +1,44 @@
+//***************************************************************************************
+// DeferredReleaseQueue.h
+//
+// Keeps GPU objects alive until the queue that uses them has passed a fence value,
+// then drops the last reference.  Fence values must be handed in non-decreasing order
+// (they always are for a single fence), so only the front of the queue is checked.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+#include <deque>
+
+class DeferredReleaseQueue
+{
+public:
+	DeferredReleaseQueue() = default;
+	DeferredReleaseQueue(const DeferredReleaseQueue& rhs) = delete;
+	DeferredReleaseQueue& operator=(const DeferredReleaseQueue& rhs) = delete;
+
+	// object is released once the fence reaches fenceValue.  byteSize is only used for
+	// GetPendingBytes().
+	void Release(Microsoft::WRL::ComPtr<ID3D12Pageable> object, UINT64 fenceValue, UINT64 byteSize = 0);
+
+	void ReleaseCompleted(UINT64 completedFenceValue);
+
+	// Only call when the GPU is idle.
+	void ReleaseAll();
+
+	UINT64 GetPendingBytes()const;
+	UINT GetPendingCount()const;
+
+private:
+	struct Entry
+	{
+		Microsoft::WRL::ComPtr<ID3D12Pageable> Object;
+		UINT64 Fence = 0;
+		UINT64 ByteSize = 0;
+	};
+
+	std::deque<Entry> mEntries;
+	UINT64 mPendingBytes = 0;
+};
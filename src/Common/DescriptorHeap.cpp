@@ -0,0 +1,84 @@
+//***************************************************************************************
+// DescriptorHeap.cpp
+//***************************************************************************************
+
+#include "DescriptorHeap.h"
+
+DescriptorHeap::DescriptorHeap(ID3D12Device* device, UINT persistentCount, UINT transientCount) :
+	mPersistentCount(persistentCount),
+	mPersistent(persistentCount),
+	mTransient(transientCount)
+{
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = persistentCount + transientCount;
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mHeap)));
+
+	mDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+UINT DescriptorHeap::AllocatePersistent(UINT count)
+{
+	UINT index = mPersistent.Allocate(count);
+	if(index == FreeListAllocator::InvalidIndex)
+		ThrowIfFailed(E_OUTOFMEMORY);
+
+	return index;
+}
+
+void DescriptorHeap::FreePersistent(UINT index, UINT count)
+{
+	mPersistent.FreeDeferred(index, count);
+}
+
+UINT DescriptorHeap::AllocateTransient(UINT count)
+{
+	UINT64 offset = mTransient.Allocate(count, 1);
+	if(offset == LinearRingAllocator::InvalidOffset)
+		ThrowIfFailed(E_OUTOFMEMORY);
+
+	return mPersistentCount + (UINT)offset;
+}
+
+void DescriptorHeap::FinishFrame(UINT64 fenceValue)
+{
+	mPersistent.FinishFrame(fenceValue);
+	mTransient.FinishFrame(fenceValue);
+}
+
+void DescriptorHeap::ReleaseCompleted(UINT64 completedFenceValue)
+{
+	mPersistent.ReleaseCompleted(completedFenceValue);
+	mTransient.ReleaseCompleted(completedFenceValue);
+}
+
+ID3D12DescriptorHeap* DescriptorHeap::Heap()const
+{
+	return mHeap.Get();
+}
+
+CD3DX12_CPU_DESCRIPTOR_HANDLE DescriptorHeap::CpuHandle(UINT index)const
+{
+	return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), index, mDescriptorSize);
+}
+
+CD3DX12_GPU_DESCRIPTOR_HANDLE DescriptorHeap::GpuHandle(UINT index)const
+{
+	return CD3DX12_GPU_DESCRIPTOR_HANDLE(mHeap->GetGPUDescriptorHandleForHeapStart(), index, mDescriptorSize);
+}
+
+UINT DescriptorHeap::IndexOf(D3D12_CPU_DESCRIPTOR_HANDLE handle)const
+{
+	return (UINT)((handle.ptr - mHeap->GetCPUDescriptorHandleForHeapStart().ptr) / mDescriptorSize);
+}
+
+UINT DescriptorHeap::GetPersistentCount()const
+{
+	return mPersistentCount;
+}
+
+UINT DescriptorHeap::GetPersistentFreeCount()const
+{
+	return mPersistent.GetFreeCount();
+}
@@ -0,0 +1,57 @@
+//***************************************************************************************
+// DescriptorHeap.h
+//
+// Shader visible CBV/SRV/UAV heap split into two regions:
+//   -[0, persistentCount): long-lived descriptors (textures, UI font atlas) managed by a
+//    FreeListAllocator, so they can be created at any time.  Freed slots are reused
+//    only once the frames that may still reference them have completed.
+//   -[persistentCount, persistentCount + transientCount): per-frame descriptors handed
+//    out by a LinearRingAllocator and reclaimed by fence value like UploadRing.
+// All functions take and return slot indices into the heap.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "FreeListAllocator.h"
+#include "LinearRingAllocator.h"
+
+class DescriptorHeap
+{
+public:
+	DescriptorHeap(ID3D12Device* device, UINT persistentCount, UINT transientCount);
+	DescriptorHeap(const DescriptorHeap& rhs) = delete;
+	DescriptorHeap& operator=(const DescriptorHeap& rhs) = delete;
+
+	// Throws if the region is full.
+	UINT AllocatePersistent(UINT count = 1);
+
+	// The slots can be allocated again once the fence passed to the FinishFrame() that
+	// follows reaches its value, so command lists already recorded can still use them.
+	void FreePersistent(UINT index, UINT count = 1);
+
+	// Valid until the fence passed to the FinishFrame() that follows reaches its value.
+	UINT AllocateTransient(UINT count);
+
+	// Tags the transient allocations and persistent frees made since the last call.
+	void FinishFrame(UINT64 fenceValue);
+	void ReleaseCompleted(UINT64 completedFenceValue);
+
+	ID3D12DescriptorHeap* Heap()const;
+	CD3DX12_CPU_DESCRIPTOR_HANDLE CpuHandle(UINT index)const;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE GpuHandle(UINT index)const;
+
+	// Inverse of CpuHandle().
+	UINT IndexOf(D3D12_CPU_DESCRIPTOR_HANDLE handle)const;
+
+	UINT GetPersistentCount()const;
+	UINT GetPersistentFreeCount()const;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap;
+	UINT mDescriptorSize = 0;
+	UINT mPersistentCount = 0;
+
+	FreeListAllocator mPersistent;
+	LinearRingAllocator mTransient;
+};
@@ -0,0 +1,171 @@
+//***************************************************************************************
+// FrameArena.cpp
+//***************************************************************************************
+
+#include "FrameArena.h"
+
+namespace
+{
+	std::atomic<std::uint64_t> gNextFrameArenaId{ 1 };
+
+	// The arenas the calling thread used last, to skip the lookup under the mutex.
+	struct LocalArenas
+	{
+		std::uint64_t OwnerId = 0;
+		void* Arenas = nullptr;
+	};
+
+	thread_local LocalArenas tlsArenas;
+}
+
+LinearArena::LinearArena(std::size_t blockSize) :
+	mBlockSize(blockSize > 0 ? blockSize : 1)
+{
+}
+
+void* LinearArena::Allocate(std::size_t size, std::size_t alignment)
+{
+	for(;;)
+	{
+		if(mCurrentBlock < mBlocks.size())
+		{
+			Block& block = mBlocks[mCurrentBlock];
+
+			// Aligns the address rather than the offset, so any alignment works.
+			std::uintptr_t base = (std::uintptr_t)block.Memory.get();
+			std::uintptr_t aligned = (base + mOffset + alignment - 1) & ~(std::uintptr_t)(alignment - 1);
+			std::size_t end = (std::size_t)(aligned - base) + size;
+			if(end <= block.Size)
+			{
+				mUsed += end - mOffset;
+				mOffset = end;
+				return (void*)aligned;
+			}
+
+			// Blocks kept from earlier frames may still have room.
+			if(mCurrentBlock + 1 < mBlocks.size())
+			{
+				mCurrentBlock++;
+				mOffset = 0;
+				continue;
+			}
+		}
+
+		AddBlock(size + alignment);
+		mCurrentBlock = mBlocks.size() - 1;
+		mOffset = 0;
+	}
+}
+
+void LinearArena::Reset()
+{
+	// A frame that needed several blocks will likely need as much again: merge them
+	// into one so the next frames stay in a single block.
+	if(mBlocks.size() > 1)
+	{
+		std::size_t total = GetCapacity();
+		mBlocks.clear();
+		AddBlock(total);
+	}
+
+	mCurrentBlock = 0;
+	mOffset = 0;
+	mUsed = 0;
+}
+
+std::size_t LinearArena::GetUsedBytes()const
+{
+	return mUsed;
+}
+
+std::size_t LinearArena::GetCapacity()const
+{
+	std::size_t capacity = 0;
+	for(const auto& block : mBlocks)
+		capacity += block.Size;
+	return capacity;
+}
+
+void LinearArena::AddBlock(std::size_t minSize)
+{
+	Block block;
+	block.Size = minSize > mBlockSize ? minSize : mBlockSize;
+	block.Memory.reset(new unsigned char[block.Size]);
+	mBlocks.push_back(std::move(block));
+}
+
+FrameArena::FrameArena(std::uint32_t frameCount, std::size_t blockSize) :
+	mId(gNextFrameArenaId.fetch_add(1, std::memory_order_relaxed)),
+	mFrameCount(frameCount > 0 ? frameCount : 1),
+	mBlockSize(blockSize)
+{
+}
+
+void FrameArena::BeginFrame(std::uint32_t frameIndex)
+{
+	frameIndex %= mFrameCount;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	for(auto& thread : mThreads)
+		thread->Frames[frameIndex]->Reset();
+
+	mCurrentFrame.store(frameIndex, std::memory_order_release);
+}
+
+LinearArena& FrameArena::Local()
+{
+	ThreadArenas* arenas = static_cast<ThreadArenas*>(tlsArenas.Arenas);
+	if(tlsArenas.OwnerId != mId)
+	{
+		arenas = &RegisterThread();
+		tlsArenas.OwnerId = mId;
+		tlsArenas.Arenas = arenas;
+	}
+
+	return *arenas->Frames[mCurrentFrame.load(std::memory_order_acquire)];
+}
+
+std::size_t FrameArena::GetUsedBytes()const
+{
+	std::uint32_t frame = mCurrentFrame.load(std::memory_order_acquire);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	std::size_t used = 0;
+	for(const auto& thread : mThreads)
+		used += thread->Frames[frame]->GetUsedBytes();
+	return used;
+}
+
+std::size_t FrameArena::GetCapacity()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	std::size_t capacity = 0;
+	for(const auto& thread : mThreads)
+	{
+		for(const auto& arena : thread->Frames)
+			capacity += arena->GetCapacity();
+	}
+	return capacity;
+}
+
+FrameArena::ThreadArenas& FrameArena::RegisterThread()
+{
+	std::thread::id self = std::this_thread::get_id();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	// Found when the thread alternates between several FrameArenas.
+	for(auto& thread : mThreads)
+	{
+		if(thread->Thread == self)
+			return *thread;
+	}
+
+	auto thread = std::make_unique<ThreadArenas>();
+	thread->Thread = self;
+	for(std::uint32_t i = 0; i < mFrameCount; ++i)
+		thread->Frames.push_back(std::make_unique<LinearArena>(mBlockSize));
+
+	mThreads.push_back(std::move(thread));
+	return *mThreads.back();
+}
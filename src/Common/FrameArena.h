@@ -0,0 +1,168 @@
+//***************************************************************************************
+// FrameArena.h
+//
+// Bump allocation for transient per-frame CPU data: visible lists, sort keys,
+// per-job scratch.  Nothing is freed individually; a frame's memory is reclaimed all
+// at once when the frame comes around again.
+//   -LinearArena hands out memory linearly from blocks it keeps between resets.  When
+//    a frame outgrows the first block, the next Reset() replaces the blocks with one
+//    block large enough for everything, so the steady state is a single block and
+//    no heap traffic.
+//   -FrameArena keeps one LinearArena per frame in flight and per thread, so jobs
+//    allocate from the calling worker's arena without any synchronization.
+//   -ArenaAllocator/ArenaVector let standard containers live in an arena.
+// No D3D types are used.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+class LinearArena
+{
+public:
+	explicit LinearArena(std::size_t blockSize);
+	LinearArena(const LinearArena& rhs) = delete;
+	LinearArena& operator=(const LinearArena& rhs) = delete;
+
+	// Never returns null; throws std::bad_alloc if a new block cannot be allocated.
+	void* Allocate(std::size_t size, std::size_t alignment);
+
+	// Invalidates everything allocated so far.
+	void Reset();
+
+	// Bytes handed out since the last Reset(), including alignment padding.
+	std::size_t GetUsedBytes()const;
+
+	// Bytes of all blocks held.
+	std::size_t GetCapacity()const;
+
+private:
+	struct Block
+	{
+		std::unique_ptr<unsigned char[]> Memory;
+		std::size_t Size = 0;
+	};
+
+	void AddBlock(std::size_t minSize);
+
+	std::vector<Block> mBlocks;
+	std::size_t mBlockSize;
+
+	// Position in mBlocks[mCurrentBlock].
+	std::size_t mCurrentBlock = 0;
+	std::size_t mOffset = 0;
+
+	std::size_t mUsed = 0;
+};
+
+// Standard allocator over a LinearArena.  deallocate() is a no-op: memory comes back
+// when the arena is reset, so containers must not outlive that.  A vector that grows
+// leaves its old buffers behind until then, so reserve up front where the size is
+// known.
+template<typename T>
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+
+	explicit ArenaAllocator(LinearArena& arena) noexcept :
+		mArena(&arena)
+	{
+	}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept :
+		mArena(other.GetArena())
+	{
+	}
+
+	T* allocate(std::size_t count)
+	{
+		if(count > (std::size_t)-1 / sizeof(T))
+			throw std::bad_array_new_length();
+		return static_cast<T*>(mArena->Allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T*, std::size_t) noexcept
+	{
+	}
+
+	LinearArena* GetArena()const noexcept
+	{
+		return mArena;
+	}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& rhs)const noexcept
+	{
+		return mArena == rhs.GetArena();
+	}
+
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& rhs)const noexcept
+	{
+		return mArena != rhs.GetArena();
+	}
+
+private:
+	LinearArena* mArena;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+class FrameArena
+{
+public:
+	// frameCount arenas per thread, e.g. one per frame resource.  Each arena starts
+	// with blockSize bytes on the first allocation of its thread.
+	FrameArena(std::uint32_t frameCount, std::size_t blockSize);
+	FrameArena(const FrameArena& rhs) = delete;
+	FrameArena& operator=(const FrameArena& rhs) = delete;
+
+	// Resets every thread's arena of frameIndex and makes it the current one.  Memory
+	// allocated in frame frameIndex stays valid until the next BeginFrame(frameIndex).
+	// No other thread may allocate from this FrameArena during the call.
+	void BeginFrame(std::uint32_t frameIndex);
+
+	// The calling thread's arena for the current frame.
+	LinearArena& Local();
+
+	template<typename T>
+	ArenaAllocator<T> Allocator()
+	{
+		return ArenaAllocator<T>(Local());
+	}
+
+	// Over all threads, for the current frame.
+	std::size_t GetUsedBytes()const;
+	std::size_t GetCapacity()const;
+
+private:
+	struct ThreadArenas
+	{
+		std::thread::id Thread;
+		std::vector<std::unique_ptr<LinearArena>> Frames;
+	};
+
+	ThreadArenas& RegisterThread();
+
+	// Distinguishes instances in the per-thread cache, even one created at the
+	// address of a destroyed one.
+	const std::uint64_t mId;
+
+	std::uint32_t mFrameCount;
+	std::size_t mBlockSize;
+	std::atomic<std::uint32_t> mCurrentFrame{ 0 };
+
+	mutable std::mutex mMutex;
+	std::vector<std::unique_ptr<ThreadArenas>> mThreads;
+};
@@ -0,0 +1,132 @@
+//***************************************************************************************
+// FrameLimiter.cpp
+//***************************************************************************************
+
+#include "FrameLimiter.h"
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+namespace
+{
+	const std::int64_t gSleepSliceNs = 1000000;
+
+	// The estimate never goes below one slice, and older samples fade out so a
+	// change in system load is picked up.
+	const std::uint64_t gMaxSleepSamples = 1000;
+}
+
+FrameLimiter::FrameLimiter()
+{
+#if defined(_WIN32)
+	timeBeginPeriod(1);
+#endif
+	mSleepEstimateNs = gSleepSliceNs * 2;
+}
+
+FrameLimiter::~FrameLimiter()
+{
+#if defined(_WIN32)
+	timeEndPeriod(1);
+#endif
+}
+
+void FrameLimiter::SetTargetFrameTime(double seconds)
+{
+	mTargetNs = seconds > 0.0 ? (std::int64_t)(seconds * 1e9) : 0;
+	mNextDeadline = 0;
+}
+
+double FrameLimiter::GetTargetFrameTime()const
+{
+	return mTargetNs / 1e9;
+}
+
+void FrameLimiter::Wait()
+{
+	mLastWaitNs = 0;
+	mLastSpinNs = 0;
+	mLastLatenessNs = 0;
+	if(mTargetNs == 0)
+		return;
+
+	std::int64_t start = Now();
+	if(mNextDeadline == 0 || start - mNextDeadline > mTargetNs)
+	{
+		// First frame, or so far behind that catching up would mean a burst of frames.
+		mNextDeadline = start + mTargetNs;
+		return;
+	}
+
+	std::int64_t deadline = mNextDeadline;
+	mNextDeadline += mTargetNs;
+
+	std::int64_t now = start;
+	while(deadline - now > mSleepEstimateNs)
+	{
+		std::this_thread::sleep_for(std::chrono::nanoseconds(gSleepSliceNs));
+		std::int64_t woke = Now();
+		AddSleepSample(woke - now);
+		now = woke;
+	}
+
+	std::int64_t spinStart = now;
+	while(now < deadline)
+	{
+		std::this_thread::yield();
+		now = Now();
+	}
+
+	mLastWaitNs = now - start;
+	mLastSpinNs = now - spinStart;
+	mLastLatenessNs = now - deadline;
+}
+
+std::int64_t FrameLimiter::GetLastWaitNs()const
+{
+	return mLastWaitNs;
+}
+
+std::int64_t FrameLimiter::GetLastSpinNs()const
+{
+	return mLastSpinNs;
+}
+
+std::int64_t FrameLimiter::GetLastLatenessNs()const
+{
+	return mLastLatenessNs;
+}
+
+std::int64_t FrameLimiter::GetSleepEstimateNs()const
+{
+	return mSleepEstimateNs;
+}
+
+std::int64_t FrameLimiter::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FrameLimiter::AddSleepSample(std::int64_t ns)
+{
+	if(mSleepSamples < gMaxSleepSamples)
+		mSleepSamples++;
+
+	double delta = ns - mSleepMeanNs;
+	mSleepMeanNs += delta / mSleepSamples;
+	mSleepM2 += delta * (ns - mSleepMeanNs);
+	if(mSleepSamples == gMaxSleepSamples)
+		mSleepM2 *= (double)(gMaxSleepSamples - 1) / gMaxSleepSamples;
+
+	double stddev = mSleepSamples > 1 ? std::sqrt(mSleepM2 / (mSleepSamples - 1)) : 0.0;
+	std::int64_t estimate = (std::int64_t)(mSleepMeanNs + stddev);
+	mSleepEstimateNs = estimate > gSleepSliceNs ? estimate : gSleepSliceNs;
+}
@@ -0,0 +1,64 @@
+//***************************************************************************************
+// FrameLimiter.h
+//
+// Caps the frame rate by waiting out the rest of each frame.  OS sleeps are cheap but
+// wake up late by an amount that depends on the timer resolution, while spinning is
+// exact but burns a core, so Wait() does both:
+//   -it sleeps in short slices while more time is left than a slice is expected to
+//    take, where the expectation is the running mean plus one standard deviation of
+//    the slices measured so far, so it adapts to how the OS actually behaves;
+//   -it spins for the rest, yielding to other threads, reading the clock.
+// Deadlines advance by exactly the target frame time, so no error accumulates; after
+// a frame that ran long by more than a whole frame the schedule restarts instead of
+// letting the following frames catch up.  No D3D types are used.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+class FrameLimiter
+{
+public:
+	// On Windows this raises the system timer resolution to 1 ms for the lifetime of
+	// the limiter, so sleep slices are not rounded up to 15.6 ms.
+	FrameLimiter();
+	FrameLimiter(const FrameLimiter& rhs) = delete;
+	FrameLimiter& operator=(const FrameLimiter& rhs) = delete;
+	~FrameLimiter();
+
+	// 0 turns the limiter off.
+	void SetTargetFrameTime(double seconds);
+	double GetTargetFrameTime()const;
+
+	// Call once per frame.  Returns at the next deadline, or at once if the frame
+	// is already late or the limiter is off.
+	void Wait();
+
+	// Of the last Wait(): how long it waited, the part of that spent spinning, and
+	// how late it returned after its deadline.
+	std::int64_t GetLastWaitNs()const;
+	std::int64_t GetLastSpinNs()const;
+	std::int64_t GetLastLatenessNs()const;
+
+	// Time a sleep slice is currently expected to take.
+	std::int64_t GetSleepEstimateNs()const;
+
+	static std::int64_t Now();
+
+private:
+	void AddSleepSample(std::int64_t ns);
+
+	std::int64_t mTargetNs = 0;
+	std::int64_t mNextDeadline = 0;
+
+	// Welford's running mean and variance of the measured sleep slices.
+	std::uint64_t mSleepSamples = 0;
+	double mSleepMeanNs = 0.0;
+	double mSleepM2 = 0.0;
+	std::int64_t mSleepEstimateNs = 0;
+
+	std::int64_t mLastWaitNs = 0;
+	std::int64_t mLastSpinNs = 0;
+	std::int64_t mLastLatenessNs = 0;
+};
@@ -0,0 +1,244 @@
+//***************************************************************************************
+// FrameStats.cpp
+//***************************************************************************************
+
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+FrameSampleRing::FrameSampleRing(std::uint32_t capacity) :
+	mItems(std::max(capacity, 1u))
+{
+}
+
+void FrameSampleRing::push_back(const FrameSample& sample)
+{
+	if(full())
+		pop_front();
+	mItems[(mHead + mCount) % mItems.size()] = sample;
+	mCount++;
+}
+
+void FrameSampleRing::pop_front()
+{
+	mHead = (mHead + 1) % mItems.size();
+	mCount--;
+}
+
+void FrameSampleRing::clear()
+{
+	mHead = 0;
+	mCount = 0;
+}
+
+FrameStats::FrameStats(std::uint32_t windowSize, double stutterThresholdMs, double bucketMs, std::uint32_t bucketCount) :
+	mWindowSize(std::max(windowSize, 1u)),
+	mStutterThresholdMs(stutterThresholdMs),
+	mBucketMs(bucketMs),
+	mSamples(mWindowSize),
+	mHistogram(std::max(bucketCount, 1u), 0),
+	mStutters(MaxStutterEvents)
+{
+}
+
+bool FrameStats::AddFrame(double frameMs, const std::vector<FrameStageTime>& stages, const CounterFrame* counters)
+{
+	FrameSample sample;
+	sample.FrameIndex = mFrameIndex++;
+	sample.FrameMs = frameMs;
+	for(const auto& stage : stages)
+	{
+		if(stage.Ms > sample.DominantStageMs)
+		{
+			sample.DominantStage = stage.Name;
+			sample.DominantStageMs = stage.Ms;
+		}
+	}
+	if(counters != nullptr)
+		std::copy(std::begin(counters->Values), std::end(counters->Values), sample.CounterValues);
+
+	if(mSamples.full())
+		mHistogram[BucketOf(mSamples.front().FrameMs)]--;
+	mSamples.push_back(sample);
+	mHistogram[BucketOf(frameMs)]++;
+
+	if(frameMs <= mStutterThresholdMs)
+		return false;
+
+	mStutters.push_back(sample);
+	mStutterCount++;
+	return true;
+}
+
+FrameStatsSummary FrameStats::ComputeSummary()const
+{
+	FrameStatsSummary summary;
+	summary.FrameCount = (std::uint32_t)mSamples.size();
+	if(mSamples.empty())
+		return summary;
+
+	std::vector<double> sorted;
+	sorted.reserve(mSamples.size());
+	double total = 0.0;
+	for(const auto& sample : mSamples)
+	{
+		sorted.push_back(sample.FrameMs);
+		total += sample.FrameMs;
+	}
+	std::sort(sorted.begin(), sorted.end());
+
+	// Nearest rank: the smallest value with at least p percent of the frames at or
+	// below it.
+	auto percentile = [&sorted](double p)
+	{
+		std::size_t rank = (std::size_t)std::ceil(p / 100.0 * sorted.size());
+		return sorted[std::min(std::max(rank, (std::size_t)1), sorted.size()) - 1];
+	};
+
+	summary.AverageMs = total / sorted.size();
+	summary.P50Ms = percentile(50.0);
+	summary.P95Ms = percentile(95.0);
+	summary.P99Ms = percentile(99.0);
+	summary.MaxMs = sorted.back();
+	return summary;
+}
+
+const std::vector<std::uint32_t>& FrameStats::GetHistogram()const
+{
+	return mHistogram;
+}
+
+double FrameStats::GetBucketMs()const
+{
+	return mBucketMs;
+}
+
+const FrameSampleRing& FrameStats::GetSamples()const
+{
+	return mSamples;
+}
+
+const FrameSampleRing& FrameStats::GetStutters()const
+{
+	return mStutters;
+}
+
+std::uint64_t FrameStats::GetStutterCount()const
+{
+	return mStutterCount;
+}
+
+double FrameStats::GetStutterThresholdMs()const
+{
+	return mStutterThresholdMs;
+}
+
+void FrameStats::SetStutterThresholdMs(double thresholdMs)
+{
+	mStutterThresholdMs = thresholdMs;
+}
+
+void FrameStats::Clear()
+{
+	mSamples.clear();
+	mStutters.clear();
+	mStutterCount = 0;
+	std::fill(mHistogram.begin(), mHistogram.end(), 0);
+}
+
+bool FrameStats::WriteCsv(const std::filesystem::path& file)const
+{
+	std::error_code ec;
+	if(file.has_parent_path())
+		std::filesystem::create_directories(file.parent_path(), ec);
+
+	std::ofstream fout(file, std::ios::trunc);
+	if(!fout)
+		return false;
+
+	fout << "frame,frame_ms,stutter,dominant_stage,dominant_stage_ms";
+	for(int i = 0; i < CounterCount; ++i)
+		fout << ',' << Counters::GetInfo((CounterId)i).Key;
+	fout << '\n';
+
+	for(const auto& sample : mSamples)
+	{
+		fout << sample.FrameIndex << ',' << sample.FrameMs << ','
+			<< (sample.FrameMs > mStutterThresholdMs ? 1 : 0) << ','
+			<< sample.DominantStage << ',' << sample.DominantStageMs;
+		for(int i = 0; i < CounterCount; ++i)
+			fout << ',' << sample.CounterValues[i];
+		fout << '\n';
+	}
+
+	FrameStatsSummary summary = ComputeSummary();
+	fout << "# frames," << summary.FrameCount << '\n'
+		<< "# average_ms," << summary.AverageMs << '\n'
+		<< "# p50_ms," << summary.P50Ms << '\n'
+		<< "# p95_ms," << summary.P95Ms << '\n'
+		<< "# p99_ms," << summary.P99Ms << '\n'
+		<< "# max_ms," << summary.MaxMs << '\n'
+		<< "# stutter_threshold_ms," << mStutterThresholdMs << '\n';
+
+	return (bool)fout;
+}
+
+void FrameStats::ComputeStageTimes(const std::vector<ProfileZone>& zones, std::uint32_t threadIndex,
+	std::vector<FrameStageTime>& stages, std::vector<OpenStageZone>& stack)
+{
+	stages.clear();
+	stack.clear();
+
+	auto addSelfTime = [&stages](const char* name, double ms)
+	{
+		for(auto& stage : stages)
+		{
+			if(stage.Name == name || std::strcmp(stage.Name, name) == 0)
+			{
+				stage.Ms += ms;
+				return;
+			}
+		}
+		FrameStageTime stage;
+		stage.Name = name;
+		stage.Ms = ms;
+		stages.push_back(stage);
+	};
+
+	auto close = [&]()
+	{
+		const OpenStageZone& open = stack.back();
+		std::uint64_t totalNs = open.Zone->EndNs - open.Zone->StartNs;
+		std::uint64_t selfNs = totalNs > open.ChildNs ? totalNs - open.ChildNs : 0;
+		addSelfTime(open.Zone->Name, selfNs / 1e6);
+		stack.pop_back();
+	};
+
+	for(const auto& zone : zones)
+	{
+		if(zone.ThreadIndex != threadIndex)
+			continue;
+
+		while(!stack.empty() && stack.back().Zone->EndNs <= zone.StartNs)
+			close();
+
+		if(!stack.empty())
+			stack.back().ChildNs += zone.EndNs - zone.StartNs;
+
+		OpenStageZone open;
+		open.Zone = &zone;
+		stack.push_back(open);
+	}
+
+	while(!stack.empty())
+		close();
+}
+
+std::uint32_t FrameStats::BucketOf(double frameMs)const
+{
+	double bucket = std::floor(std::max(frameMs, 0.0) / mBucketMs);
+	return (std::uint32_t)std::min(bucket, (double)(mHistogram.size() - 1));
+}
@@ -0,0 +1,163 @@
+//***************************************************************************************
+// FrameStats.h
+//
+// Rolling window of frame times with percentiles, a histogram and stutter detection.
+// A frame slower than the stutter threshold is logged together with the stage that
+// dominated it, i.e. the profiler zone with the largest self time (time not spent in
+// nested zones) on the main thread.  The frame's counter values are kept with it for
+// the CSV.  Storage is sized in the constructor, so adding frames and computing stage
+// times do not allocate once the callers' vectors have grown.  Only standard types,
+// ProfileZone and CounterFrame are used.
+//***************************************************************************************
+
+#pragma once
+
+#include "Counters.h"
+#include "Profiler.h"
+
+#include <filesystem>
+#include <vector>
+
+// Self time of one zone name within a frame.
+struct FrameStageTime
+{
+	const char* Name = nullptr;
+	double Ms = 0.0;
+};
+
+// A zone of ComputeStageTimes still open, with the time spent in its direct children
+// so far.
+struct OpenStageZone
+{
+	const ProfileZone* Zone = nullptr;
+	std::uint64_t ChildNs = 0;
+};
+
+struct FrameSample
+{
+	std::uint64_t FrameIndex = 0;
+	double FrameMs = 0.0;
+
+	// Empty if no stages were reported for the frame.
+	const char* DominantStage = "";
+	double DominantStageMs = 0.0;
+
+	std::uint64_t CounterValues[CounterCount] = {};
+};
+
+struct FrameStatsSummary
+{
+	std::uint32_t FrameCount = 0;
+	double AverageMs = 0.0;
+	double P50Ms = 0.0;
+	double P95Ms = 0.0;
+	double P99Ms = 0.0;
+	double MaxMs = 0.0;
+};
+
+// Fixed-capacity queue of samples, oldest first.  Pushing onto a full ring drops the
+// oldest sample.  The method names follow the std containers it replaces.
+class FrameSampleRing
+{
+public:
+	class ConstIterator
+	{
+	public:
+		ConstIterator(const FrameSampleRing* ring, std::size_t index) : mRing(ring), mIndex(index) {}
+
+		const FrameSample& operator*()const { return (*mRing)[mIndex]; }
+		const FrameSample* operator->()const { return &(*mRing)[mIndex]; }
+		ConstIterator& operator++() { ++mIndex; return *this; }
+		bool operator==(const ConstIterator& rhs)const { return mIndex == rhs.mIndex; }
+		bool operator!=(const ConstIterator& rhs)const { return mIndex != rhs.mIndex; }
+
+	private:
+		const FrameSampleRing* mRing;
+		std::size_t mIndex;
+	};
+
+	explicit FrameSampleRing(std::uint32_t capacity);
+	FrameSampleRing(const FrameSampleRing& rhs) = delete;
+	FrameSampleRing& operator=(const FrameSampleRing& rhs) = delete;
+
+	std::size_t size()const { return mCount; }
+	std::size_t capacity()const { return mItems.size(); }
+	bool empty()const { return mCount == 0; }
+	bool full()const { return mCount == mItems.size(); }
+
+	// 0 is the oldest sample.
+	const FrameSample& operator[](std::size_t i)const { return mItems[(mHead + i) % mItems.size()]; }
+	const FrameSample& front()const { return (*this)[0]; }
+	const FrameSample& back()const { return (*this)[mCount - 1]; }
+
+	ConstIterator begin()const { return ConstIterator(this, 0); }
+	ConstIterator end()const { return ConstIterator(this, mCount); }
+
+	void push_back(const FrameSample& sample);
+	void pop_front();
+	void clear();
+
+private:
+	std::vector<FrameSample> mItems;
+	std::size_t mHead = 0;
+	std::size_t mCount = 0;
+};
+
+class FrameStats
+{
+public:
+	static const std::uint32_t MaxStutterEvents = 64;
+
+	// windowSize frames are kept.  The histogram has bucketCount buckets of bucketMs
+	// each; the last one also holds every slower frame.
+	FrameStats(std::uint32_t windowSize = 1000, double stutterThresholdMs = 33.3,
+		double bucketMs = 2.0, std::uint32_t bucketCount = 25);
+	FrameStats(const FrameStats& rhs) = delete;
+	FrameStats& operator=(const FrameStats& rhs) = delete;
+
+	// Returns true if the frame is a stutter.  counters may be null.
+	bool AddFrame(double frameMs, const std::vector<FrameStageTime>& stages, const CounterFrame* counters = nullptr);
+
+	// Nearest rank percentiles over the window.  Sorts a copy of the window, so call it
+	// when the numbers are shown rather than every frame.
+	FrameStatsSummary ComputeSummary()const;
+
+	// Frame counts per bucket over the window.
+	const std::vector<std::uint32_t>& GetHistogram()const;
+	double GetBucketMs()const;
+
+	const FrameSampleRing& GetSamples()const;
+
+	// Most recent last.  At most MaxStutterEvents are kept.
+	const FrameSampleRing& GetStutters()const;
+	std::uint64_t GetStutterCount()const;
+
+	double GetStutterThresholdMs()const;
+	void SetStutterThresholdMs(double thresholdMs);
+
+	void Clear();
+
+	// One row per frame in the window with its counters, then the summary as comment
+	// lines.
+	bool WriteCsv(const std::filesystem::path& file)const;
+
+	// Sums the self time of zones on one thread by name.  zones must be ordered by
+	// start time.  stack is scratch owned by the caller; keep it between calls so it
+	// stops allocating once it is as deep as the deepest nesting.
+	static void ComputeStageTimes(const std::vector<ProfileZone>& zones, std::uint32_t threadIndex,
+		std::vector<FrameStageTime>& stages, std::vector<OpenStageZone>& stack);
+
+private:
+	std::uint32_t BucketOf(double frameMs)const;
+
+	std::uint32_t mWindowSize;
+	double mStutterThresholdMs;
+	double mBucketMs;
+
+	std::uint64_t mFrameIndex = 0;
+	FrameSampleRing mSamples;
+	std::vector<std::uint32_t> mHistogram;
+
+	FrameSampleRing mStutters;
+	std::uint64_t mStutterCount = 0;
+};
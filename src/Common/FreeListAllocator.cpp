@@ -0,0 +1,120 @@
+//***************************************************************************************
+// FreeListAllocator.cpp
+//***************************************************************************************
+
+#include "FreeListAllocator.h"
+#include <cassert>
+#include <iterator>
+
+FreeListAllocator::FreeListAllocator(std::uint32_t capacity) :
+	mCapacity(capacity), mFreeCount(capacity)
+{
+	if(capacity > 0)
+		mFreeRanges[0] = capacity;
+}
+
+std::uint32_t FreeListAllocator::Allocate(std::uint32_t count)
+{
+	if(count == 0)
+		return InvalidIndex;
+
+	for(auto it = mFreeRanges.begin(); it != mFreeRanges.end(); ++it)
+	{
+		if(it->second < count)
+			continue;
+
+		std::uint32_t index = it->first;
+		std::uint32_t remaining = it->second - count;
+		mFreeRanges.erase(it);
+		if(remaining > 0)
+			mFreeRanges[index + count] = remaining;
+
+		mFreeCount -= count;
+		return index;
+	}
+
+	return InvalidIndex;
+}
+
+void FreeListAllocator::Free(std::uint32_t index, std::uint32_t count)
+{
+	if(count == 0)
+		return;
+
+	assert(index + count <= mCapacity);
+
+	std::uint32_t start = index;
+	std::uint32_t end = index + count;
+
+	auto next = mFreeRanges.lower_bound(index);
+	assert(next == mFreeRanges.end() || next->first >= end);
+
+	// Merge with the free range right after.
+	if(next != mFreeRanges.end() && next->first == end)
+	{
+		end += next->second;
+		next = mFreeRanges.erase(next);
+	}
+
+	// Merge with the free range right before.
+	if(next != mFreeRanges.begin())
+	{
+		auto prev = std::prev(next);
+		assert(prev->first + prev->second <= index);
+		if(prev->first + prev->second == start)
+		{
+			start = prev->first;
+			mFreeRanges.erase(prev);
+		}
+	}
+
+	mFreeRanges[start] = end - start;
+	mFreeCount += count;
+}
+
+void FreeListAllocator::FreeDeferred(std::uint32_t index, std::uint32_t count)
+{
+	if(count == 0)
+		return;
+
+	assert(index + count <= mCapacity);
+
+	PendingFree pending;
+	pending.Index = index;
+	pending.Count = count;
+	pending.FenceValue = UnfinishedFence;
+	mPending.push_back(pending);
+	mPendingCount += count;
+}
+
+void FreeListAllocator::FinishFrame(std::uint64_t fenceValue)
+{
+	for(auto it = mPending.rbegin(); it != mPending.rend() && it->FenceValue == UnfinishedFence; ++it)
+		it->FenceValue = fenceValue;
+}
+
+void FreeListAllocator::ReleaseCompleted(std::uint64_t completedFenceValue)
+{
+	while(!mPending.empty() && mPending.front().FenceValue <= completedFenceValue)
+	{
+		const PendingFree& pending = mPending.front();
+		Free(pending.Index, pending.Count);
+		mPendingCount -= pending.Count;
+		mPending.pop_front();
+	}
+}
+
+std::uint32_t FreeListAllocator::GetCapacity()const
+{
+	return mCapacity;
+}
+
+std::uint32_t FreeListAllocator::GetFreeCount()const
+{
+	return mFreeCount;
+}
+
+std::uint32_t FreeListAllocator::GetPendingCount()const
+{
+	return mPendingCount;
+}
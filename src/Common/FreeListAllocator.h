@@ -0,0 +1,64 @@
+//***************************************************************************************
+// FreeListAllocator.h
+//
+// First-fit allocator for ranges of slots in [0, capacity), e.g. descriptors in the
+// persistent part of a descriptor heap.  Freed ranges are merged with their free
+// neighbours.  Ranges the GPU may still read are freed with FreeDeferred() and only
+// return to the free list once their fence has passed, the same FinishFrame() /
+// ReleaseCompleted() protocol as LinearRingAllocator.  No D3D types are used.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+
+class FreeListAllocator
+{
+public:
+	static const std::uint32_t InvalidIndex = ~0u;
+
+	explicit FreeListAllocator(std::uint32_t capacity);
+	FreeListAllocator(const FreeListAllocator& rhs) = delete;
+	FreeListAllocator& operator=(const FreeListAllocator& rhs) = delete;
+
+	// Returns the first slot of count contiguous free slots, or InvalidIndex.
+	std::uint32_t Allocate(std::uint32_t count);
+
+	// Returns a range obtained from Allocate().  The whole range must be freed at once.
+	void Free(std::uint32_t index, std::uint32_t count);
+
+	// Like Free(), but the range stays allocated until the fence passed to the next
+	// FinishFrame() is reached.
+	void FreeDeferred(std::uint32_t index, std::uint32_t count);
+	void FinishFrame(std::uint64_t fenceValue);
+	void ReleaseCompleted(std::uint64_t completedFenceValue);
+
+	std::uint32_t GetCapacity()const;
+	std::uint32_t GetFreeCount()const;
+
+	// Slots freed with FreeDeferred() that are not yet back on the free list.
+	std::uint32_t GetPendingCount()const;
+
+private:
+	struct PendingFree
+	{
+		std::uint32_t Index = 0;
+		std::uint32_t Count = 0;
+		std::uint64_t FenceValue = 0;
+	};
+
+	// FenceValue of frees made since the last FinishFrame().
+	static const std::uint64_t UnfinishedFence = ~0ull;
+
+	// In the order they were freed, so fence values never decrease.
+	std::deque<PendingFree> mPending;
+	std::uint32_t mPendingCount = 0;
+
+	// Start of each free range -> its length.  Ranges never touch or overlap.
+	std::map<std::uint32_t, std::uint32_t> mFreeRanges;
+
+	std::uint32_t mCapacity = 0;
+	std::uint32_t mFreeCount = 0;
+};
@@ -5,6 +5,10 @@
 #ifndef GAMETIMER_H
 #define GAMETIMER_H
 
+#include <cstdint>
+
+// Times are read from std::chrono::steady_clock, which is QueryPerformanceCounter on
+// Windows and clock_gettime(CLOCK_MONOTONIC) on Linux.
 class GameTimer
 {
 public:
@@ -17,16 +21,20 @@ public:
 	void Start(); // Call when unpaused.
 	void Stop();  // Call when paused.
 	void Tick();  // Call every frame.
+	bool IsStopped()const;
+
+	// Current steady_clock time in nanoseconds, the counts used by GameTimer.
+	static std::int64_t Now();
 
 private:
 	double mSecondsPerCount;
 	double mDeltaTime;
 
-	__int64 mBaseTime;
-	__int64 mPausedTime;
-	__int64 mStopTime;
-	__int64 mPrevTime;
-	__int64 mCurrTime;
+	std::int64_t mBaseTime;
+	std::int64_t mPausedTime;
+	std::int64_t mStopTime;
+	std::int64_t mPrevTime;
+	std::int64_t mCurrTime;
 
 	bool mStopped;
 };
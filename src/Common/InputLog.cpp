@@ -0,0 +1,266 @@
+//***************************************************************************************
+// InputLog.cpp
+//***************************************************************************************
+
+#include "InputLog.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+	const char gMagic[4] = { 'I', 'N', 'P', 'L' };
+	const std::uint8_t gVersion = 1;
+
+	// LEB128: 7 bits per byte, low bits first, high bit set on all but the last byte.
+	void WriteVarint(std::vector<unsigned char>& out, std::uint64_t value)
+	{
+		while(value >= 0x80)
+		{
+			out.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((unsigned char)value);
+	}
+
+	// Small negative numbers stay short: 0, -1, 1, -2, ... map to 0, 1, 2, 3, ...  The
+	// sign is spread over 32 bits only, so the result never takes more than 5 bytes.
+	std::uint32_t ZigZag(std::int32_t value)
+	{
+		return (std::uint32_t)value << 1 ^ (std::uint32_t)(value >> 31);
+	}
+
+	std::int32_t UnZigZag(std::uint64_t value)
+	{
+		return (std::int32_t)((std::uint32_t)(value >> 1) ^ (std::uint32_t)(0 - (value & 1)));
+	}
+
+	bool HasPosition(InputEventType type)
+	{
+		return type == InputEventType::MouseDown || type == InputEventType::MouseMove;
+	}
+
+	class Reader
+	{
+	public:
+		explicit Reader(const std::vector<unsigned char>& data) :
+			mData(data)
+		{
+		}
+
+		bool ReadByte(std::uint8_t& value)
+		{
+			if(mPos >= mData.size())
+				return false;
+			value = mData[mPos++];
+			return true;
+		}
+
+		bool ReadVarint(std::uint64_t& value)
+		{
+			value = 0;
+			for(int shift = 0; shift < 64; shift += 7)
+			{
+				std::uint8_t byte = 0;
+				if(!ReadByte(byte))
+					return false;
+				value |= (std::uint64_t)(byte & 0x7f) << shift;
+				if((byte & 0x80) == 0)
+					return true;
+			}
+			return false;
+		}
+
+		bool ReadBytes(void* dest, std::size_t size)
+		{
+			if(mData.size() - mPos < size)
+				return false;
+			std::memcpy(dest, &mData[mPos], size);
+			mPos += size;
+			return true;
+		}
+
+	private:
+		const std::vector<unsigned char>& mData;
+		std::size_t mPos = 0;
+	};
+}
+
+bool InputLog::Add(const InputEvent& event)
+{
+	if(!mEvents.empty() && event.Frame < mEvents.back().Frame)
+		return false;
+	if(event.Type >= InputEventType::Count || event.Size > InputEvent::MaxValueSize)
+		return false;
+
+	mEvents.push_back(event);
+	if(event.Frame >= mFrameCount)
+		mFrameCount = event.Frame + 1;
+	return true;
+}
+
+const std::vector<InputEvent>& InputLog::GetEvents()const
+{
+	return mEvents;
+}
+
+std::uint32_t InputLog::GetFrameCount()const
+{
+	return mFrameCount;
+}
+
+void InputLog::SetFrameCount(std::uint32_t frameCount)
+{
+	// Never cut events off.
+	std::uint32_t minFrames = mEvents.empty() ? 0 : mEvents.back().Frame + 1;
+	mFrameCount = frameCount > minFrames ? frameCount : minFrames;
+}
+
+void InputLog::Clear()
+{
+	mEvents.clear();
+	mFrameCount = 0;
+}
+
+bool InputLog::Load(const std::filesystem::path& file, std::string& error)
+{
+	std::ifstream fin(file, std::ios::binary);
+	if(!fin)
+	{
+		error = "cannot open " + file.string();
+		return false;
+	}
+	std::vector<unsigned char> data((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+
+	Reader in(data);
+	char magic[4] = {};
+	std::uint8_t version = 0;
+	std::uint64_t frameCount = 0;
+	std::uint64_t eventCount = 0;
+	if(!in.ReadBytes(magic, sizeof(magic)) || std::memcmp(magic, gMagic, sizeof(magic)) != 0 || !in.ReadByte(version))
+	{
+		error = file.string() + " is not an input log";
+		return false;
+	}
+	if(version != gVersion)
+	{
+		error = file.string() + " has unsupported version " + std::to_string(version);
+		return false;
+	}
+	if(!in.ReadVarint(frameCount) || !in.ReadVarint(eventCount) || frameCount > UINT32_MAX)
+	{
+		error = file.string() + " has a corrupt header";
+		return false;
+	}
+
+	// Every event takes at least two bytes, which bounds the reservation on corrupt input.
+	InputLog log;
+	log.mEvents.reserve((std::size_t)(eventCount < data.size() / 2 ? eventCount : data.size() / 2));
+
+	std::uint64_t frame = 0;
+	for(std::uint64_t i = 0; i < eventCount; ++i)
+	{
+		InputEvent event;
+		std::uint64_t frameDelta = 0;
+		std::uint8_t type = 0;
+		bool ok = in.ReadVarint(frameDelta) && in.ReadByte(type) && in.ReadVarint(event.Code);
+		frame += frameDelta;
+		event.Frame = (std::uint32_t)frame;
+		event.Type = (InputEventType)type;
+
+		if(ok && HasPosition(event.Type))
+		{
+			std::uint64_t x = 0;
+			std::uint64_t y = 0;
+			ok = in.ReadVarint(x) && in.ReadVarint(y);
+			event.X = UnZigZag(x);
+			event.Y = UnZigZag(y);
+		}
+		else if(ok && event.Type == InputEventType::Value)
+		{
+			ok = in.ReadByte(event.Size) && event.Size <= InputEvent::MaxValueSize && in.ReadBytes(event.Data, event.Size);
+		}
+
+		if(!ok || frame > UINT32_MAX || !log.Add(event))
+		{
+			error = file.string() + ": event " + std::to_string(i) + " is corrupt";
+			return false;
+		}
+	}
+	log.SetFrameCount((std::uint32_t)frameCount);
+
+	*this = std::move(log);
+	return true;
+}
+
+bool InputLog::Save(const std::filesystem::path& file)const
+{
+	std::vector<unsigned char> data(std::begin(gMagic), std::end(gMagic));
+	data.push_back(gVersion);
+	WriteVarint(data, mFrameCount);
+	WriteVarint(data, mEvents.size());
+
+	std::uint32_t frame = 0;
+	for(const auto& event : mEvents)
+	{
+		WriteVarint(data, event.Frame - frame);
+		frame = event.Frame;
+		data.push_back((unsigned char)event.Type);
+		WriteVarint(data, event.Code);
+
+		if(HasPosition(event.Type))
+		{
+			WriteVarint(data, ZigZag(event.X));
+			WriteVarint(data, ZigZag(event.Y));
+		}
+		else if(event.Type == InputEventType::Value)
+		{
+			data.push_back(event.Size);
+			data.insert(data.end(), event.Data, event.Data + event.Size);
+		}
+	}
+
+	std::error_code ec;
+	if(file.has_parent_path())
+		std::filesystem::create_directories(file.parent_path(), ec);
+
+	std::ofstream fout(file, std::ios::binary | std::ios::trunc);
+	if(!fout)
+		return false;
+	fout.write((const char*)data.data(), (std::streamsize)data.size());
+	return (bool)fout;
+}
+
+InputReplay::InputReplay(InputLog log) :
+	mLog(std::move(log))
+{
+}
+
+bool InputReplay::Next(std::uint32_t frame, InputEvent& event)
+{
+	const auto& events = mLog.GetEvents();
+	if(mCursor >= events.size() || events[mCursor].Frame > frame)
+		return false;
+
+	event = events[mCursor++];
+	return true;
+}
+
+const InputEvent* InputReplay::Peek(std::uint32_t frame)const
+{
+	const auto& events = mLog.GetEvents();
+	if(mCursor >= events.size() || events[mCursor].Frame > frame)
+		return nullptr;
+	return &events[mCursor];
+}
+
+bool InputReplay::IsFinished(std::uint32_t frame)const
+{
+	return frame >= mLog.GetFrameCount();
+}
+
+const InputLog& InputReplay::GetLog()const
+{
+	return mLog;
+}
@@ -0,0 +1,90 @@
+//***************************************************************************************
+// InputLog.h
+//
+// Frame-stamped record of the input that drives an app, for replaying a session
+// exactly: key presses and releases, mouse presses and moves, and changes to UI
+// values.  Events are stored with the frame they were applied in, so a replay that
+// feeds them back at the same frames reaches the same state whatever its frame rate.
+//   -InputLog collects events and reads/writes them as a compact binary file: a small
+//    header, then per event the frame delta, type and payload as variable length
+//    integers.  A typical event takes 3 to 6 bytes.
+//   -InputReplay hands the events back frame by frame.
+// No D3D or Windows types are used.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+enum class InputEventType : std::uint8_t
+{
+	KeyDown,      // Code: key, or the WPARAM of a mouse wheel message
+	KeyUp,        // Code: key
+	MouseDown,    // Code: button state; X, Y
+	MouseMove,    // Code: button state; X, Y
+	Value,        // Code: value id; Size bytes of Data
+	Count
+};
+
+struct InputEvent
+{
+	static const std::uint32_t MaxValueSize = 16;
+
+	std::uint32_t Frame = 0;
+	InputEventType Type = InputEventType::KeyDown;
+	std::uint64_t Code = 0;
+	std::int32_t X = 0;
+	std::int32_t Y = 0;
+	std::uint8_t Size = 0;
+	unsigned char Data[MaxValueSize] = {};
+};
+
+class InputLog
+{
+public:
+	// Events must be added in frame order.  Returns false, leaving the log unchanged,
+	// if event is older than the last one or has an invalid type or value size.
+	bool Add(const InputEvent& event);
+
+	const std::vector<InputEvent>& GetEvents()const;
+
+	// Number of frames the recording covers, which may end after its last event.
+	std::uint32_t GetFrameCount()const;
+	void SetFrameCount(std::uint32_t frameCount);
+
+	void Clear();
+
+	// On failure the log is unchanged and error says what is wrong with the file.
+	bool Load(const std::filesystem::path& file, std::string& error);
+	bool Save(const std::filesystem::path& file)const;
+
+private:
+	std::vector<InputEvent> mEvents;
+	std::uint32_t mFrameCount = 0;
+};
+
+class InputReplay
+{
+public:
+	explicit InputReplay(InputLog log);
+	InputReplay(const InputReplay& rhs) = delete;
+	InputReplay& operator=(const InputReplay& rhs) = delete;
+
+	// Returns the events of frames up to frame in order, one per call, then false.
+	bool Next(std::uint32_t frame, InputEvent& event);
+
+	// The event Next() would return, without consuming it, or null.
+	const InputEvent* Peek(std::uint32_t frame)const;
+
+	// Whether frame is past the end of the recording.
+	bool IsFinished(std::uint32_t frame)const;
+
+	const InputLog& GetLog()const;
+
+private:
+	InputLog mLog;
+	std::size_t mCursor = 0;
+};
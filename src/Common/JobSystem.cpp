@@ -0,0 +1,309 @@
+//***************************************************************************************
+// JobSystem.cpp
+//***************************************************************************************
+
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <string>
+
+namespace
+{
+	// Identifies the queue owned by the current thread.  Threads that are not
+	// workers of the given system fall back to the shared queue 0.
+	struct WorkerIdentity
+	{
+		const JobSystem* Owner = nullptr;
+		std::uint32_t QueueIndex = 0;
+	};
+
+	thread_local WorkerIdentity tlsWorker;
+}
+
+bool JobCounter::IsDone()const
+{
+	if(mValue.load(std::memory_order_acquire) != 0)
+		return false;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mValue.load(std::memory_order_acquire) == 0;
+}
+
+void JobCounter::Add(std::uint32_t count)
+{
+	mValue.fetch_add(count, std::memory_order_relaxed);
+}
+
+std::vector<JobCounter::Continuation> JobCounter::Decrement()
+{
+	std::vector<Continuation> ready;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	if(mValue.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		ready.swap(mContinuations);
+
+	return ready;
+}
+
+JobSystem::WorkQueue::WorkQueue()
+	: Slots(InitialCapacity)
+{
+}
+
+void JobSystem::WorkQueue::PushBack(Job&& job)
+{
+	if(Count == Slots.size())
+	{
+		// Unwrap into a buffer twice the size.
+		std::vector<Job> grown(Slots.size() * 2);
+		for(std::size_t i = 0; i < Count; ++i)
+			grown[i] = std::move(Slots[(Head + i) % Slots.size()]);
+		Slots.swap(grown);
+		Head = 0;
+	}
+
+	Slots[(Head + Count) % Slots.size()] = std::move(job);
+	Count++;
+}
+
+bool JobSystem::WorkQueue::PopBack(Job& job)
+{
+	if(Count == 0)
+		return false;
+
+	Count--;
+	job = std::move(Slots[(Head + Count) % Slots.size()]);
+	return true;
+}
+
+bool JobSystem::WorkQueue::PopFront(Job& job)
+{
+	if(Count == 0)
+		return false;
+
+	job = std::move(Slots[Head]);
+	Head = (Head + 1) % Slots.size();
+	Count--;
+	return true;
+}
+
+JobSystem::JobSystem(std::uint32_t workerCount)
+{
+	if(workerCount == 0)
+	{
+		std::uint32_t cores = std::thread::hardware_concurrency();
+		workerCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	mQueues.reserve(workerCount + 1);
+	for(std::uint32_t i = 0; i < workerCount + 1; ++i)
+		mQueues.push_back(std::make_unique<WorkQueue>());
+
+	mWorkers.reserve(workerCount);
+	for(std::uint32_t i = 0; i < workerCount; ++i)
+		mWorkers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		mShutdown = true;
+	}
+	mWakeCondition.notify_all();
+
+	for(auto& worker : mWorkers)
+		worker.join();
+}
+
+std::uint32_t JobSystem::GetWorkerCount()const
+{
+	return (std::uint32_t)mWorkers.size();
+}
+
+void JobSystem::Run(JobFunc func, JobCounter& counter)
+{
+	counter.Add(1);
+
+	Job job;
+	job.Func = std::move(func);
+	job.Counter = &counter;
+	Push(std::move(job));
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, JobFunc func, JobCounter& counter)
+{
+	counter.Add(1);
+
+	{
+		std::lock_guard<std::mutex> lock(dependency.mMutex);
+		if(dependency.mValue.load(std::memory_order_acquire) != 0)
+		{
+			JobCounter::Continuation continuation;
+			continuation.Func = std::move(func);
+			continuation.Counter = &counter;
+			dependency.mContinuations.push_back(std::move(continuation));
+			return;
+		}
+	}
+
+	Job job;
+	job.Func = std::move(func);
+	job.Counter = &counter;
+	Push(std::move(job));
+}
+
+void JobSystem::Dispatch(std::uint32_t count, std::uint32_t grainSize, const RangeFunc& func, JobCounter& counter)
+{
+	if(count == 0)
+		return;
+
+	if(grainSize == 0)
+		grainSize = 1;
+
+	// Not worth the queue round trip.
+	if(count <= grainSize)
+	{
+		func(0, count);
+		return;
+	}
+
+	std::uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+	counter.Add(chunkCount);
+
+	for(std::uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+	{
+		Job job;
+		job.Range = &func;
+		job.Begin = chunk * grainSize;
+		job.End = job.Begin + grainSize < count ? job.Begin + grainSize : count;
+		job.Counter = &counter;
+		Push(std::move(job));
+	}
+}
+
+void JobSystem::ParallelFor(std::uint32_t count, std::uint32_t grainSize, const RangeFunc& func)
+{
+	JobCounter counter;
+	Dispatch(count, grainSize, func, counter);
+	Wait(counter);
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+	std::uint32_t queueIndex = CurrentQueueIndex();
+
+	while(!counter.IsDone())
+	{
+		if(!TryRunOne(queueIndex))
+			std::this_thread::yield();
+	}
+}
+
+std::uint32_t JobSystem::CurrentQueueIndex()
+{
+	return tlsWorker.Owner == this ? tlsWorker.QueueIndex : 0;
+}
+
+void JobSystem::Push(Job job)
+{
+	std::uint32_t queueIndex = CurrentQueueIndex();
+
+	// Spread work submitted from outside over all queues so workers start
+	// on their own deque instead of all stealing from the same one.
+	if(queueIndex == 0)
+		queueIndex = mNextExternalQueue.fetch_add(1, std::memory_order_relaxed) % (std::uint32_t)mQueues.size();
+
+	// Counted before the job becomes visible so a thief can never take it first
+	// and drive the pending count below zero.
+	mPendingJobs.fetch_add(1, std::memory_order_release);
+
+	{
+		WorkQueue& queue = *mQueues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		queue.PushBack(std::move(job));
+	}
+
+	{
+		// Taking the lock orders this notify after a worker's predicate check.
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+	}
+	mWakeCondition.notify_one();
+}
+
+bool JobSystem::PopLocal(std::uint32_t queueIndex, Job& job)
+{
+	WorkQueue& queue = *mQueues[queueIndex];
+	std::lock_guard<std::mutex> lock(queue.Mutex);
+	return queue.PopBack(job);
+}
+
+bool JobSystem::Steal(std::uint32_t thiefIndex, Job& job)
+{
+	std::uint32_t queueCount = (std::uint32_t)mQueues.size();
+	for(std::uint32_t i = 1; i < queueCount; ++i)
+	{
+		WorkQueue& queue = *mQueues[(thiefIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		if(queue.PopFront(job))
+			return true;
+	}
+
+	return false;
+}
+
+bool JobSystem::TryRunOne(std::uint32_t queueIndex)
+{
+	Job job;
+	if(!PopLocal(queueIndex, job) && !Steal(queueIndex, job))
+		return false;
+
+	mPendingJobs.fetch_sub(1, std::memory_order_relaxed);
+	Execute(job);
+	return true;
+}
+
+void JobSystem::Execute(Job& job)
+{
+	{
+		PROFILE_ZONE("Job");
+		if(job.Range != nullptr)
+			(*job.Range)(job.Begin, job.End);
+		else
+			job.Func();
+	}
+
+	if(job.Counter == nullptr)
+		return;
+
+	for(auto& continuation : job.Counter->Decrement())
+	{
+		Job next;
+		next.Func = std::move(continuation.Func);
+		next.Counter = continuation.Counter;
+		Push(std::move(next));
+	}
+}
+
+void JobSystem::WorkerLoop(std::uint32_t queueIndex)
+{
+	tlsWorker.Owner = this;
+	tlsWorker.QueueIndex = queueIndex;
+
+	PROFILE_THREAD_NAME(("Worker " + std::to_string(queueIndex)).c_str());
+
+	for(;;)
+	{
+		if(TryRunOne(queueIndex))
+			continue;
+
+		std::unique_lock<std::mutex> lock(mSleepMutex);
+		mWakeCondition.wait(lock, [this]()
+		{
+			return mShutdown || mPendingJobs.load(std::memory_order_acquire) != 0;
+		});
+
+		if(mShutdown)
+			return;
+	}
+}
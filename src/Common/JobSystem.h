@@ -0,0 +1,145 @@
+//***************************************************************************************
+// JobSystem.h
+//
+// Work-stealing job system shared by every subsystem that wants more than one thread
+// (texture loading, mesh processing, culling, constant buffer updates).
+//   -Each worker owns a queue: it pushes/pops its own jobs at the back and other
+//    threads steal from the front.  Threads that are not workers push round-robin.
+//    Queues are ring buffers that only ever grow, so once they have reached the
+//    frame's peak, queuing a job does not touch the heap.
+//   -Jobs are tracked by JobCounters.  Waiting on a counter runs other jobs instead
+//    of blocking, so it is safe to wait from inside a job.
+//   -A continuation is a job that is queued once a counter reaches zero.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Counts outstanding jobs.  A counter reaches zero once every job that was
+// dispatched against it has finished.  Counters can be reused after they reach zero.
+class JobCounter
+{
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter& rhs) = delete;
+	JobCounter& operator=(const JobCounter& rhs) = delete;
+
+	bool IsDone()const;
+
+private:
+	friend class JobSystem;
+
+	struct Continuation
+	{
+		std::function<void()> Func;
+		JobCounter* Counter = nullptr;
+	};
+
+	void Add(std::uint32_t count);
+
+	// Returns the continuations to schedule when the counter drops to zero.
+	std::vector<Continuation> Decrement();
+
+	std::atomic<std::uint32_t> mValue{ 0 };
+
+	// Also taken by IsDone() so a waiter never destroys the counter while the
+	// thread that finished the last job is still inside Decrement().
+	mutable std::mutex mMutex;
+	std::vector<Continuation> mContinuations;
+};
+
+class JobSystem
+{
+public:
+	using JobFunc = std::function<void()>;
+
+	// Range job: processes elements [begin, end).
+	using RangeFunc = std::function<void(std::uint32_t begin, std::uint32_t end)>;
+
+	// workerCount == 0 picks hardware_concurrency() - 1 workers, leaving one core
+	// for the thread that dispatches and waits.
+	explicit JobSystem(std::uint32_t workerCount = 0);
+	JobSystem(const JobSystem& rhs) = delete;
+	JobSystem& operator=(const JobSystem& rhs) = delete;
+	~JobSystem();
+
+	std::uint32_t GetWorkerCount()const;
+
+	// Queues a single job.
+	void Run(JobFunc func, JobCounter& counter);
+
+	// Queues func once dependency reaches zero (immediately if it already has).
+	// counter is incremented now, so waiting on it also waits for the continuation.
+	void RunAfter(JobCounter& dependency, JobFunc func, JobCounter& counter);
+
+	// Splits [0, count) into chunks of grainSize elements and queues one job per chunk.
+	// A single chunk is executed inline on the calling thread.  The chunks refer to
+	// func instead of copying it, so Dispatch never allocates; func must outlive the
+	// counter reaching zero, which is why a temporary is rejected.
+	void Dispatch(std::uint32_t count, std::uint32_t grainSize, const RangeFunc& func, JobCounter& counter);
+	void Dispatch(std::uint32_t count, std::uint32_t grainSize, RangeFunc&& func, JobCounter& counter) = delete;
+
+	// Blocking Dispatch: returns once every chunk has been processed.
+	void ParallelFor(std::uint32_t count, std::uint32_t grainSize, const RangeFunc& func);
+
+	// Returns once the counter reaches zero, running queued jobs in the meantime.
+	void Wait(const JobCounter& counter);
+
+private:
+	// Either a single job (Func) or one chunk of a Dispatch (Range over [Begin, End)).
+	struct Job
+	{
+		JobFunc Func;
+		const RangeFunc* Range = nullptr;
+		std::uint32_t Begin = 0;
+		std::uint32_t End = 0;
+		JobCounter* Counter = nullptr;
+	};
+
+	// Ring buffer of jobs, doubled when full and never shrunk.
+	struct WorkQueue
+	{
+		static const std::size_t InitialCapacity = 256;
+
+		WorkQueue();
+
+		void PushBack(Job&& job);
+		bool PopBack(Job& job);
+		bool PopFront(Job& job);
+
+		std::mutex Mutex;
+		std::vector<Job> Slots;
+		std::size_t Head = 0;
+		std::size_t Count = 0;
+	};
+
+	std::uint32_t CurrentQueueIndex();
+	void Push(Job job);
+	bool PopLocal(std::uint32_t queueIndex, Job& job);
+	bool Steal(std::uint32_t thiefIndex, Job& job);
+	bool TryRunOne(std::uint32_t queueIndex);
+	void Execute(Job& job);
+	void WorkerLoop(std::uint32_t queueIndex);
+
+	// mQueues[0] is shared by all non-worker threads; worker i owns mQueues[i + 1].
+	std::vector<std::unique_ptr<WorkQueue>> mQueues;
+	std::vector<std::thread> mWorkers;
+
+	std::atomic<std::uint32_t> mPendingJobs{ 0 };
+	std::atomic<std::uint32_t> mNextExternalQueue{ 0 };
+
+	std::mutex mSleepMutex;
+	std::condition_variable mWakeCondition;
+	bool mShutdown = false;
+};
@@ -0,0 +1,82 @@
+//***************************************************************************************
+// LinearRingAllocator.cpp
+//***************************************************************************************
+
+#include "LinearRingAllocator.h"
+
+LinearRingAllocator::LinearRingAllocator(std::uint64_t capacity) :
+	mCapacity(capacity)
+{
+}
+
+std::uint64_t LinearRingAllocator::Allocate(std::uint64_t size, std::uint64_t alignment)
+{
+	if(size == 0 || size > mCapacity || mUsed == mCapacity)
+		return InvalidOffset;
+
+	// Nothing in flight: start over at the beginning to avoid needless wrapping.
+	if(mUsed == 0)
+		mHead = mTail = 0;
+
+	std::uint64_t offset = (mHead + alignment - 1) & ~(alignment - 1);
+
+	if(mHead >= mTail)
+	{
+		// Free space is [head, capacity) followed by [0, tail).
+		if(offset + size > mCapacity)
+		{
+			// Does not fit before the end: skip the rest and wrap to 0.
+			if(size > mTail)
+				return InvalidOffset;
+			offset = 0;
+		}
+	}
+	else
+	{
+		// Free space is [head, tail).
+		if(offset + size > mTail)
+			return InvalidOffset;
+	}
+
+	std::uint64_t taken = offset >= mHead ? offset + size - mHead : mCapacity - mHead + size;
+
+	mUsed += taken;
+	mFrameSize += taken;
+	mHead = offset + size;
+
+	return offset;
+}
+
+void LinearRingAllocator::FinishFrame(std::uint64_t fenceValue)
+{
+	if(mFrameSize == 0)
+		return;
+
+	FrameMarker marker;
+	marker.FenceValue = fenceValue;
+	marker.End = mHead;
+	marker.Size = mFrameSize;
+	mFrames.push_back(marker);
+
+	mFrameSize = 0;
+}
+
+void LinearRingAllocator::ReleaseCompleted(std::uint64_t completedFenceValue)
+{
+	while(!mFrames.empty() && mFrames.front().FenceValue <= completedFenceValue)
+	{
+		mTail = mFrames.front().End;
+		mUsed -= mFrames.front().Size;
+		mFrames.pop_front();
+	}
+}
+
+std::uint64_t LinearRingAllocator::GetCapacity()const
+{
+	return mCapacity;
+}
+
+std::uint64_t LinearRingAllocator::GetUsedSize()const
+{
+	return mUsed;
+}
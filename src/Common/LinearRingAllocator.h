@@ -0,0 +1,58 @@
+//***************************************************************************************
+// LinearRingAllocator.h
+//
+// Offset bookkeeping for a ring buffer shared by the frames in flight.  Allocations are
+// handed out linearly from the head; FinishFrame() tags everything allocated since the
+// previous call with a fence value, and ReleaseCompleted() moves the tail past every
+// frame whose fence the GPU has reached.  No D3D types are used, so the logic can be
+// driven with a fake fence counter.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+class LinearRingAllocator
+{
+public:
+	static const std::uint64_t InvalidOffset = ~0ull;
+
+	explicit LinearRingAllocator(std::uint64_t capacity);
+	LinearRingAllocator(const LinearRingAllocator& rhs) = delete;
+	LinearRingAllocator& operator=(const LinearRingAllocator& rhs) = delete;
+
+	// Returns the offset of size bytes aligned to alignment (a power of two), or
+	// InvalidOffset if the ring has no room until more frames complete.
+	std::uint64_t Allocate(std::uint64_t size, std::uint64_t alignment);
+
+	// Everything allocated since the previous call is released once the fence
+	// reaches fenceValue.
+	void FinishFrame(std::uint64_t fenceValue);
+
+	// Releases the frames whose fence value is <= completedFenceValue.
+	void ReleaseCompleted(std::uint64_t completedFenceValue);
+
+	std::uint64_t GetCapacity()const;
+
+	// Bytes in use, including alignment padding and the space skipped when wrapping.
+	std::uint64_t GetUsedSize()const;
+
+private:
+	struct FrameMarker
+	{
+		std::uint64_t FenceValue = 0;
+		std::uint64_t End = 0;
+		std::uint64_t Size = 0;
+	};
+
+	std::deque<FrameMarker> mFrames;
+
+	std::uint64_t mCapacity = 0;
+	std::uint64_t mHead = 0;
+	std::uint64_t mTail = 0;
+	std::uint64_t mUsed = 0;
+
+	// Bytes taken since the last FinishFrame().
+	std::uint64_t mFrameSize = 0;
+};
@@ -0,0 +1,64 @@
+//***************************************************************************************
+// MemoryReport.cpp
+//***************************************************************************************
+
+#include "MemoryReport.h"
+
+#include <cstdio>
+
+void MemoryReport::Add(MemoryCategory category, UINT64 byteSize, UINT objectCount)
+{
+	Bytes[category] += byteSize;
+	Objects[category] += objectCount;
+}
+
+UINT64 MemoryReport::Total()const
+{
+	UINT64 total = 0;
+	for(int i = 0; i < MemoryCategoryCount; ++i)
+		total += Bytes[i];
+	return total;
+}
+
+std::string MemoryReport::ToString()const
+{
+	const double mb = 1024.0 * 1024.0;
+
+	std::string s;
+	char line[128];
+	for(int i = 0; i < MemoryCategoryCount; ++i)
+	{
+		std::snprintf(line, sizeof(line), "%-14s %10.2f MB  (%u)\n",
+			CategoryName((MemoryCategory)i), Bytes[i] / mb, Objects[i]);
+		s += line;
+	}
+	std::snprintf(line, sizeof(line), "%-14s %10.2f MB\n", "Total", Total() / mb);
+	s += line;
+	return s;
+}
+
+const char* MemoryReport::CategoryName(MemoryCategory category)
+{
+	switch(category)
+	{
+	case MemoryCategoryTextures:
+		return "Textures";
+	case MemoryCategoryStaging:
+		return "Staging";
+	case MemoryCategoryGeometryCpu:
+		return "Geometry CPU";
+	case MemoryCategoryGeometryGpu:
+		return "Geometry GPU";
+	default:
+		return "Unknown";
+	}
+}
+
+UINT64 ResourceAllocationSize(ID3D12Device* device, ID3D12Resource* resource)
+{
+	if(resource == nullptr)
+		return 0;
+
+	D3D12_RESOURCE_DESC desc = resource->GetDesc();
+	return device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+}
@@ -0,0 +1,37 @@
+//***************************************************************************************
+// MemoryReport.h
+//
+// Live bytes by category, filled in by the app from its own containers on request.
+// GPU resources are counted by their allocation size, which includes the alignment and
+// tiling padding the driver adds on top of the resource description.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+enum MemoryCategory
+{
+	MemoryCategoryTextures,
+	MemoryCategoryStaging,
+	MemoryCategoryGeometryCpu,
+	MemoryCategoryGeometryGpu,
+	MemoryCategoryCount
+};
+
+struct MemoryReport
+{
+	UINT64 Bytes[MemoryCategoryCount] = {};
+	UINT Objects[MemoryCategoryCount] = {};
+
+	void Add(MemoryCategory category, UINT64 byteSize, UINT objectCount = 1);
+	UINT64 Total()const;
+
+	// One line per category plus the total, sizes in MB.
+	std::string ToString()const;
+
+	static const char* CategoryName(MemoryCategory category);
+};
+
+// Bytes the device reserves for resource; 0 for a null resource.
+UINT64 ResourceAllocationSize(ID3D12Device* device, ID3D12Resource* resource);
@@ -0,0 +1,230 @@
+//***************************************************************************************
+// Profiler.cpp
+//***************************************************************************************
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+namespace
+{
+	struct ProfilerState
+	{
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<Profiler::ThreadBuffer>> Threads;
+
+		// Start ticks of the last FrameHistoryCapacity frames, indexed by frame number.
+		std::unique_ptr<std::uint64_t[]> FrameStarts{ new std::uint64_t[Profiler::FrameHistoryCapacity]() };
+		std::atomic<std::uint64_t> FrameCount{ 0 };
+
+		// Ticks are converted with the rate measured between these and the time of
+		// the conversion.  This assumes an invariant TSC, as on every CPU the demos
+		// run on.
+		std::uint64_t BaseTicks = Profiler::Ticks();
+		std::chrono::steady_clock::time_point BaseTime = std::chrono::steady_clock::now();
+	};
+
+	ProfilerState& State()
+	{
+		static ProfilerState state;
+		return state;
+	}
+
+	// Ticks to ns since the profiler started, with one rate for a whole collection.
+	struct TickConverter
+	{
+		TickConverter()
+		{
+			ProfilerState& state = State();
+			BaseTicks = state.BaseTicks;
+
+			std::uint64_t ticks = Profiler::Ticks();
+			double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - state.BaseTime).count();
+			NsPerTick = ticks > BaseTicks ? ns / (double)(ticks - BaseTicks) : 0.0;
+		}
+
+		std::uint64_t operator()(std::uint64_t ticks)const
+		{
+			return ticks > BaseTicks ? (std::uint64_t)((double)(ticks - BaseTicks) * NsPerTick) : 0;
+		}
+
+		std::uint64_t BaseTicks = 0;
+		double NsPerTick = 0.0;
+	};
+
+	// Appends the records [first, head) of buffer that are still intact and returns
+	// the head the copy went up to.
+	std::uint64_t CopyRecords(const Profiler::ThreadBuffer& buffer, std::uint64_t first,
+		const TickConverter& toNs, std::vector<ProfileZone>& zones)
+	{
+		const std::uint64_t capacity = Profiler::ThreadBufferCapacity;
+
+		std::uint64_t head = buffer.Head.load(std::memory_order_acquire);
+		first = std::max(first, head > capacity ? head - capacity : 0);
+
+		std::size_t begin = zones.size();
+		for(std::uint64_t i = first; i < head; ++i)
+		{
+			const ProfileZoneRecord& record = buffer.Records[i & (capacity - 1)];
+
+			ProfileZone zone;
+			zone.Name = record.Name;
+			zone.StartNs = toNs(record.StartTicks);
+			zone.EndNs = toNs(record.EndTicks);
+			zone.Depth = record.Depth;
+			zone.ThreadIndex = buffer.Index;
+			zone.Allocations = record.Allocations;
+			zone.AllocatedBytes = record.AllocatedBytes;
+			zones.push_back(zone);
+		}
+
+		// Records the writer reached while they were copied may be torn; drop them.
+		// That includes the slot of record newHead, which the writer may be filling
+		// right now: it holds record newHead - capacity.
+		std::uint64_t newHead = buffer.Head.load(std::memory_order_acquire);
+		std::uint64_t overwritten = newHead + 1 > capacity ? newHead + 1 - capacity : 0;
+		std::size_t torn = overwritten > first ? (std::size_t)(overwritten - first) : 0;
+		torn = std::min(torn, zones.size() - begin);
+		zones.erase(zones.begin() + begin, zones.begin() + begin + torn);
+
+		return head;
+	}
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	ThreadBuffer& buffer = LocalBuffer();
+
+	std::lock_guard<std::mutex> lock(State().Mutex);
+	buffer.Name = name;
+}
+
+void Profiler::FrameMark()
+{
+	ProfilerState& state = State();
+	std::uint64_t frame = state.FrameCount.load(std::memory_order_relaxed);
+	state.FrameStarts[frame & (FrameHistoryCapacity - 1)] = Ticks();
+	state.FrameCount.store(frame + 1, std::memory_order_release);
+}
+
+std::uint64_t Profiler::GetFrameCount()
+{
+	return State().FrameCount.load(std::memory_order_acquire);
+}
+
+bool Profiler::GetFrameBounds(std::uint32_t framesAgo, std::uint64_t& startNs, std::uint64_t& endNs)
+{
+	ProfilerState& state = State();
+	std::uint64_t count = state.FrameCount.load(std::memory_order_acquire);
+
+	// Frame count - 1 has started but not ended.
+	if(count < (std::uint64_t)framesAgo + 2)
+		return false;
+
+	std::uint64_t frame = count - 2 - framesAgo;
+	if(count - frame > FrameHistoryCapacity)
+		return false;
+
+	TickConverter toNs;
+	startNs = toNs(state.FrameStarts[frame & (FrameHistoryCapacity - 1)]);
+	endNs = toNs(state.FrameStarts[(frame + 1) & (FrameHistoryCapacity - 1)]);
+	return true;
+}
+
+bool Profiler::GetFrameStart(std::uint64_t frame, std::uint64_t& startNs)
+{
+	ProfilerState& state = State();
+	std::uint64_t count = state.FrameCount.load(std::memory_order_acquire);
+	if(frame >= count || count - frame > FrameHistoryCapacity)
+		return false;
+
+	startNs = TickConverter()(state.FrameStarts[frame & (FrameHistoryCapacity - 1)]);
+	return true;
+}
+
+void Profiler::CollectZones(std::uint64_t sinceNs, std::vector<ProfileZone>& zones)
+{
+	ProfilerState& state = State();
+	TickConverter toNs;
+
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	for(const auto& buffer : state.Threads)
+	{
+		std::size_t begin = zones.size();
+		CopyRecords(*buffer, 0, toNs, zones);
+
+		// Records are in end order, so the old ones are all at the front.
+		std::size_t old = begin;
+		while(old < zones.size() && zones[old].EndNs < sinceNs)
+			++old;
+		zones.erase(zones.begin() + begin, zones.begin() + old);
+	}
+}
+
+void Profiler::CollectNewZones(std::vector<std::uint64_t>& cursors, std::vector<ProfileZone>& zones)
+{
+	ProfilerState& state = State();
+	TickConverter toNs;
+
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	cursors.resize(state.Threads.size(), 0);
+	for(const auto& buffer : state.Threads)
+		cursors[buffer->Index] = CopyRecords(*buffer, cursors[buffer->Index], toNs, zones);
+}
+
+std::vector<std::string> Profiler::GetThreadNames()
+{
+	ProfilerState& state = State();
+
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	std::vector<std::string> names;
+	for(const auto& buffer : state.Threads)
+		names.push_back(buffer->Name);
+	return names;
+}
+
+std::uint32_t Profiler::GetCurrentThreadIndex()
+{
+	return LocalBuffer().Index;
+}
+
+std::uint64_t Profiler::NowNs()
+{
+	return TickConverter()(Ticks());
+}
+
+double Profiler::MeasureZoneOverheadNs(std::uint32_t iterations)
+{
+	// Registers the thread outside the timed loop.
+	LocalBuffer();
+
+	// Timed with the steady clock: right after startup the tick rate is not yet
+	// known precisely.
+	auto start = std::chrono::steady_clock::now();
+	for(std::uint32_t i = 0; i < iterations; ++i)
+	{
+		ProfileScope zone("ProfilerOverhead");
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / (double)iterations;
+}
+
+Profiler::ThreadBuffer* Profiler::RegisterThread()
+{
+	auto buffer = std::make_unique<ThreadBuffer>();
+	buffer->Records.reset(new ProfileZoneRecord[ThreadBufferCapacity]);
+
+	ProfilerState& state = State();
+	std::lock_guard<std::mutex> lock(state.Mutex);
+	buffer->Index = (std::uint32_t)state.Threads.size();
+	buffer->Name = "Thread " + std::to_string(buffer->Index);
+
+	// Buffers are never freed, so zones of threads that have exited stay readable.
+	tlsBuffer = buffer.get();
+	state.Threads.push_back(std::move(buffer));
+	return tlsBuffer;
+}
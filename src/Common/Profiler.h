@@ -0,0 +1,195 @@
+//***************************************************************************************
+// Profiler.h
+//
+// Scoped CPU zones for every thread.  PROFILE_ZONE("Name") times the enclosing scope;
+// zones nest, and each records its depth in the thread's zone stack.
+//   -Every thread writes finished zones into a ring buffer of its own, so recording
+//    takes no lock.  The oldest zones are overwritten once the ring is full.
+//   -Timestamps are raw TSC ticks while recording.  They are converted to nanoseconds
+//    since the profiler started only when zones are collected.
+//   -Names must be string literals (or otherwise outlive the profiler): only the
+//    pointer is stored.
+//   -Each zone also records the heap allocations its thread made inside it, nested
+//    zones included (see AllocationTracker.h).
+// Defining PROFILER_ENABLED to 0 compiles the macros to nothing.  No D3D types are
+// used.
+//***************************************************************************************
+
+#pragma once
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#include "AllocationTracker.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+// A finished zone, as stored while recording.
+struct ProfileZoneRecord
+{
+	const char* Name = nullptr;
+	std::uint64_t StartTicks = 0;
+	std::uint64_t EndTicks = 0;
+	std::uint32_t Depth = 0;
+	std::uint32_t Allocations = 0;
+	std::uint64_t AllocatedBytes = 0;
+};
+
+// A finished zone, as returned by Profiler::CollectZones().
+struct ProfileZone
+{
+	const char* Name = nullptr;
+	std::uint64_t StartNs = 0;
+	std::uint64_t EndNs = 0;
+	std::uint32_t Depth = 0;
+	std::uint32_t ThreadIndex = 0;
+	std::uint32_t Allocations = 0;
+	std::uint64_t AllocatedBytes = 0;
+};
+
+class Profiler
+{
+public:
+	static const std::uint32_t ThreadBufferCapacity = 1 << 15;
+	static const std::uint32_t FrameHistoryCapacity = 1 << 10;
+
+	// Zones recorded by one thread.  Only the owning thread writes; readers copy
+	// records below Head and discard any that the writer may have lapped meanwhile.
+	struct ThreadBuffer
+	{
+		std::unique_ptr<ProfileZoneRecord[]> Records;
+		std::atomic<std::uint64_t> Head{ 0 };
+		std::uint32_t Depth = 0;
+		std::uint32_t Index = 0;
+		std::string Name;
+	};
+
+	static std::uint64_t Ticks()
+	{
+		return __rdtsc();
+	}
+
+	// Hot path of ProfileScope.  Returns the zone's start ticks.
+	static std::uint64_t BeginZone()
+	{
+		LocalBuffer().Depth++;
+		return Ticks();
+	}
+
+	static void EndZone(const char* name, std::uint64_t startTicks, const AllocationCounts& startAllocations)
+	{
+		std::uint64_t endTicks = Ticks();
+		AllocationCounts allocations = AllocationTracker::GetThreadCounts();
+
+		ThreadBuffer& buffer = LocalBuffer();
+		std::uint64_t head = buffer.Head.load(std::memory_order_relaxed);
+
+		ProfileZoneRecord& record = buffer.Records[head & (ThreadBufferCapacity - 1)];
+		record.Name = name;
+		record.StartTicks = startTicks;
+		record.EndTicks = endTicks;
+		record.Depth = --buffer.Depth;
+		record.Allocations = (std::uint32_t)(allocations.Allocations - startAllocations.Allocations);
+		record.AllocatedBytes = allocations.Bytes - startAllocations.Bytes;
+
+		buffer.Head.store(head + 1, std::memory_order_release);
+	}
+
+	// Names the calling thread's track ("Main", "Worker 1", ...).
+	static void SetThreadName(const char* name);
+
+	// Marks the start of a new frame.  Call once per frame from the main loop.
+	static void FrameMark();
+
+	// Number of FrameMark() calls so far.
+	static std::uint64_t GetFrameCount();
+
+	// Bounds of a finished frame: framesAgo == 0 is the last frame that has both a
+	// start and an end mark.  Returns false if that frame is no longer (or not yet)
+	// in the history.
+	static bool GetFrameBounds(std::uint32_t framesAgo, std::uint64_t& startNs, std::uint64_t& endNs);
+
+	// Start of frame number frame (counting FrameMark() calls from 0), if it is still
+	// in the history.
+	static bool GetFrameStart(std::uint64_t frame, std::uint64_t& startNs);
+
+	// Appends every recorded zone that ended at or after sinceNs, thread by thread.
+	static void CollectZones(std::uint64_t sinceNs, std::vector<ProfileZone>& zones);
+
+	// Appends the zones each thread finished since the previous call with the same
+	// cursors (one per thread, grown as threads appear) and advances them.  Zones
+	// overwritten in between are skipped.
+	static void CollectNewZones(std::vector<std::uint64_t>& cursors, std::vector<ProfileZone>& zones);
+
+	// Indexed by ProfileZone::ThreadIndex.
+	static std::vector<std::string> GetThreadNames();
+	static std::uint32_t GetCurrentThreadIndex();
+
+	static std::uint64_t NowNs();
+
+	// Average cost of one empty zone, measured on the calling thread.  The zones it
+	// records replace the older entries of that thread's ring.
+	static double MeasureZoneOverheadNs(std::uint32_t iterations = 100000);
+
+private:
+	static ThreadBuffer& LocalBuffer()
+	{
+		ThreadBuffer* buffer = tlsBuffer;
+		if(buffer == nullptr)
+			buffer = RegisterThread();
+		return *buffer;
+	}
+
+	static ThreadBuffer* RegisterThread();
+
+	inline static thread_local ThreadBuffer* tlsBuffer = nullptr;
+};
+
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name) :
+		mName(name),
+		mStartTicks(Profiler::BeginZone()),
+		mStartAllocations(AllocationTracker::GetThreadCounts())
+	{
+	}
+	ProfileScope(const ProfileScope& rhs) = delete;
+	ProfileScope& operator=(const ProfileScope& rhs) = delete;
+
+	~ProfileScope()
+	{
+		Profiler::EndZone(mName, mStartTicks, mStartAllocations);
+	}
+
+private:
+	const char* mName;
+	std::uint64_t mStartTicks;
+
+	// Read after BeginZone(), which allocates the thread's ring on its first zone.
+	AllocationCounts mStartAllocations;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if PROFILER_ENABLED
+#define PROFILE_ZONE(name) ProfileScope PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FRAME_MARK() Profiler::FrameMark()
+#define PROFILE_THREAD_NAME(name) Profiler::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FRAME_MARK() ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#endif
@@ -0,0 +1,223 @@
+//***************************************************************************************
+// PsoCache.cpp
+//***************************************************************************************
+
+#include "PsoCache.h"
+
+#include <filesystem>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	D3D12_SHADER_BYTECODE Bytecode(ID3DBlob* shader)
+	{
+		if(shader == nullptr)
+			return D3D12_SHADER_BYTECODE{ nullptr, 0 };
+		return D3D12_SHADER_BYTECODE{ shader->GetBufferPointer(), shader->GetBufferSize() };
+	}
+
+	std::wstring PsoName(std::uint64_t hash)
+	{
+		wchar_t name[17];
+		swprintf_s(name, L"%016llx", (unsigned long long)hash);
+		return name;
+	}
+}
+
+GraphicsPsoBuilder::GraphicsPsoBuilder()
+{
+	ZeroMemory(&mDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
+	mDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	mDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+	mDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+	mDesc.SampleMask = UINT_MAX;
+	mDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	mDesc.NumRenderTargets = 1;
+	mDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	mDesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	mDesc.SampleDesc.Count = 1;
+	mDesc.SampleDesc.Quality = 0;
+}
+
+GraphicsPsoBuilder& GraphicsPsoBuilder::RootSignature(ID3D12RootSignature* rootSignature)
+{
+	mDesc.pRootSignature = rootSignature;
+	return *this;
+}
+
+GraphicsPsoBuilder& GraphicsPsoBuilder::InputLayout(const std::vector<D3D12_INPUT_ELEMENT_DESC>& inputLayout)
+{
+	mDesc.InputLayout = { inputLayout.data(), (UINT)inputLayout.size() };
+	return *this;
+}
+
+GraphicsPsoBuilder& GraphicsPsoBuilder::VS(ID3DBlob* shader)
+{
+	mDesc.VS = Bytecode(shader);
+	return *this;
+}
+
+GraphicsPsoBuilder& GraphicsPsoBuilder::HS(ID3DBlob* shader)
+{
+	mDesc.HS = Bytecode(shader);
+	return *this;
+}
+
+GraphicsPsoBuilder& GraphicsPsoBuilder::DS(ID3DBlob* shader)
+{
+	mDesc.DS = Bytecode(shader);
+	return *this;
+}
+
+GraphicsPsoBuilder& GraphicsPsoBuilder::PS(ID3DBlob* shader)
+{
+	mDesc.PS = Bytecode(shader);
+	return *this;
+}
+
+GraphicsPsoBuilder& GraphicsPsoBuilder::FillMode(D3D12_FILL_MODE fillMode)
+{
+	mDesc.RasterizerState.FillMode = fillMode;
+	return *this;
+}
+
+GraphicsPsoBuilder& GraphicsPsoBuilder::TopologyType(D3D12_PRIMITIVE_TOPOLOGY_TYPE topologyType)
+{
+	mDesc.PrimitiveTopologyType = topologyType;
+	return *this;
+}
+
+GraphicsPsoBuilder& GraphicsPsoBuilder::RenderTarget(DXGI_FORMAT format)
+{
+	mDesc.RTVFormats[0] = format;
+	return *this;
+}
+
+GraphicsPsoBuilder& GraphicsPsoBuilder::DepthStencil(DXGI_FORMAT format)
+{
+	mDesc.DSVFormat = format;
+	return *this;
+}
+
+GraphicsPsoBuilder& GraphicsPsoBuilder::Msaa(UINT count, UINT quality)
+{
+	mDesc.SampleDesc.Count = count;
+	mDesc.SampleDesc.Quality = quality;
+	return *this;
+}
+
+const D3D12_GRAPHICS_PIPELINE_STATE_DESC& GraphicsPsoBuilder::Desc()const
+{
+	return mDesc;
+}
+
+PsoCache::PsoCache(ID3D12Device* device, const std::wstring& libraryFile) :
+	mDevice(device),
+	mLibraryFile(libraryFile)
+{
+	if(SUCCEEDED(device->QueryInterface(IID_PPV_ARGS(&mDevice1))))
+		OpenLibrary();
+}
+
+void PsoCache::OpenLibrary()
+{
+	std::ifstream fin(mLibraryFile, std::ios::binary);
+	if(fin)
+	{
+		fin.seekg(0, std::ios_base::end);
+		mLibraryData.resize((size_t)fin.tellg());
+		fin.seekg(0, std::ios_base::beg);
+		fin.read(mLibraryData.data(), mLibraryData.size());
+
+		// Fails with D3D12_ERROR_DRIVER_VERSION_MISMATCH / ADAPTER_NOT_FOUND when the
+		// file comes from another driver or GPU; start over with an empty library then.
+		if(fin && !mLibraryData.empty() &&
+			SUCCEEDED(mDevice1->CreatePipelineLibrary(mLibraryData.data(), mLibraryData.size(), IID_PPV_ARGS(&mLibrary))))
+			return;
+	}
+
+	mLibraryData.clear();
+	mLibrary = nullptr;
+	if(FAILED(mDevice1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&mLibrary))))
+		mLibrary = nullptr;
+}
+
+ID3D12PipelineState* PsoCache::GetOrCreate(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, std::uint64_t rootSignatureHash)
+{
+	std::uint64_t hash = HashGraphicsPsoDesc(desc, rootSignatureHash);
+
+	auto it = mPSOs.find(hash);
+	if(it != mPSOs.end())
+		return it->second.Get();
+
+	ComPtr<ID3D12PipelineState> pso;
+	std::wstring name = PsoName(hash);
+
+	if(mLibrary != nullptr && SUCCEEDED(mLibrary->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(&pso))))
+	{
+		++mLibraryLoadCount;
+	}
+	else
+	{
+		ThrowIfFailed(mDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pso)));
+		++mCreateCount;
+
+		if(mLibrary != nullptr && SUCCEEDED(mLibrary->StorePipeline(name.c_str(), pso.Get())))
+			mLibraryDirty = true;
+	}
+
+	mPSOs[hash] = pso;
+	return pso.Get();
+}
+
+void PsoCache::Save()
+{
+	if(mLibrary == nullptr || !mLibraryDirty)
+		return;
+
+	std::vector<char> data(mLibrary->GetSerializedSize());
+	if(FAILED(mLibrary->Serialize(data.data(), data.size())))
+		return;
+
+	// Same write-then-rename as the shader cache, so a crash never leaves a torn file.
+	std::error_code ec;
+	std::filesystem::path path(mLibraryFile);
+	if(path.has_parent_path())
+		std::filesystem::create_directories(path.parent_path(), ec);
+
+	std::filesystem::path tempPath = path;
+	tempPath += L".tmp";
+	{
+		std::ofstream fout(tempPath, std::ios::binary | std::ios::trunc);
+		fout.write(data.data(), data.size());
+		if(!fout)
+		{
+			fout.close();
+			std::filesystem::remove(tempPath, ec);
+			return;
+		}
+	}
+	std::filesystem::rename(tempPath, path, ec);
+	if(ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return;
+	}
+	mLibraryDirty = false;
+}
+
+UINT PsoCache::GetPsoCount()const
+{
+	return (UINT)mPSOs.size();
+}
+
+UINT PsoCache::GetLibraryLoadCount()const
+{
+	return mLibraryLoadCount;
+}
+
+UINT PsoCache::GetCreateCount()const
+{
+	return mCreateCount;
+}
@@ -0,0 +1,81 @@
+//***************************************************************************************
+// PsoCache.h
+//
+// GraphicsPsoBuilder fills a D3D12_GRAPHICS_PIPELINE_STATE_DESC with the defaults every
+// PSO in the demos shares, so a variant only states what differs.  PsoCache creates
+// each distinct description once, keyed by a hash of its full contents (shader bytes,
+// input layout, fixed function state and the root signature's serialized blob, never
+// pointers), and keeps the PSOs in an ID3D12PipelineLibrary that is written to disk so
+// later runs load them instead of compiling them again.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "PsoHash.h"
+
+class GraphicsPsoBuilder
+{
+public:
+	// Default rasterizer, blend and depth/stencil state, triangles, one render target.
+	GraphicsPsoBuilder();
+
+	GraphicsPsoBuilder& RootSignature(ID3D12RootSignature* rootSignature);
+	GraphicsPsoBuilder& InputLayout(const std::vector<D3D12_INPUT_ELEMENT_DESC>& inputLayout);
+
+	// A null blob removes the stage.
+	GraphicsPsoBuilder& VS(ID3DBlob* shader);
+	GraphicsPsoBuilder& HS(ID3DBlob* shader);
+	GraphicsPsoBuilder& DS(ID3DBlob* shader);
+	GraphicsPsoBuilder& PS(ID3DBlob* shader);
+
+	GraphicsPsoBuilder& FillMode(D3D12_FILL_MODE fillMode);
+	GraphicsPsoBuilder& TopologyType(D3D12_PRIMITIVE_TOPOLOGY_TYPE topologyType);
+	GraphicsPsoBuilder& RenderTarget(DXGI_FORMAT format);
+	GraphicsPsoBuilder& DepthStencil(DXGI_FORMAT format);
+	GraphicsPsoBuilder& Msaa(UINT count, UINT quality);
+
+	const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Desc()const;
+
+private:
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC mDesc;
+};
+
+class PsoCache
+{
+public:
+	// libraryFile is loaded if present.  Without ID3D12Device1, or if the file was
+	// written by another driver or adapter, PSOs are created normally and only
+	// deduplicated in memory.
+	PsoCache(ID3D12Device* device, const std::wstring& libraryFile);
+	PsoCache(const PsoCache& rhs) = delete;
+	PsoCache& operator=(const PsoCache& rhs) = delete;
+
+	// Returns the PSO for desc, creating it only if no equal description was seen
+	// in this run or stored in the library.  The cache keeps the PSO alive.
+	ID3D12PipelineState* GetOrCreate(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, std::uint64_t rootSignatureHash);
+
+	// Writes the library back to disk if PSOs were added since it was loaded.
+	void Save();
+
+	UINT GetPsoCount()const;
+	UINT GetLibraryLoadCount()const;
+	UINT GetCreateCount()const;
+
+private:
+	void OpenLibrary();
+
+	Microsoft::WRL::ComPtr<ID3D12Device> mDevice;
+	Microsoft::WRL::ComPtr<ID3D12Device1> mDevice1;
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> mLibrary;
+
+	// The library reads from this memory for as long as it exists.
+	std::vector<char> mLibraryData;
+	std::wstring mLibraryFile;
+	bool mLibraryDirty = false;
+
+	std::unordered_map<std::uint64_t, Microsoft::WRL::ComPtr<ID3D12PipelineState>> mPSOs;
+
+	UINT mLibraryLoadCount = 0;
+	UINT mCreateCount = 0;
+};
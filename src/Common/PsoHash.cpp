@@ -0,0 +1,150 @@
+//***************************************************************************************
+// PsoHash.cpp
+//***************************************************************************************
+
+#include "PsoHash.h"
+#include "ShaderCache.h"
+
+#include <cstring>
+#include <type_traits>
+
+namespace
+{
+	class DescHasher
+	{
+	public:
+		explicit DescHasher(std::uint64_t seed) : mHash(seed) {}
+
+		template<typename T>
+		void Add(const T& value)
+		{
+			static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "hash fields one by one");
+			mHash = ShaderCache::Fnv1a(&value, sizeof(value), mHash);
+		}
+
+		void AddBytes(const void* data, std::size_t size)
+		{
+			Add((std::uint64_t)size);
+			if(size > 0)
+				mHash = ShaderCache::Fnv1a(data, size, mHash);
+		}
+
+		void AddString(const char* s)
+		{
+			AddBytes(s, s != nullptr ? std::strlen(s) : 0);
+		}
+
+		void AddShader(const D3D12_SHADER_BYTECODE& shader)
+		{
+			AddBytes(shader.pShaderBytecode, shader.pShaderBytecode != nullptr ? shader.BytecodeLength : 0);
+		}
+
+		std::uint64_t Get()const { return mHash; }
+
+	private:
+		std::uint64_t mHash;
+	};
+}
+
+std::uint64_t HashGraphicsPsoDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, std::uint64_t rootSignatureHash)
+{
+	DescHasher h(ShaderCache::FnvOffsetBasis);
+
+	h.Add(rootSignatureHash);
+
+	h.AddShader(desc.VS);
+	h.AddShader(desc.PS);
+	h.AddShader(desc.DS);
+	h.AddShader(desc.HS);
+	h.AddShader(desc.GS);
+
+	const D3D12_STREAM_OUTPUT_DESC& so = desc.StreamOutput;
+	h.Add(so.NumEntries);
+	for(UINT i = 0; i < so.NumEntries; ++i)
+	{
+		const D3D12_SO_DECLARATION_ENTRY& e = so.pSODeclaration[i];
+		h.Add(e.Stream);
+		h.AddString(e.SemanticName);
+		h.Add(e.SemanticIndex);
+		h.Add(e.StartComponent);
+		h.Add(e.ComponentCount);
+		h.Add(e.OutputSlot);
+	}
+	h.Add(so.NumStrides);
+	for(UINT i = 0; i < so.NumStrides; ++i)
+		h.Add(so.pBufferStrides[i]);
+	h.Add(so.RasterizedStream);
+
+	const D3D12_BLEND_DESC& blend = desc.BlendState;
+	h.Add(blend.AlphaToCoverageEnable);
+	h.Add(blend.IndependentBlendEnable);
+	for(const auto& rt : blend.RenderTarget)
+	{
+		h.Add(rt.BlendEnable);
+		h.Add(rt.LogicOpEnable);
+		h.Add(rt.SrcBlend);
+		h.Add(rt.DestBlend);
+		h.Add(rt.BlendOp);
+		h.Add(rt.SrcBlendAlpha);
+		h.Add(rt.DestBlendAlpha);
+		h.Add(rt.BlendOpAlpha);
+		h.Add(rt.LogicOp);
+		h.Add(rt.RenderTargetWriteMask);
+	}
+
+	h.Add(desc.SampleMask);
+
+	const D3D12_RASTERIZER_DESC& rs = desc.RasterizerState;
+	h.Add(rs.FillMode);
+	h.Add(rs.CullMode);
+	h.Add(rs.FrontCounterClockwise);
+	h.Add(rs.DepthBias);
+	h.Add(rs.DepthBiasClamp);
+	h.Add(rs.SlopeScaledDepthBias);
+	h.Add(rs.DepthClipEnable);
+	h.Add(rs.MultisampleEnable);
+	h.Add(rs.AntialiasedLineEnable);
+	h.Add(rs.ForcedSampleCount);
+	h.Add(rs.ConservativeRaster);
+
+	const D3D12_DEPTH_STENCIL_DESC& ds = desc.DepthStencilState;
+	h.Add(ds.DepthEnable);
+	h.Add(ds.DepthWriteMask);
+	h.Add(ds.DepthFunc);
+	h.Add(ds.StencilEnable);
+	h.Add(ds.StencilReadMask);
+	h.Add(ds.StencilWriteMask);
+	for(const D3D12_DEPTH_STENCILOP_DESC* face : { &ds.FrontFace, &ds.BackFace })
+	{
+		h.Add(face->StencilFailOp);
+		h.Add(face->StencilDepthFailOp);
+		h.Add(face->StencilPassOp);
+		h.Add(face->StencilFunc);
+	}
+
+	h.Add(desc.InputLayout.NumElements);
+	for(UINT i = 0; i < desc.InputLayout.NumElements; ++i)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& e = desc.InputLayout.pInputElementDescs[i];
+		h.AddString(e.SemanticName);
+		h.Add(e.SemanticIndex);
+		h.Add(e.Format);
+		h.Add(e.InputSlot);
+		h.Add(e.AlignedByteOffset);
+		h.Add(e.InputSlotClass);
+		h.Add(e.InstanceDataStepRate);
+	}
+
+	h.Add(desc.IBStripCutValue);
+	h.Add(desc.PrimitiveTopologyType);
+	h.Add(desc.NumRenderTargets);
+	for(UINT i = 0; i < desc.NumRenderTargets && i < 8; ++i)
+		h.Add(desc.RTVFormats[i]);
+	h.Add(desc.DSVFormat);
+	h.Add(desc.SampleDesc.Count);
+	h.Add(desc.SampleDesc.Quality);
+	h.Add(desc.NodeMask);
+	h.Add(desc.Flags);
+
+	return h.Get();
+}
@@ -0,0 +1,18 @@
+//***************************************************************************************
+// PsoHash.h
+//
+// Content hash of a graphics PSO description, used by PsoCache as its key.  Only needs
+// the D3D12 structure definitions, not a device, so it can be tested headless.
+//***************************************************************************************
+
+#pragma once
+
+#include <d3d12.h>
+
+#include <cstdint>
+
+// Hash of everything in desc that affects the PSO.  Pointers are followed (shader
+// bytecode, input element semantics) and struct padding is never read, so equal
+// descriptions hash equally across runs.  desc.pRootSignature is not followed; pass a
+// hash of the serialized root signature instead.  CachedPSO is ignored.
+std::uint64_t HashGraphicsPsoDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, std::uint64_t rootSignatureHash);
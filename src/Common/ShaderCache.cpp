@@ -0,0 +1,222 @@
+//***************************************************************************************
+// ShaderCache.cpp
+//***************************************************************************************
+
+#include "ShaderCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	struct CacheFileHeader
+	{
+		char Magic[4];
+		std::uint32_t Version;
+		std::uint64_t Key;
+		std::uint64_t PayloadSize;
+		std::uint64_t PayloadHash;
+	};
+
+	const char CacheFileMagic[4] = { 'S', 'H', 'C', 'B' };
+
+	bool ReadFile(const fs::path& file, std::string& out)
+	{
+		std::ifstream fin(file, std::ios::binary);
+		if(!fin)
+			return false;
+
+		std::ostringstream ss;
+		ss << fin.rdbuf();
+		out = ss.str();
+		return true;
+	}
+
+	// Returns the quoted or bracketed name if line is an #include directive.
+	bool ParseInclude(const std::string& line, std::string& name)
+	{
+		std::size_t i = line.find_first_not_of(" \t");
+		if(i == std::string::npos || line[i] != '#')
+			return false;
+
+		i = line.find_first_not_of(" \t", i + 1);
+		if(i == std::string::npos || line.compare(i, 7, "include") != 0)
+			return false;
+
+		i = line.find_first_not_of(" \t", i + 7);
+		if(i == std::string::npos || (line[i] != '"' && line[i] != '<'))
+			return false;
+
+		char close = line[i] == '"' ? '"' : '>';
+		std::size_t end = line.find(close, i + 1);
+		if(end == std::string::npos)
+			return false;
+
+		name = line.substr(i + 1, end - i - 1);
+		return true;
+	}
+
+	bool Expand(const fs::path& file, std::string& out, std::vector<fs::path>& stack)
+	{
+		std::string source;
+		if(!ReadFile(file, source))
+			return false;
+
+		// A file that includes itself (directly or not) is only expanded once on this path.
+		fs::path canonical = fs::weakly_canonical(file);
+		for(const auto& p : stack)
+		{
+			if(p == canonical)
+				return true;
+		}
+		stack.push_back(canonical);
+
+		std::istringstream lines(source);
+		std::string line;
+		std::string name;
+		while(std::getline(lines, line))
+		{
+			if(ParseInclude(line, name) && Expand(file.parent_path() / name, out, stack))
+				continue;
+
+			out += line;
+			out += '\n';
+		}
+
+		stack.pop_back();
+		return true;
+	}
+
+	void HashString(std::uint64_t& hash, const std::string& s)
+	{
+		// Length first, so ("ab", "c") and ("a", "bc") hash differently.
+		std::uint64_t size = s.size();
+		hash = ShaderCache::Fnv1a(&size, sizeof(size), hash);
+		hash = ShaderCache::Fnv1a(s.data(), s.size(), hash);
+	}
+}
+
+ShaderCache::ShaderCache(const fs::path& directory) :
+	mDirectory(directory)
+{
+}
+
+std::uint64_t ShaderCache::Fnv1a(const void* data, std::size_t size, std::uint64_t hash)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for(std::size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= FnvPrime;
+	}
+	return hash;
+}
+
+bool ShaderCache::ExpandIncludes(const fs::path& file, std::string& out)
+{
+	std::vector<fs::path> stack;
+	return Expand(file, out, stack);
+}
+
+std::uint64_t ShaderCache::MakeKey(const std::string& expandedSource, const std::string& entryPoint,
+	const std::string& target, const std::vector<ShaderDefine>& defines, std::uint32_t compileFlags)
+{
+	std::uint64_t hash = FnvOffsetBasis;
+
+	std::uint32_t version = FormatVersion;
+	hash = Fnv1a(&version, sizeof(version), hash);
+	hash = Fnv1a(&compileFlags, sizeof(compileFlags), hash);
+
+	HashString(hash, expandedSource);
+	HashString(hash, entryPoint);
+	HashString(hash, target);
+
+	// Defines are hashed in order: a later define of the same name wins in the compiler.
+	std::uint64_t defineCount = defines.size();
+	hash = Fnv1a(&defineCount, sizeof(defineCount), hash);
+	for(const auto& d : defines)
+	{
+		HashString(hash, d.Name);
+		HashString(hash, d.Value);
+	}
+
+	return hash;
+}
+
+fs::path ShaderCache::PathFor(std::uint64_t key)const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.cso", (unsigned long long)key);
+	return mDirectory / name;
+}
+
+bool ShaderCache::Load(std::uint64_t key, std::vector<char>& blob)const
+{
+	std::ifstream fin(PathFor(key), std::ios::binary);
+	if(!fin)
+		return false;
+
+	CacheFileHeader header;
+	if(!fin.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		return false;
+
+	if(std::memcmp(header.Magic, CacheFileMagic, sizeof(CacheFileMagic)) != 0 ||
+		header.Version != FormatVersion || header.Key != key)
+		return false;
+
+	// Guards against absurd sizes from a corrupt header before allocating.
+	fin.seekg(0, std::ios::end);
+	std::uint64_t fileSize = (std::uint64_t)fin.tellg();
+	if(fileSize != sizeof(header) + header.PayloadSize)
+		return false;
+	fin.seekg(sizeof(header), std::ios::beg);
+
+	blob.resize((std::size_t)header.PayloadSize);
+	if(!fin.read(blob.data(), blob.size()))
+		return false;
+
+	return Fnv1a(blob.data(), blob.size()) == header.PayloadHash;
+}
+
+bool ShaderCache::Store(std::uint64_t key, const void* data, std::size_t size)const
+{
+	std::error_code ec;
+	fs::create_directories(mDirectory, ec);
+
+	CacheFileHeader header;
+	std::memcpy(header.Magic, CacheFileMagic, sizeof(CacheFileMagic));
+	header.Version = FormatVersion;
+	header.Key = key;
+	header.PayloadSize = size;
+	header.PayloadHash = Fnv1a(data, size);
+
+	fs::path path = PathFor(key);
+	fs::path tempPath = path;
+	tempPath += ".tmp";
+	{
+		std::ofstream fout(tempPath, std::ios::binary | std::ios::trunc);
+		if(!fout)
+			return false;
+
+		fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		fout.write(static_cast<const char*>(data), size);
+		if(!fout)
+		{
+			fout.close();
+			fs::remove(tempPath, ec);
+			return false;
+		}
+	}
+
+	fs::rename(tempPath, path, ec);
+	if(ec)
+	{
+		fs::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
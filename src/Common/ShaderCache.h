@@ -0,0 +1,58 @@
+//***************************************************************************************
+// ShaderCache.h
+//
+// On-disk cache of compiled shader blobs.  The key is an FNV-1a hash of the shader
+// source with every #include expanded, the entry point, the target, the defines and the
+// compile flags, so editing any file a shader includes gives it a new key.  A cache file
+// holds a small header with the key and a hash of the payload; files that are truncated,
+// corrupt or written by another format version are treated as misses.  Nothing here
+// depends on D3D, so the logic can be exercised without a shader compiler.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct ShaderDefine
+{
+	std::string Name;
+	std::string Value;
+};
+
+class ShaderCache
+{
+public:
+	static const std::uint64_t FnvOffsetBasis = 14695981039346656037ull;
+	static const std::uint64_t FnvPrime = 1099511628211ull;
+
+	// Bumped whenever the file layout or the key recipe changes.
+	static const std::uint32_t FormatVersion = 1;
+
+	explicit ShaderCache(const std::filesystem::path& directory);
+
+	static std::uint64_t Fnv1a(const void* data, std::size_t size, std::uint64_t hash = FnvOffsetBasis);
+
+	// Appends the contents of file to out with every #include "x" / #include <x> line
+	// replaced by the contents of x, resolved relative to the including file the same
+	// way D3D_COMPILE_STANDARD_FILE_INCLUDE does.  Includes that cannot be opened are
+	// kept as text (the compiler reports them).  Returns false if file cannot be read.
+	static bool ExpandIncludes(const std::filesystem::path& file, std::string& out);
+
+	static std::uint64_t MakeKey(const std::string& expandedSource, const std::string& entryPoint,
+		const std::string& target, const std::vector<ShaderDefine>& defines, std::uint32_t compileFlags);
+
+	std::filesystem::path PathFor(std::uint64_t key)const;
+
+	// Returns false on a miss or an invalid file.
+	bool Load(std::uint64_t key, std::vector<char>& blob)const;
+
+	// Writes to a temporary file and renames it into place, so a crash never leaves a
+	// half written entry under the real name.  Returns false if the write failed.
+	bool Store(std::uint64_t key, const void* data, std::size_t size)const;
+
+private:
+	std::filesystem::path mDirectory;
+};
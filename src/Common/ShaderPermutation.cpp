@@ -0,0 +1,170 @@
+//***************************************************************************************
+// ShaderPermutation.cpp
+//***************************************************************************************
+
+#include "ShaderPermutation.h"
+
+#include <algorithm>
+
+std::uint32_t ShaderPermutationKey::Pack()const
+{
+	auto clamp8 = [](std::uint32_t v) { return std::min<std::uint32_t>(v, 255u); };
+
+	return (Features & 0xff) |
+		(clamp8(NumDirLights) << 8) |
+		(clamp8(NumPointLights) << 16) |
+		(clamp8(NumSpotLights) << 24);
+}
+
+std::vector<ShaderDefine> ShaderPermutationKey::Defines()const
+{
+	return
+	{
+		{ "TESSELLATION", Has(ShaderFeatureTessellation) ? "1" : "0" },
+		{ "DECAL", Has(ShaderFeatureDecal) ? "1" : "0" },
+		{ "NORMAL_MAP", Has(ShaderFeatureNormalMap) ? "1" : "0" },
+		{ "NUM_DIR_LIGHTS", std::to_string(NumDirLights) },
+		{ "NUM_POINT_LIGHTS", std::to_string(NumPointLights) },
+		{ "NUM_SPOT_LIGHTS", std::to_string(NumSpotLights) },
+	};
+}
+
+std::string ShaderPermutationKey::Name()const
+{
+	std::string name;
+	auto add = [&name](const char* part)
+	{
+		if(!name.empty())
+			name += '+';
+		name += part;
+	};
+
+	if(Has(ShaderFeatureTessellation))
+		add("tess");
+	if(Has(ShaderFeatureDecal))
+		add("decal");
+	if(Has(ShaderFeatureNormalMap))
+		add("nmap");
+	if(name.empty())
+		name = "base";
+
+	name += "_d" + std::to_string(NumDirLights) +
+		"p" + std::to_string(NumPointLights) +
+		"s" + std::to_string(NumSpotLights);
+	return name;
+}
+
+ShaderPermutationKey ShaderPermutationKey::Merge(const ShaderPermutationKey& a, const ShaderPermutationKey& b)
+{
+	ShaderPermutationKey key;
+	key.Features = a.Features | b.Features;
+	key.NumDirLights = std::max(a.NumDirLights, b.NumDirLights);
+	key.NumPointLights = std::max(a.NumPointLights, b.NumPointLights);
+	key.NumSpotLights = std::max(a.NumSpotLights, b.NumSpotLights);
+	return key;
+}
+
+ShaderPermutationKeyBuilder& ShaderPermutationKeyBuilder::Set(ShaderFeature feature, bool enable)
+{
+	if(enable)
+		mKey.Features |= feature;
+	else
+		mKey.Features &= ~(std::uint32_t)feature;
+	return *this;
+}
+
+ShaderPermutationKeyBuilder& ShaderPermutationKeyBuilder::Tessellation(bool enable)
+{
+	return Set(ShaderFeatureTessellation, enable);
+}
+
+ShaderPermutationKeyBuilder& ShaderPermutationKeyBuilder::Decal(bool enable)
+{
+	return Set(ShaderFeatureDecal, enable);
+}
+
+ShaderPermutationKeyBuilder& ShaderPermutationKeyBuilder::NormalMap(bool enable)
+{
+	return Set(ShaderFeatureNormalMap, enable);
+}
+
+ShaderPermutationKeyBuilder& ShaderPermutationKeyBuilder::Lights(std::uint32_t numDir, std::uint32_t numPoint, std::uint32_t numSpot)
+{
+	mKey.NumDirLights = numDir;
+	mKey.NumPointLights = numPoint;
+	mKey.NumSpotLights = numSpot;
+	return *this;
+}
+
+ShaderPermutationKey ShaderPermutationKeyBuilder::Build()const
+{
+	return mKey;
+}
+
+ShaderPermutationKey SelectShaderPermutation(const PermutationItemInfo& item, const PermutationSceneInfo& scene)
+{
+	// The decal (tessellation factor, displacement and texture) only matters where
+	// its influence is non zero somewhere on the item.
+	bool decal = item.DistanceToDecal - item.Radius < scene.DecalReach;
+
+	// Outside the decal the domain shader adds no displacement, so tessellating only
+	// splits flat triangles.
+	bool tessellation = decal && item.DistanceToEye - item.Radius < scene.TessellationDistance;
+
+	// Lights are indexed [dir][point][spot] in the pass constants, so point lights can
+	// only be dropped from the end, and only when no spot lights follow them.
+	std::uint32_t numPoint = scene.NumPointLights;
+	if(scene.NumSpotLights == 0)
+	{
+		std::uint32_t mask = item.PointLightMask;
+		if(numPoint < 32)
+			mask &= (1u << numPoint) - 1;
+
+		numPoint = 0;
+		while(mask != 0)
+		{
+			++numPoint;
+			mask >>= 1;
+		}
+	}
+
+	return ShaderPermutationKeyBuilder()
+		.Tessellation(tessellation)
+		.Decal(decal)
+		.NormalMap(item.HasNormalMap)
+		.Lights(scene.NumDirLights, numPoint, scene.NumSpotLights)
+		.Build();
+}
+
+std::vector<ShaderPermutationKey> ReachableShaderPermutations(const PermutationSceneInfo& scene,
+	bool withNormalMap, bool withoutNormalMap)
+{
+	// Point lights are only dropped when there are no spot lights, and the mask
+	// SelectShaderPermutation reads has 32 bits.
+	std::uint32_t maxPoint = scene.NumSpotLights == 0 ? std::min<std::uint32_t>(scene.NumPointLights, 32) : scene.NumPointLights;
+	std::uint32_t minPoint = scene.NumSpotLights == 0 ? 0 : scene.NumPointLights;
+
+	std::vector<ShaderPermutationKey> keys;
+	for(int normalMap = 0; normalMap < 2; ++normalMap)
+	{
+		if(normalMap ? !withNormalMap : !withoutNormalMap)
+			continue;
+
+		// Tessellation is only ever selected together with the decal.
+		for(int stage = 0; stage < 3; ++stage)
+		{
+			for(std::uint32_t numPoint = minPoint; numPoint <= maxPoint; ++numPoint)
+			{
+				keys.push_back(ShaderPermutationKeyBuilder()
+					.Tessellation(stage == 2)
+					.Decal(stage >= 1)
+					.NormalMap(normalMap != 0)
+					.Lights(scene.NumDirLights, numPoint, scene.NumSpotLights)
+					.Build());
+			}
+		}
+	}
+
+	std::sort(keys.begin(), keys.end());
+	return keys;
+}
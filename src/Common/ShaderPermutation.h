@@ -0,0 +1,105 @@
+//***************************************************************************************
+// ShaderPermutation.h
+//
+// Compile time switches of Default.hlsl and the choice of the cheapest variant that
+// still draws an item correctly.  A ShaderPermutationKey maps one to one onto the
+// TESSELLATION, DECAL, NORMAL_MAP and NUM_*_LIGHTS defines.  SelectShaderPermutation
+// only looks at distances and flags the app computes, so nothing here depends on D3D.
+//***************************************************************************************
+
+#pragma once
+
+#include "ShaderCache.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum ShaderFeature : std::uint32_t
+{
+	ShaderFeatureTessellation = 1 << 0,
+	ShaderFeatureDecal = 1 << 1,
+	ShaderFeatureNormalMap = 1 << 2,
+};
+
+struct ShaderPermutationKey
+{
+	std::uint32_t Features = 0;
+	std::uint32_t NumDirLights = 0;
+	std::uint32_t NumPointLights = 0;
+	std::uint32_t NumSpotLights = 0;
+
+	bool Has(ShaderFeature feature)const { return (Features & feature) != 0; }
+
+	// Features in the low byte, then one byte per light count.  Light counts are
+	// clamped to 255 (MaxLights is far below that).
+	std::uint32_t Pack()const;
+
+	// Defines for d3dUtil::CompileShader, every switch spelled out.
+	std::vector<ShaderDefine> Defines()const;
+
+	// Short readable name, e.g. "tess+decal+nmap_d0p1s0".
+	std::string Name()const;
+
+	// Smallest key that is correct wherever a or b is: the union of the features
+	// and the larger light counts.  Used for instanced batches.
+	static ShaderPermutationKey Merge(const ShaderPermutationKey& a, const ShaderPermutationKey& b);
+
+	bool operator==(const ShaderPermutationKey& rhs)const { return Pack() == rhs.Pack(); }
+	bool operator!=(const ShaderPermutationKey& rhs)const { return Pack() != rhs.Pack(); }
+	bool operator<(const ShaderPermutationKey& rhs)const { return Pack() < rhs.Pack(); }
+};
+
+class ShaderPermutationKeyBuilder
+{
+public:
+	ShaderPermutationKeyBuilder& Tessellation(bool enable = true);
+	ShaderPermutationKeyBuilder& Decal(bool enable = true);
+	ShaderPermutationKeyBuilder& NormalMap(bool enable = true);
+	ShaderPermutationKeyBuilder& Lights(std::uint32_t numDir, std::uint32_t numPoint, std::uint32_t numSpot);
+
+	ShaderPermutationKey Build()const;
+
+private:
+	ShaderPermutationKeyBuilder& Set(ShaderFeature feature, bool enable);
+
+	ShaderPermutationKey mKey;
+};
+
+// Scene wide inputs of the selection.
+struct PermutationSceneInfo
+{
+	std::uint32_t NumDirLights = 0;
+	std::uint32_t NumPointLights = 0;
+	std::uint32_t NumSpotLights = 0;
+
+	// The decal has no influence at all beyond this distance from its center.
+	float DecalReach = 0.0f;
+
+	// Items whose bounds are farther than this from the eye skip the tessellation
+	// stages; the decal is then displaced per vertex instead of per domain point.
+	float TessellationDistance = 0.0f;
+};
+
+// Per item inputs, measured from the item's world space bounding sphere.
+struct PermutationItemInfo
+{
+	float Radius = 0.0f;
+	float DistanceToEye = 0.0f;
+	float DistanceToDecal = 0.0f;
+
+	bool HasNormalMap = true;
+
+	// Bit i is set if point light i (counting from the first point light) can reach
+	// the item.
+	std::uint32_t PointLightMask = ~0u;
+};
+
+ShaderPermutationKey SelectShaderPermutation(const PermutationItemInfo& item, const PermutationSceneInfo& scene);
+
+// Every key SelectShaderPermutation can return in a scene with these light counts,
+// whatever the distances, for items with a normal map (withNormalMap) and without one
+// (withoutNormalMap).  The set is closed under Merge, so it also covers instanced
+// batches.  Sorted, so the variants can all be built up front in a fixed order.
+std::vector<ShaderPermutationKey> ReachableShaderPermutations(const PermutationSceneInfo& scene,
+	bool withNormalMap, bool withoutNormalMap);
@@ -0,0 +1,56 @@
+//***************************************************************************************
+// StreamCopy.cpp
+//***************************************************************************************
+
+#include "StreamCopy.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+	#define STREAM_COPY_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define STREAM_COPY_SSE2 0
+#endif
+
+void StreamCopy(void* dst, const void* src, std::size_t byteCount)
+{
+	auto d = static_cast<std::uint8_t*>(dst);
+	auto s = static_cast<const std::uint8_t*>(src);
+
+#if STREAM_COPY_SSE2
+	std::size_t head = (16 - (reinterpret_cast<std::uintptr_t>(d) & 15)) & 15;
+	if(head > byteCount)
+		head = byteCount;
+
+	std::memcpy(d, s, head);
+	d += head;
+	s += head;
+	byteCount -= head;
+
+	// One 64 byte write-combining buffer per iteration.
+	for(; byteCount >= 64; byteCount -= 64, d += 64, s += 64)
+	{
+		__m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+		__m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+		__m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+		__m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d), r0);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), r1);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), r2);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), r3);
+	}
+
+	for(; byteCount >= 16; byteCount -= 16, d += 16, s += 16)
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+#endif
+
+	std::memcpy(d, s, byteCount);
+}
+
+void StreamFence()
+{
+#if STREAM_COPY_SSE2
+	_mm_sfence();
+#endif
+}
@@ -0,0 +1,19 @@
+//***************************************************************************************
+// StreamCopy.h
+//
+// Copies into write-combined memory (mapped upload heaps) with non-temporal 16 byte
+// stores, so whole lines are written without first being read into the cache.  The
+// destination must only ever be written, never read back: reads from write-combined
+// memory are uncached and very slow.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+
+// dst does not need to be aligned, but the fast path starts at the first 16 byte
+// boundary of dst.  Call StreamFence() after a batch of copies and before the GPU
+// can see the data, because streaming stores are weakly ordered.
+void StreamCopy(void* dst, const void* src, std::size_t byteCount);
+
+void StreamFence();
@@ -0,0 +1,274 @@
+//***************************************************************************************
+// TraceExporter.cpp
+//***************************************************************************************
+
+#include "TraceExporter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+	void WriteEscaped(std::ostream& out, const char* s)
+	{
+		for(; *s != '\0'; ++s)
+		{
+			char c = *s;
+			if(c == '"' || c == '\\')
+				out << '\\' << c;
+			else if((unsigned char)c < 0x20)
+				out << ' ';
+			else
+				out << c;
+		}
+	}
+
+	// Trace timestamps are microseconds; keep the nanoseconds as decimals.
+	void WriteMicroseconds(std::ostream& out, std::uint64_t ns)
+	{
+		char text[32];
+		std::snprintf(text, sizeof(text), "%llu.%03llu",
+			(unsigned long long)(ns / 1000), (unsigned long long)(ns % 1000));
+		out << text;
+	}
+}
+
+TraceExporter::TraceExporter() :
+	mWriter(&TraceExporter::WriterLoop, this)
+{
+}
+
+TraceExporter::~TraceExporter()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mShutdown = true;
+	}
+	mWake.notify_one();
+	mWriter.join();
+}
+
+bool TraceExporter::CaptureLastFrames(const std::filesystem::path& file, std::uint32_t frameCount)
+{
+	std::uint64_t endNs = 0;
+	std::uint64_t startNs = 0;
+	std::uint64_t lastStartNs = 0;
+	if(frameCount == 0 || !Profiler::GetFrameBounds(0, lastStartNs, endNs))
+		return false;
+
+	// Fewer frames may still be in the history than requested.
+	std::uint64_t frameEnd = Profiler::GetFrameCount() - 1;
+	std::uint64_t firstFrame = frameEnd > frameCount ? frameEnd - frameCount : 0;
+	while(!Profiler::GetFrameStart(firstFrame, startNs))
+		++firstFrame;
+
+	Capture capture;
+	capture.File = file;
+	for(std::uint64_t frame = firstFrame; frame <= frameEnd; ++frame)
+	{
+		std::uint64_t frameStartNs = 0;
+		if(Profiler::GetFrameStart(frame, frameStartNs))
+			capture.FrameStartsNs.push_back(frameStartNs);
+	}
+
+	Profiler::CollectZones(startNs, capture.Zones);
+	capture.Zones.erase(std::remove_if(capture.Zones.begin(), capture.Zones.end(), [endNs](const ProfileZone& zone)
+	{
+		return zone.StartNs >= endNs;
+	}), capture.Zones.end());
+
+	Counters::CollectFrames(startNs, capture.CounterFrames);
+	capture.CounterFrames.erase(std::remove_if(capture.CounterFrames.begin(), capture.CounterFrames.end(), [endNs](const CounterFrame& frame)
+	{
+		return frame.StartNs >= endNs;
+	}), capture.CounterFrames.end());
+
+	capture.ThreadNames = Profiler::GetThreadNames();
+	Queue(std::move(capture));
+	return true;
+}
+
+void TraceExporter::BeginCapture(const std::filesystem::path& file)
+{
+	if(mCapturing)
+		EndCapture();
+
+	mWindow = Capture();
+	mWindow.File = file;
+	mLastFrameCount = Profiler::GetFrameCount();
+	mCounterCursor = Counters::GetFrameCount();
+
+	// Start the cursors at the current heads: only zones finished from now on count.
+	std::vector<ProfileZone> discard;
+	mCursors.clear();
+	Profiler::CollectNewZones(mCursors, discard);
+
+	mCapturing = true;
+}
+
+void TraceExporter::EndCapture()
+{
+	if(!mCapturing)
+		return;
+
+	Tick();
+	mCapturing = false;
+
+	mWindow.ThreadNames = Profiler::GetThreadNames();
+	Queue(std::move(mWindow));
+	mWindow = Capture();
+}
+
+bool TraceExporter::IsCapturing()const
+{
+	return mCapturing;
+}
+
+void TraceExporter::Tick()
+{
+	if(!mCapturing)
+		return;
+
+	Profiler::CollectNewZones(mCursors, mWindow.Zones);
+	Counters::CollectNewFrames(mCounterCursor, mWindow.CounterFrames);
+
+	std::uint64_t frameCount = Profiler::GetFrameCount();
+	for(; mLastFrameCount < frameCount; ++mLastFrameCount)
+	{
+		std::uint64_t startNs = 0;
+		if(Profiler::GetFrameStart(mLastFrameCount, startNs))
+			mWindow.FrameStartsNs.push_back(startNs);
+	}
+}
+
+std::uint32_t TraceExporter::GetPendingWrites()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mPendingWrites;
+}
+
+std::filesystem::path TraceExporter::GetLastWrittenFile()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mLastWrittenFile;
+}
+
+void TraceExporter::WriteJson(std::ostream& out, const std::vector<ProfileZone>& zones,
+	const std::vector<std::string>& threadNames, const std::vector<std::uint64_t>& frameStartsNs,
+	const std::vector<CounterFrame>& counterFrames)
+{
+	out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+	bool first = true;
+	auto separator = [&]()
+	{
+		if(!first)
+			out << ",\n";
+		first = false;
+	};
+
+	// Track names, in profiler registration order.
+	for(std::size_t i = 0; i < threadNames.size(); ++i)
+	{
+		separator();
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"name\":\"";
+		WriteEscaped(out, threadNames[i].c_str());
+		out << "\"}}";
+
+		separator();
+		out << "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+			<< ",\"args\":{\"sort_index\":" << i << "}}";
+	}
+
+	for(std::size_t i = 0; i < frameStartsNs.size(); ++i)
+	{
+		separator();
+		out << "{\"name\":\"Frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":";
+		WriteMicroseconds(out, frameStartsNs[i]);
+		out << "}";
+	}
+
+	// A counter holds its value until the next event, so each frame's value is set at
+	// the frame's start.
+	for(const auto& frame : counterFrames)
+	{
+		for(int i = 0; i < CounterCount; ++i)
+		{
+			separator();
+			out << "{\"name\":\"" << Counters::GetInfo((CounterId)i).Name << "\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":";
+			WriteMicroseconds(out, frame.StartNs);
+			out << ",\"args\":{\"value\":" << frame.Values[i] << "}}";
+		}
+	}
+
+	for(const auto& zone : zones)
+	{
+		separator();
+		out << "{\"name\":\"";
+		WriteEscaped(out, zone.Name);
+		out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << zone.ThreadIndex << ",\"ts\":";
+		WriteMicroseconds(out, zone.StartNs);
+		out << ",\"dur\":";
+		WriteMicroseconds(out, zone.EndNs - zone.StartNs);
+		if(zone.Allocations != 0)
+			out << ",\"args\":{\"allocations\":" << zone.Allocations << ",\"allocated_bytes\":" << zone.AllocatedBytes << "}";
+		out << "}";
+	}
+
+	out << "\n]}\n";
+}
+
+void TraceExporter::Queue(Capture capture)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQueue.push_back(std::move(capture));
+		mPendingWrites++;
+	}
+	mWake.notify_one();
+}
+
+void TraceExporter::WriterLoop()
+{
+	for(;;)
+	{
+		Capture capture;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWake.wait(lock, [this]() { return mShutdown || !mQueue.empty(); });
+
+			// Queued captures are still written on shutdown.
+			if(mQueue.empty())
+				return;
+
+			capture = std::move(mQueue.front());
+			mQueue.pop_front();
+		}
+
+		// Viewers draw nested slices correctly in any order, but sorted output is
+		// easier to diff and to read.
+		std::sort(capture.Zones.begin(), capture.Zones.end(), [](const ProfileZone& a, const ProfileZone& b)
+		{
+			return a.ThreadIndex != b.ThreadIndex ? a.ThreadIndex < b.ThreadIndex : a.StartNs < b.StartNs;
+		});
+
+		bool written = false;
+		{
+			std::error_code ec;
+			if(capture.File.has_parent_path())
+				std::filesystem::create_directories(capture.File.parent_path(), ec);
+
+			std::ofstream fout(capture.File, std::ios::binary | std::ios::trunc);
+			if(fout)
+			{
+				WriteJson(fout, capture.Zones, capture.ThreadNames, capture.FrameStartsNs, capture.CounterFrames);
+				written = (bool)fout;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mLastWrittenFile = written ? capture.File : std::filesystem::path();
+		mPendingWrites--;
+	}
+}
@@ -0,0 +1,86 @@
+//***************************************************************************************
+// TraceExporter.h
+//
+// Writes Profiler zones as Chrome Trace Event JSON (chrome://tracing, ui.perfetto.dev),
+// one track per profiled thread, a marker per frame start and a counter track per
+// Counters entry with its per-frame values.  Two ways to capture:
+//   -CaptureLastFrames(n) takes the last n finished frames still in the profiler rings.
+//   -BeginCapture()/EndCapture() take everything in between, however long.  Tick()
+//    drains the rings once per frame so nothing is lost to ring wrap-around.
+// Zones are copied on the calling thread; formatting and file I/O run on a writer
+// thread, so a capture never waits on the disk.
+//***************************************************************************************
+
+#pragma once
+
+#include "Counters.h"
+#include "Profiler.h"
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+class TraceExporter
+{
+public:
+	TraceExporter();
+	TraceExporter(const TraceExporter& rhs) = delete;
+	TraceExporter& operator=(const TraceExporter& rhs) = delete;
+
+	// Finishes writing the queued captures.
+	~TraceExporter();
+
+	// Queues the last frameCount finished frames for writing to file.  Returns false
+	// if the profiler has no finished frame yet.
+	bool CaptureLastFrames(const std::filesystem::path& file, std::uint32_t frameCount);
+
+	// Starts a capture window that is written to file by EndCapture().
+	void BeginCapture(const std::filesystem::path& file);
+	void EndCapture();
+	bool IsCapturing()const;
+
+	// Call once per frame, after PROFILE_FRAME_MARK().
+	void Tick();
+
+	// Captures queued or being written.
+	std::uint32_t GetPendingWrites()const;
+
+	// File of the last capture written, empty if none or if it failed.
+	std::filesystem::path GetLastWrittenFile()const;
+
+	// Writes a trace to out.  Used by the writer thread; exposed for other sinks.
+	static void WriteJson(std::ostream& out, const std::vector<ProfileZone>& zones,
+		const std::vector<std::string>& threadNames, const std::vector<std::uint64_t>& frameStartsNs,
+		const std::vector<CounterFrame>& counterFrames);
+
+private:
+	struct Capture
+	{
+		std::filesystem::path File;
+		std::vector<ProfileZone> Zones;
+		std::vector<std::string> ThreadNames;
+		std::vector<std::uint64_t> FrameStartsNs;
+		std::vector<CounterFrame> CounterFrames;
+	};
+
+	void Queue(Capture capture);
+	void WriterLoop();
+
+	// Window capture state, only touched by the frame thread.
+	bool mCapturing = false;
+	Capture mWindow;
+	std::vector<std::uint64_t> mCursors;
+	std::uint64_t mLastFrameCount = 0;
+	std::uint64_t mCounterCursor = 0;
+
+	mutable std::mutex mMutex;
+	std::condition_variable mWake;
+	std::deque<Capture> mQueue;
+	std::uint32_t mPendingWrites = 0;
+	std::filesystem::path mLastWrittenFile;
+	bool mShutdown = false;
+
+	std::thread mWriter;
+};
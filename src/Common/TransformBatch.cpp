@@ -0,0 +1,420 @@
+//***************************************************************************************
+// TransformBatch.cpp
+//***************************************************************************************
+
+#include "TransformBatch.h"
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+	#define TRANSFORM_BATCH_X86 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define TRANSFORM_BATCH_AVX2_TARGET
+	#else
+		#define TRANSFORM_BATCH_AVX2_TARGET __attribute__((target("avx2")))
+	#endif
+#else
+	#define TRANSFORM_BATCH_X86 0
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	//
+	// Scalar reference kernels.  Also used for the tail of SIMD batches.
+	//
+
+	void TransposeScalar(const XMFLOAT4X4& m, XMFLOAT4X4& out)
+	{
+		XMFLOAT4X4 t;
+		for(int r = 0; r < 4; ++r)
+			for(int c = 0; c < 4; ++c)
+				t.m[r][c] = m.m[c][r];
+		out = t;
+	}
+
+	void AffineInverseTransposeScalar(const XMFLOAT4X4& m, XMFLOAT4X4& out)
+	{
+		// Inverse-transpose of the upper 3x3 is its cofactor matrix divided by the determinant.
+		float c00 = m._22 * m._33 - m._23 * m._32;
+		float c01 = m._23 * m._31 - m._21 * m._33;
+		float c02 = m._21 * m._32 - m._22 * m._31;
+		float c10 = m._13 * m._32 - m._12 * m._33;
+		float c11 = m._11 * m._33 - m._13 * m._31;
+		float c12 = m._12 * m._31 - m._11 * m._32;
+		float c20 = m._12 * m._23 - m._13 * m._22;
+		float c21 = m._13 * m._21 - m._11 * m._23;
+		float c22 = m._11 * m._22 - m._12 * m._21;
+
+		float invDet = 1.0f / (m._11 * c00 + m._12 * c01 + m._13 * c02);
+
+		out = XMFLOAT4X4(
+			c00 * invDet, c01 * invDet, c02 * invDet, 0.0f,
+			c10 * invDet, c11 * invDet, c12 * invDet, 0.0f,
+			c20 * invDet, c21 * invDet, c22 * invDet, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	void ComposeScalar(const XMFLOAT4X4& a, const XMFLOAT4X4& b, XMFLOAT4X4& out)
+	{
+		XMFLOAT4X4 t;
+		for(int r = 0; r < 4; ++r)
+		{
+			for(int c = 0; c < 4; ++c)
+			{
+				t.m[r][c] =
+					a.m[r][0] * b.m[0][c] +
+					a.m[r][1] * b.m[1][c] +
+					a.m[r][2] * b.m[2][c] +
+					a.m[r][3] * b.m[3][c];
+			}
+		}
+		out = t;
+	}
+
+#if TRANSFORM_BATCH_X86
+
+	//
+	// SSE kernels.
+	//
+
+	void TransposeSSE(const XMFLOAT4X4* src, XMFLOAT4X4* dst, std::size_t count)
+	{
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			__m128 r0 = _mm_loadu_ps(src[i].m[0]);
+			__m128 r1 = _mm_loadu_ps(src[i].m[1]);
+			__m128 r2 = _mm_loadu_ps(src[i].m[2]);
+			__m128 r3 = _mm_loadu_ps(src[i].m[3]);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps(dst[i].m[0], r0);
+			_mm_storeu_ps(dst[i].m[1], r1);
+			_mm_storeu_ps(dst[i].m[2], r2);
+			_mm_storeu_ps(dst[i].m[3], r3);
+		}
+	}
+
+	std::size_t AffineInverseTransposeSSE(const XMFLOAT4X4* src, XMFLOAT4X4* dst, std::size_t count)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 lastRow = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+		std::size_t i = 0;
+		for(; i + 4 <= count; i += 4)
+		{
+			// AoS -> SoA: after the transpose m[r][c] holds element (r,c) of all 4 matrices.
+			__m128 m[3][4];
+			for(int r = 0; r < 3; ++r)
+			{
+				m[r][0] = _mm_loadu_ps(src[i + 0].m[r]);
+				m[r][1] = _mm_loadu_ps(src[i + 1].m[r]);
+				m[r][2] = _mm_loadu_ps(src[i + 2].m[r]);
+				m[r][3] = _mm_loadu_ps(src[i + 3].m[r]);
+				_MM_TRANSPOSE4_PS(m[r][0], m[r][1], m[r][2], m[r][3]);
+			}
+
+			__m128 c[3][4];
+			c[0][0] = _mm_sub_ps(_mm_mul_ps(m[1][1], m[2][2]), _mm_mul_ps(m[1][2], m[2][1]));
+			c[0][1] = _mm_sub_ps(_mm_mul_ps(m[1][2], m[2][0]), _mm_mul_ps(m[1][0], m[2][2]));
+			c[0][2] = _mm_sub_ps(_mm_mul_ps(m[1][0], m[2][1]), _mm_mul_ps(m[1][1], m[2][0]));
+			c[1][0] = _mm_sub_ps(_mm_mul_ps(m[0][2], m[2][1]), _mm_mul_ps(m[0][1], m[2][2]));
+			c[1][1] = _mm_sub_ps(_mm_mul_ps(m[0][0], m[2][2]), _mm_mul_ps(m[0][2], m[2][0]));
+			c[1][2] = _mm_sub_ps(_mm_mul_ps(m[0][1], m[2][0]), _mm_mul_ps(m[0][0], m[2][1]));
+			c[2][0] = _mm_sub_ps(_mm_mul_ps(m[0][1], m[1][2]), _mm_mul_ps(m[0][2], m[1][1]));
+			c[2][1] = _mm_sub_ps(_mm_mul_ps(m[0][2], m[1][0]), _mm_mul_ps(m[0][0], m[1][2]));
+			c[2][2] = _mm_sub_ps(_mm_mul_ps(m[0][0], m[1][1]), _mm_mul_ps(m[0][1], m[1][0]));
+
+			__m128 det = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(m[0][0], c[0][0]), _mm_mul_ps(m[0][1], c[0][1])),
+				_mm_mul_ps(m[0][2], c[0][2]));
+			__m128 invDet = _mm_div_ps(one, det);
+
+			// SoA -> AoS, one output row at a time.
+			for(int r = 0; r < 3; ++r)
+			{
+				c[r][0] = _mm_mul_ps(c[r][0], invDet);
+				c[r][1] = _mm_mul_ps(c[r][1], invDet);
+				c[r][2] = _mm_mul_ps(c[r][2], invDet);
+				c[r][3] = zero;
+				_MM_TRANSPOSE4_PS(c[r][0], c[r][1], c[r][2], c[r][3]);
+			}
+
+			for(int k = 0; k < 4; ++k)
+			{
+				_mm_storeu_ps(dst[i + k].m[0], c[0][k]);
+				_mm_storeu_ps(dst[i + k].m[1], c[1][k]);
+				_mm_storeu_ps(dst[i + k].m[2], c[2][k]);
+				_mm_storeu_ps(dst[i + k].m[3], lastRow);
+			}
+		}
+
+		return i;
+	}
+
+	void ComposeSSE(const XMFLOAT4X4* a, const XMFLOAT4X4* b, XMFLOAT4X4* dst, std::size_t count)
+	{
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			__m128 b0 = _mm_loadu_ps(b[i].m[0]);
+			__m128 b1 = _mm_loadu_ps(b[i].m[1]);
+			__m128 b2 = _mm_loadu_ps(b[i].m[2]);
+			__m128 b3 = _mm_loadu_ps(b[i].m[3]);
+
+			// All rows are computed before any store so dst may alias a or b.
+			__m128 rows[4];
+			for(int r = 0; r < 4; ++r)
+			{
+				__m128 ar = _mm_loadu_ps(a[i].m[r]);
+				__m128 x = _mm_shuffle_ps(ar, ar, _MM_SHUFFLE(0, 0, 0, 0));
+				__m128 y = _mm_shuffle_ps(ar, ar, _MM_SHUFFLE(1, 1, 1, 1));
+				__m128 z = _mm_shuffle_ps(ar, ar, _MM_SHUFFLE(2, 2, 2, 2));
+				__m128 w = _mm_shuffle_ps(ar, ar, _MM_SHUFFLE(3, 3, 3, 3));
+				rows[r] = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(x, b0), _mm_mul_ps(y, b1)),
+					_mm_add_ps(_mm_mul_ps(z, b2), _mm_mul_ps(w, b3)));
+			}
+
+			for(int r = 0; r < 4; ++r)
+				_mm_storeu_ps(dst[i].m[r], rows[r]);
+		}
+	}
+
+	//
+	// AVX2 kernels.  The low 128-bit lane holds matrices [i, i+4), the high lane [i+4, i+8).
+	//
+
+	TRANSFORM_BATCH_AVX2_TARGET
+	inline void Transpose4InLanes(__m256& r0, __m256& r1, __m256& r2, __m256& r3)
+	{
+		__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+		__m256 t1 = _mm256_unpacklo_ps(r2, r3);
+		__m256 t2 = _mm256_unpackhi_ps(r0, r1);
+		__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+		r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+		r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+		r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+	}
+
+	TRANSFORM_BATCH_AVX2_TARGET
+	inline __m256 LoadRowPair(const XMFLOAT4X4& lo, const XMFLOAT4X4& hi, int r)
+	{
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(lo.m[r])), _mm_loadu_ps(hi.m[r]), 1);
+	}
+
+	TRANSFORM_BATCH_AVX2_TARGET
+	std::size_t AffineInverseTransposeAVX2(const XMFLOAT4X4* src, XMFLOAT4X4* dst, std::size_t count)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m128 lastRow = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+		std::size_t i = 0;
+		for(; i + 8 <= count; i += 8)
+		{
+			__m256 m[3][4];
+			for(int r = 0; r < 3; ++r)
+			{
+				m[r][0] = LoadRowPair(src[i + 0], src[i + 4], r);
+				m[r][1] = LoadRowPair(src[i + 1], src[i + 5], r);
+				m[r][2] = LoadRowPair(src[i + 2], src[i + 6], r);
+				m[r][3] = LoadRowPair(src[i + 3], src[i + 7], r);
+				Transpose4InLanes(m[r][0], m[r][1], m[r][2], m[r][3]);
+			}
+
+			__m256 c[3][4];
+			c[0][0] = _mm256_sub_ps(_mm256_mul_ps(m[1][1], m[2][2]), _mm256_mul_ps(m[1][2], m[2][1]));
+			c[0][1] = _mm256_sub_ps(_mm256_mul_ps(m[1][2], m[2][0]), _mm256_mul_ps(m[1][0], m[2][2]));
+			c[0][2] = _mm256_sub_ps(_mm256_mul_ps(m[1][0], m[2][1]), _mm256_mul_ps(m[1][1], m[2][0]));
+			c[1][0] = _mm256_sub_ps(_mm256_mul_ps(m[0][2], m[2][1]), _mm256_mul_ps(m[0][1], m[2][2]));
+			c[1][1] = _mm256_sub_ps(_mm256_mul_ps(m[0][0], m[2][2]), _mm256_mul_ps(m[0][2], m[2][0]));
+			c[1][2] = _mm256_sub_ps(_mm256_mul_ps(m[0][1], m[2][0]), _mm256_mul_ps(m[0][0], m[2][1]));
+			c[2][0] = _mm256_sub_ps(_mm256_mul_ps(m[0][1], m[1][2]), _mm256_mul_ps(m[0][2], m[1][1]));
+			c[2][1] = _mm256_sub_ps(_mm256_mul_ps(m[0][2], m[1][0]), _mm256_mul_ps(m[0][0], m[1][2]));
+			c[2][2] = _mm256_sub_ps(_mm256_mul_ps(m[0][0], m[1][1]), _mm256_mul_ps(m[0][1], m[1][0]));
+
+			__m256 det = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(m[0][0], c[0][0]), _mm256_mul_ps(m[0][1], c[0][1])),
+				_mm256_mul_ps(m[0][2], c[0][2]));
+			__m256 invDet = _mm256_div_ps(one, det);
+
+			for(int r = 0; r < 3; ++r)
+			{
+				c[r][0] = _mm256_mul_ps(c[r][0], invDet);
+				c[r][1] = _mm256_mul_ps(c[r][1], invDet);
+				c[r][2] = _mm256_mul_ps(c[r][2], invDet);
+				c[r][3] = zero;
+				Transpose4InLanes(c[r][0], c[r][1], c[r][2], c[r][3]);
+			}
+
+			for(int k = 0; k < 4; ++k)
+			{
+				for(int r = 0; r < 3; ++r)
+				{
+					_mm_storeu_ps(dst[i + k].m[r], _mm256_castps256_ps128(c[r][k]));
+					_mm_storeu_ps(dst[i + k + 4].m[r], _mm256_extractf128_ps(c[r][k], 1));
+				}
+				_mm_storeu_ps(dst[i + k].m[3], lastRow);
+				_mm_storeu_ps(dst[i + k + 4].m[3], lastRow);
+			}
+		}
+
+		return i;
+	}
+
+	TRANSFORM_BATCH_AVX2_TARGET
+	void ComposeAVX2(const XMFLOAT4X4* a, const XMFLOAT4X4* b, XMFLOAT4X4* dst, std::size_t count)
+	{
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			// Each row of b is duplicated into both lanes so two rows of a are done at once.
+			__m256 b0 = _mm256_broadcast_ps((const __m128*)b[i].m[0]);
+			__m256 b1 = _mm256_broadcast_ps((const __m128*)b[i].m[1]);
+			__m256 b2 = _mm256_broadcast_ps((const __m128*)b[i].m[2]);
+			__m256 b3 = _mm256_broadcast_ps((const __m128*)b[i].m[3]);
+
+			__m256 rows[2];
+			for(int r = 0; r < 2; ++r)
+			{
+				__m256 ar = _mm256_loadu_ps(a[i].m[2 * r]);
+				__m256 x = _mm256_shuffle_ps(ar, ar, _MM_SHUFFLE(0, 0, 0, 0));
+				__m256 y = _mm256_shuffle_ps(ar, ar, _MM_SHUFFLE(1, 1, 1, 1));
+				__m256 z = _mm256_shuffle_ps(ar, ar, _MM_SHUFFLE(2, 2, 2, 2));
+				__m256 w = _mm256_shuffle_ps(ar, ar, _MM_SHUFFLE(3, 3, 3, 3));
+				rows[r] = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(x, b0), _mm256_mul_ps(y, b1)),
+					_mm256_add_ps(_mm256_mul_ps(z, b2), _mm256_mul_ps(w, b3)));
+			}
+
+			_mm256_storeu_ps(dst[i].m[0], rows[0]);
+			_mm256_storeu_ps(dst[i].m[2], rows[1]);
+		}
+	}
+
+#endif // TRANSFORM_BATCH_X86
+
+	TransformBatch::Path DetectPath()
+	{
+#if TRANSFORM_BATCH_X86
+	#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if(info[0] >= 7)
+		{
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+
+			// The OS must save the YMM registers on context switches.
+			if(osxsave && avx && (_xgetbv(0) & 0x6) == 0x6)
+			{
+				__cpuidex(info, 7, 0);
+				if((info[1] & (1 << 5)) != 0)
+					return TransformBatch::Path::AVX2;
+			}
+		}
+	#else
+		if(__builtin_cpu_supports("avx2"))
+			return TransformBatch::Path::AVX2;
+	#endif
+		return TransformBatch::Path::SSE;
+#else
+		return TransformBatch::Path::Scalar;
+#endif
+	}
+
+	const TransformBatch::Path gDetectedPath = DetectPath();
+	std::atomic<TransformBatch::Path> gActivePath{ gDetectedPath };
+}
+
+TransformBatch::Path TransformBatch::GetPath()
+{
+	return gActivePath.load(std::memory_order_relaxed);
+}
+
+void TransformBatch::ForcePath(Path path)
+{
+	if((int)path > (int)gDetectedPath)
+		path = gDetectedPath;
+
+	gActivePath.store(path, std::memory_order_relaxed);
+}
+
+void TransformBatch::Transpose(const XMFLOAT4X4* src, XMFLOAT4X4* dst, std::size_t count)
+{
+#if TRANSFORM_BATCH_X86
+	// A single 4x4 transpose is already one SSE shuffle network; AVX2 adds nothing here.
+	if(GetPath() != Path::Scalar)
+	{
+		TransposeSSE(src, dst, count);
+		return;
+	}
+#endif
+
+	for(std::size_t i = 0; i < count; ++i)
+		TransposeScalar(src[i], dst[i]);
+}
+
+void TransformBatch::AffineInverseTranspose(const XMFLOAT4X4* src, XMFLOAT4X4* dst, std::size_t count)
+{
+	std::size_t done = 0;
+
+#if TRANSFORM_BATCH_X86
+	Path path = GetPath();
+	if(path == Path::AVX2)
+		done = AffineInverseTransposeAVX2(src, dst, count);
+	if(path != Path::Scalar)
+		done += AffineInverseTransposeSSE(src + done, dst + done, count - done);
+#endif
+
+	for(std::size_t i = done; i < count; ++i)
+		AffineInverseTransposeScalar(src[i], dst[i]);
+}
+
+void TransformBatch::Compose(const XMFLOAT4X4* a, const XMFLOAT4X4* b, XMFLOAT4X4* dst, std::size_t count)
+{
+#if TRANSFORM_BATCH_X86
+	Path path = GetPath();
+	if(path == Path::AVX2)
+	{
+		ComposeAVX2(a, b, dst, count);
+		return;
+	}
+	if(path == Path::SSE)
+	{
+		ComposeSSE(a, b, dst, count);
+		return;
+	}
+#endif
+
+	for(std::size_t i = 0; i < count; ++i)
+		ComposeScalar(a[i], b[i], dst[i]);
+}
+
+void TransformBatch::ExpandTRS(const TransformTRS* src, XMFLOAT4X4* world, XMFLOAT4X4* invWorld, std::size_t count)
+{
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		XMMATRIX r = XMMatrixRotationQuaternion(XMLoadFloat4(&src[i].Rotation));
+		XMVECTOR s = XMLoadFloat3(&src[i].Scale);
+		XMVECTOR invS = XMVectorReciprocal(s);
+
+		XMMATRIX w;
+		w.r[0] = XMVectorMultiply(r.r[0], XMVectorSplatX(s));
+		w.r[1] = XMVectorMultiply(r.r[1], XMVectorSplatY(s));
+		w.r[2] = XMVectorMultiply(r.r[2], XMVectorSplatZ(s));
+		w.r[3] = XMVectorSetW(XMLoadFloat3(&src[i].Translation), 1.0f);
+
+		XMMATRIX invT;
+		invT.r[0] = XMVectorMultiply(r.r[0], XMVectorSplatX(invS));
+		invT.r[1] = XMVectorMultiply(r.r[1], XMVectorSplatY(invS));
+		invT.r[2] = XMVectorMultiply(r.r[2], XMVectorSplatZ(invS));
+		invT.r[3] = g_XMIdentityR3;
+
+		XMStoreFloat4x4(&world[i], w);
+		XMStoreFloat4x4(&invWorld[i], invT);
+	}
+}
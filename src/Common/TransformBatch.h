@@ -0,0 +1,68 @@
+//***************************************************************************************
+// TransformBatch.h
+//
+// Matrix kernels that work on whole arrays of transforms instead of one XMMATRIX at a
+// time.  The inverse-transpose kernel works in SoA form (one register holds the same
+// element of 4 (SSE) or 8 (AVX2) matrices).  AVX2 is picked at run time, SSE is the
+// x86 baseline and every kernel has a scalar fallback for other targets and for the
+// remainder of a batch.  ExpandTRS turns compact TransformTRS values into matrices.
+//
+// All matrices use the DirectXMath row-vector convention.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+
+// Compact scale/rotation/translation transform (40 bytes instead of a 64 byte matrix).
+// Expands to Scale * Rotation * Translation.  Rotation must be a unit quaternion.
+struct TransformTRS
+{
+	DirectX::XMFLOAT3 Translation = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT4 Rotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+	DirectX::XMFLOAT3 Scale = { 1.0f, 1.0f, 1.0f };
+
+	static TransformTRS Make(const DirectX::XMFLOAT3& scale, float pitch, float yaw, float roll, const DirectX::XMFLOAT3& translation)
+	{
+		TransformTRS t;
+		t.Scale = scale;
+		DirectX::XMStoreFloat4(&t.Rotation, DirectX::XMQuaternionRotationRollPitchYaw(pitch, yaw, roll));
+		t.Translation = translation;
+		return t;
+	}
+};
+
+class TransformBatch
+{
+public:
+	enum class Path
+	{
+		Scalar,
+		SSE,
+		AVX2
+	};
+
+	// Widest path supported by the CPU (or forced with ForcePath).
+	static Path GetPath();
+
+	// Forces a narrower path, e.g. to compare results or throughput.  Requests
+	// wider than the CPU supports are clamped.
+	static void ForcePath(Path path);
+
+	// dst[i] = transpose(src[i]).  src and dst may alias.
+	static void Transpose(const DirectX::XMFLOAT4X4* src, DirectX::XMFLOAT4X4* dst, std::size_t count);
+
+	// dst[i] = MathHelper::InverseTranspose(src[i]) for affine matrices (the 4th column
+	// is (0,0,0,1)).  Only the upper 3x3 is inverted, via its cofactors, instead of a
+	// full 4x4 determinant and inverse.  Translation is dropped.  src and dst may alias.
+	static void AffineInverseTranspose(const DirectX::XMFLOAT4X4* src, DirectX::XMFLOAT4X4* dst, std::size_t count);
+
+	// dst[i] = a[i] * b[i].  dst may alias a or b.
+	static void Compose(const DirectX::XMFLOAT4X4* a, const DirectX::XMFLOAT4X4* b, DirectX::XMFLOAT4X4* dst, std::size_t count);
+
+	// Expands src[i] into its world matrix and the inverse-transpose of it (same result
+	// as AffineInverseTranspose(world)).  With M = S*R the inverse-transpose is S^-1 * R,
+	// i.e. the rows of R divided by the scale, so no inverse is computed at all.
+	static void ExpandTRS(const TransformTRS* src, DirectX::XMFLOAT4X4* world, DirectX::XMFLOAT4X4* invWorld, std::size_t count);
+};
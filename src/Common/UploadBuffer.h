@@ -1,6 +1,8 @@
 #pragma once
 
 #include "d3dUtil.h"
+#include "Counters.h"
+#include "StreamCopy.h"
 
 template<typename T>
 class UploadBuffer
@@ -50,9 +52,30 @@ public:
         return mUploadBuffer.Get();
     }
 
+    // The mapped memory is write-combined: it must only be written, never read back.
     void CopyData(int elementIndex, const T& data)
     {
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
+        Counters::Add(CounterUploadBytes, sizeof(T));
+    }
+
+    // Writes count consecutive elements starting at elementIndex with streaming
+    // stores.  Prefer this over a loop of single CopyData calls.
+    void CopyData(int elementIndex, const T* data, UINT count)
+    {
+        if(mElementByteSize == sizeof(T))
+        {
+            StreamCopy(&mMappedData[elementIndex*mElementByteSize], data, sizeof(T)*count);
+        }
+        else
+        {
+            // Constant buffer elements are padded; the padding is left untouched.
+            for(UINT i = 0; i < count; ++i)
+                StreamCopy(&mMappedData[(elementIndex + i)*mElementByteSize], &data[i], sizeof(T));
+        }
+
+        StreamFence();
+        Counters::Add(CounterUploadBytes, (std::uint64_t)sizeof(T)*count);
     }
 
 private:
@@ -0,0 +1,85 @@
+//***************************************************************************************
+// UploadBufferPool.h
+//
+// Growable array of upload heap elements built from fixed size UploadBuffer chunks.
+// Growing only appends chunks: existing chunks are never reallocated or moved, so the
+// pool can grow while the GPU is still reading from it without flushing the queue.
+// Elements never straddle two chunks, so any run of elements inside one chunk can be
+// bound through a single GPU virtual address.
+//***************************************************************************************
+
+#pragma once
+
+#include "UploadBuffer.h"
+
+template<typename T>
+class UploadBufferPool
+{
+public:
+    UploadBufferPool(ID3D12Device* device, UINT chunkSize, bool isConstantBuffer) :
+        mDevice(device), mChunkSize(chunkSize), mIsConstantBuffer(isConstantBuffer)
+    {
+        mElementByteSize = sizeof(T);
+        if(isConstantBuffer)
+            mElementByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(T));
+    }
+
+    UploadBufferPool(const UploadBufferPool& rhs) = delete;
+    UploadBufferPool& operator=(const UploadBufferPool& rhs) = delete;
+
+    // Makes sure elements [0, elementCount) exist.  Never shrinks.
+    void Reserve(UINT elementCount)
+    {
+        while(Capacity() < elementCount)
+            mChunks.push_back(std::make_unique<UploadBuffer<T>>(mDevice, mChunkSize, mIsConstantBuffer));
+    }
+
+    UINT Capacity()const
+    {
+        return (UINT)mChunks.size() * mChunkSize;
+    }
+
+    UINT GetChunkSize()const
+    {
+        return mChunkSize;
+    }
+
+    void CopyData(UINT elementIndex, const T& data)
+    {
+        mChunks[elementIndex / mChunkSize]->CopyData(elementIndex % mChunkSize, data);
+    }
+
+    // Bulk streaming write of count consecutive elements, split at chunk boundaries.
+    void CopyData(UINT elementIndex, const T* data, UINT count)
+    {
+        while(count > 0)
+        {
+            UINT indexInChunk = elementIndex % mChunkSize;
+            UINT run = mChunkSize - indexInChunk < count ? mChunkSize - indexInChunk : count;
+            mChunks[elementIndex / mChunkSize]->CopyData(indexInChunk, data, run);
+
+            elementIndex += run;
+            data += run;
+            count -= run;
+        }
+    }
+
+    // Start of the chunk holding elementIndex.
+    D3D12_GPU_VIRTUAL_ADDRESS GetChunkGPUVirtualAddress(UINT elementIndex)const
+    {
+        return mChunks[elementIndex / mChunkSize]->Resource()->GetGPUVirtualAddress();
+    }
+
+    D3D12_GPU_VIRTUAL_ADDRESS GetGPUVirtualAddress(UINT elementIndex)const
+    {
+        return GetChunkGPUVirtualAddress(elementIndex) + (elementIndex % mChunkSize) * (UINT64)mElementByteSize;
+    }
+
+private:
+    ID3D12Device* mDevice = nullptr;
+    std::vector<std::unique_ptr<UploadBuffer<T>>> mChunks;
+
+    UINT mChunkSize = 0;
+    UINT mElementByteSize = 0;
+    bool mIsConstantBuffer = false;
+};
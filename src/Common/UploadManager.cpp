@@ -0,0 +1,208 @@
+//***************************************************************************************
+// UploadManager.cpp
+//***************************************************************************************
+
+#include "UploadManager.h"
+#include "Counters.h"
+
+using Microsoft::WRL::ComPtr;
+
+UploadManager::UploadManager(ID3D12Device* device, UINT64 batchBudget) :
+	mDevice(device),
+	mBatchBudget(batchBudget)
+{
+	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	ThrowIfFailed(mDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&mQueue)));
+
+	ThrowIfFailed(mDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
+
+	mFenceEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+	if(mFenceEvent == nullptr)
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+}
+
+UploadManager::~UploadManager()
+{
+	// Staging buffers must outlive the copies that read them.
+	if(mQueue != nullptr)
+		Flush();
+
+	if(mFenceEvent != nullptr)
+		CloseHandle(mFenceEvent);
+}
+
+ComPtr<ID3D12Resource> UploadManager::CreateBuffer(const void* data, UINT64 byteSize)
+{
+	OpenBatch();
+
+	ComPtr<ID3D12Resource> buffer;
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(&buffer)));
+
+	ComPtr<ID3D12Resource> staging;
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&staging)));
+
+	void* mapped = nullptr;
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(staging->Map(0, &readRange, &mapped));
+	memcpy(mapped, data, (size_t)byteSize);
+	staging->Unmap(0, nullptr);
+
+	// The copy promotes the buffer to COPY_DEST; it decays back to COMMON when the
+	// batch completes.
+	mCommandList->CopyBufferRegion(buffer.Get(), 0, staging.Get(), 0, byteSize);
+
+	AddStaging(std::move(staging), byteSize);
+	return buffer;
+}
+
+HRESULT UploadManager::CreateDDSTexture(const uint8_t* ddsData, size_t ddsDataSize, ComPtr<ID3D12Resource>& texture)
+{
+	OpenBatch();
+
+	// Copy command lists only accept copy states, so the loader returns the texture to
+	// COMMON instead of PIXEL_SHADER_RESOURCE.
+	ComPtr<ID3D12Resource> staging;
+	HRESULT hr = DirectX::CreateDDSTextureFromMemory12(mDevice.Get(), mCommandList.Get(),
+		ddsData, ddsDataSize, texture, staging, 0, nullptr, D3D12_RESOURCE_STATE_COMMON);
+	if(FAILED(hr))
+		return hr;
+
+	UINT64 byteSize = staging->GetDesc().Width;
+	AddStaging(std::move(staging), byteSize);
+	return S_OK;
+}
+
+UINT64 UploadManager::Submit()
+{
+	if(!mBatchOpen)
+		return mFenceValue;
+
+	ThrowIfFailed(mCommandList->Close());
+	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
+	mQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+
+	mOpenBatch.Fence = ++mFenceValue;
+	ThrowIfFailed(mQueue->Signal(mFence.Get(), mOpenBatch.Fence));
+
+	mInFlight.push_back(std::move(mOpenBatch));
+	mOpenBatch = Batch();
+	mBatchOpen = false;
+
+	return mFenceValue;
+}
+
+void UploadManager::InsertWait(ID3D12CommandQueue* queue)
+{
+	if(mWaitedFenceValue == mFenceValue || IsComplete(mFenceValue))
+		return;
+
+	ThrowIfFailed(queue->Wait(mFence.Get(), mFenceValue));
+	mWaitedFenceValue = mFenceValue;
+}
+
+void UploadManager::ReleaseCompleted()
+{
+	UINT64 completed = mFence->GetCompletedValue();
+	while(!mInFlight.empty() && mInFlight.front().Fence <= completed)
+	{
+		mFreeAllocators.push_back(std::move(mInFlight.front().Allocator));
+		mInFlight.pop_front();
+	}
+	mStaging.ReleaseCompleted(completed);
+}
+
+void UploadManager::Flush()
+{
+	Submit();
+
+	if(mFence->GetCompletedValue() < mFenceValue)
+	{
+		ThrowIfFailed(mFence->SetEventOnCompletion(mFenceValue, mFenceEvent));
+		WaitForSingleObject(mFenceEvent, INFINITE);
+	}
+
+	ReleaseCompleted();
+}
+
+bool UploadManager::IsComplete(UINT64 fenceValue)const
+{
+	return mFence->GetCompletedValue() >= fenceValue;
+}
+
+UINT64 UploadManager::GetCompletedFenceValue()const
+{
+	return mFence->GetCompletedValue();
+}
+
+UINT64 UploadManager::GetPendingStagingBytes()const
+{
+	return mStaging.GetPendingBytes();
+}
+
+UINT UploadManager::GetPendingStagingCount()const
+{
+	return mStaging.GetPendingCount();
+}
+
+UINT UploadManager::GetBatchesInFlight()const
+{
+	return (UINT)mInFlight.size();
+}
+
+void UploadManager::OpenBatch()
+{
+	if(mBatchOpen)
+		return;
+
+	// Give finished batches their allocators back before creating a new one.
+	ReleaseCompleted();
+
+	if(!mFreeAllocators.empty())
+	{
+		mOpenBatch.Allocator = std::move(mFreeAllocators.back());
+		mFreeAllocators.pop_back();
+		ThrowIfFailed(mOpenBatch.Allocator->Reset());
+	}
+	else
+	{
+		ThrowIfFailed(mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY,
+			IID_PPV_ARGS(&mOpenBatch.Allocator)));
+	}
+
+	if(mCommandList == nullptr)
+	{
+		ThrowIfFailed(mDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY,
+			mOpenBatch.Allocator.Get(), nullptr, IID_PPV_ARGS(&mCommandList)));
+	}
+	else
+	{
+		ThrowIfFailed(mCommandList->Reset(mOpenBatch.Allocator.Get(), nullptr));
+	}
+
+	mBatchOpen = true;
+}
+
+void UploadManager::AddStaging(ComPtr<ID3D12Resource> staging, UINT64 byteSize)
+{
+	// Submit() signals the open batch with the next fence value.
+	mStaging.Release(std::move(staging), mFenceValue + 1, byteSize);
+	mOpenBatch.StagingBytes += byteSize;
+	Counters::Add(CounterUploadBytes, byteSize);
+
+	if(mOpenBatch.StagingBytes >= mBatchBudget)
+		Submit();
+}
@@ -0,0 +1,92 @@
+//***************************************************************************************
+// UploadManager.h
+//
+// Records buffer and texture uploads on a command list of its own and executes them on
+// a dedicated copy queue, so loading never touches the direct command list and the
+// CPU does not wait for it.  Uploads are grouped into batches; each submitted batch
+// signals the manager's fence, and its staging buffers (held in a DeferredReleaseQueue)
+// and allocator are released as soon as that fence value completes.
+//
+// Resources are left in the COMMON state.  Buffers and read-only texture states are
+// promoted implicitly on first use, so the direct queue only has to wait on the copy
+// fence (InsertWait) before it executes work that reads them.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "DeferredReleaseQueue.h"
+
+#include <deque>
+
+class UploadManager
+{
+public:
+	// A batch is submitted automatically once its staging memory reaches batchBudget,
+	// which bounds how much staging memory is alive while large assets load.
+	UploadManager(ID3D12Device* device, UINT64 batchBudget = 64 * 1024 * 1024);
+	UploadManager(const UploadManager& rhs) = delete;
+	UploadManager& operator=(const UploadManager& rhs) = delete;
+	~UploadManager();
+
+	// Creates a default heap buffer and schedules a copy of byteSize bytes of data into
+	// it.  data is copied to staging memory before the call returns.
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(const void* data, UINT64 byteSize);
+
+	// Creates a texture from a DDS file in memory and schedules the upload of all its
+	// subresources.  Returns the loader's error code on failure.
+	HRESULT CreateDDSTexture(const uint8_t* ddsData, size_t ddsDataSize,
+		Microsoft::WRL::ComPtr<ID3D12Resource>& texture);
+
+	// Executes the open batch, if any.  Returns the copy fence value that marks the
+	// completion of everything scheduled so far.
+	UINT64 Submit();
+
+	// Makes queue wait (on the GPU) for every batch submitted so far.  Does nothing if
+	// those batches are already complete or were already waited for; the manager
+	// assumes a single consuming queue.
+	void InsertWait(ID3D12CommandQueue* queue);
+
+	// Frees staging buffers and recycles allocators of the batches that have completed.
+	void ReleaseCompleted();
+
+	// Submits the open batch and blocks until the copy queue is idle.
+	void Flush();
+
+	bool IsComplete(UINT64 fenceValue)const;
+	UINT64 GetCompletedFenceValue()const;
+
+	// Bytes of staging memory scheduled or in flight.
+	UINT64 GetPendingStagingBytes()const;
+	UINT GetPendingStagingCount()const;
+	UINT GetBatchesInFlight()const;
+
+private:
+	struct Batch
+	{
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Allocator;
+		UINT64 StagingBytes = 0;
+		UINT64 Fence = 0;
+	};
+
+	void OpenBatch();
+	void AddStaging(Microsoft::WRL::ComPtr<ID3D12Resource> staging, UINT64 byteSize);
+
+	Microsoft::WRL::ComPtr<ID3D12Device> mDevice;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> mQueue;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> mCommandList;
+	Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
+	HANDLE mFenceEvent = nullptr;
+
+	UINT64 mFenceValue = 0;
+	UINT64 mWaitedFenceValue = 0;
+	UINT64 mBatchBudget = 0;
+
+	bool mBatchOpen = false;
+	Batch mOpenBatch;
+	std::deque<Batch> mInFlight;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> mFreeAllocators;
+
+	// Staging buffers are tagged with the fence value of the batch that reads them.
+	DeferredReleaseQueue mStaging;
+};
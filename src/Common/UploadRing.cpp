@@ -0,0 +1,69 @@
+//***************************************************************************************
+// UploadRing.cpp
+//***************************************************************************************
+
+#include "UploadRing.h"
+#include "Counters.h"
+
+UploadRing::UploadRing(ID3D12Device* device, UINT64 capacity) :
+	mAllocator(capacity)
+{
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(capacity),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&mBuffer)));
+
+	// Stays mapped for the lifetime of the ring.
+	ThrowIfFailed(mBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mMappedData)));
+}
+
+UploadRing::~UploadRing()
+{
+	if(mBuffer != nullptr)
+		mBuffer->Unmap(0, nullptr);
+
+	mMappedData = nullptr;
+}
+
+UploadRing::Allocation UploadRing::Allocate(UINT64 size, UINT64 alignment)
+{
+	UINT64 offset = mAllocator.Allocate(size, alignment);
+	if(offset == LinearRingAllocator::InvalidOffset)
+		ThrowIfFailed(E_OUTOFMEMORY);
+
+	// Whatever is allocated is written by the caller.
+	Counters::Add(CounterUploadBytes, size);
+
+	Allocation allocation;
+	allocation.CpuAddress = mMappedData + offset;
+	allocation.GpuAddress = mBuffer->GetGPUVirtualAddress() + offset;
+	return allocation;
+}
+
+void UploadRing::FinishFrame(UINT64 fenceValue)
+{
+	mAllocator.FinishFrame(fenceValue);
+}
+
+void UploadRing::ReleaseCompleted(UINT64 completedFenceValue)
+{
+	mAllocator.ReleaseCompleted(completedFenceValue);
+}
+
+ID3D12Resource* UploadRing::Resource()const
+{
+	return mBuffer.Get();
+}
+
+UINT64 UploadRing::GetCapacity()const
+{
+	return mAllocator.GetCapacity();
+}
+
+UINT64 UploadRing::GetUsedSize()const
+{
+	return mAllocator.GetUsedSize();
+}
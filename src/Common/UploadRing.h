@@ -0,0 +1,54 @@
+//***************************************************************************************
+// UploadRing.h
+//
+// One large persistently mapped upload buffer that per-frame dynamic data (pass and
+// material constants, transient vertex/instance data) is suballocated from.  Space is
+// handed out by a LinearRingAllocator and reclaimed by fence value, so the caller
+// must call FinishFrame() after signaling the frame's fence and ReleaseCompleted()
+// with the fence's completed value.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "LinearRingAllocator.h"
+
+class UploadRing
+{
+public:
+	// CpuAddress points into write-combined memory: fill it with StreamCopy (or
+	// memcpy) and never read from it.
+	struct Allocation
+	{
+		BYTE* CpuAddress = nullptr;
+		D3D12_GPU_VIRTUAL_ADDRESS GpuAddress = 0;
+	};
+
+	UploadRing(ID3D12Device* device, UINT64 capacity);
+	UploadRing(const UploadRing& rhs) = delete;
+	UploadRing& operator=(const UploadRing& rhs) = delete;
+	~UploadRing();
+
+	// Throws if the ring is full, i.e. if it is too small for the frames in flight.
+	Allocation Allocate(UINT64 size, UINT64 alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+	// count constant buffer elements, each padded to 256 bytes.
+	template<typename T>
+	Allocation AllocateConstants(UINT count)
+	{
+		return Allocate((UINT64)d3dUtil::CalcConstantBufferByteSize(sizeof(T)) * count);
+	}
+
+	void FinishFrame(UINT64 fenceValue);
+	void ReleaseCompleted(UINT64 completedFenceValue);
+
+	ID3D12Resource* Resource()const;
+	UINT64 GetCapacity()const;
+	UINT64 GetUsedSize()const;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Resource> mBuffer;
+	BYTE* mMappedData = nullptr;
+
+	LinearRingAllocator mAllocator;
+};
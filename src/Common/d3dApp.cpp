@@ -3,6 +3,9 @@
 //***************************************************************************************
 
 #include "d3dApp.h"
+#include "AllocationTracker.h"
+#include "Counters.h"
+#include "Profiler.h"
 #include <WindowsX.h>
 #include "imgui.h"
 #include "imgui_impl_dx12.h"
@@ -77,6 +80,11 @@ int D3DApp::Run()
 {
 	MSG msg = {0};
 	
+	PROFILE_THREAD_NAME("Main");
+
+	// Set while the timer is stopped for idling rather than by a pause.
+	bool idleStoppedTimer = false;
+
 	mTimer.Reset();
 	while(msg.message != WM_QUIT)
 	{
@@ -85,10 +93,40 @@ int D3DApp::Run()
 		{
             TranslateMessage( &msg );
             DispatchMessage( &msg );
+
+			if((msg.message >= WM_KEYFIRST && msg.message <= WM_KEYLAST) ||
+				(msg.message >= WM_MOUSEFIRST && msg.message <= WM_MOUSELAST))
+				mInputSinceLastFrame = true;
 		}
 		// Otherwise, do animation/game stuff.
 		else
         {	
+			if(CanIdle())
+			{
+				// The screen would not change, so wait for a message instead of drawing
+				// the same frame again.  No timeout: everything that can change the
+				// picture while idle arrives as a message (input, WM_SIZE, WM_PAINT,
+				// WM_ACTIVATE), and the app does not go idle while uploads are pending.
+				// MWMO_INPUTAVAILABLE also returns for messages already in the queue.
+				PROFILE_ZONE("Idle");
+				if(!mTimer.IsStopped())
+				{
+					mTimer.Stop();
+					idleStoppedTimer = true;
+				}
+				MsgWaitForMultipleObjectsEx(0, nullptr, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+				continue;
+			}
+			if(idleStoppedTimer)
+			{
+				mTimer.Start();
+				idleStoppedTimer = false;
+			}
+
+			{
+				PROFILE_ZONE("FrameLimiter");
+				mFrameLimiter.Wait();
+			}
 			mTimer.Tick();
 
 			if(true )
@@ -117,9 +155,14 @@ int D3DApp::Run()
 				{
 					 OnKeyPressed(mTimer, 'Q');
 				}
+				AllocationTracker::EndFrame();
+				Counters::EndFrame();
+				PROFILE_FRAME_MARK();
 				CalculateFrameStats();
 				Update(mTimer);	
                 Draw(mTimer);
+				mInputSinceLastFrame = false;
+				mRedrawRequested = false;
 				
 				
 			}
@@ -262,6 +305,9 @@ void D3DApp::OnResize()
 	mScreenViewport.MaxDepth = 1.0f;
 
     mScissorRect = { 0, 0, mClientWidth, mClientHeight };
+
+	// The new back buffers hold nothing yet.
+	mRedrawRequested = true;
 }
  
 LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -284,6 +330,7 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 			mAppPaused = false;
 			mTimer.Start();
 		}
+		mRedrawRequested = true;
 		return 0;
 
 	// WM_SIZE is sent when the user resizes the window.  
@@ -343,6 +390,12 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		}
 		return 0;
 
+	// WM_PAINT is sent when part of the window was uncovered or invalidated.  The
+	// next frame redraws all of it; DefWindowProc validates the region.
+	case WM_PAINT:
+		mRedrawRequested = true;
+		break;
+
 	// WM_EXITSIZEMOVE is sent when the user grabs the resize bars.
 	case WM_ENTERSIZEMOVE:
 		mAppPaused = true;
@@ -640,15 +693,13 @@ void D3DApp::CalculateFrameStats()
 		float fps = (float)frameCnt; // fps = frameCnt / 1
 		float mspf = 1000.0f / fps;
 
-        wstring fpsStr = to_wstring(fps);
-        wstring mspfStr = to_wstring(mspf);
-
-		wstring windowText = mMainWndCaption +
-			L"    fps: " + fpsStr +
-			L"   mspf: " + mspfStr +
-			L"  speed: " + GetCamSpeed();
+		// Formatted into a fixed buffer: the caption changes several times a second
+		// and must not allocate.
+		wchar_t windowText[256];
+		swprintf_s(windowText, L"%ls    fps: %f   mspf: %f  speed: %f",
+			mMainWndCaption.c_str(), fps, mspf, GetCamSpeed());
 
-        SetWindowText(mhMainWnd, windowText.c_str());
+        SetWindowText(mhMainWnd, windowText);
 		
 		// Reset for next average.
 		frameCnt = 0;
@@ -10,7 +10,9 @@
 #endif
 
 #include "d3dUtil.h"
+#include "FrameLimiter.h"
 #include "GameTimer.h"
+#include "JobSystem.h"
 
 // Link necessary d3d12 libraries.
 #pragma comment(lib,"d3dcompiler.lib")
@@ -57,7 +59,12 @@ protected:
 	virtual void MoveUpDown(float step) {};
 	virtual void OnKeyPressed(const GameTimer& gt, WPARAM key) {};
 	virtual void OnKeyReleased(const GameTimer& gt, WPARAM key) {};
-	virtual std::wstring GetCamSpeed() { return L""; };
+	virtual float GetCamSpeed() { return 0.0f; };
+
+	// Return true when the next frame would look exactly like the last one.  Run() then
+	// waits for a message instead of updating and drawing, with the timer stopped.
+	// Must return false while mRedrawRequested is set.
+	virtual bool CanIdle() { return false; };
 
 protected:
 
@@ -85,6 +92,13 @@ protected:
     HINSTANCE mhAppInst = nullptr; // application instance handle
     HWND      mhMainWnd = nullptr; // main window handle
 	bool      mAppPaused = false;  // is the application paused?
+
+	// Set when a keyboard or mouse message was dispatched since the last frame was drawn.
+	bool      mInputSinceLastFrame = false;
+
+	// Set when the window needs a new frame without any input: a resize or restore
+	// (OnResize), WM_PAINT or WM_ACTIVATE.  Cleared once a frame was drawn.
+	bool      mRedrawRequested = false;
 	bool      mMinimized = false;  // is the application minimized?
 	bool      mMaximized = false;  // is the application maximized?
 	bool      mResizing = false;   // are the resize bars being dragged?
@@ -94,8 +108,14 @@ protected:
     bool      m4xMsaaState = false;    // 4X MSAA enabled
     UINT      m4xMsaaQuality = 0;      // quality level of 4X MSAA
 
+	// Worker threads shared by every subsystem of the app.
+	JobSystem mJobSystem;
+
 	// Used to keep track of the delta-time and game time (4.4).
 	GameTimer mTimer;
+
+	// Caps the frame rate on top of vsync; off by default.
+	FrameLimiter mFrameLimiter;
 	
     Microsoft::WRL::ComPtr<IDXGIFactory4> mdxgiFactory;
     Microsoft::WRL::ComPtr<IDXGISwapChain> mSwapChain;
@@ -1,5 +1,6 @@
 
 #include "d3dUtil.h"
+#include "ShaderCache.h"
 #include <comdef.h>
 #include <fstream>
 
@@ -87,16 +88,22 @@ Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(
     return defaultBuffer;
 }
 
+static UINT ShaderCompileFlags()
+{
+	UINT compileFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)  
+	compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+	return compileFlags;
+}
+
 ComPtr<ID3DBlob> d3dUtil::CompileShader(
 	const std::wstring& filename,
 	const D3D_SHADER_MACRO* defines,
 	const std::string& entrypoint,
 	const std::string& target)
 {
-	UINT compileFlags = 0;
-#if defined(DEBUG) || defined(_DEBUG)  
-	compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
+	UINT compileFlags = ShaderCompileFlags();
 
 	HRESULT hr = S_OK;
 
@@ -113,6 +120,42 @@ ComPtr<ID3DBlob> d3dUtil::CompileShader(
 	return byteCode;
 }
 
+ComPtr<ID3DBlob> d3dUtil::CompileShaderCached(
+	const std::wstring& filename,
+	const D3D_SHADER_MACRO* defines,
+	const std::string& entrypoint,
+	const std::string& target,
+	const std::wstring& cacheDirectory)
+{
+	// If the source cannot be read let the compiler report the error.
+	std::string source;
+	if(!ShaderCache::ExpandIncludes(filename, source))
+		return CompileShader(filename, defines, entrypoint, target);
+
+	std::vector<ShaderDefine> defineList;
+	for(const D3D_SHADER_MACRO* d = defines; d != nullptr && d->Name != nullptr; ++d)
+		defineList.push_back({ d->Name, d->Definition != nullptr ? d->Definition : "" });
+
+	std::uint64_t key = ShaderCache::MakeKey(source, entrypoint, target, defineList, ShaderCompileFlags());
+
+	ShaderCache cache(cacheDirectory);
+	std::vector<char> cached;
+	if(cache.Load(key, cached))
+	{
+		ComPtr<ID3DBlob> blob;
+		ThrowIfFailed(D3DCreateBlob(cached.size(), blob.GetAddressOf()));
+		memcpy(blob->GetBufferPointer(), cached.data(), cached.size());
+		return blob;
+	}
+
+	ComPtr<ID3DBlob> byteCode = CompileShader(filename, defines, entrypoint, target);
+
+	// A failed write only costs a recompile next time.
+	cache.Store(key, byteCode->GetBufferPointer(), byteCode->GetBufferSize());
+
+	return byteCode;
+}
+
 std::wstring DxException::ToString()const
 {
     // Get the string description of the error code.
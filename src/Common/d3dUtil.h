@@ -127,6 +127,15 @@ public:
 		const D3D_SHADER_MACRO* defines,
 		const std::string& entrypoint,
 		const std::string& target);
+
+	// Same as CompileShader, but blobs are kept in cacheDirectory (see ShaderCache.h)
+	// and only recompiled when the source, an include, the defines or the flags change.
+	static Microsoft::WRL::ComPtr<ID3DBlob> CompileShaderCached(
+		const std::wstring& filename,
+		const D3D_SHADER_MACRO* defines,
+		const std::string& entrypoint,
+		const std::string& target,
+		const std::wstring& cacheDirectory = L"ShaderCache");
 };
 
 class DxException
@@ -171,9 +180,6 @@ struct MeshGeometry
 	Microsoft::WRL::ComPtr<ID3D12Resource> VertexBufferGPU = nullptr;
 	Microsoft::WRL::ComPtr<ID3D12Resource> IndexBufferGPU = nullptr;
 
-	Microsoft::WRL::ComPtr<ID3D12Resource> VertexBufferUploader = nullptr;
-	Microsoft::WRL::ComPtr<ID3D12Resource> IndexBufferUploader = nullptr;
-
     // Data about the buffers.
 	UINT VertexByteStride = 0;
 	UINT VertexBufferByteSize = 0;
@@ -206,11 +212,43 @@ struct MeshGeometry
 		return ibv;
 	}
 
-	// We can free this memory after we finish upload to the GPU.
-	void DisposeUploaders()
+	// Bytes of system memory held by the CPU copies and the per submesh MeshData.
+	UINT64 CpuByteSize()const
 	{
-		VertexBufferUploader = nullptr;
-		IndexBufferUploader = nullptr;
+		UINT64 size = 0;
+		if(VertexBufferCPU != nullptr)
+			size += VertexBufferCPU->GetBufferSize();
+		if(IndexBufferCPU != nullptr)
+			size += IndexBufferCPU->GetBufferSize();
+
+		for(const auto& kv : MultiDrawArgs)
+		{
+			for(const auto& submesh : kv.second)
+			{
+				size += submesh.first.Vertices.capacity() * sizeof(GeometryGenerator::Vertex);
+				size += submesh.first.Indices32.capacity() * sizeof(GeometryGenerator::uint32);
+			}
+		}
+		return size;
+	}
+
+	// Frees the system memory copies once the GPU buffers are all that is drawn from.
+	// Submesh ranges, bounds and material names are kept.
+	void DisposeCpuCopies()
+	{
+		VertexBufferCPU = nullptr;
+		IndexBufferCPU = nullptr;
+
+		for(auto& kv : MultiDrawArgs)
+		{
+			for(auto& submesh : kv.second)
+			{
+				GeometryGenerator::MeshData stripped;
+				stripped.matName = std::move(submesh.first.matName);
+				stripped.texfile = std::move(submesh.first.texfile);
+				submesh.first = std::move(stripped);
+			}
+		}
 	}
 };
 
@@ -251,6 +289,10 @@ struct Material
 
 	// Index into SRV heap for normal texture.
 	int NormalSrvHeapIndex = -1;
+
+	// False if the material has no normal map of its own.  NormalSrvHeapIndex then
+	// still names a valid descriptor, so the normal map table can always be bound.
+	bool HasNormalMap = false;
 	
     int DispSrvHeapIndex = -1;
 
@@ -275,7 +317,6 @@ struct Texture
 	std::wstring Filename;
 
 	Microsoft::WRL::ComPtr<ID3D12Resource> Resource = nullptr;
-	Microsoft::WRL::ComPtr<ID3D12Resource> UploadHeap = nullptr;
 };
 
 #ifndef ThrowIfFailed
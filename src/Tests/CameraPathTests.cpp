@@ -0,0 +1,255 @@
+//***************************************************************************************
+// CameraPathTests.cpp
+//
+// CameraPath and CameraPathPlayback without a window: spline evaluation at and
+// between keyframes, the text format round trip and its errors, and playback that
+// must produce the same poses at the same frame numbers on every run.
+//***************************************************************************************
+
+#include "CameraPath.h"
+#include "TestUtil.h"
+
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const std::filesystem::path gScratch = "CameraPathTests.tmp";
+
+	CameraPose MakePose(float px, float py, float pz, float lx, float ly, float lz)
+	{
+		CameraPose pose;
+		pose.Position[0] = px;
+		pose.Position[1] = py;
+		pose.Position[2] = pz;
+		pose.Look[0] = lx;
+		pose.Look[1] = ly;
+		pose.Look[2] = lz;
+		return pose;
+	}
+
+	bool Near(const CameraPose& a, const CameraPose& b, float tolerance = 1e-4f)
+	{
+		for(int c = 0; c < 3; ++c)
+		{
+			if(!(std::fabs(a.Position[c] - b.Position[c]) <= tolerance) || !(std::fabs(a.Look[c] - b.Look[c]) <= tolerance))
+				return false;
+		}
+		return true;
+	}
+
+	bool Same(const CameraPose& a, const CameraPose& b)
+	{
+		for(int c = 0; c < 3; ++c)
+		{
+			if(a.Position[c] != b.Position[c] || a.Look[c] != b.Look[c])
+				return false;
+		}
+		return true;
+	}
+
+	// Four keys, unevenly spaced, that go around a corner.
+	CameraPath MakeCornerPath()
+	{
+		CameraPath path;
+		path.AddKeyframe(1.0, MakePose(0.0f, 5.0f, -20.0f, 0.0f, 0.0f, 1.0f));
+		path.AddKeyframe(2.0, MakePose(10.0f, 5.0f, -20.0f, 1.0f, 0.0f, 0.0f));
+		path.AddKeyframe(4.5, MakePose(10.0f, 8.0f, 0.0f, 0.0f, -0.5f, 1.0f));
+		path.AddKeyframe(5.0, MakePose(0.0f, 8.0f, 5.0f, -1.0f, 0.0f, 0.0f));
+		return path;
+	}
+
+	void WriteFile(const std::filesystem::path& file, const std::string& text)
+	{
+		std::ofstream fout(file, std::ios::trunc);
+		fout << text;
+	}
+
+	void TestKeyframes()
+	{
+		CameraPath path;
+		CHECK(path.IsEmpty());
+		CHECK(path.GetDuration() == 0.0);
+
+		CHECK(path.AddKeyframe(1.0, MakePose(0, 0, 0, 0, 0, 1)));
+		CHECK(!path.AddKeyframe(1.0, MakePose(1, 0, 0, 0, 0, 1)));
+		CHECK(!path.AddKeyframe(0.5, MakePose(1, 0, 0, 0, 0, 1)));
+		CHECK(!path.AddKeyframe(std::nan(""), MakePose(1, 0, 0, 0, 0, 1)));
+		CHECK(path.AddKeyframe(3.0, MakePose(1, 0, 0, 0, 0, 1)));
+		CHECK(path.GetKeyframes().size() == 2);
+		CHECK(path.GetDuration() == 2.0);
+
+		path.Clear();
+		CHECK(path.IsEmpty());
+	}
+
+	void TestEvaluate()
+	{
+		CameraPath path = MakeCornerPath();
+		const auto& keys = path.GetKeyframes();
+
+		// Passes through every key and holds the end poses outside the path.
+		for(const auto& key : keys)
+			CHECK(Near(path.Evaluate(key.Time), key.Pose));
+		CHECK(Same(path.Evaluate(-100.0), keys.front().Pose));
+		CHECK(Same(path.Evaluate(100.0), keys.back().Pose));
+
+		// No jumps: steps of 1 ms move the camera by no more than a few mm.
+		float maxStep = 0.0f;
+		CameraPose previous = path.Evaluate(keys.front().Time);
+		for(double t = keys.front().Time; t <= keys.back().Time; t += 0.001)
+		{
+			CameraPose pose = path.Evaluate(t);
+			for(int c = 0; c < 3; ++c)
+				maxStep = std::fmax(maxStep, std::fabs(pose.Position[c] - previous.Position[c]));
+			previous = pose;
+		}
+		CHECK(maxStep < 0.05f);
+
+		// Catmull-Rom tangents scaled by key spacing reproduce straight uniform motion
+		// exactly, however unevenly the keys are placed.
+		CameraPath line;
+		const double times[] = { 0.0, 0.2, 1.5, 1.6, 4.0 };
+		for(double t : times)
+			line.AddKeyframe(t, MakePose((float)(3.0 * t), (float)(-t), 2.0f, 0.0f, 0.0f, 1.0f));
+		bool linear = true;
+		for(double t = 0.0; t <= 4.0; t += 0.01)
+			linear = linear && Near(line.Evaluate(t), MakePose((float)(3.0 * t), (float)(-t), 2.0f, 0.0f, 0.0f, 1.0f));
+		CHECK(linear);
+
+		// A single key is a fixed camera.
+		CameraPath single;
+		single.AddKeyframe(2.0, MakePose(1, 2, 3, 0, 1, 0));
+		CHECK(Same(single.Evaluate(0.0), single.GetKeyframes()[0].Pose));
+		CHECK(Same(single.Evaluate(5.0), single.GetKeyframes()[0].Pose));
+	}
+
+	void TestSaveLoad()
+	{
+		std::filesystem::remove_all(gScratch);
+
+		CameraPath path = MakeCornerPath();
+		CHECK(path.Save(gScratch / "sub" / "path.txt"));
+
+		CameraPath loaded;
+		std::string error;
+		CHECK(loaded.Load(gScratch / "sub" / "path.txt", error));
+		CHECK(loaded.GetKeyframes().size() == path.GetKeyframes().size());
+		bool same = loaded.GetKeyframes().size() == path.GetKeyframes().size();
+		for(std::size_t i = 0; same && i < path.GetKeyframes().size(); ++i)
+			same = loaded.GetKeyframes()[i].Time == path.GetKeyframes()[i].Time && Same(loaded.GetKeyframes()[i].Pose, path.GetKeyframes()[i].Pose);
+		CHECK(same);
+
+		// Comments, blank lines and CRLF line ends are accepted.
+		WriteFile(gScratch / "comments.txt", "# recorded path\r\n\r\n  0 1 2 3 0 0 1\r\n\t# half way\n1 2 2 3 0 0 1\n");
+		CHECK(loaded.Load(gScratch / "comments.txt", error));
+		CHECK(loaded.GetKeyframes().size() == 2);
+		CHECK(loaded.GetDuration() == 1.0);
+
+		// A file that fails leaves the loaded path alone and says where it went wrong.
+		struct BadFile
+		{
+			const char* Text;
+			const char* Error;
+		};
+		const BadFile badFiles[] = {
+			{ "0 0 0 0 0 0 1\n1 0 0 0 0 0\n", "line 2:" },
+			{ "0 0 0 0 0 0 1\nx 0 0 0 0 0 1\n", "line 2:" },
+			{ "# a\n1 0 0 0 0 0 1\n1 1 0 0 0 0 1\n", "line 3:" },
+			{ "# nothing but a comment\n", "no keyframes" },
+		};
+		for(const BadFile& bad : badFiles)
+		{
+			WriteFile(gScratch / "bad.txt", bad.Text);
+			error.clear();
+			CHECK(!loaded.Load(gScratch / "bad.txt", error));
+			CHECK(error.find(bad.Error) != std::string::npos);
+			CHECK(loaded.GetKeyframes().size() == 2);
+		}
+
+		error.clear();
+		CHECK(!loaded.Load(gScratch / "missing.txt", error));
+		CHECK(!error.empty());
+		CHECK(loaded.GetKeyframes().size() == 2);
+
+		std::filesystem::remove_all(gScratch);
+	}
+
+	void TestPlayback()
+	{
+		// Duration 4 s, played at 0.5 s per frame after 3 warm-up frames.
+		CameraPath path = MakeCornerPath();
+		const std::uint32_t warmup = 3;
+		const std::uint32_t frames = 12;
+		CameraPathPlayback playback(path, 0.5, warmup, frames);
+		CHECK(playback.GetTotalFrames() == warmup + frames);
+		CHECK(playback.GetFrame() == 0);
+
+		std::vector<CameraPose> poses;
+		std::vector<double> times;
+		CameraPose pose;
+		bool warmupOk = true;
+		bool measuringOk = true;
+		while(playback.Next(pose))
+		{
+			std::uint32_t frame = playback.GetFrame() - 1;
+			if(frame < warmup)
+				warmupOk = warmupOk && !playback.IsMeasuring() && playback.GetTime() == 0.0 && Same(pose, path.GetKeyframes().front().Pose);
+			else
+				measuringOk = measuringOk && playback.IsMeasuring();
+			poses.push_back(pose);
+			times.push_back(playback.GetTime());
+		}
+		CHECK(warmupOk);
+		CHECK(measuringOk);
+		CHECK(poses.size() == warmup + frames);
+		CHECK(playback.GetFrame() == warmup + frames);
+		CHECK(!playback.Next(pose));
+
+		// Frame times are k * step, and wrap once the path has been played through.
+		const double expected[] = { 0.0, 0.5, 1.0, 1.5, 2.0, 2.5, 3.0, 3.5, 4.0, 0.5, 1.0, 1.5 };
+		bool timesOk = true;
+		for(std::uint32_t i = 0; i < frames; ++i)
+		{
+			timesOk = timesOk && std::fabs(times[warmup + i] - expected[i]) < 1e-9;
+			timesOk = timesOk && Same(poses[warmup + i], path.Evaluate(path.GetKeyframes().front().Time + expected[i]));
+		}
+		CHECK(timesOk);
+
+		// A second run, e.g. the next benchmark session, sees exactly the same views.
+		CameraPathPlayback again(path, 0.5, warmup, frames);
+		bool repeatable = true;
+		for(std::size_t i = 0; again.Next(pose); ++i)
+			repeatable = repeatable && i < poses.size() && Same(pose, poses[i]);
+		CHECK(repeatable);
+
+		// A long run at a typical 60 Hz step does not drift: frame n is at n / 60 s
+		// whatever n is, because time is not accumulated.
+		CameraPath longPath;
+		longPath.AddKeyframe(0.0, MakePose(0, 0, 0, 0, 0, 1));
+		longPath.AddKeyframe(1000.0, MakePose(1000, 0, 0, 0, 0, 1));
+		CameraPathPlayback sixty(std::move(longPath), 1.0 / 60.0, 0, 50000);
+		double lastTime = 0.0;
+		while(sixty.Next(pose))
+			lastTime = sixty.GetTime();
+		CHECK(std::fabs(lastTime - 49999.0 / 60.0) < 1e-9);
+
+		// Without frames there is nothing to play.
+		CameraPathPlayback empty(path, 0.5, 0, 0);
+		CHECK(!empty.Next(pose));
+		CHECK(!empty.IsMeasuring());
+	}
+}
+
+int main()
+{
+	TestKeyframes();
+	TestEvaluate();
+	TestSaveLoad();
+	TestPlayback();
+	return TestResult();
+}
@@ -0,0 +1,142 @@
+//***************************************************************************************
+// FrameArenaBench.cpp
+//
+// Per-frame scratch vectors in a FrameArena against the std::vector alternatives,
+// shaped like an ObjectCBChunk: a handful of vectors, all alive at once, filled with
+// push_back from source data and dropped together.  The data pointers are published
+// to a volatile so the compiler cannot elide the allocations and stores of vectors
+// that are never read.
+//   -std::vector: a new vector every frame, so every frame allocates and frees.
+//   -reused std::vector: cleared and refilled, as the thread_local scratch arrays
+//    ObjectCBChunk used before; no heap traffic once capacity has been reached.
+//   -ArenaVector: allocated from the frame's arena, reset by BeginFrame.
+// Each row is measured with and without reserve(), and also reports heap
+// allocations per frame of the calling thread.
+//
+// Usage: FrameArenaBench [repeats]
+//***************************************************************************************
+
+#include "AllocationTracker.h"
+#include "FrameArena.h"
+#include "TestUtil.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	const std::uint32_t gVectorsPerFrame = 7;
+	const std::uint32_t gFrameCount = 3;
+
+	// The size of an XMFLOAT4X4.
+	struct Element
+	{
+		float M[16];
+	};
+
+	struct Result
+	{
+		double NsPerFrame = 0.0;
+		double AllocationsPerFrame = 0.0;
+	};
+
+	void* volatile gEscape = nullptr;
+
+	template<typename Vector>
+	void Fill(Vector& v, const Element* source, std::uint32_t count, bool reserve)
+	{
+		if(reserve)
+			v.reserve(count);
+		for(std::uint32_t i = 0; i < count; ++i)
+			v.push_back(source[i]);
+		gEscape = v.data();
+	}
+
+	// Median nanoseconds per frame of frame(f), run for f = 0, 1, 2, ...
+	template<typename FrameFunc>
+	Result Measure(FrameFunc frame, std::uint32_t count, std::uint32_t repeats)
+	{
+		const std::uint32_t frames = count >= 16384 ? 50 : 2000;
+		for(std::uint32_t f = 0; f < 10; ++f)
+			frame(f);
+
+		std::vector<double> samples;
+		Result result;
+		for(std::uint32_t r = 0; r < repeats; ++r)
+		{
+			AllocationCounts before = AllocationTracker::GetThreadCounts();
+			double start = TestUtil::NowSeconds();
+			for(std::uint32_t f = 0; f < frames; ++f)
+				frame(f);
+			double elapsed = TestUtil::NowSeconds() - start;
+			AllocationCounts after = AllocationTracker::GetThreadCounts();
+
+			samples.push_back(elapsed * 1e9 / frames);
+			result.AllocationsPerFrame = (double)(after.Allocations - before.Allocations) / frames;
+		}
+		result.NsPerFrame = TestUtil::Median(samples);
+		return result;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::uint32_t repeats = argc > 1 ? (std::uint32_t)std::strtoul(argv[1], nullptr, 10) : 9;
+	if(repeats == 0)
+		repeats = 1;
+
+	std::printf("%u vectors of %zu-byte elements per frame, median of %u\n\n", gVectorsPerFrame, sizeof(Element), repeats);
+	std::printf("%8s %-8s %12s %12s %12s %12s %12s %12s\n", "count", "reserve",
+		"vector ns", "allocs", "reused ns", "allocs", "arena ns", "allocs");
+
+	const std::uint32_t counts[] = { 16, 256, 4096, 65536 };
+	std::vector<Element> source(counts[3]);
+	for(std::size_t i = 0; i < source.size(); ++i)
+	{
+		for(int j = 0; j < 16; ++j)
+			source[i].M[j] = (float)(i + j);
+	}
+
+	for(std::uint32_t count : counts)
+	{
+		for(bool reserve : { false, true })
+		{
+			Result fresh = Measure([&](std::uint32_t)
+			{
+				std::vector<Element> vectors[gVectorsPerFrame];
+				for(auto& vector : vectors)
+					Fill(vector, source.data(), count, reserve);
+			}, count, repeats);
+
+			std::vector<Element> scratch[gVectorsPerFrame];
+			Result reused = Measure([&](std::uint32_t)
+			{
+				for(auto& vector : scratch)
+				{
+					vector.clear();
+					Fill(vector, source.data(), count, reserve);
+				}
+			}, count, repeats);
+
+			FrameArena arena(gFrameCount, 64 * 1024);
+			Result arenaResult = Measure([&](std::uint32_t f)
+			{
+				arena.BeginFrame(f % gFrameCount);
+				ArenaVector<ArenaVector<Element>> vectors{ arena.Allocator<ArenaVector<Element>>() };
+				vectors.reserve(gVectorsPerFrame);
+				for(std::uint32_t v = 0; v < gVectorsPerFrame; ++v)
+				{
+					vectors.emplace_back(arena.Allocator<Element>());
+					Fill(vectors.back(), source.data(), count, reserve);
+				}
+			}, count, repeats);
+
+			std::printf("%8u %-8s %12.0f %12.1f %12.0f %12.1f %12.0f %12.1f\n", count, reserve ? "yes" : "no",
+				fresh.NsPerFrame, fresh.AllocationsPerFrame,
+				reused.NsPerFrame, reused.AllocationsPerFrame,
+				arenaResult.NsPerFrame, arenaResult.AllocationsPerFrame);
+		}
+	}
+	return 0;
+}
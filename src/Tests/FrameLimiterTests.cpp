@@ -0,0 +1,169 @@
+//***************************************************************************************
+// FrameLimiterTests.cpp
+//
+// FrameLimiter against the real clock: frame intervals, lateness and long-run drift
+// at 60 and 240 Hz with some simulated work per frame, the restart after a frame
+// that ran long, and the CPU time spent waiting.  CPU time is read from
+// CLOCK_THREAD_CPUTIME_ID, so that part only runs on Linux.
+//
+// Limits are loose enough for a loaded CI machine: the point is to catch a limiter
+// that sleeps through its deadline, drifts, or spins for the whole frame.
+//***************************************************************************************
+
+#include "FrameLimiter.h"
+#include "TestUtil.h"
+
+#include <cstdint>
+#include <vector>
+
+#if defined(__linux__)
+#include <time.h>
+#endif
+
+namespace
+{
+	// Nanoseconds of CPU time used by the calling thread, or -1 where not measured.
+	std::int64_t ThreadCpuNs()
+	{
+#if defined(__linux__)
+		timespec ts;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+		return (std::int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+		return -1;
+#endif
+	}
+
+	void BusyFor(std::int64_t ns)
+	{
+		std::int64_t end = FrameLimiter::Now() + ns;
+		while(FrameLimiter::Now() < end)
+		{
+		}
+	}
+
+	void TestRate(double hz, std::uint32_t frames, std::int64_t workNs)
+	{
+		const std::int64_t targetNs = (std::int64_t)(1e9 / hz);
+		FrameLimiter limiter;
+		limiter.SetTargetFrameTime(1.0 / hz);
+
+		// The first Wait() only starts the schedule.
+		limiter.Wait();
+		CHECK(limiter.GetLastWaitNs() == 0);
+
+		std::vector<double> intervals;
+		std::vector<double> lateness;
+		std::int64_t waitNs = 0;
+		std::int64_t spinNs = 0;
+		std::int64_t waitCpuNs = 0;
+		std::int64_t first = FrameLimiter::Now();
+		std::int64_t previous = first;
+		for(std::uint32_t i = 0; i < frames; ++i)
+		{
+			BusyFor(workNs);
+
+			std::int64_t cpuBefore = ThreadCpuNs();
+			limiter.Wait();
+			std::int64_t cpuAfter = ThreadCpuNs();
+
+			std::int64_t now = FrameLimiter::Now();
+			intervals.push_back((double)(now - previous));
+			lateness.push_back((double)limiter.GetLastLatenessNs());
+			waitNs += limiter.GetLastWaitNs();
+			spinNs += limiter.GetLastSpinNs();
+			waitCpuNs += cpuAfter - cpuBefore;
+			previous = now;
+		}
+		std::int64_t elapsed = previous - first;
+
+		double medianInterval = TestUtil::Median(intervals);
+		double p95Interval = TestUtil::Percentile(intervals, 0.95);
+		double medianLateness = TestUtil::Median(lateness);
+		double p95Lateness = TestUtil::Percentile(lateness, 0.95);
+		double spinShare = waitNs > 0 ? (double)spinNs / waitNs : 1.0;
+		double cpuShare = waitNs > 0 && waitCpuNs >= 0 ? (double)waitCpuNs / waitNs : 0.0;
+		std::printf("%.0f Hz: interval median %.3f ms p95 %.3f ms, lateness median %.1f us p95 %.1f us, "
+			"spin %.1f%% of waiting, CPU %.1f%% of waiting, sleep estimate %.3f ms\n",
+			hz, medianInterval / 1e6, p95Interval / 1e6, medianLateness / 1e3, p95Lateness / 1e3,
+			spinShare * 100.0, cpuShare * 100.0, limiter.GetSleepEstimateNs() / 1e6);
+
+		// Every frame ends close to its deadline.
+		CHECK(medianInterval > targetNs - 200000 && medianInterval < targetNs + 200000);
+		CHECK(p95Interval < targetNs + 2000000);
+		CHECK(medianLateness >= 0.0 && medianLateness < 100000);
+		CHECK(p95Lateness < 1000000);
+
+		// Deadlines advance by exactly the target, so the whole run is not longer than
+		// frames * target by more than the lateness of its last frame, however late
+		// that one was scheduled.
+		CHECK(elapsed > (std::int64_t)frames * targetNs - targetNs);
+		CHECK(elapsed < (std::int64_t)frames * targetNs + (std::int64_t)lateness.back() + 2000000);
+
+		// The rest of the wait is slept: spinning covers at most about one sleep
+		// estimate per frame, whatever the frame rate, and so does the CPU time.
+		std::int64_t estimateNs = limiter.GetSleepEstimateNs();
+		CHECK(estimateNs >= 1000000 && estimateNs < targetNs);
+		CHECK(spinNs / frames < estimateNs + 1000000);
+#if defined(__linux__)
+		CHECK(waitCpuNs / frames < estimateNs + 1000000);
+#endif
+	}
+
+	void TestLongFrame()
+	{
+		const std::int64_t targetNs = 10000000;
+		FrameLimiter limiter;
+		limiter.SetTargetFrameTime(0.010);
+		limiter.Wait();
+		for(int i = 0; i < 5; ++i)
+			limiter.Wait();
+
+		// A frame that runs long by more than a whole frame restarts the schedule
+		// rather than being made up by a burst of short frames.
+		BusyFor(targetNs * 3);
+		limiter.Wait();
+		CHECK(limiter.GetLastWaitNs() == 0);
+
+		std::int64_t start = FrameLimiter::Now();
+		limiter.Wait();
+		std::int64_t waited = FrameLimiter::Now() - start;
+		CHECK(waited > targetNs - 1000000);
+
+		// A frame that is late by less than a frame is caught up: the next deadline
+		// stays on the old schedule, so the following wait is short.
+		BusyFor(targetNs + targetNs / 2);
+		limiter.Wait();
+		CHECK(limiter.GetLastWaitNs() == 0);
+		start = FrameLimiter::Now();
+		limiter.Wait();
+		waited = FrameLimiter::Now() - start;
+		CHECK(waited < targetNs);
+	}
+
+	void TestOff()
+	{
+		FrameLimiter limiter;
+		CHECK(limiter.GetTargetFrameTime() == 0.0);
+
+		std::int64_t start = FrameLimiter::Now();
+		for(int i = 0; i < 1000; ++i)
+			limiter.Wait();
+		CHECK(FrameLimiter::Now() - start < 10000000);
+		CHECK(limiter.GetLastWaitNs() == 0);
+
+		limiter.SetTargetFrameTime(0.5);
+		CHECK(limiter.GetTargetFrameTime() == 0.5);
+		limiter.SetTargetFrameTime(-1.0);
+		CHECK(limiter.GetTargetFrameTime() == 0.0);
+	}
+}
+
+int main()
+{
+	TestOff();
+	TestRate(60.0, 120, 3000000);
+	TestRate(240.0, 240, 1000000);
+	TestLongFrame();
+	return TestResult();
+}
@@ -0,0 +1,310 @@
+//***************************************************************************************
+// FrameStatsTests.cpp
+//
+// FrameStats on made-up frame times: nearest-rank percentiles on tiny and full
+// windows, the histogram following samples in and out of the window, clamping into
+// the last bucket, the stutter log cap, self times of nested and sibling zones, the
+// CSV layout, and a steady state of AddFrame and ComputeStageTimes without heap
+// allocations.
+//***************************************************************************************
+
+#include "AllocationTracker.h"
+#include "FrameStats.h"
+#include "TestUtil.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const std::filesystem::path gScratch = "FrameStatsTests.tmp";
+	const std::vector<FrameStageTime> gNoStages;
+
+	bool Near(double a, double b)
+	{
+		return std::fabs(a - b) < 1e-9;
+	}
+
+	std::uint32_t HistogramTotal(const FrameStats& stats)
+	{
+		const auto& histogram = stats.GetHistogram();
+		return std::accumulate(histogram.begin(), histogram.end(), 0u);
+	}
+
+	std::size_t ColumnCount(const std::string& line)
+	{
+		return (std::size_t)std::count(line.begin(), line.end(), ',') + 1;
+	}
+
+	void TestPercentiles()
+	{
+		FrameStats empty;
+		CHECK(empty.ComputeSummary().FrameCount == 0);
+		CHECK(empty.ComputeSummary().MaxMs == 0.0);
+
+		// With one sample every percentile is that sample.
+		FrameStats one;
+		one.AddFrame(5.0, gNoStages);
+		FrameStatsSummary s = one.ComputeSummary();
+		CHECK(s.FrameCount == 1);
+		CHECK(s.AverageMs == 5.0 && s.P50Ms == 5.0 && s.P95Ms == 5.0 && s.P99Ms == 5.0 && s.MaxMs == 5.0);
+
+		// Nearest rank of two: p50 is rank 1, p95 and p99 round up to rank 2.
+		FrameStats two;
+		two.AddFrame(20.0, gNoStages);
+		two.AddFrame(10.0, gNoStages);
+		s = two.ComputeSummary();
+		CHECK(s.P50Ms == 10.0);
+		CHECK(s.P95Ms == 20.0);
+		CHECK(s.P99Ms == 20.0);
+		CHECK(s.MaxMs == 20.0);
+		CHECK(Near(s.AverageMs, 15.0));
+
+		// 1..100 ms in scrambled order: rank p is p ms.
+		FrameStats hundred;
+		for(std::uint32_t i = 0; i < 100; ++i)
+			hundred.AddFrame((double)((i * 37) % 100 + 1), gNoStages);
+		s = hundred.ComputeSummary();
+		CHECK(s.FrameCount == 100);
+		CHECK(s.P50Ms == 50.0);
+		CHECK(s.P95Ms == 95.0);
+		CHECK(s.P99Ms == 99.0);
+		CHECK(s.MaxMs == 100.0);
+		CHECK(Near(s.AverageMs, 50.5));
+	}
+
+	void TestWindow()
+	{
+		// Buckets of 2 ms: 1, 3, 5, 7 and 9 ms land in buckets 0 to 4.
+		FrameStats stats(4, 33.3, 2.0, 8);
+		const double frames[] = { 1.0, 3.0, 5.0, 7.0 };
+		for(double ms : frames)
+			stats.AddFrame(ms, gNoStages);
+		CHECK(stats.GetSamples().size() == 4);
+		CHECK(stats.GetHistogram()[0] == 1 && stats.GetHistogram()[3] == 1);
+
+		// The fifth frame pushes the first one out, and its bucket with it.
+		stats.AddFrame(9.0, gNoStages);
+		CHECK(stats.GetSamples().size() == 4);
+		CHECK(stats.GetSamples().front().FrameIndex == 1);
+		CHECK(stats.GetSamples().front().FrameMs == 3.0);
+		CHECK(stats.GetSamples().back().FrameIndex == 4);
+		CHECK(stats.GetHistogram()[0] == 0);
+		CHECK(stats.GetHistogram()[4] == 1);
+		CHECK(HistogramTotal(stats) == 4);
+		CHECK(stats.ComputeSummary().FrameCount == 4);
+		CHECK(stats.ComputeSummary().P50Ms == 5.0);
+
+		// Many more frames later the histogram still counts exactly the window.
+		for(std::uint32_t i = 0; i < 1000; ++i)
+			stats.AddFrame((double)(i % 13), gNoStages);
+		CHECK(HistogramTotal(stats) == 4);
+		std::vector<std::uint32_t> expected(stats.GetHistogram().size(), 0);
+		for(const auto& sample : stats.GetSamples())
+			expected[std::min((std::size_t)(sample.FrameMs / 2.0), expected.size() - 1)]++;
+		CHECK(expected == stats.GetHistogram());
+
+		stats.Clear();
+		CHECK(stats.GetSamples().size() == 0);
+		CHECK(HistogramTotal(stats) == 0);
+		CHECK(stats.GetStutterCount() == 0);
+	}
+
+	void TestBucketClamp()
+	{
+		FrameStats stats(100, 33.3, 2.0, 5);
+		stats.AddFrame(9.99, gNoStages);
+		stats.AddFrame(10.0, gNoStages);
+		stats.AddFrame(250.0, gNoStages);
+		stats.AddFrame(-1.0, gNoStages);
+
+		const auto& histogram = stats.GetHistogram();
+		CHECK(histogram.size() == 5);
+		CHECK(histogram[4] == 3);
+		CHECK(histogram[0] == 1);
+		CHECK(stats.GetBucketMs() == 2.0);
+	}
+
+	void TestStutters()
+	{
+		FrameStats stats(1000, 10.0);
+		CHECK(!stats.AddFrame(10.0, gNoStages));
+		CHECK(stats.GetStutterCount() == 0);
+
+		std::vector<FrameStageTime> stages(2);
+		stages[0].Name = "Update";
+		stages[0].Ms = 2.0;
+		stages[1].Name = "Draw";
+		stages[1].Ms = 9.0;
+		CHECK(stats.AddFrame(11.0, stages));
+		CHECK(stats.GetStutters().size() == 1);
+		CHECK(std::string(stats.GetStutters().back().DominantStage) == "Draw");
+		CHECK(stats.GetStutters().back().DominantStageMs == 9.0);
+		CHECK(std::string(stats.GetSamples().front().DominantStage).empty());
+
+		// The log keeps the last MaxStutterEvents; the count keeps going.
+		const std::uint32_t total = FrameStats::MaxStutterEvents + 36;
+		for(std::uint32_t i = 1; i < total; ++i)
+			stats.AddFrame(11.0 + i, gNoStages);
+		CHECK(stats.GetStutterCount() == total);
+		CHECK(stats.GetStutters().size() == FrameStats::MaxStutterEvents);
+		CHECK(stats.GetStutters().front().FrameMs == 11.0 + (total - FrameStats::MaxStutterEvents));
+		CHECK(stats.GetStutters().back().FrameMs == 11.0 + (total - 1));
+
+		stats.SetStutterThresholdMs(1000.0);
+		CHECK(!stats.AddFrame(500.0, gNoStages));
+		CHECK(stats.GetStutterThresholdMs() == 1000.0);
+	}
+
+	ProfileZone Zone(const char* name, std::uint32_t thread, double startMs, double endMs)
+	{
+		ProfileZone zone;
+		zone.Name = name;
+		zone.ThreadIndex = thread;
+		zone.StartNs = (std::uint64_t)(startMs * 1e6);
+		zone.EndNs = (std::uint64_t)(endMs * 1e6);
+		return zone;
+	}
+
+	double StageMs(const std::vector<FrameStageTime>& stages, const char* name)
+	{
+		for(const auto& stage : stages)
+		{
+			if(std::string(stage.Name) == name)
+				return stage.Ms;
+		}
+		return -1.0;
+	}
+
+	void TestStageTimes()
+	{
+		// Frame [0, 100) holds Update [10, 40) with Culling [20, 30) inside it, and a
+		// sibling Draw [50, 70).  Present [100, 110) follows at the top level.  A
+		// second Update [80, 90) is named by a different pointer to the same text.
+		// Thread 1 zones overlap everything and must be ignored.
+		static const char updateCopy[] = "Update";
+		std::vector<ProfileZone> zones = {
+			Zone("Frame", 0, 0, 100),
+			Zone("Worker", 1, 0, 200),
+			Zone("Update", 0, 10, 40),
+			Zone("Culling", 0, 20, 30),
+			Zone("Draw", 0, 50, 70),
+			Zone("Job", 1, 55, 60),
+			Zone(updateCopy, 0, 80, 90),
+			Zone("Present", 0, 100, 110),
+		};
+
+		std::vector<FrameStageTime> stages;
+		std::vector<OpenStageZone> stack;
+		FrameStats::ComputeStageTimes(zones, 0, stages, stack);
+		CHECK(stages.size() == 5);
+		CHECK(Near(StageMs(stages, "Frame"), 100.0 - 30.0 - 20.0 - 10.0));
+		CHECK(Near(StageMs(stages, "Update"), 20.0 + 10.0));
+		CHECK(Near(StageMs(stages, "Culling"), 10.0));
+		CHECK(Near(StageMs(stages, "Draw"), 20.0));
+		CHECK(Near(StageMs(stages, "Present"), 10.0));
+		CHECK(StageMs(stages, "Job") < 0.0);
+
+		FrameStats::ComputeStageTimes(zones, 1, stages, stack);
+		CHECK(stages.size() == 2);
+		CHECK(Near(StageMs(stages, "Worker"), 195.0));
+		CHECK(Near(StageMs(stages, "Job"), 5.0));
+
+		FrameStats::ComputeStageTimes(zones, 7, stages, stack);
+		CHECK(stages.empty());
+	}
+
+	void TestCsv()
+	{
+		std::filesystem::remove_all(gScratch);
+
+		FrameStats stats(10, 20.0);
+		CounterFrame counters;
+		for(int i = 0; i < CounterCount; ++i)
+			counters.Values[i] = 1000 + i;
+		stats.AddFrame(16.0, gNoStages, &counters);
+		stats.AddFrame(25.0, gNoStages);
+		stats.AddFrame(17.0, gNoStages, &counters);
+		CHECK(stats.WriteCsv(gScratch / "sub" / "frames.csv"));
+
+		std::ifstream fin(gScratch / "sub" / "frames.csv");
+		std::vector<std::string> lines;
+		std::string line;
+		while(std::getline(fin, line))
+			lines.push_back(line);
+
+		const std::size_t columns = 5 + CounterCount;
+		CHECK(lines.size() == 1 + 3 + 7);
+		if(lines.size() != 1 + 3 + 7)
+			return;
+
+		CHECK(lines[0].rfind("frame,frame_ms,stutter,dominant_stage,dominant_stage_ms,", 0) == 0);
+		CHECK(ColumnCount(lines[0]) == columns);
+		CHECK(lines[0].find(Counters::GetInfo((CounterId)0).Key) != std::string::npos);
+		for(std::size_t i = 1; i <= 3; ++i)
+			CHECK(ColumnCount(lines[i]) == columns);
+		CHECK(lines[1].rfind("0,16,0,,0,1000,", 0) == 0);
+		CHECK(lines[2].rfind("1,25,1,", 0) == 0);
+		for(std::size_t i = 4; i < lines.size(); ++i)
+			CHECK(lines[i].rfind("# ", 0) == 0);
+		CHECK(lines[4] == "# frames,3");
+		CHECK(lines[10] == "# stutter_threshold_ms,20");
+
+		std::filesystem::remove_all(gScratch);
+	}
+
+	void TestDoesNotAllocate()
+	{
+		// What UpdateFrameStats does every frame under -zeroalloc.  The first frames
+		// may grow the caller's vectors; after that, frames that fill the window,
+		// wrap it and stutter must not touch the heap.
+		std::vector<ProfileZone> zones = {
+			Zone("Frame", 0, 0, 16),
+			Zone("Update", 0, 1, 5),
+			Zone("Culling", 0, 2, 3),
+			Zone("Draw", 0, 6, 14),
+			Zone("Record", 0, 7, 12),
+			Zone("Present", 0, 16, 17),
+		};
+		FrameStats stats(100, 20.0);
+		CounterFrame counters;
+		std::vector<FrameStageTime> stages;
+		std::vector<OpenStageZone> stack;
+		auto frame = [&](std::uint32_t f)
+		{
+			FrameStats::ComputeStageTimes(zones, 0, stages, stack);
+			stats.AddFrame(f % 10 == 0 ? 40.0 : 16.0, stages, &counters);
+		};
+		for(std::uint32_t f = 0; f < 10; ++f)
+			frame(f);
+
+		AllocationCounts before = AllocationTracker::GetThreadCounts();
+		for(std::uint32_t f = 10; f < 1010; ++f)
+			frame(f);
+		AllocationCounts after = AllocationTracker::GetThreadCounts();
+
+		CHECK(after.Allocations == before.Allocations);
+		CHECK(stages.size() == 6);
+		CHECK(stats.GetSamples().size() == 100);
+		CHECK(stats.GetStutterCount() == 101);
+		CHECK(stats.GetStutters().size() == FrameStats::MaxStutterEvents);
+	}
+}
+
+int main()
+{
+	TestPercentiles();
+	TestWindow();
+	TestBucketClamp();
+	TestStutters();
+	TestStageTimes();
+	TestCsv();
+	TestDoesNotAllocate();
+	return TestResult();
+}
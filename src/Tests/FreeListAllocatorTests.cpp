@@ -0,0 +1,184 @@
+//***************************************************************************************
+// FreeListAllocatorTests.cpp
+//
+// FreeListAllocator as the persistent descriptor region uses it: first-fit allocation,
+// merging of freed neighbours, and frees deferred by fence value so a slot is not
+// handed out again while a frame in flight may still read it.
+//***************************************************************************************
+
+#include "FreeListAllocator.h"
+#include "TestUtil.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+	void TestFirstFit()
+	{
+		FreeListAllocator slots(10);
+		CHECK(slots.GetCapacity() == 10);
+		CHECK(slots.Allocate(0) == FreeListAllocator::InvalidIndex);
+		CHECK(slots.Allocate(11) == FreeListAllocator::InvalidIndex);
+
+		CHECK(slots.Allocate(3) == 0);
+		CHECK(slots.Allocate(3) == 3);
+		CHECK(slots.Allocate(3) == 6);
+		CHECK(slots.GetFreeCount() == 1);
+		CHECK(slots.Allocate(2) == FreeListAllocator::InvalidIndex);
+
+		// The hole at [3, 6) is the first range large enough for 2, then 1.
+		slots.Free(3, 3);
+		CHECK(slots.Allocate(2) == 3);
+		CHECK(slots.Allocate(1) == 5);
+		CHECK(slots.Allocate(1) == 9);
+		CHECK(slots.GetFreeCount() == 0);
+	}
+
+	void TestMerge()
+	{
+		FreeListAllocator slots(9);
+		CHECK(slots.Allocate(3) == 0);
+		CHECK(slots.Allocate(3) == 3);
+		CHECK(slots.Allocate(3) == 6);
+
+		// Freed in an order that merges with the right, then the left neighbour, until
+		// one range covers everything again.
+		slots.Free(6, 3);
+		slots.Free(0, 3);
+		CHECK(slots.Allocate(4) == FreeListAllocator::InvalidIndex);
+		slots.Free(3, 3);
+		CHECK(slots.GetFreeCount() == 9);
+		CHECK(slots.Allocate(9) == 0);
+	}
+
+	void TestDeferredFree()
+	{
+		FreeListAllocator slots(4);
+		CHECK(slots.Allocate(2) == 0);
+		CHECK(slots.Allocate(2) == 2);
+
+		// Freed during frame 1: still allocated until fence 1 completes.
+		slots.FreeDeferred(0, 2);
+		CHECK(slots.GetPendingCount() == 2);
+		CHECK(slots.GetFreeCount() == 0);
+		slots.ReleaseCompleted(100);
+		CHECK(slots.GetFreeCount() == 0);
+		CHECK(slots.Allocate(1) == FreeListAllocator::InvalidIndex);
+		slots.FinishFrame(1);
+
+		// Freed during frame 2.
+		slots.FreeDeferred(2, 2);
+		slots.FinishFrame(2);
+
+		slots.ReleaseCompleted(0);
+		CHECK(slots.GetFreeCount() == 0);
+		slots.ReleaseCompleted(1);
+		CHECK(slots.GetFreeCount() == 2);
+		CHECK(slots.GetPendingCount() == 2);
+		CHECK(slots.Allocate(2) == 0);
+		slots.ReleaseCompleted(2);
+		CHECK(slots.GetPendingCount() == 0);
+		CHECK(slots.Allocate(2) == 2);
+	}
+
+	// Random allocations and deferred frees with a fake GPU up to three frames behind.
+	// A slot must never be handed out while a live allocation or an unfinished frame
+	// that freed it still owns it.
+	void TestFramesInFlight()
+	{
+		const std::uint32_t capacity = 256;
+		const std::uint64_t framesInFlight = 3;
+		FreeListAllocator slots(capacity);
+
+		// Per slot: 0 free, Allocated, or the fence of the frame that freed it.
+		const std::uint64_t Allocated = ~0ull;
+		std::vector<std::uint64_t> owner(capacity, 0);
+		struct Live
+		{
+			std::uint32_t Index;
+			std::uint32_t Count;
+		};
+		std::vector<Live> live;
+
+		std::uint64_t fence = 0;
+		std::uint64_t completed = 0;
+		std::uint64_t seed = 7;
+		std::uint64_t failures = 0;
+		bool reused = false;
+
+		auto next = [&seed]()
+		{
+			seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+			return seed >> 33;
+		};
+
+		for(std::uint64_t frame = 0; frame < 20000; ++frame)
+		{
+			if(next() % 2 == 0 && completed < fence)
+				completed++;
+			if(fence - completed > framesInFlight)
+				completed = fence - framesInFlight;
+			slots.ReleaseCompleted(completed);
+			for(std::uint64_t& o : owner)
+			{
+				if(o != Allocated && o <= completed)
+					o = 0;
+			}
+
+			for(std::uint64_t i = next() % 4; i > 0; --i)
+			{
+				std::uint32_t count = 1 + (std::uint32_t)(next() % 8);
+				std::uint32_t index = slots.Allocate(count);
+				if(index == FreeListAllocator::InvalidIndex)
+				{
+					failures++;
+					continue;
+				}
+				for(std::uint32_t s = index; s < index + count; ++s)
+				{
+					reused = reused || owner[s] != 0;
+					owner[s] = Allocated;
+				}
+				live.push_back({ index, count });
+			}
+
+			for(std::uint64_t i = next() % 4; i > 0 && !live.empty(); --i)
+			{
+				std::size_t pick = (std::size_t)(next() % live.size());
+				Live range = live[pick];
+				live[pick] = live.back();
+				live.pop_back();
+
+				slots.FreeDeferred(range.Index, range.Count);
+				for(std::uint32_t s = range.Index; s < range.Index + range.Count; ++s)
+					owner[s] = fence + 1;
+			}
+
+			slots.FinishFrame(++fence);
+		}
+
+		CHECK(!reused);
+		CHECK(failures > 0);
+
+		std::uint32_t liveCount = 0;
+		for(const Live& range : live)
+			liveCount += range.Count;
+		slots.ReleaseCompleted(fence);
+		CHECK(slots.GetPendingCount() == 0);
+		CHECK(slots.GetFreeCount() == capacity - liveCount);
+
+		for(const Live& range : live)
+			slots.Free(range.Index, range.Count);
+		CHECK(slots.Allocate(capacity) == 0);
+	}
+}
+
+int main()
+{
+	TestFirstFit();
+	TestMerge();
+	TestDeferredFree();
+	TestFramesInFlight();
+	return TestResult();
+}
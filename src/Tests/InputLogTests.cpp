@@ -0,0 +1,273 @@
+//***************************************************************************************
+// InputLogTests.cpp
+//
+// InputLog and InputReplay without a window: the binary format round trip, including
+// negative and extreme mouse positions, the encoded size of small values, files that
+// are truncated or have a bad magic or version, and Next/Peek at frame boundaries.
+//***************************************************************************************
+
+#include "InputLog.h"
+#include "TestUtil.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const std::filesystem::path gScratch = "InputLogTests.tmp";
+
+	InputEvent MakeEvent(std::uint32_t frame, InputEventType type, std::uint64_t code, std::int32_t x = 0, std::int32_t y = 0)
+	{
+		InputEvent event;
+		event.Frame = frame;
+		event.Type = type;
+		event.Code = code;
+		event.X = x;
+		event.Y = y;
+		return event;
+	}
+
+	InputEvent MakeValue(std::uint32_t frame, std::uint64_t id, const void* data, std::uint8_t size)
+	{
+		InputEvent event = MakeEvent(frame, InputEventType::Value, id);
+		event.Size = size;
+		std::memcpy(event.Data, data, size);
+		return event;
+	}
+
+	bool Same(const InputEvent& a, const InputEvent& b)
+	{
+		return a.Frame == b.Frame && a.Type == b.Type && a.Code == b.Code && a.X == b.X && a.Y == b.Y &&
+			a.Size == b.Size && std::memcmp(a.Data, b.Data, a.Size) == 0;
+	}
+
+	std::vector<unsigned char> ReadFile(const std::filesystem::path& file)
+	{
+		std::ifstream fin(file, std::ios::binary);
+		return std::vector<unsigned char>((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+	}
+
+	void WriteFile(const std::filesystem::path& file, const std::vector<unsigned char>& data)
+	{
+		std::ofstream fout(file, std::ios::binary | std::ios::trunc);
+		fout.write((const char*)data.data(), (std::streamsize)data.size());
+	}
+
+	// A session with every event type, several events per frame and empty frames.
+	InputLog MakeSession()
+	{
+		const float speed = 2.5f;
+		const std::uint32_t objects = 40000;
+
+		InputLog log;
+		log.Add(MakeEvent(0, InputEventType::KeyDown, 'W'));
+		log.Add(MakeEvent(0, InputEventType::MouseDown, 1, 400, 300));
+		log.Add(MakeEvent(3, InputEventType::MouseMove, 1, -1, -2));
+		log.Add(MakeEvent(3, InputEventType::MouseMove, 1, -640, 63));
+		log.Add(MakeEvent(4, InputEventType::MouseMove, 0, INT32_MIN, INT32_MAX));
+		log.Add(MakeValue(4, 7, &speed, sizeof(speed)));
+		log.Add(MakeValue(9, 8, &objects, sizeof(objects)));
+		log.Add(MakeEvent(200, InputEventType::KeyUp, 'W'));
+		log.Add(MakeEvent(200, InputEventType::KeyDown, 0xff00000000ull));
+		log.SetFrameCount(300);
+		return log;
+	}
+
+	void TestAdd()
+	{
+		InputLog log;
+		CHECK(log.Add(MakeEvent(5, InputEventType::KeyDown, 1)));
+		CHECK(log.Add(MakeEvent(5, InputEventType::KeyUp, 1)));
+		CHECK(!log.Add(MakeEvent(4, InputEventType::KeyDown, 2)));
+		CHECK(!log.Add(MakeEvent(6, InputEventType::Count, 2)));
+		InputEvent tooBig = MakeEvent(6, InputEventType::Value, 3);
+		tooBig.Size = InputEvent::MaxValueSize + 1;
+		CHECK(!log.Add(tooBig));
+		CHECK(log.GetEvents().size() == 2);
+		CHECK(log.GetFrameCount() == 6);
+
+		// The frame count can be extended but never cut below the last event.
+		log.SetFrameCount(100);
+		CHECK(log.GetFrameCount() == 100);
+		log.SetFrameCount(2);
+		CHECK(log.GetFrameCount() == 6);
+
+		log.Clear();
+		CHECK(log.GetEvents().empty());
+		CHECK(log.GetFrameCount() == 0);
+	}
+
+	void TestRoundTrip()
+	{
+		std::filesystem::remove_all(gScratch);
+
+		InputLog log = MakeSession();
+		CHECK(log.GetEvents().size() == 9);
+		CHECK(log.Save(gScratch / "sub" / "session.inputlog"));
+
+		InputLog loaded;
+		std::string error;
+		CHECK(loaded.Load(gScratch / "sub" / "session.inputlog", error));
+		CHECK(error.empty());
+		CHECK(loaded.GetFrameCount() == 300);
+		CHECK(loaded.GetEvents().size() == log.GetEvents().size());
+		bool same = loaded.GetEvents().size() == log.GetEvents().size();
+		for(std::size_t i = 0; same && i < log.GetEvents().size(); ++i)
+			same = Same(loaded.GetEvents()[i], log.GetEvents()[i]);
+		CHECK(same);
+
+		// An empty log is a header only.
+		CHECK(InputLog().Save(gScratch / "empty.inputlog"));
+		CHECK(loaded.Load(gScratch / "empty.inputlog", error));
+		CHECK(loaded.GetEvents().empty());
+		CHECK(loaded.GetFrameCount() == 0);
+
+		std::filesystem::remove_all(gScratch);
+	}
+
+	// Bytes taken by one MouseMove at frame 0 with code 0: file size minus the header.
+	std::size_t MouseMoveSize(std::int32_t x, std::int32_t y)
+	{
+		InputLog log;
+		log.Add(MakeEvent(0, InputEventType::MouseMove, 0, x, y));
+		log.Save(gScratch / "size.inputlog");
+
+		// Magic, version, frame count 1 and event count 1.
+		const std::size_t headerSize = 4 + 1 + 1 + 1;
+		return ReadFile(gScratch / "size.inputlog").size() - headerSize;
+	}
+
+	void TestEncodedSize()
+	{
+		std::filesystem::remove_all(gScratch);
+		std::filesystem::create_directories(gScratch);
+
+		// Frame delta, type and code take a byte each; then X and Y.  Zigzag keeps
+		// -64..63 in one byte and every 32-bit value within five.
+		CHECK(MouseMoveSize(0, 0) == 3 + 1 + 1);
+		CHECK(MouseMoveSize(-1, 1) == 3 + 1 + 1);
+		CHECK(MouseMoveSize(-64, 63) == 3 + 1 + 1);
+		CHECK(MouseMoveSize(-65, 64) == 3 + 2 + 2);
+		CHECK(MouseMoveSize(-8192, 8191) == 3 + 2 + 2);
+		CHECK(MouseMoveSize(INT32_MIN, INT32_MAX) == 3 + 5 + 5);
+
+		// A recording of small mouse moves, one per frame, takes 5 bytes per event.
+		InputLog log;
+		for(std::uint32_t frame = 0; frame < 1000; ++frame)
+			log.Add(MakeEvent(frame, InputEventType::MouseMove, 1, (std::int32_t)(frame % 7) - 3, -(std::int32_t)(frame % 5)));
+		CHECK(log.Save(gScratch / "moves.inputlog"));
+		CHECK(ReadFile(gScratch / "moves.inputlog").size() <= 4 + 1 + 2 + 2 + 1000 * 5);
+
+		std::filesystem::remove_all(gScratch);
+	}
+
+	void TestBadFiles()
+	{
+		std::filesystem::remove_all(gScratch);
+		std::filesystem::create_directories(gScratch);
+
+		CHECK(MakeSession().Save(gScratch / "session.inputlog"));
+		const std::vector<unsigned char> good = ReadFile(gScratch / "session.inputlog");
+		CHECK(good.size() > 8);
+
+		// A log that fails to load keeps what it had.
+		InputLog log;
+		log.Add(MakeEvent(1, InputEventType::KeyDown, 42));
+		std::string error;
+		auto failsToLoad = [&](const std::vector<unsigned char>& data, const char* expected)
+		{
+			WriteFile(gScratch / "bad.inputlog", data);
+			error.clear();
+			bool failed = !log.Load(gScratch / "bad.inputlog", error);
+			return failed && error.find(expected) != std::string::npos &&
+				log.GetEvents().size() == 1 && log.GetEvents()[0].Code == 42;
+		};
+
+		// Every byte belongs to the header or an event, so every prefix is corrupt.
+		bool truncatedFails = true;
+		for(std::size_t size = 0; size < good.size(); ++size)
+		{
+			std::vector<unsigned char> truncated(good.begin(), good.begin() + size);
+			const char* expected = size < 5 ? "is not an input log" : "";
+			truncatedFails = truncatedFails && failsToLoad(truncated, expected);
+		}
+		CHECK(truncatedFails);
+
+		std::vector<unsigned char> badMagic = good;
+		badMagic[0] = 'X';
+		CHECK(failsToLoad(badMagic, "is not an input log"));
+
+		std::vector<unsigned char> badVersion = good;
+		badVersion[4] = 2;
+		CHECK(failsToLoad(badVersion, "unsupported version 2"));
+
+		// An event count far beyond the data must not be trusted for the reservation.
+		std::vector<unsigned char> hugeCount(good.begin(), good.begin() + 5);
+		const unsigned char header[] = { 1, 0xff, 0xff, 0xff, 0xff, 0x0f };
+		hugeCount.insert(hugeCount.end(), std::begin(header), std::end(header));
+		CHECK(failsToLoad(hugeCount, "event 0 is corrupt"));
+
+		error.clear();
+		CHECK(!log.Load(gScratch / "missing.inputlog", error));
+		CHECK(error.find("cannot open") != std::string::npos);
+
+		CHECK(log.Load(gScratch / "session.inputlog", error));
+		CHECK(log.GetEvents().size() == 9);
+
+		std::filesystem::remove_all(gScratch);
+	}
+
+	void TestReplay()
+	{
+		// Events at frames 0, 0, 3, 3, 4, 4, 9, 200, 200 of a 300 frame recording.
+		InputReplay replay(MakeSession());
+		InputEvent event;
+
+		CHECK(replay.Peek(0) != nullptr && replay.Peek(0)->Type == InputEventType::KeyDown);
+		CHECK(replay.Next(0, event) && event.Frame == 0 && event.Code == 'W');
+		CHECK(replay.Next(0, event) && event.Frame == 0 && event.Type == InputEventType::MouseDown);
+		CHECK(!replay.Next(0, event));
+		CHECK(replay.Peek(0) == nullptr);
+
+		// Nothing happens in frames 1 and 2, and Peek does not consume.
+		CHECK(replay.Peek(2) == nullptr);
+		CHECK(!replay.Next(2, event));
+		CHECK(replay.Peek(3) != nullptr && replay.Peek(3)->X == -1);
+		CHECK(replay.Peek(3) != nullptr && replay.Peek(3)->X == -1);
+		CHECK(replay.Next(3, event) && event.X == -1 && event.Y == -2);
+		CHECK(replay.Next(3, event) && event.X == -640 && event.Y == 63);
+		CHECK(!replay.Next(3, event));
+
+		// A frame that skipped ahead catches up on every earlier event, in order.
+		std::vector<std::uint32_t> frames;
+		while(replay.Next(100, event))
+			frames.push_back(event.Frame);
+		CHECK((frames == std::vector<std::uint32_t>{ 4, 4, 9 }));
+		CHECK(!replay.Next(199, event));
+		CHECK(replay.Next(200, event) && event.Type == InputEventType::KeyUp);
+		CHECK(replay.Next(200, event) && event.Code == 0xff00000000ull);
+		CHECK(!replay.Next(1000, event));
+		CHECK(replay.Peek(1000) == nullptr);
+
+		// The recording ends after its frame count, not its last event.
+		CHECK(!replay.IsFinished(200));
+		CHECK(!replay.IsFinished(299));
+		CHECK(replay.IsFinished(300));
+		CHECK(replay.GetLog().GetFrameCount() == 300);
+	}
+}
+
+int main()
+{
+	TestAdd();
+	TestRoundTrip();
+	TestEncodedSize();
+	TestBadFiles();
+	TestReplay();
+	return TestResult();
+}
@@ -0,0 +1,143 @@
+//***************************************************************************************
+// JobSystemBench.cpp
+//
+// JobSystem against a std::async baseline:
+//   -spawn: cost per job of many tiny jobs (submit, run, wait).
+//   -parallel for: a range of cheap per-element work split into chunks, as the app
+//    splits UpdateObjectCBs.
+// std::async(std::launch::async) starts a thread per task on some standard libraries
+// and uses a pool on others, so the baseline differs between compilers.
+//
+// Usage: JobSystemBench [workers] [repeats]
+//***************************************************************************************
+
+#include "JobSystem.h"
+#include "TestUtil.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	std::atomic<std::uint64_t> gSink{ 0 };
+
+	// About a microsecond of arithmetic, kept from being optimized out.
+	void SmallWork(std::uint32_t seed)
+	{
+		std::uint64_t x = seed;
+		for(int i = 0; i < 200; ++i)
+			x = x * 6364136223846793005ull + 1442695040888963407ull;
+		gSink.fetch_add(x & 1, std::memory_order_relaxed);
+	}
+
+	void ElementWork(float* data, std::uint32_t begin, std::uint32_t end)
+	{
+		for(std::uint32_t i = begin; i < end; ++i)
+			data[i] = std::sqrt(data[i] * 1.0001f + 0.5f);
+	}
+
+	// Nanoseconds per job.
+	double SpawnJobSystem(JobSystem& jobs, std::uint32_t jobCount)
+	{
+		double start = TestUtil::NowSeconds();
+		JobCounter counter;
+		for(std::uint32_t i = 0; i < jobCount; ++i)
+			jobs.Run([i]() { SmallWork(i); }, counter);
+		jobs.Wait(counter);
+		return (TestUtil::NowSeconds() - start) * 1e9 / jobCount;
+	}
+
+	double SpawnAsync(std::uint32_t jobCount)
+	{
+		double start = TestUtil::NowSeconds();
+		std::vector<std::future<void>> futures;
+		futures.reserve(jobCount);
+		for(std::uint32_t i = 0; i < jobCount; ++i)
+			futures.push_back(std::async(std::launch::async, [i]() { SmallWork(i); }));
+		for(auto& future : futures)
+			future.get();
+		return (TestUtil::NowSeconds() - start) * 1e9 / jobCount;
+	}
+
+	// Milliseconds for the whole range.
+	double ParallelForSerial(std::vector<float>& data)
+	{
+		double start = TestUtil::NowSeconds();
+		ElementWork(data.data(), 0, (std::uint32_t)data.size());
+		return (TestUtil::NowSeconds() - start) * 1e3;
+	}
+
+	double ParallelForJobSystem(JobSystem& jobs, std::vector<float>& data, std::uint32_t grain)
+	{
+		double start = TestUtil::NowSeconds();
+		jobs.ParallelFor((std::uint32_t)data.size(), grain, [&data](std::uint32_t begin, std::uint32_t end)
+		{
+			ElementWork(data.data(), begin, end);
+		});
+		return (TestUtil::NowSeconds() - start) * 1e3;
+	}
+
+	double ParallelForAsync(std::vector<float>& data, std::uint32_t grain)
+	{
+		double start = TestUtil::NowSeconds();
+		std::uint32_t count = (std::uint32_t)data.size();
+		std::vector<std::future<void>> futures;
+		for(std::uint32_t begin = 0; begin < count; begin += grain)
+		{
+			std::uint32_t end = begin + grain < count ? begin + grain : count;
+			futures.push_back(std::async(std::launch::async, [&data, begin, end]() { ElementWork(data.data(), begin, end); }));
+		}
+		for(auto& future : futures)
+			future.get();
+		return (TestUtil::NowSeconds() - start) * 1e3;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::uint32_t workers = argc > 1 ? (std::uint32_t)std::strtoul(argv[1], nullptr, 10) : 0;
+	std::uint32_t repeats = argc > 2 ? (std::uint32_t)std::strtoul(argv[2], nullptr, 10) : 9;
+	if(repeats == 0)
+		repeats = 1;
+
+	JobSystem jobs(workers);
+	std::printf("%u hardware threads, %u workers, median of %u runs\n\n",
+		std::thread::hardware_concurrency(), jobs.GetWorkerCount(), repeats);
+
+	const std::uint32_t jobCounts[] = { 1000, 10000 };
+	std::printf("spawn, ns per job\n%10s %12s %12s\n", "jobs", "JobSystem", "std::async");
+	for(std::uint32_t jobCount : jobCounts)
+	{
+		std::vector<double> jobSystem;
+		std::vector<double> async;
+		for(std::uint32_t r = 0; r < repeats; ++r)
+		{
+			jobSystem.push_back(SpawnJobSystem(jobs, jobCount));
+			async.push_back(SpawnAsync(jobCount));
+		}
+		std::printf("%10u %12.0f %12.0f\n", jobCount, TestUtil::Median(jobSystem), TestUtil::Median(async));
+	}
+
+	std::vector<float> data(4 * 1024 * 1024, 1.0f);
+	const std::uint32_t grains[] = { 1024, 16384, 262144 };
+	std::printf("\nparallel for over %zu floats, ms\n%10s %12s %12s %12s\n", data.size(), "grain", "serial", "JobSystem", "std::async");
+	for(std::uint32_t grain : grains)
+	{
+		std::vector<double> serial;
+		std::vector<double> jobSystem;
+		std::vector<double> async;
+		for(std::uint32_t r = 0; r < repeats; ++r)
+		{
+			serial.push_back(ParallelForSerial(data));
+			jobSystem.push_back(ParallelForJobSystem(jobs, data, grain));
+			async.push_back(ParallelForAsync(data, grain));
+		}
+		std::printf("%10u %12.3f %12.3f %12.3f\n", grain, TestUtil::Median(serial), TestUtil::Median(jobSystem), TestUtil::Median(async));
+	}
+	return 0;
+}
@@ -0,0 +1,206 @@
+//***************************************************************************************
+// JobSystemTests.cpp
+//
+// Correctness of JobSystem under contention: many threads submitting at once, jobs
+// that submit and wait on more jobs, continuations, ranges that must be covered
+// exactly once, and a steady-state Dispatch that does not allocate.  Every case runs
+// with more workers than this machine may have cores, so queues are contended and
+// stealing happens.
+//***************************************************************************************
+
+#include "AllocationTracker.h"
+#include "JobSystem.h"
+#include "TestUtil.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	void TestRunFromManyThreads()
+	{
+		JobSystem jobs(4);
+		const std::uint32_t submitters = 8;
+		const std::uint32_t jobsPerSubmitter = 5000;
+
+		std::atomic<std::uint32_t> ran{ 0 };
+		std::vector<std::thread> threads;
+		for(std::uint32_t t = 0; t < submitters; ++t)
+		{
+			threads.emplace_back([&]()
+			{
+				JobCounter counter;
+				for(std::uint32_t i = 0; i < jobsPerSubmitter; ++i)
+					jobs.Run([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }, counter);
+				jobs.Wait(counter);
+				CHECK(counter.IsDone());
+			});
+		}
+		for(auto& thread : threads)
+			thread.join();
+
+		CHECK(ran.load() == submitters * jobsPerSubmitter);
+	}
+
+	void TestDispatchCoversRangeOnce()
+	{
+		JobSystem jobs(3);
+		const std::uint32_t counts[] = { 0, 1, 7, 64, 65, 1000, 4099 };
+		const std::uint32_t grains[] = { 0, 1, 16, 64, 5000 };
+		for(std::uint32_t count : counts)
+		{
+			for(std::uint32_t grain : grains)
+			{
+				std::unique_ptr<std::atomic<std::uint32_t>[]> hits(new std::atomic<std::uint32_t>[count + 1]);
+				for(std::uint32_t i = 0; i <= count; ++i)
+					hits[i] = 0;
+
+				std::atomic<bool> badRange{ false };
+				JobSystem::RangeFunc func = [&](std::uint32_t begin, std::uint32_t end)
+				{
+					if(begin >= end || end > count)
+						badRange = true;
+					for(std::uint32_t i = begin; i < end; ++i)
+						hits[i].fetch_add(1, std::memory_order_relaxed);
+				};
+
+				JobCounter counter;
+				jobs.Dispatch(count, grain, func, counter);
+				jobs.Wait(counter);
+
+				CHECK(!badRange.load());
+				bool once = true;
+				for(std::uint32_t i = 0; i < count; ++i)
+					once = once && hits[i].load() == 1;
+				CHECK(once);
+			}
+		}
+	}
+
+	void TestNestedWait()
+	{
+		// Every outer job dispatches and waits on inner work from inside a worker.  With
+		// a blocking wait this deadlocks as soon as all workers sit in outer jobs.
+		JobSystem jobs(2);
+		std::atomic<std::uint32_t> inner{ 0 };
+
+		JobCounter outer;
+		for(std::uint32_t i = 0; i < 64; ++i)
+		{
+			jobs.Run([&]()
+			{
+				jobs.ParallelFor(100, 10, [&](std::uint32_t begin, std::uint32_t end)
+				{
+					inner.fetch_add(end - begin, std::memory_order_relaxed);
+				});
+			}, outer);
+		}
+		jobs.Wait(outer);
+
+		CHECK(inner.load() == 64 * 100);
+	}
+
+	void TestContinuations()
+	{
+		JobSystem jobs(3);
+		for(int round = 0; round < 200; ++round)
+		{
+			std::atomic<std::uint32_t> first{ 0 };
+			std::atomic<bool> orderOk{ true };
+
+			JobCounter dependency;
+			JobCounter done;
+			for(std::uint32_t i = 0; i < 16; ++i)
+				jobs.Run([&first]() { first.fetch_add(1, std::memory_order_relaxed); }, dependency);
+			jobs.RunAfter(dependency, [&]()
+			{
+				if(first.load() != 16)
+					orderOk = false;
+			}, done);
+			jobs.Wait(done);
+
+			CHECK(orderOk.load());
+			CHECK(dependency.IsDone());
+		}
+
+		// A dependency that is already done runs the continuation right away.
+		JobCounter idle;
+		JobCounter done;
+		std::atomic<bool> ran{ false };
+		jobs.RunAfter(idle, [&ran]() { ran = true; }, done);
+		jobs.Wait(done);
+		CHECK(ran.load());
+	}
+
+	void TestCounterReuse()
+	{
+		JobSystem jobs(2);
+		JobCounter counter;
+		std::atomic<std::uint32_t> total{ 0 };
+		JobSystem::RangeFunc func = [&total](std::uint32_t begin, std::uint32_t end)
+		{
+			total.fetch_add(end - begin, std::memory_order_relaxed);
+		};
+		for(std::uint32_t round = 0; round < 1000; ++round)
+		{
+			jobs.Dispatch(256, 32, func, counter);
+			jobs.Wait(counter);
+		}
+		CHECK(total.load() == 1000 * 256);
+	}
+
+	void TestDispatchDoesNotAllocate()
+	{
+		// What the app does every frame under -zeroalloc.  The first rounds may grow
+		// the queues; after that the dispatching thread must not touch the heap.
+		JobSystem jobs(3);
+		std::atomic<std::uint32_t> total{ 0 };
+		JobSystem::RangeFunc func = [&total](std::uint32_t begin, std::uint32_t end)
+		{
+			total.fetch_add(end - begin, std::memory_order_relaxed);
+		};
+
+		JobCounter counter;
+		for(std::uint32_t round = 0; round < 10; ++round)
+		{
+			jobs.Dispatch(4096, 16, func, counter);
+			jobs.Wait(counter);
+		}
+
+		AllocationCounts before = AllocationTracker::GetThreadCounts();
+		for(std::uint32_t round = 0; round < 1000; ++round)
+		{
+			jobs.Dispatch(4096, 16, func, counter);
+			jobs.Wait(counter);
+		}
+		AllocationCounts after = AllocationTracker::GetThreadCounts();
+
+		CHECK(after.Allocations == before.Allocations);
+		CHECK(total.load() == 1010 * 4096);
+	}
+
+	void TestStartStop()
+	{
+		// Workers that never received a job must still shut down.
+		for(int i = 0; i < 50; ++i)
+		{
+			JobSystem jobs(4);
+			CHECK(jobs.GetWorkerCount() == 4);
+		}
+	}
+}
+
+int main()
+{
+	TestRunFromManyThreads();
+	TestDispatchCoversRangeOnce();
+	TestNestedWait();
+	TestContinuations();
+	TestCounterReuse();
+	TestDispatchDoesNotAllocate();
+	TestStartStop();
+	return TestResult();
+}
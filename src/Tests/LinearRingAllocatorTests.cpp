@@ -0,0 +1,160 @@
+//***************************************************************************************
+// LinearRingAllocatorTests.cpp
+//
+// LinearRingAllocator driven by a fake fence, the way UploadRing and the transient
+// descriptor region use it: each frame allocates, is tagged with the next fence value,
+// and is released once the "GPU" has caught up.  A shadow list of live ranges checks
+// that no allocation ever overlaps one the GPU may still be reading.
+//***************************************************************************************
+
+#include "LinearRingAllocator.h"
+#include "TestUtil.h"
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace
+{
+	struct Range
+	{
+		std::uint64_t Begin = 0;
+		std::uint64_t End = 0;
+		std::uint64_t Fence = 0;
+	};
+
+	bool Overlaps(const std::deque<Range>& live, std::uint64_t begin, std::uint64_t end)
+	{
+		for(const Range& range : live)
+		{
+			if(begin < range.End && range.Begin < end)
+				return true;
+		}
+		return false;
+	}
+
+	void TestBasics()
+	{
+		LinearRingAllocator ring(1024);
+		CHECK(ring.GetCapacity() == 1024);
+		CHECK(ring.Allocate(0, 16) == LinearRingAllocator::InvalidOffset);
+		CHECK(ring.Allocate(1025, 16) == LinearRingAllocator::InvalidOffset);
+
+		CHECK(ring.Allocate(10, 1) == 0);
+		CHECK(ring.Allocate(10, 256) == 256);
+		CHECK(ring.GetUsedSize() == 266);
+
+		// Fence 1 has not passed yet, so the rest of the ring is all there is.
+		ring.FinishFrame(1);
+		CHECK(ring.Allocate(758, 1) == 266);
+		CHECK(ring.Allocate(1, 1) == LinearRingAllocator::InvalidOffset);
+
+		ring.FinishFrame(2);
+		ring.ReleaseCompleted(0);
+		CHECK(ring.GetUsedSize() == 1024);
+		ring.ReleaseCompleted(2);
+		CHECK(ring.GetUsedSize() == 0);
+
+		// Empty again, so allocation restarts at 0 instead of wrapping.
+		CHECK(ring.Allocate(100, 1) == 0);
+	}
+
+	void TestWrap()
+	{
+		LinearRingAllocator ring(1000);
+		CHECK(ring.Allocate(600, 1) == 0);
+		ring.FinishFrame(1);
+		CHECK(ring.Allocate(300, 1) == 600);
+		ring.FinishFrame(2);
+		ring.ReleaseCompleted(1);
+
+		// 100 bytes are left before the end; 200 only fit after wrapping to 0, and the
+		// skipped tail counts as used until the frame is released.
+		CHECK(ring.Allocate(200, 1) == 0);
+		CHECK(ring.GetUsedSize() == 300 + 100 + 200);
+		ring.FinishFrame(3);
+
+		// [200, 600) is free, but nothing past the tail of frame 2 is.
+		CHECK(ring.Allocate(401, 1) == LinearRingAllocator::InvalidOffset);
+		CHECK(ring.Allocate(400, 1) == 200);
+		ring.FinishFrame(4);
+		ring.ReleaseCompleted(4);
+		CHECK(ring.GetUsedSize() == 0);
+	}
+
+	void TestFramesInFlight()
+	{
+		const std::uint64_t capacity = 24 * 1024;
+		const std::uint64_t framesInFlight = 3;
+		LinearRingAllocator ring(capacity);
+
+		std::deque<Range> live;
+		std::uint64_t fence = 0;
+		std::uint64_t completed = 0;
+		std::uint64_t seed = 1;
+		std::uint64_t attempts = 0;
+		std::uint64_t failures = 0;
+		bool overlap = false;
+		bool misaligned = false;
+
+		for(std::uint64_t frame = 0; frame < 20000; ++frame)
+		{
+			// The GPU finishes a frame half of the time, and the CPU waits for it rather
+			// than get more than framesInFlight frames ahead.
+			seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+			if((seed >> 63) != 0 && completed < fence)
+				completed++;
+			if(fence - completed > framesInFlight)
+				completed = fence - framesInFlight;
+			ring.ReleaseCompleted(completed);
+			while(!live.empty() && live.front().Fence <= completed)
+				live.pop_front();
+
+			std::uint32_t allocations = (std::uint32_t)(seed >> 60) + 1;
+			for(std::uint32_t i = 0; i < allocations; ++i)
+			{
+				seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+				std::uint64_t size = 1 + (seed >> 54);
+				std::uint64_t alignment = 1ull << ((seed >> 20) % 9);
+				std::uint64_t offset = ring.Allocate(size, alignment);
+				attempts++;
+				if(offset == LinearRingAllocator::InvalidOffset)
+				{
+					failures++;
+					continue;
+				}
+
+				misaligned = misaligned || (offset & (alignment - 1)) != 0 || offset + size > capacity;
+				overlap = overlap || Overlaps(live, offset, offset + size);
+
+				Range range;
+				range.Begin = offset;
+				range.End = offset + size;
+				range.Fence = fence + 1;
+				live.push_back(range);
+			}
+
+			ring.FinishFrame(++fence);
+		}
+
+		CHECK(!overlap);
+		CHECK(!misaligned);
+
+		// Frames average about 4 KB and up to four can be live, so the 24 KB ring is
+		// sometimes full but mostly not.
+		CHECK(failures > 0);
+		CHECK(failures < attempts / 10);
+		std::printf("%llu of %llu allocations found the ring full\n", (unsigned long long)failures, (unsigned long long)attempts);
+
+		ring.ReleaseCompleted(fence);
+		CHECK(ring.GetUsedSize() == 0);
+	}
+}
+
+int main()
+{
+	TestBasics();
+	TestWrap();
+	TestFramesInFlight();
+	return TestResult();
+}
@@ -0,0 +1,177 @@
+//***************************************************************************************
+// ObjectUpdateBench.cpp
+//
+// How the parallel object constant buffer update (TexColumnsApp::UpdateObjectCBs)
+// scales with threads, for 10k to 1M dirty objects.  Each frame every object is dirty
+// and goes through the same steps as in the app: chunks of gObjectCBChunkSize items are
+// dispatched to the JobSystem, each chunk gathers its items into frame arena scratch,
+// expands them with TransformBatch and streams the constants into 256 byte slots.  The
+// destination is ordinary memory here, not a write-combined upload heap.
+//
+// Usage: ObjectUpdateBench [max threads] [frames]
+// Threads count the dispatching thread, which runs chunks while it waits: 1 thread
+// updates inline, n threads use a JobSystem with n - 1 workers.
+//***************************************************************************************
+
+#include "FrameArena.h"
+#include "JobSystem.h"
+#include "StreamCopy.h"
+#include "TestUtil.h"
+#include "TransformBatch.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Same values as in TexColumnsApp.cpp.
+	const std::uint32_t gObjectCBChunkSize = 256;
+	const std::uint32_t gNumFrameResources = 3;
+
+	const std::uint32_t gSlotSize = 256;
+
+	// Same layout as in FrameResource.h.
+	struct ObjectConstants
+	{
+		XMFLOAT4X4 World;
+		XMFLOAT4X4 InvWorld;
+		XMFLOAT4X4 TexTransform;
+	};
+
+	struct Object
+	{
+		TransformTRS Transform;
+		XMFLOAT4X4 TexTransform;
+		std::uint32_t ObjCBIndex = 0;
+	};
+
+	std::vector<Object> MakeObjects(std::uint32_t count)
+	{
+		std::vector<Object> objects(count);
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			float f = (float)i;
+			objects[i].Transform = TransformTRS::Make(XMFLOAT3(1.0f + (i % 3), 2.0f, 1.5f), f * 0.01f, f * 0.02f, f * 0.03f, XMFLOAT3(f, -f, 0.5f * f));
+			objects[i].TexTransform = XMFLOAT4X4(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
+			objects[i].ObjCBIndex = i;
+		}
+		return objects;
+	}
+
+	void UpdateChunk(const std::vector<Object>& objects, std::uint32_t begin, std::uint32_t end, LinearArena& arena, unsigned char* slots)
+	{
+		std::uint32_t count = end - begin;
+		ArenaVector<TransformTRS> transforms{ ArenaAllocator<TransformTRS>(arena) };
+		ArenaVector<XMFLOAT4X4> world{ ArenaAllocator<XMFLOAT4X4>(arena) };
+		ArenaVector<XMFLOAT4X4> invWorld{ ArenaAllocator<XMFLOAT4X4>(arena) };
+		ArenaVector<XMFLOAT4X4> texTransform{ ArenaAllocator<XMFLOAT4X4>(arena) };
+		ArenaVector<ObjectConstants> constants{ ArenaAllocator<ObjectConstants>(arena) };
+
+		transforms.reserve(count);
+		texTransform.reserve(count);
+		for(std::uint32_t i = begin; i < end; ++i)
+		{
+			transforms.push_back(objects[i].Transform);
+			texTransform.push_back(objects[i].TexTransform);
+		}
+
+		world.resize(count);
+		invWorld.resize(count);
+		TransformBatch::ExpandTRS(transforms.data(), world.data(), invWorld.data(), count);
+		TransformBatch::Transpose(world.data(), world.data(), count);
+		TransformBatch::Transpose(texTransform.data(), texTransform.data(), count);
+
+		constants.resize(count);
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			constants[i].World = world[i];
+			constants[i].InvWorld = invWorld[i];
+			constants[i].TexTransform = texTransform[i];
+		}
+
+		// Slots are contiguous, as the ObjCBIndex runs are in the app.
+		for(std::uint32_t i = 0; i < count; ++i)
+			StreamCopy(slots + (std::size_t)objects[begin + i].ObjCBIndex * gSlotSize, &constants[i], sizeof(ObjectConstants));
+	}
+
+	// Median milliseconds per frame.
+	double Measure(std::uint32_t threads, std::uint32_t objectCount, std::uint32_t frames)
+	{
+		std::vector<Object> objects = MakeObjects(objectCount);
+		std::unique_ptr<unsigned char[]> slots(new unsigned char[(std::size_t)objectCount * gSlotSize]);
+		FrameArena frameArena(gNumFrameResources, 256 * 1024);
+		std::unique_ptr<JobSystem> jobs;
+		if(threads > 1)
+			jobs = std::make_unique<JobSystem>(threads - 1);
+
+		JobSystem::RangeFunc updateChunk = [&](std::uint32_t begin, std::uint32_t end)
+		{
+			UpdateChunk(objects, begin, end, frameArena.Local(), slots.get());
+		};
+
+		std::vector<double> samples;
+		for(std::uint32_t frame = 0; frame < frames + 2; ++frame)
+		{
+			frameArena.BeginFrame(frame % gNumFrameResources);
+
+			double start = TestUtil::NowSeconds();
+			if(jobs != nullptr)
+			{
+				JobCounter counter;
+				jobs->Dispatch(objectCount, gObjectCBChunkSize, updateChunk, counter);
+				jobs->Wait(counter);
+			}
+			else
+			{
+				for(std::uint32_t begin = 0; begin < objectCount; begin += gObjectCBChunkSize)
+					updateChunk(begin, begin + gObjectCBChunkSize < objectCount ? begin + gObjectCBChunkSize : objectCount);
+			}
+			StreamFence();
+			double elapsed = TestUtil::NowSeconds() - start;
+
+			// The first frames grow the arenas and fault in the slots.
+			if(frame >= 2)
+				samples.push_back(elapsed * 1000.0);
+		}
+		return TestUtil::Median(samples);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::uint32_t maxThreads = std::thread::hardware_concurrency();
+	if(argc > 1)
+		maxThreads = (std::uint32_t)std::strtoul(argv[1], nullptr, 10);
+	if(maxThreads == 0)
+		maxThreads = 1;
+	std::uint32_t frames = argc > 2 ? (std::uint32_t)std::strtoul(argv[2], nullptr, 10) : 20;
+
+	const std::uint32_t objectCounts[] = { 10000, 100000, 1000000 };
+
+	// Powers of two, then the maximum.
+	std::vector<std::uint32_t> threadCounts;
+	for(std::uint32_t threads = 1; threads < maxThreads; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(maxThreads);
+
+	std::printf("%u hardware threads, chunk %u, %u frames, median per frame\n\n",
+		std::thread::hardware_concurrency(), gObjectCBChunkSize, frames);
+	std::printf("%10s %8s %10s %10s %12s\n", "objects", "threads", "ms/frame", "speedup", "Mobjects/s");
+	for(std::uint32_t objectCount : objectCounts)
+	{
+		double baseline = 0.0;
+		for(std::uint32_t threads : threadCounts)
+		{
+			double ms = Measure(threads, objectCount, frames);
+			if(threads == 1)
+				baseline = ms;
+			std::printf("%10u %8u %10.3f %10.2f %12.2f\n", objectCount, threads, ms, baseline / ms, objectCount / ms / 1000.0);
+		}
+	}
+	return 0;
+}
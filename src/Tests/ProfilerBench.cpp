@@ -0,0 +1,115 @@
+//***************************************************************************************
+// ProfilerBench.cpp
+//
+// Cost of PROFILE_ZONE on the calling thread, in ns per zone:
+//   -empty: one zone per loop iteration, nothing inside.
+//   -nested: four zones inside each other per iteration, as in Update -> UpdateObjectCBs
+//    -> ObjectCBChunk; the cost is per zone.
+// Each loop is also built with PROFILER_ENABLED 0 (ProfilerBenchDisabled.cpp), and the
+// difference is what a zone adds.  The parts of a zone are timed on their own too: a
+// zone reads the TSC twice and the allocation counts twice.  Under a hypervisor that
+// traps rdtsc, the TSC reads dominate.
+//
+// Usage: ProfilerBench [repeats]
+//***************************************************************************************
+
+#include "Profiler.h"
+#include "TestUtil.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+namespace ProfilerDisabled
+{
+	void EmptyZones(std::uint32_t count);
+	void NestedZones(std::uint32_t count);
+}
+
+namespace
+{
+	const std::uint32_t gZoneCount = 1 << 20;
+
+	volatile std::uint32_t gSink = 0;
+	volatile std::uint64_t gSink64 = 0;
+
+	void EmptyZones(std::uint32_t count)
+	{
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			PROFILE_ZONE("Empty");
+			gSink = i;
+		}
+	}
+
+	void NestedZones(std::uint32_t count)
+	{
+		for(std::uint32_t i = 0; i < count / 4; ++i)
+		{
+			PROFILE_ZONE("Nested0");
+			{
+				PROFILE_ZONE("Nested1");
+				{
+					PROFILE_ZONE("Nested2");
+					{
+						PROFILE_ZONE("Nested3");
+						gSink = i;
+					}
+				}
+			}
+		}
+	}
+
+	void ReadTicks(std::uint32_t count)
+	{
+		for(std::uint32_t i = 0; i < count; ++i)
+			gSink64 = Profiler::Ticks();
+	}
+
+	void ReadAllocationCounts(std::uint32_t count)
+	{
+		for(std::uint32_t i = 0; i < count; ++i)
+			gSink64 = AllocationTracker::GetThreadCounts().Allocations;
+	}
+
+	// Median ns per item of loop(gZoneCount).
+	double Measure(const std::function<void(std::uint32_t)>& loop, std::uint32_t repeats)
+	{
+		loop(gZoneCount / 16);
+
+		std::vector<double> samples;
+		for(std::uint32_t r = 0; r < repeats; ++r)
+		{
+			double start = TestUtil::NowSeconds();
+			loop(gZoneCount);
+			samples.push_back((TestUtil::NowSeconds() - start) * 1e9 / gZoneCount);
+		}
+		return TestUtil::Median(samples);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::uint32_t repeats = argc > 1 ? (std::uint32_t)std::strtoul(argv[1], nullptr, 10) : 9;
+	if(repeats == 0)
+		repeats = 1;
+
+	std::printf("ns per zone, %u zones per run, median of %u runs, allocation tracking %s\n\n",
+		gZoneCount, repeats, ALLOCATION_TRACKING_ENABLED ? "on" : "off");
+	std::printf("%-10s %10s %10s %10s\n", "zones", "enabled", "disabled", "added");
+
+	double empty = Measure(EmptyZones, repeats);
+	double emptyBaseline = Measure(ProfilerDisabled::EmptyZones, repeats);
+	std::printf("%-10s %10.1f %10.1f %10.1f\n", "empty", empty, emptyBaseline, empty - emptyBaseline);
+
+	double nested = Measure(NestedZones, repeats);
+	double nestedBaseline = Measure(ProfilerDisabled::NestedZones, repeats);
+	std::printf("%-10s %10.1f %10.1f %10.1f\n", "nested", nested, nestedBaseline, nested - nestedBaseline);
+
+	std::printf("\nparts, ns per call\n");
+	std::printf("%-28s %10.1f\n", "Profiler::Ticks (rdtsc)", Measure(ReadTicks, repeats));
+	std::printf("%-28s %10.1f\n", "GetThreadCounts", Measure(ReadAllocationCounts, repeats));
+	std::printf("%-28s %10.1f\n", "MeasureZoneOverheadNs", Profiler::MeasureZoneOverheadNs(gZoneCount));
+	return 0;
+}
@@ -0,0 +1,41 @@
+//***************************************************************************************
+// ProfilerBenchDisabled.cpp
+//
+// The zone loops of ProfilerBench compiled with PROFILER_ENABLED 0, so PROFILE_ZONE
+// expands to nothing.  Timing these gives the cost of the loop itself.
+//***************************************************************************************
+
+#define PROFILER_ENABLED 0
+#include "Profiler.h"
+
+namespace ProfilerDisabled
+{
+	volatile std::uint32_t gSink = 0;
+
+	void EmptyZones(std::uint32_t count)
+	{
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			PROFILE_ZONE("Empty");
+			gSink = i;
+		}
+	}
+
+	void NestedZones(std::uint32_t count)
+	{
+		for(std::uint32_t i = 0; i < count / 4; ++i)
+		{
+			PROFILE_ZONE("Nested0");
+			{
+				PROFILE_ZONE("Nested1");
+				{
+					PROFILE_ZONE("Nested2");
+					{
+						PROFILE_ZONE("Nested3");
+						gSink = i;
+					}
+				}
+			}
+		}
+	}
+}
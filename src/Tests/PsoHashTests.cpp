@@ -0,0 +1,275 @@
+//***************************************************************************************
+// PsoHashTests.cpp
+//
+// HashGraphicsPsoDesc without a device: equal descriptions must hash equally however
+// their shader bytes and input layouts are stored (that is what lets PsoCache share one
+// PSO between equal variants and find it in the pipeline library next run), and every
+// field that changes the PSO must change the hash.  Needs only d3d12.h.
+//***************************************************************************************
+
+#include "PsoHash.h"
+#include "TestUtil.h"
+
+#include <cstring>
+#include <functional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+	// Stand-ins for compiled shaders; only the bytes matter to the hash.
+	const std::vector<char> gVS = { 'v', 's', 0, 1, 2, 3 };
+	const std::vector<char> gPS = { 'p', 's', 4, 5, 6, 7, 8 };
+	const std::uint64_t gRootSignatureHash = 0x1234;
+
+	// Everything one description needs to point at, so two descriptions can use
+	// separate copies of equal data.
+	struct DescStorage
+	{
+		std::vector<char> VS = gVS;
+		std::vector<char> PS = gPS;
+		std::string Position = "POSITION";
+		std::string TexCoord = "TEXCOORD";
+		std::vector<D3D12_INPUT_ELEMENT_DESC> InputLayout;
+	};
+
+	// Sets every field one by one, the way GraphicsPsoBuilder's defaults do, so
+	// struct padding keeps whatever the memory held before.
+	void Fill(D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, DescStorage& storage)
+	{
+		storage.InputLayout.resize(2);
+		for(D3D12_INPUT_ELEMENT_DESC& e : storage.InputLayout)
+		{
+			e.SemanticIndex = 0;
+			e.InputSlot = 0;
+			e.InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
+			e.InstanceDataStepRate = 0;
+		}
+		storage.InputLayout[0].SemanticName = storage.Position.c_str();
+		storage.InputLayout[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+		storage.InputLayout[0].AlignedByteOffset = 0;
+		storage.InputLayout[1].SemanticName = storage.TexCoord.c_str();
+		storage.InputLayout[1].Format = DXGI_FORMAT_R32G32_FLOAT;
+		storage.InputLayout[1].AlignedByteOffset = 12;
+
+		desc.pRootSignature = nullptr;
+		desc.VS.pShaderBytecode = storage.VS.data();
+		desc.VS.BytecodeLength = storage.VS.size();
+		desc.PS.pShaderBytecode = storage.PS.data();
+		desc.PS.BytecodeLength = storage.PS.size();
+		for(D3D12_SHADER_BYTECODE* stage : { &desc.DS, &desc.HS, &desc.GS })
+		{
+			stage->pShaderBytecode = nullptr;
+			stage->BytecodeLength = 0;
+		}
+
+		desc.StreamOutput.pSODeclaration = nullptr;
+		desc.StreamOutput.NumEntries = 0;
+		desc.StreamOutput.pBufferStrides = nullptr;
+		desc.StreamOutput.NumStrides = 0;
+		desc.StreamOutput.RasterizedStream = 0;
+
+		desc.BlendState.AlphaToCoverageEnable = 0;
+		desc.BlendState.IndependentBlendEnable = 0;
+		for(D3D12_RENDER_TARGET_BLEND_DESC& rt : desc.BlendState.RenderTarget)
+		{
+			rt.BlendEnable = 0;
+			rt.LogicOpEnable = 0;
+			rt.SrcBlend = D3D12_BLEND_ONE;
+			rt.DestBlend = D3D12_BLEND_ZERO;
+			rt.BlendOp = D3D12_BLEND_OP_ADD;
+			rt.SrcBlendAlpha = D3D12_BLEND_ONE;
+			rt.DestBlendAlpha = D3D12_BLEND_ZERO;
+			rt.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+			rt.LogicOp = D3D12_LOGIC_OP_NOOP;
+			rt.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+		}
+		desc.SampleMask = 0xffffffffu;
+
+		D3D12_RASTERIZER_DESC& rs = desc.RasterizerState;
+		rs.FillMode = D3D12_FILL_MODE_SOLID;
+		rs.CullMode = D3D12_CULL_MODE_BACK;
+		rs.FrontCounterClockwise = 0;
+		rs.DepthBias = 0;
+		rs.DepthBiasClamp = 0.0f;
+		rs.SlopeScaledDepthBias = 0.0f;
+		rs.DepthClipEnable = 1;
+		rs.MultisampleEnable = 0;
+		rs.AntialiasedLineEnable = 0;
+		rs.ForcedSampleCount = 0;
+		rs.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF;
+
+		D3D12_DEPTH_STENCIL_DESC& ds = desc.DepthStencilState;
+		ds.DepthEnable = 1;
+		ds.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+		ds.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+		ds.StencilEnable = 0;
+		ds.StencilReadMask = 0xff;
+		ds.StencilWriteMask = 0xff;
+		for(D3D12_DEPTH_STENCILOP_DESC* face : { &ds.FrontFace, &ds.BackFace })
+		{
+			face->StencilFailOp = D3D12_STENCIL_OP_KEEP;
+			face->StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
+			face->StencilPassOp = D3D12_STENCIL_OP_KEEP;
+			face->StencilFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+		}
+
+		desc.InputLayout.pInputElementDescs = storage.InputLayout.data();
+		desc.InputLayout.NumElements = (UINT)storage.InputLayout.size();
+		desc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED;
+		desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+		desc.NumRenderTargets = 1;
+		for(DXGI_FORMAT& format : desc.RTVFormats)
+			format = DXGI_FORMAT_UNKNOWN;
+		desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.NodeMask = 0;
+		desc.CachedPSO.pCachedBlob = nullptr;
+		desc.CachedPSO.CachedBlobSizeInBytes = 0;
+		desc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+	}
+
+	// A filled description in memory that held garbage before.
+	struct TestDesc
+	{
+		explicit TestDesc(unsigned char garbage = 0)
+		{
+			std::memset(&Desc, garbage, sizeof(Desc));
+			Fill(Desc, Storage);
+		}
+		TestDesc(const TestDesc&) = delete;
+		TestDesc& operator=(const TestDesc&) = delete;
+
+		std::uint64_t Hash()const { return HashGraphicsPsoDesc(Desc, gRootSignatureHash); }
+
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc;
+		DescStorage Storage;
+	};
+
+	void TestEqualDescriptions()
+	{
+		TestDesc a(0x00);
+		TestDesc b(0xcd);
+
+		// Separate shader and semantic name storage, and different padding bytes.
+		CHECK(a.Desc.VS.pShaderBytecode != b.Desc.VS.pShaderBytecode);
+		CHECK(a.Desc.InputLayout.pInputElementDescs[0].SemanticName != b.Desc.InputLayout.pInputElementDescs[0].SemanticName);
+		CHECK(a.Hash() == b.Hash());
+		CHECK(a.Hash() == HashGraphicsPsoDesc(a.Desc, gRootSignatureHash));
+
+		// The root signature counts by content (its hash), never by pointer, and the
+		// cached blob is not part of the description.
+		b.Desc.pRootSignature = reinterpret_cast<ID3D12RootSignature*>(&b);
+		b.Desc.CachedPSO.pCachedBlob = &b;
+		b.Desc.CachedPSO.CachedBlobSizeInBytes = 16;
+		CHECK(a.Hash() == b.Hash());
+		CHECK(HashGraphicsPsoDesc(a.Desc, gRootSignatureHash + 1) != a.Hash());
+
+		// Render target formats past NumRenderTargets are unused.
+		b.Desc.RTVFormats[3] = DXGI_FORMAT_B8G8R8A8_UNORM;
+		CHECK(a.Hash() == b.Hash());
+	}
+
+	void TestEveryFieldCounts()
+	{
+		using Mutation = std::function<void(TestDesc&)>;
+		const std::pair<const char*, Mutation> mutations[] = {
+			{ "VS bytes", [](TestDesc& t) { t.Storage.VS[3] ^= 1; } },
+			{ "VS length", [](TestDesc& t) { t.Desc.VS.BytecodeLength -= 1; } },
+			{ "VS moved to GS", [](TestDesc& t) { t.Desc.GS = t.Desc.VS; t.Desc.VS = D3D12_SHADER_BYTECODE{ nullptr, 0 }; } },
+			{ "HS added", [](TestDesc& t) { t.Desc.HS = t.Desc.PS; } },
+			{ "fill mode", [](TestDesc& t) { t.Desc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME; } },
+			{ "cull mode", [](TestDesc& t) { t.Desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE; } },
+			{ "depth bias", [](TestDesc& t) { t.Desc.RasterizerState.SlopeScaledDepthBias = 1.0f; } },
+			{ "depth func", [](TestDesc& t) { t.Desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL; } },
+			{ "back face stencil", [](TestDesc& t) { t.Desc.DepthStencilState.BackFace.StencilPassOp = D3D12_STENCIL_OP_REPLACE; } },
+			{ "blend", [](TestDesc& t) { t.Desc.BlendState.RenderTarget[0].BlendEnable = 1; t.Desc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA; } },
+			{ "write mask", [](TestDesc& t) { t.Desc.BlendState.RenderTarget[0].RenderTargetWriteMask = 0x7; } },
+			{ "sample mask", [](TestDesc& t) { t.Desc.SampleMask = 1; } },
+			{ "semantic name", [](TestDesc& t) { t.Storage.TexCoord[0] = 'X'; } },
+			{ "element format", [](TestDesc& t) { t.Storage.InputLayout[1].Format = DXGI_FORMAT_R32G32B32_FLOAT; } },
+			{ "per instance", [](TestDesc& t) { t.Storage.InputLayout[1].InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA; } },
+			{ "element count", [](TestDesc& t) { t.Desc.InputLayout.NumElements = 1; } },
+			{ "topology", [](TestDesc& t) { t.Desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH; } },
+			{ "RTV format", [](TestDesc& t) { t.Desc.RTVFormats[0] = DXGI_FORMAT_B8G8R8A8_UNORM; } },
+			{ "render targets", [](TestDesc& t) { t.Desc.NumRenderTargets = 2; } },
+			{ "DSV format", [](TestDesc& t) { t.Desc.DSVFormat = DXGI_FORMAT_UNKNOWN; } },
+			{ "MSAA", [](TestDesc& t) { t.Desc.SampleDesc.Count = 4; } },
+			{ "node mask", [](TestDesc& t) { t.Desc.NodeMask = 1; } },
+		};
+
+		TestDesc base;
+		std::unordered_set<std::uint64_t> hashes = { base.Hash() };
+		for(const auto& mutation : mutations)
+		{
+			TestDesc changed;
+			mutation.second(changed);
+			if(!hashes.insert(changed.Hash()).second)
+			{
+				std::printf("no new hash for: %s\n", mutation.first);
+				CHECK(false);
+			}
+		}
+	}
+
+	void TestStreamOutput()
+	{
+		const std::string semantic = "SV_Position";
+		D3D12_SO_DECLARATION_ENTRY entry = { 0, semantic.c_str(), 0, 0, 4, 0 };
+		const UINT stride = 16;
+
+		TestDesc a;
+		a.Desc.StreamOutput = D3D12_STREAM_OUTPUT_DESC{ &entry, 1, &stride, 1, 0 };
+		std::uint64_t withEntry = a.Hash();
+		CHECK(withEntry != TestDesc().Hash());
+
+		// Followed by content, not by the entry's address.
+		D3D12_SO_DECLARATION_ENTRY copy = entry;
+		const std::string semanticCopy = semantic;
+		copy.SemanticName = semanticCopy.c_str();
+		UINT strideCopy = stride;
+		TestDesc b;
+		b.Desc.StreamOutput = D3D12_STREAM_OUTPUT_DESC{ &copy, 1, &strideCopy, 1, 0 };
+		CHECK(b.Hash() == withEntry);
+
+		copy.ComponentCount = 3;
+		CHECK(b.Hash() != withEntry);
+	}
+
+	// PsoCache keys its PSOs by this hash: the solid and wireframe variants of a few
+	// passes, each requested from two independently built descriptions, must come to
+	// one entry per distinct PSO.
+	void TestDedup()
+	{
+		std::unordered_set<std::uint64_t> psos;
+		int requests = 0;
+		for(int copy = 0; copy < 2; ++copy)
+		{
+			for(D3D12_FILL_MODE fill : { D3D12_FILL_MODE_SOLID, D3D12_FILL_MODE_WIREFRAME })
+			{
+				for(D3D12_PRIMITIVE_TOPOLOGY_TYPE topology : { D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE, D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH })
+				{
+					TestDesc t((unsigned char)(copy * 0x55));
+					t.Desc.RasterizerState.FillMode = fill;
+					t.Desc.PrimitiveTopologyType = topology;
+					psos.insert(t.Hash());
+					requests++;
+				}
+			}
+		}
+		CHECK(requests == 8);
+		CHECK(psos.size() == 4);
+	}
+}
+
+int main()
+{
+	TestEqualDescriptions();
+	TestEveryFieldCounts();
+	TestStreamOutput();
+	TestDedup();
+	return TestResult();
+}
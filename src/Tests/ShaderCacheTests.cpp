@@ -0,0 +1,181 @@
+//***************************************************************************************
+// ShaderCacheTests.cpp
+//
+// ShaderCache without a shader compiler: include expansion, which inputs change the
+// key (so a stale blob is never reused), and that damaged cache files are misses.
+// Shader sources and cache files are written under ShaderCacheTests.tmp in the
+// working directory, which is cleared at the start of each run.
+//***************************************************************************************
+
+#include "ShaderCache.h"
+#include "TestUtil.h"
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	const fs::path gRoot = "ShaderCacheTests.tmp";
+
+	void WriteText(const fs::path& file, const std::string& text)
+	{
+		fs::create_directories(file.parent_path());
+		std::ofstream fout(file, std::ios::binary | std::ios::trunc);
+		fout << text;
+	}
+
+	std::string Expand(const fs::path& file)
+	{
+		std::string out;
+		CHECK(ShaderCache::ExpandIncludes(file, out));
+		return out;
+	}
+
+	std::uint64_t KeyOf(const fs::path& file)
+	{
+		return ShaderCache::MakeKey(Expand(file), "PS", "ps_5_1", {}, 0);
+	}
+
+	void TestFnv1a()
+	{
+		// Reference values of 64-bit FNV-1a.
+		CHECK(ShaderCache::Fnv1a("", 0) == 0xcbf29ce484222325ull);
+		CHECK(ShaderCache::Fnv1a("a", 1) == 0xaf63dc4c8601ec8cull);
+		CHECK(ShaderCache::Fnv1a("foobar", 6) == 0x85944171f73967e8ull);
+
+		// Hashing in pieces is the same as hashing at once.
+		CHECK(ShaderCache::Fnv1a("bar", 3, ShaderCache::Fnv1a("foo", 3)) == ShaderCache::Fnv1a("foobar", 6));
+	}
+
+	void TestExpandIncludes()
+	{
+		const fs::path dir = gRoot / "expand";
+		WriteText(dir / "main.hlsl", "#include \"common.hlsl\"\n  #  include <sub/light.hlsl>\nmain\n#include \"missing.hlsl\"\n");
+		WriteText(dir / "common.hlsl", "common\n#include \"main.hlsl\"\n");
+		WriteText(dir / "sub/light.hlsl", "light\n#include \"util.hlsl\"\n");
+		WriteText(dir / "sub/util.hlsl", "util\n");
+
+		// Nested includes resolve relative to the including file, a cycle back to main
+		// is cut, and an include that cannot be opened is left for the compiler.
+		CHECK(Expand(dir / "main.hlsl") == "common\nlight\nutil\nmain\n#include \"missing.hlsl\"\n");
+
+		std::string out = "kept";
+		CHECK(!ShaderCache::ExpandIncludes(dir / "nope.hlsl", out));
+		CHECK(out == "kept");
+	}
+
+	void TestKeyInvalidation()
+	{
+		const fs::path dir = gRoot / "keys";
+		WriteText(dir / "main.hlsl", "#include \"common.hlsl\"\nfloat4 PS() : SV_Target { return Color(); }\n");
+		WriteText(dir / "common.hlsl", "float4 Color() { return 1; }\n");
+
+		const std::uint64_t key = KeyOf(dir / "main.hlsl");
+		CHECK(KeyOf(dir / "main.hlsl") == key);
+
+		// Editing only the included file must give a new key.
+		WriteText(dir / "common.hlsl", "float4 Color() { return 0.5; }\n");
+		const std::uint64_t editedKey = KeyOf(dir / "main.hlsl");
+		CHECK(editedKey != key);
+		WriteText(dir / "common.hlsl", "float4 Color() { return 1; }\n");
+		CHECK(KeyOf(dir / "main.hlsl") == key);
+
+		const std::string source = Expand(dir / "main.hlsl");
+		const std::vector<ShaderDefine> alphaTest = { { "ALPHA_TEST", "1" } };
+		std::vector<std::uint64_t> keys = {
+			ShaderCache::MakeKey(source, "PS", "ps_5_1", {}, 0),
+			ShaderCache::MakeKey(source, "VS", "ps_5_1", {}, 0),
+			ShaderCache::MakeKey(source, "PS", "ps_5_0", {}, 0),
+			ShaderCache::MakeKey(source, "PS", "ps_5_1", {}, 1),
+			ShaderCache::MakeKey(source, "PS", "ps_5_1", alphaTest, 0),
+			ShaderCache::MakeKey(source, "PS", "ps_5_1", { { "ALPHA_TEST", "0" } }, 0),
+			ShaderCache::MakeKey(source, "PS", "ps_5_1", { { "ALPHA_TEST", "1" }, { "FOG", "1" } }, 0),
+			// Order matters: a later define of the same name wins in the compiler.
+			ShaderCache::MakeKey(source, "PS", "ps_5_1", { { "FOG", "1" }, { "ALPHA_TEST", "1" } }, 0),
+			// Moving characters between fields must not collide.
+			ShaderCache::MakeKey(source, "PSp", "s_5_1", {}, 0),
+			ShaderCache::MakeKey(source, "PS", "ps_5_1", { { "ALPHA_TEST1", "" } }, 0),
+		};
+
+		bool distinct = true;
+		for(std::size_t i = 0; i < keys.size(); ++i)
+		{
+			for(std::size_t j = i + 1; j < keys.size(); ++j)
+				distinct = distinct && keys[i] != keys[j];
+		}
+		CHECK(distinct);
+		CHECK(keys[0] == key);
+		CHECK(ShaderCache::MakeKey(source, "PS", "ps_5_1", alphaTest, 0) == keys[4]);
+	}
+
+	void TestLoadStore()
+	{
+		ShaderCache cache(gRoot / "cache");
+		const std::uint64_t key = 0x0123456789abcdefull;
+		const char payload[] = "compiled shader bytes";
+		std::vector<char> blob;
+
+		CHECK(!cache.Load(key, blob));
+		CHECK(cache.Store(key, payload, sizeof(payload)));
+		CHECK(cache.PathFor(key).filename() == "0123456789abcdef.cso");
+		CHECK(!fs::exists(fs::path(cache.PathFor(key)) += ".tmp"));
+		CHECK(cache.Load(key, blob));
+		CHECK(blob.size() == sizeof(payload) && std::memcmp(blob.data(), payload, sizeof(payload)) == 0);
+
+		// Storing again replaces the entry.
+		const char newPayload[] = "recompiled";
+		CHECK(cache.Store(key, newPayload, sizeof(newPayload)));
+		CHECK(cache.Load(key, blob));
+		CHECK(blob.size() == sizeof(newPayload) && std::memcmp(blob.data(), newPayload, sizeof(newPayload)) == 0);
+
+		// A flipped payload byte fails the payload hash.
+		{
+			std::fstream f(cache.PathFor(key), std::ios::in | std::ios::out | std::ios::binary);
+			f.seekp(-1, std::ios::end);
+			f.put('X');
+		}
+		CHECK(!cache.Load(key, blob));
+
+		// A file stored under one key and found under another is a miss.
+		const std::uint64_t otherKey = key + 1;
+		CHECK(cache.Store(key, payload, sizeof(payload)));
+		fs::copy_file(cache.PathFor(key), cache.PathFor(otherKey), fs::copy_options::overwrite_existing);
+		CHECK(!cache.Load(otherKey, blob));
+
+		// Another format version is a miss.  The version follows the 4 byte magic.
+		{
+			std::fstream f(cache.PathFor(key), std::ios::in | std::ios::out | std::ios::binary);
+			f.seekp(4);
+			f.put((char)(ShaderCache::FormatVersion + 1));
+		}
+		CHECK(!cache.Load(key, blob));
+
+		// Truncated files, in the header or in the payload, are misses.
+		CHECK(cache.Store(key, payload, sizeof(payload)));
+		const std::uintmax_t fullSize = fs::file_size(cache.PathFor(key));
+		fs::resize_file(cache.PathFor(key), fullSize - 1);
+		CHECK(!cache.Load(key, blob));
+		fs::resize_file(cache.PathFor(key), 10);
+		CHECK(!cache.Load(key, blob));
+
+		// An empty blob is a valid entry.
+		CHECK(cache.Store(key, payload, 0));
+		CHECK(cache.Load(key, blob) && blob.empty());
+	}
+}
+
+int main()
+{
+	std::error_code ec;
+	fs::remove_all(gRoot, ec);
+
+	TestFnv1a();
+	TestExpandIncludes();
+	TestKeyInvalidation();
+	TestLoadStore();
+	return TestResult();
+}
@@ -0,0 +1,209 @@
+//***************************************************************************************
+// ShaderPermutationTests.cpp
+//
+// ShaderPermutationKey and its builder, SelectShaderPermutation at the edges of each
+// rule, and ReachableShaderPermutations against random selections: every key the app
+// can bind must be one of the variants built at load.
+//***************************************************************************************
+
+#include "ShaderPermutation.h"
+#include "TestUtil.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::string DefineValue(const ShaderPermutationKey& key, const std::string& name)
+	{
+		for(const auto& d : key.Defines())
+		{
+			if(d.Name == name)
+				return d.Value;
+		}
+		return "<missing>";
+	}
+
+	void TestKey()
+	{
+		ShaderPermutationKey empty;
+		CHECK(empty.Pack() == 0);
+		CHECK(empty.Name() == "base_d0p0s0");
+
+		ShaderPermutationKey key = ShaderPermutationKeyBuilder()
+			.Tessellation()
+			.Decal()
+			.NormalMap()
+			.Lights(1, 2, 3)
+			.Build();
+		CHECK(key.Has(ShaderFeatureTessellation) && key.Has(ShaderFeatureDecal) && key.Has(ShaderFeatureNormalMap));
+		CHECK(key.Pack() == (0x07u | 1u << 8 | 2u << 16 | 3u << 24));
+		CHECK(key.Name() == "tess+decal+nmap_d1p2s3");
+
+		// Every switch is spelled out, so an unset define never falls back to the
+		// shader's default.
+		CHECK(key.Defines().size() == 6);
+		CHECK(DefineValue(key, "TESSELLATION") == "1");
+		CHECK(DefineValue(key, "NUM_SPOT_LIGHTS") == "3");
+		CHECK(DefineValue(empty, "NORMAL_MAP") == "0");
+		CHECK(DefineValue(empty, "NUM_POINT_LIGHTS") == "0");
+
+		// Features can be cleared again, and the builder starts from the empty key.
+		ShaderPermutationKey cleared = ShaderPermutationKeyBuilder().Decal().NormalMap().Decal(false).Build();
+		CHECK(cleared.Features == ShaderFeatureNormalMap);
+		CHECK(cleared.Name() == "nmap_d0p0s0");
+
+		// Light counts saturate in the packed form.
+		ShaderPermutationKey many = ShaderPermutationKeyBuilder().Lights(300, 0, 0).Build();
+		CHECK(many.Pack() == 255u << 8);
+
+		CHECK(key == key);
+		CHECK(key != empty);
+		CHECK(empty < key);
+	}
+
+	void TestMerge()
+	{
+		ShaderPermutationKey a = ShaderPermutationKeyBuilder().Decal().Lights(1, 0, 2).Build();
+		ShaderPermutationKey b = ShaderPermutationKeyBuilder().NormalMap().Lights(0, 3, 1).Build();
+		ShaderPermutationKey merged = ShaderPermutationKey::Merge(a, b);
+		CHECK(merged == ShaderPermutationKeyBuilder().Decal().NormalMap().Lights(1, 3, 2).Build());
+		CHECK(ShaderPermutationKey::Merge(b, a) == merged);
+		CHECK(ShaderPermutationKey::Merge(a, ShaderPermutationKey()) == a);
+	}
+
+	PermutationSceneInfo Scene(std::uint32_t numPoint, std::uint32_t numSpot)
+	{
+		PermutationSceneInfo scene;
+		scene.NumDirLights = 1;
+		scene.NumPointLights = numPoint;
+		scene.NumSpotLights = numSpot;
+		scene.DecalReach = 10.0f;
+		scene.TessellationDistance = 50.0f;
+		return scene;
+	}
+
+	void TestSelection()
+	{
+		const PermutationSceneInfo scene = Scene(3, 0);
+
+		PermutationItemInfo item;
+		item.Radius = 2.0f;
+
+		// Decal: the item's bounds must come within DecalReach of the decal.
+		item.DistanceToDecal = 11.9f;
+		CHECK(SelectShaderPermutation(item, scene).Has(ShaderFeatureDecal));
+		item.DistanceToDecal = 12.0f;
+		CHECK(!SelectShaderPermutation(item, scene).Has(ShaderFeatureDecal));
+
+		// Tessellation: only near the eye, and only with the decal.
+		item.DistanceToDecal = 0.0f;
+		item.DistanceToEye = 51.9f;
+		CHECK(SelectShaderPermutation(item, scene).Has(ShaderFeatureTessellation));
+		item.DistanceToEye = 52.0f;
+		CHECK(!SelectShaderPermutation(item, scene).Has(ShaderFeatureTessellation));
+		item.DistanceToEye = 0.0f;
+		item.DistanceToDecal = 100.0f;
+		CHECK(!SelectShaderPermutation(item, scene).Has(ShaderFeatureTessellation));
+
+		// The normal map comes from the item's material.
+		CHECK(SelectShaderPermutation(item, scene).Has(ShaderFeatureNormalMap));
+		item.HasNormalMap = false;
+		CHECK(!SelectShaderPermutation(item, scene).Has(ShaderFeatureNormalMap));
+
+		// Point lights are dropped from the end only: light 1 reaching the item keeps
+		// lights 0 and 1.  Mask bits past the scene's lights are ignored.
+		item.PointLightMask = 0;
+		CHECK(SelectShaderPermutation(item, scene).NumPointLights == 0);
+		item.PointLightMask = 0x2;
+		CHECK(SelectShaderPermutation(item, scene).NumPointLights == 2);
+		item.PointLightMask = 0xf0;
+		CHECK(SelectShaderPermutation(item, scene).NumPointLights == 0);
+		item.PointLightMask = ~0u;
+		CHECK(SelectShaderPermutation(item, scene).NumPointLights == 3);
+
+		// With spot lights after them in the light array, no point light is dropped.
+		item.PointLightMask = 0;
+		ShaderPermutationKey withSpots = SelectShaderPermutation(item, Scene(3, 1));
+		CHECK(withSpots.NumPointLights == 3);
+		CHECK(withSpots.NumDirLights == 1 && withSpots.NumSpotLights == 1);
+	}
+
+	bool Contains(const std::vector<ShaderPermutationKey>& keys, const ShaderPermutationKey& key)
+	{
+		return std::binary_search(keys.begin(), keys.end(), key);
+	}
+
+	void TestReachable()
+	{
+		// Three stage combinations (none, decal, decal + tessellation) per normal map
+		// setting per point light count.
+		CHECK(ReachableShaderPermutations(Scene(3, 0), true, true).size() == 2 * 3 * 4);
+		CHECK(ReachableShaderPermutations(Scene(3, 0), true, false).size() == 3 * 4);
+		CHECK(ReachableShaderPermutations(Scene(3, 2), true, true).size() == 2 * 3);
+		CHECK(ReachableShaderPermutations(Scene(3, 0), false, false).empty());
+
+		std::vector<ShaderPermutationKey> sorted = ReachableShaderPermutations(Scene(2, 0), true, true);
+		CHECK(std::is_sorted(sorted.begin(), sorted.end()));
+		CHECK(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+
+		std::uint64_t seed = 99;
+		auto next = [&seed](float lo, float hi)
+		{
+			seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+			return lo + (hi - lo) * (float)(seed >> 40) / (float)(1ull << 24);
+		};
+
+		const std::uint32_t pointCounts[] = { 0, 1, 3 };
+		const std::uint32_t spotCounts[] = { 0, 2 };
+		for(std::uint32_t numPoint : pointCounts)
+		{
+			for(std::uint32_t numSpot : spotCounts)
+			{
+				for(int normalMaps = 1; normalMaps < 4; ++normalMaps)
+				{
+					bool withNormalMap = (normalMaps & 1) != 0;
+					bool withoutNormalMap = (normalMaps & 2) != 0;
+					std::vector<ShaderPermutationKey> reachable = ReachableShaderPermutations(Scene(numPoint, numSpot), withNormalMap, withoutNormalMap);
+
+					// Random items, and batches merged from them as instancing does.
+					bool allReachable = true;
+					for(int batch = 0; batch < 200; ++batch)
+					{
+						PermutationSceneInfo scene = Scene(numPoint, numSpot);
+						scene.DecalReach = next(0.0f, 20.0f);
+						scene.TessellationDistance = next(0.0f, 100.0f);
+
+						ShaderPermutationKey merged;
+						for(int i = 0; i < 8; ++i)
+						{
+							PermutationItemInfo item;
+							item.Radius = next(0.0f, 5.0f);
+							item.DistanceToEye = next(0.0f, 120.0f);
+							item.DistanceToDecal = next(0.0f, 40.0f);
+							item.HasNormalMap = withNormalMap && (!withoutNormalMap || next(0.0f, 1.0f) < 0.5f);
+							item.PointLightMask = (std::uint32_t)(seed >> 32);
+
+							ShaderPermutationKey key = SelectShaderPermutation(item, scene);
+							allReachable = allReachable && Contains(reachable, key);
+							merged = i == 0 ? key : ShaderPermutationKey::Merge(merged, key);
+						}
+						allReachable = allReachable && Contains(reachable, merged);
+					}
+					CHECK(allReachable);
+				}
+			}
+		}
+	}
+}
+
+int main()
+{
+	TestKey();
+	TestMerge();
+	TestSelection();
+	TestReachable();
+	return TestResult();
+}
@@ -0,0 +1,69 @@
+//***************************************************************************************
+// TestUtil.h
+//
+// Just enough support for the headless tests and benchmarks in this directory:
+//   -CHECK(expr) reports a failed expression with its location and keeps going, so one
+//    run shows every failure.  A test's main() returns TestResult().
+//   -Timing and median helpers for the benchmarks.
+//***************************************************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace TestUtil
+{
+	inline int& FailureCount()
+	{
+		static int count = 0;
+		return count;
+	}
+
+	inline double NowSeconds()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Sorts samples.
+	inline double Median(std::vector<double>& samples)
+	{
+		if(samples.empty())
+			return 0.0;
+		std::sort(samples.begin(), samples.end());
+		return samples[samples.size() / 2];
+	}
+
+	// Sorts samples.  p in [0, 1].
+	inline double Percentile(std::vector<double>& samples, double p)
+	{
+		if(samples.empty())
+			return 0.0;
+		std::sort(samples.begin(), samples.end());
+		std::size_t index = (std::size_t)(p * (samples.size() - 1) + 0.5);
+		return samples[index];
+	}
+}
+
+#define CHECK(expr) \
+	do \
+	{ \
+		if(!(expr)) \
+		{ \
+			std::fprintf(stderr, "%s(%d): CHECK failed: %s\n", __FILE__, __LINE__, #expr); \
+			TestUtil::FailureCount()++; \
+		} \
+	} while(0)
+
+inline int TestResult()
+{
+	if(TestUtil::FailureCount() != 0)
+	{
+		std::fprintf(stderr, "%d check(s) failed\n", TestUtil::FailureCount());
+		return 1;
+	}
+	std::printf("all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,429 @@
+//***************************************************************************************
+// TraceExporterTests.cpp
+//
+// TraceExporter::WriteJson on hand-made zones, without the profiler or a writer
+// thread: the output must parse as JSON, name every track once, escape zone and
+// thread names, and write ts/dur as microseconds with the nanoseconds as exactly
+// three decimals.  A minimal strict parser below keeps the number text as written so
+// the formatting itself can be checked.
+//***************************************************************************************
+
+#include "TraceExporter.h"
+#include "TestUtil.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct JsonValue
+	{
+		enum class Type { Null, Bool, Number, String, Array, Object };
+
+		Type Kind = Type::Null;
+		bool Bool = false;
+		std::string Text;   // string contents, or a number as written
+		std::vector<JsonValue> Items;
+		std::vector<std::pair<std::string, JsonValue>> Members;
+
+		const JsonValue* Find(const std::string& key)const
+		{
+			for(const auto& member : Members)
+			{
+				if(member.first == key)
+					return &member.second;
+			}
+			return nullptr;
+		}
+	};
+
+	// Recursive descent over RFC 8259 JSON; any error makes Parse() return false.
+	class JsonParser
+	{
+	public:
+		explicit JsonParser(const std::string& text) :
+			mText(text)
+		{
+		}
+
+		bool Parse(JsonValue& value)
+		{
+			if(!ParseValue(value))
+				return false;
+			SkipSpace();
+			return mPos == mText.size();
+		}
+
+	private:
+		void SkipSpace()
+		{
+			while(mPos < mText.size() && (mText[mPos] == ' ' || mText[mPos] == '\n' || mText[mPos] == '\r' || mText[mPos] == '\t'))
+				mPos++;
+		}
+
+		bool Consume(const char* literal)
+		{
+			std::size_t length = std::char_traits<char>::length(literal);
+			if(mText.compare(mPos, length, literal) != 0)
+				return false;
+			mPos += length;
+			return true;
+		}
+
+		bool ParseValue(JsonValue& value)
+		{
+			SkipSpace();
+			if(mPos >= mText.size())
+				return false;
+
+			char c = mText[mPos];
+			if(c == '{')
+				return ParseObject(value);
+			if(c == '[')
+				return ParseArray(value);
+			if(c == '"')
+			{
+				value.Kind = JsonValue::Type::String;
+				return ParseString(value.Text);
+			}
+			if(c == '-' || (c >= '0' && c <= '9'))
+				return ParseNumber(value);
+			if(Consume("true") || Consume("false"))
+			{
+				value.Kind = JsonValue::Type::Bool;
+				value.Bool = c == 't';
+				return true;
+			}
+			value.Kind = JsonValue::Type::Null;
+			return Consume("null");
+		}
+
+		bool ParseObject(JsonValue& value)
+		{
+			value.Kind = JsonValue::Type::Object;
+			mPos++;
+			SkipSpace();
+			if(Consume("}"))
+				return true;
+			for(;;)
+			{
+				SkipSpace();
+				std::string key;
+				if(mPos >= mText.size() || mText[mPos] != '"' || !ParseString(key))
+					return false;
+				SkipSpace();
+				if(!Consume(":"))
+					return false;
+				JsonValue member;
+				if(!ParseValue(member))
+					return false;
+				value.Members.emplace_back(key, member);
+				SkipSpace();
+				if(Consume("}"))
+					return true;
+				if(!Consume(","))
+					return false;
+			}
+		}
+
+		bool ParseArray(JsonValue& value)
+		{
+			value.Kind = JsonValue::Type::Array;
+			mPos++;
+			SkipSpace();
+			if(Consume("]"))
+				return true;
+			for(;;)
+			{
+				JsonValue item;
+				if(!ParseValue(item))
+					return false;
+				value.Items.push_back(item);
+				SkipSpace();
+				if(Consume("]"))
+					return true;
+				if(!Consume(","))
+					return false;
+			}
+		}
+
+		bool ParseString(std::string& out)
+		{
+			mPos++;
+			while(mPos < mText.size())
+			{
+				char c = mText[mPos++];
+				if(c == '"')
+					return true;
+				if((unsigned char)c < 0x20)
+					return false;
+				if(c != '\\')
+				{
+					out += c;
+					continue;
+				}
+				if(mPos >= mText.size())
+					return false;
+				char e = mText[mPos++];
+				switch(e)
+				{
+				case '"': out += '"'; break;
+				case '\\': out += '\\'; break;
+				case '/': out += '/'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u':
+				{
+					if(mPos + 4 > mText.size())
+						return false;
+					// Only ASCII is needed here.
+					unsigned long code = std::strtoul(mText.substr(mPos, 4).c_str(), nullptr, 16);
+					out += (char)code;
+					mPos += 4;
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+			return false;
+		}
+
+		bool ParseNumber(JsonValue& value)
+		{
+			std::size_t start = mPos;
+			if(mText[mPos] == '-')
+				mPos++;
+			if(mPos >= mText.size() || !IsDigit(mText[mPos]))
+				return false;
+			if(mText[mPos] == '0')
+				mPos++;
+			else
+				SkipDigits();
+			if(mPos < mText.size() && mText[mPos] == '.')
+			{
+				mPos++;
+				if(mPos >= mText.size() || !IsDigit(mText[mPos]))
+					return false;
+				SkipDigits();
+			}
+			if(mPos < mText.size() && (mText[mPos] == 'e' || mText[mPos] == 'E'))
+			{
+				mPos++;
+				if(mPos < mText.size() && (mText[mPos] == '+' || mText[mPos] == '-'))
+					mPos++;
+				if(mPos >= mText.size() || !IsDigit(mText[mPos]))
+					return false;
+				SkipDigits();
+			}
+			value.Kind = JsonValue::Type::Number;
+			value.Text = mText.substr(start, mPos - start);
+			return true;
+		}
+
+		static bool IsDigit(char c)
+		{
+			return c >= '0' && c <= '9';
+		}
+
+		void SkipDigits()
+		{
+			while(mPos < mText.size() && IsDigit(mText[mPos]))
+				mPos++;
+		}
+
+		const std::string& mText;
+		std::size_t mPos = 0;
+	};
+
+	ProfileZone MakeZone(const char* name, std::uint32_t thread, std::uint64_t startNs, std::uint64_t endNs, std::uint32_t depth)
+	{
+		ProfileZone zone;
+		zone.Name = name;
+		zone.ThreadIndex = thread;
+		zone.StartNs = startNs;
+		zone.EndNs = endNs;
+		zone.Depth = depth;
+		return zone;
+	}
+
+	std::string NumberText(const JsonValue& event, const char* key)
+	{
+		const JsonValue* value = event.Find(key);
+		return value != nullptr && value->Kind == JsonValue::Type::Number ? value->Text : std::string("<missing>");
+	}
+
+	std::string StringText(const JsonValue& event, const char* key)
+	{
+		const JsonValue* value = event.Find(key);
+		return value != nullptr && value->Kind == JsonValue::Type::String ? value->Text : std::string("<missing>");
+	}
+
+	void TestWriteJson()
+	{
+		const char* oddName = "Draw \"opaque\" C:\\pass";
+
+		std::vector<ProfileZone> zones;
+		zones.push_back(MakeZone("Frame", 0, 1000000, 17667001, 0));
+		zones.push_back(MakeZone(oddName, 0, 1234567, 1234572, 1));
+		zones.push_back(MakeZone("Job", 1, 5000000001, 5000001000, 0));
+		zones.back().Allocations = 3;
+		zones.back().AllocatedBytes = 96;
+
+		std::vector<std::string> threadNames = { "Main", "Worker \"1\"\\x" };
+		std::vector<std::uint64_t> frameStarts = { 1000000, 17667001 };
+
+		std::vector<CounterFrame> counterFrames(2);
+		for(std::size_t f = 0; f < counterFrames.size(); ++f)
+		{
+			counterFrames[f].Frame = f;
+			counterFrames[f].StartNs = frameStarts[f];
+			for(int i = 0; i < CounterCount; ++i)
+				counterFrames[f].Values[i] = f * 100 + i;
+		}
+
+		std::ostringstream out;
+		TraceExporter::WriteJson(out, zones, threadNames, frameStarts, counterFrames);
+		std::string text = out.str();
+
+		JsonValue root;
+		JsonParser parser(text);
+		CHECK(parser.Parse(root));
+		CHECK(root.Kind == JsonValue::Type::Object);
+		CHECK(StringText(root, "displayTimeUnit") == "ns");
+		const JsonValue* events = root.Find("traceEvents");
+		CHECK(events != nullptr && events->Kind == JsonValue::Type::Array);
+		if(events == nullptr)
+			return;
+
+		std::map<std::string, std::uint32_t> threadNameByTid;
+		std::uint32_t threadNameEvents = 0;
+		std::vector<const JsonValue*> slices;
+		std::vector<const JsonValue*> frames;
+		std::uint32_t counterEvents = 0;
+		bool countersOk = true;
+		for(const JsonValue& event : events->Items)
+		{
+			std::string name = StringText(event, "name");
+			std::string ph = StringText(event, "ph");
+			if(ph == "M" && name == "thread_name")
+			{
+				threadNameEvents++;
+				std::string tid = NumberText(event, "tid");
+				const JsonValue* args = event.Find("args");
+				std::string trackName = args != nullptr ? StringText(*args, "name") : std::string();
+				std::uint32_t index = (std::uint32_t)std::strtoul(tid.c_str(), nullptr, 10);
+				CHECK(index < threadNames.size() && trackName == threadNames[index]);
+				threadNameByTid[tid]++;
+			}
+			else if(ph == "X")
+				slices.push_back(&event);
+			else if(ph == "i")
+				frames.push_back(&event);
+			else if(ph == "C")
+			{
+				// Each counter is set at its frame's start to that frame's value.
+				counterEvents++;
+				const JsonValue* args = event.Find("args");
+				std::string ts = NumberText(event, "ts");
+				std::size_t f = ts == "1000.000" ? 0 : ts == "17667.001" ? 1 : 2;
+				bool found = false;
+				for(int i = 0; f < 2 && i < CounterCount; ++i)
+				{
+					if(name == Counters::GetInfo((CounterId)i).Name)
+					{
+						found = args != nullptr && NumberText(*args, "value") == std::to_string(counterFrames[f].Values[i]);
+						break;
+					}
+				}
+				countersOk = countersOk && found;
+			}
+		}
+
+		// One thread_name per track, for every track.
+		CHECK(threadNameEvents == threadNames.size());
+		CHECK(threadNameByTid.size() == threadNames.size());
+		for(const auto& entry : threadNameByTid)
+			CHECK(entry.second == 1);
+
+		CHECK(counterEvents == counterFrames.size() * CounterCount);
+		CHECK(countersOk);
+
+		CHECK(frames.size() == 2);
+		if(frames.size() == 2)
+		{
+			CHECK(NumberText(*frames[0], "ts") == "1000.000");
+			CHECK(NumberText(*frames[1], "ts") == "17667.001");
+		}
+
+		// Names round-trip through the escaping; times are us with three decimals.
+		CHECK(slices.size() == zones.size());
+		if(slices.size() == zones.size())
+		{
+			CHECK(StringText(*slices[0], "name") == "Frame");
+			CHECK(NumberText(*slices[0], "ts") == "1000.000");
+			CHECK(NumberText(*slices[0], "dur") == "16667.001");
+			CHECK(slices[0]->Find("args") == nullptr);
+
+			CHECK(StringText(*slices[1], "name") == oddName);
+			CHECK(NumberText(*slices[1], "tid") == "0");
+			CHECK(NumberText(*slices[1], "ts") == "1234.567");
+			CHECK(NumberText(*slices[1], "dur") == "0.005");
+
+			CHECK(NumberText(*slices[2], "tid") == "1");
+			CHECK(NumberText(*slices[2], "ts") == "5000000.001");
+			CHECK(NumberText(*slices[2], "dur") == "0.999");
+			const JsonValue* args = slices[2]->Find("args");
+			CHECK(args != nullptr && NumberText(*args, "allocations") == "3" && NumberText(*args, "allocated_bytes") == "96");
+		}
+	}
+
+	void TestEmpty()
+	{
+		std::ostringstream out;
+		TraceExporter::WriteJson(out, {}, {}, {}, {});
+
+		JsonValue root;
+		std::string text = out.str();
+		JsonParser parser(text);
+		CHECK(parser.Parse(root));
+		const JsonValue* events = root.Find("traceEvents");
+		CHECK(events != nullptr && events->Kind == JsonValue::Type::Array && events->Items.empty());
+	}
+
+	void TestParserRejects()
+	{
+		// The parser must catch what WriteJson could get wrong.
+		const char* bad[] = {
+			"{\"a\":[1,2,]}",
+			"{\"a\":\"x\"y\"}",
+			"{\"a\":\"\\q\"}",
+			"{\"a\":01}",
+			"{\"a\":1.}",
+			"{\"a\":1}}",
+			"{\"a\" 1}",
+		};
+		for(const char* text : bad)
+		{
+			std::string s = text;
+			JsonValue root;
+			JsonParser parser(s);
+			CHECK(!parser.Parse(root));
+		}
+	}
+}
+
+int main()
+{
+	TestParserRejects();
+	TestEmpty();
+	TestWriteJson();
+	return TestResult();
+}
@@ -0,0 +1,138 @@
+//***************************************************************************************
+// TransformBatchBench.cpp
+//
+// Single-thread throughput of each TransformBatch kernel on each path, in millions of
+// matrices per second per core, next to the one-at-a-time DirectXMath code the kernels
+// replace.  Batches of 4096 matrices (256 KB per array) stay in L2 on most CPUs, so
+// this measures arithmetic rather than memory bandwidth.
+//
+// Usage: TransformBatchBench [repeats]
+//***************************************************************************************
+
+#include "TestUtil.h"
+#include "TransformBatch.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const std::size_t gBatchSize = 4096;
+
+	// Median millions of matrices per second.
+	double Measure(const std::function<void()>& kernel, std::uint32_t repeats)
+	{
+		const std::uint32_t iterations = 50;
+		kernel();
+
+		std::vector<double> samples;
+		for(std::uint32_t r = 0; r < repeats; ++r)
+		{
+			double start = TestUtil::NowSeconds();
+			for(std::uint32_t i = 0; i < iterations; ++i)
+				kernel();
+			double elapsed = TestUtil::NowSeconds() - start;
+			samples.push_back(gBatchSize * iterations / elapsed / 1e6);
+		}
+		return TestUtil::Median(samples);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::uint32_t repeats = argc > 1 ? (std::uint32_t)std::strtoul(argv[1], nullptr, 10) : 9;
+	if(repeats == 0)
+		repeats = 1;
+
+	std::vector<TransformTRS> trs(gBatchSize);
+	std::vector<XMFLOAT4X4> a(gBatchSize);
+	std::vector<XMFLOAT4X4> b(gBatchSize);
+	std::vector<XMFLOAT4X4> dst(gBatchSize);
+	std::vector<XMFLOAT4X4> dst2(gBatchSize);
+	for(std::size_t i = 0; i < gBatchSize; ++i)
+	{
+		float f = (float)i;
+		trs[i] = TransformTRS::Make(XMFLOAT3(1.0f + f * 0.001f, 2.0f, 0.5f), f * 0.01f, f * 0.02f, f * 0.03f, XMFLOAT3(f, -f, 1.0f));
+	}
+	TransformBatch::ExpandTRS(trs.data(), a.data(), dst.data(), gBatchSize);
+	TransformBatch::ExpandTRS(trs.data(), b.data(), dst.data(), gBatchSize);
+
+	std::printf("Mmatrices/s on one core, batches of %zu, median of %u\n\n", gBatchSize, repeats);
+	std::printf("%-24s %10s %10s %10s %12s\n", "kernel", "scalar", "SSE", "AVX2", "DirectXMath");
+
+	struct Kernel
+	{
+		const char* Name;
+		std::function<void()> Batch;
+		std::function<void()> Reference;
+	};
+
+	Kernel kernels[] = {
+		{ "Transpose",
+			[&]() { TransformBatch::Transpose(a.data(), dst.data(), gBatchSize); },
+			[&]()
+			{
+				for(std::size_t i = 0; i < gBatchSize; ++i)
+					XMStoreFloat4x4(&dst[i], XMMatrixTranspose(XMLoadFloat4x4(&a[i])));
+			} },
+		{ "AffineInverseTranspose",
+			[&]() { TransformBatch::AffineInverseTranspose(a.data(), dst.data(), gBatchSize); },
+			[&]()
+			{
+				for(std::size_t i = 0; i < gBatchSize; ++i)
+				{
+					XMMATRIX m = XMLoadFloat4x4(&a[i]);
+					m.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+					XMStoreFloat4x4(&dst[i], XMMatrixTranspose(XMMatrixInverse(nullptr, m)));
+				}
+			} },
+		{ "Compose",
+			[&]() { TransformBatch::Compose(a.data(), b.data(), dst.data(), gBatchSize); },
+			[&]()
+			{
+				for(std::size_t i = 0; i < gBatchSize; ++i)
+					XMStoreFloat4x4(&dst[i], XMMatrixMultiply(XMLoadFloat4x4(&a[i]), XMLoadFloat4x4(&b[i])));
+			} },
+		{ "ExpandTRS",
+			[&]() { TransformBatch::ExpandTRS(trs.data(), dst.data(), dst2.data(), gBatchSize); },
+			[&]()
+			{
+				// What UpdateObjectCBs did before: compose S*R*T, then a full inverse.
+				for(std::size_t i = 0; i < gBatchSize; ++i)
+				{
+					const TransformTRS& t = trs[i];
+					XMMATRIX world = XMMatrixMultiply(XMMatrixMultiply(
+						XMMatrixScaling(t.Scale.x, t.Scale.y, t.Scale.z),
+						XMMatrixRotationQuaternion(XMLoadFloat4(&t.Rotation))),
+						XMMatrixTranslation(t.Translation.x, t.Translation.y, t.Translation.z));
+					XMStoreFloat4x4(&dst[i], world);
+					world.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+					XMStoreFloat4x4(&dst2[i], XMMatrixTranspose(XMMatrixInverse(nullptr, world)));
+				}
+			} },
+	};
+
+	const TransformBatch::Path detected = TransformBatch::GetPath();
+	const TransformBatch::Path paths[] = { TransformBatch::Path::Scalar, TransformBatch::Path::SSE, TransformBatch::Path::AVX2 };
+	for(const Kernel& kernel : kernels)
+	{
+		std::printf("%-24s", kernel.Name);
+		for(TransformBatch::Path path : paths)
+		{
+			if((int)path > (int)detected)
+			{
+				std::printf(" %10s", "-");
+				continue;
+			}
+			TransformBatch::ForcePath(path);
+			std::printf(" %10.1f", Measure(kernel.Batch, repeats));
+		}
+		std::printf(" %12.1f\n", Measure(kernel.Reference, repeats));
+	}
+	TransformBatch::ForcePath(detected);
+	return 0;
+}
@@ -0,0 +1,212 @@
+//***************************************************************************************
+// TransformBatchTests.cpp
+//
+// Every TransformBatch kernel against plain DirectXMath (XMMatrixInverse,
+// XMMatrixMultiply, XMMatrixTranspose), on each path the CPU supports.  Batch sizes
+// cover the SIMD blocks and every length of scalar tail, and sources are also passed
+// as their own destinations.
+//***************************************************************************************
+
+#include "TestUtil.h"
+#include "TransformBatch.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Deterministic, so a failure reproduces.
+	class Random
+	{
+	public:
+		float Next(float lo, float hi)
+		{
+			mState = mState * 6364136223846793005ull + 1442695040888963407ull;
+			float unit = (float)(mState >> 40) / (float)(1ull << 24);
+			return lo + (hi - lo) * unit;
+		}
+
+	private:
+		std::uint64_t mState = 12345;
+	};
+
+	TransformTRS RandomTRS(Random& random)
+	{
+		return TransformTRS::Make(
+			XMFLOAT3(random.Next(0.2f, 5.0f), random.Next(0.2f, 5.0f), random.Next(0.2f, 5.0f)),
+			random.Next(-3.1f, 3.1f), random.Next(-3.1f, 3.1f), random.Next(-3.1f, 3.1f),
+			XMFLOAT3(random.Next(-100.0f, 100.0f), random.Next(-100.0f, 100.0f), random.Next(-100.0f, 100.0f)));
+	}
+
+	XMMATRIX WorldOf(const TransformTRS& t)
+	{
+		return XMMatrixMultiply(XMMatrixMultiply(
+			XMMatrixScaling(t.Scale.x, t.Scale.y, t.Scale.z),
+			XMMatrixRotationQuaternion(XMLoadFloat4(&t.Rotation))),
+			XMMatrixTranslation(t.Translation.x, t.Translation.y, t.Translation.z));
+	}
+
+	// Same as MathHelper::InverseTranspose.
+	XMMATRIX InverseTransposeOf(XMMATRIX m)
+	{
+		m.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+		return XMMatrixTranspose(XMMatrixInverse(nullptr, m));
+	}
+
+	std::vector<XMFLOAT4X4> RandomAffine(Random& random, std::size_t count)
+	{
+		std::vector<XMFLOAT4X4> matrices(count);
+		for(auto& m : matrices)
+			XMStoreFloat4x4(&m, WorldOf(RandomTRS(random)));
+		return matrices;
+	}
+
+	bool Near(const XMFLOAT4X4& a, const XMMATRIX& expected)
+	{
+		XMFLOAT4X4 b;
+		XMStoreFloat4x4(&b, expected);
+		for(int r = 0; r < 4; ++r)
+		{
+			for(int c = 0; c < 4; ++c)
+			{
+				float tolerance = 1e-4f * std::fmax(1.0f, std::fabs(b.m[r][c]));
+				if(!(std::fabs(a.m[r][c] - b.m[r][c]) <= tolerance))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	const std::size_t gCounts[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 12, 15, 16, 17, 23, 1000 };
+
+	void TestTranspose(Random& random)
+	{
+		for(std::size_t count : gCounts)
+		{
+			std::vector<XMFLOAT4X4> src = RandomAffine(random, count);
+			std::vector<XMFLOAT4X4> dst(count);
+			TransformBatch::Transpose(src.data(), dst.data(), count);
+
+			bool ok = true;
+			for(std::size_t i = 0; i < count; ++i)
+				ok = ok && Near(dst[i], XMMatrixTranspose(XMLoadFloat4x4(&src[i])));
+			CHECK(ok);
+
+			TransformBatch::Transpose(dst.data(), dst.data(), count);
+			for(std::size_t i = 0; i < count; ++i)
+				ok = ok && Near(dst[i], XMLoadFloat4x4(&src[i]));
+			CHECK(ok);
+		}
+	}
+
+	void TestAffineInverseTranspose(Random& random)
+	{
+		for(std::size_t count : gCounts)
+		{
+			std::vector<XMFLOAT4X4> src = RandomAffine(random, count);
+			std::vector<XMFLOAT4X4> dst(count);
+			TransformBatch::AffineInverseTranspose(src.data(), dst.data(), count);
+
+			bool ok = true;
+			for(std::size_t i = 0; i < count; ++i)
+				ok = ok && Near(dst[i], InverseTransposeOf(XMLoadFloat4x4(&src[i])));
+			CHECK(ok);
+
+			std::vector<XMFLOAT4X4> inPlace = src;
+			TransformBatch::AffineInverseTranspose(inPlace.data(), inPlace.data(), count);
+			for(std::size_t i = 0; i < count; ++i)
+				ok = ok && Near(inPlace[i], InverseTransposeOf(XMLoadFloat4x4(&src[i])));
+			CHECK(ok);
+		}
+	}
+
+	void TestCompose(Random& random)
+	{
+		for(std::size_t count : gCounts)
+		{
+			std::vector<XMFLOAT4X4> a = RandomAffine(random, count);
+			std::vector<XMFLOAT4X4> b = RandomAffine(random, count);
+			std::vector<XMFLOAT4X4> dst(count);
+			TransformBatch::Compose(a.data(), b.data(), dst.data(), count);
+
+			bool ok = true;
+			for(std::size_t i = 0; i < count; ++i)
+				ok = ok && Near(dst[i], XMMatrixMultiply(XMLoadFloat4x4(&a[i]), XMLoadFloat4x4(&b[i])));
+			CHECK(ok);
+
+			std::vector<XMFLOAT4X4> intoA = a;
+			TransformBatch::Compose(intoA.data(), b.data(), intoA.data(), count);
+			std::vector<XMFLOAT4X4> intoB = b;
+			TransformBatch::Compose(a.data(), intoB.data(), intoB.data(), count);
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				XMMATRIX expected = XMMatrixMultiply(XMLoadFloat4x4(&a[i]), XMLoadFloat4x4(&b[i]));
+				ok = ok && Near(intoA[i], expected) && Near(intoB[i], expected);
+			}
+			CHECK(ok);
+		}
+	}
+
+	void TestExpandTRS(Random& random)
+	{
+		for(std::size_t count : gCounts)
+		{
+			std::vector<TransformTRS> src(count);
+			for(auto& t : src)
+				t = RandomTRS(random);
+			std::vector<XMFLOAT4X4> world(count);
+			std::vector<XMFLOAT4X4> invWorld(count);
+			TransformBatch::ExpandTRS(src.data(), world.data(), invWorld.data(), count);
+
+			bool ok = true;
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				XMMATRIX expected = WorldOf(src[i]);
+				ok = ok && Near(world[i], expected) && Near(invWorld[i], InverseTransposeOf(expected));
+			}
+			CHECK(ok);
+
+			// Same result as the generic kernel on the expanded matrix.
+			std::vector<XMFLOAT4X4> generic(count);
+			TransformBatch::AffineInverseTranspose(world.data(), generic.data(), count);
+			for(std::size_t i = 0; i < count; ++i)
+				ok = ok && Near(invWorld[i], XMLoadFloat4x4(&generic[i]));
+			CHECK(ok);
+		}
+	}
+}
+
+int main()
+{
+	const TransformBatch::Path detected = TransformBatch::GetPath();
+	const TransformBatch::Path paths[] = { TransformBatch::Path::Scalar, TransformBatch::Path::SSE, TransformBatch::Path::AVX2 };
+	const char* names[] = { "scalar", "SSE", "AVX2" };
+
+	for(int p = 0; p < 3; ++p)
+	{
+		if((int)paths[p] > (int)detected)
+		{
+			std::printf("%s: not supported by this CPU, skipped\n", names[p]);
+			continue;
+		}
+
+		TransformBatch::ForcePath(paths[p]);
+		CHECK(TransformBatch::GetPath() == paths[p]);
+		std::printf("%s\n", names[p]);
+
+		Random random;
+		TestTranspose(random);
+		TestAffineInverseTranspose(random);
+		TestCompose(random);
+		TestExpandTRS(random);
+	}
+
+	// Wider than the CPU supports is clamped.
+	TransformBatch::ForcePath(TransformBatch::Path::AVX2);
+	CHECK(TransformBatch::GetPath() == detected);
+
+	return TestResult();
+}